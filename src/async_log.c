@@ -0,0 +1,219 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file async_log.c
+@brief Log assíncrono dos caminhos quentes do componente (DNS, HTTP, loop do gerenciador)
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include "log_ring.h"
+#include "async_log.h"
+
+
+/* @brief intervalo entre duas passagens da tarefa de escoamento */
+#define ASYNC_LOG_DRAIN_PERIOD_MS			100
+
+static struct log_ring_t async_log_ring;
+
+/* @brief serializa os consumidores: a tarefa de escoamento e GET /logs */
+static SemaphoreHandle_t async_log_consumer_mutex = NULL;
+
+/* @brief registro retirado que não coube no último async_log_read_text */
+static struct log_ring_record_t async_log_pending;
+static bool async_log_has_pending = false;
+
+static TaskHandle_t async_log_task_handle = NULL;
+static volatile bool async_log_stop_requested = false;
+static volatile bool async_log_started = false;
+
+/* @brief linha formatada pela tarefa de escoamento */
+static char async_log_line[160];
+
+
+/**
+ * @brief Envia ao console tudo o que está no buffer. Quem chama tem o mutex dos consumidores.
+ */
+static void async_log_drain(){
+
+	struct log_ring_record_t record;
+
+	if(async_log_has_pending){
+		log_ring_format(&async_log_pending, async_log_line, sizeof(async_log_line));
+		esp_log_write((esp_log_level_t)async_log_pending.level, async_log_pending.tag, "%s\n", async_log_line);
+		async_log_has_pending = false;
+	}
+
+	while(log_ring_pop(&async_log_ring, &record)){
+		/* uma linha longa demais sai com o formato cru, sem os argumentos */
+		if(log_ring_format(&record, async_log_line, sizeof(async_log_line)) >= sizeof(async_log_line)){
+			async_log_line[0] = '\0';
+			strncpy(async_log_line, record.format, sizeof(async_log_line) - 1);
+			async_log_line[sizeof(async_log_line) - 1] = '\0';
+		}
+		esp_log_write((esp_log_level_t)record.level, record.tag, "%s\n", async_log_line);
+	}
+}
+
+static void async_log_task(void *pvParameters){
+
+	while(!async_log_stop_requested){
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ASYNC_LOG_DRAIN_PERIOD_MS));
+
+		xSemaphoreTake(async_log_consumer_mutex, portMAX_DELAY);
+		async_log_drain();
+		xSemaphoreGive(async_log_consumer_mutex);
+	}
+
+	async_log_task_handle = NULL;
+	vTaskDelete(NULL);
+}
+
+esp_err_t async_log_start(uint16_t depth, struct log_ring_cell_t *cells, bool drain_to_uart, const struct task_config_t *task){
+
+	static StaticSemaphore_t consumer_mutex_buffer;
+
+	if(async_log_started) return ESP_OK;
+
+	if(cells){
+		async_log_consumer_mutex = xSemaphoreCreateMutexStatic(&consumer_mutex_buffer);
+		if(!log_ring_init_static(&async_log_ring, cells, depth)) return ESP_ERR_INVALID_ARG;
+	}
+	else{
+		async_log_consumer_mutex = xSemaphoreCreateMutex();
+		if(async_log_consumer_mutex == NULL || !log_ring_init(&async_log_ring, depth)){
+			return ESP_ERR_NO_MEM;
+		}
+	}
+	async_log_has_pending = false;
+	async_log_stop_requested = false;
+
+	if(drain_to_uart && task_config_create(task, &async_log_task, "async_log", NULL, &async_log_task_handle) != pdPASS){
+		return ESP_FAIL;
+	}
+
+	async_log_started = true;
+
+	return ESP_OK;
+}
+
+TaskHandle_t async_log_get_task(){
+	return async_log_task_handle;
+}
+
+void async_log_stop(){
+
+	if(!async_log_started) return;
+	async_log_started = false;
+
+	if(async_log_task_handle != NULL){
+		async_log_stop_requested = true;
+		xTaskNotifyGive(async_log_task_handle);
+		while(async_log_task_handle != NULL){
+			vTaskDelay(1);
+		}
+	}
+
+	xSemaphoreTake(async_log_consumer_mutex, portMAX_DELAY);
+	async_log_drain();
+	log_ring_free(&async_log_ring);
+	xSemaphoreGive(async_log_consumer_mutex);
+
+	vSemaphoreDelete(async_log_consumer_mutex);
+	async_log_consumer_mutex = NULL;
+}
+
+void async_log_write(log_subsystem_t subsystem, esp_log_level_t level, const char *tag, const char *format, ...){
+
+	va_list args;
+
+	va_start(args, format);
+	if(async_log_started){
+		log_ring_vwrite(&async_log_ring, subsystem, (uint8_t)level, (uint32_t)(esp_timer_get_time() / 1000), tag, format, args);
+	}
+	else{
+		/* uma única escrita, com o prefixo do esp_log: linhas de tarefas diferentes não se misturam */
+		static const char levels[] = "NEWIDV";
+		char line[128];
+		vsnprintf(line, sizeof(line), format, args);
+		esp_log_write(level, tag, "%c (%u) %s: %s\n", level <= ESP_LOG_VERBOSE ? levels[level] : '?', (unsigned)esp_log_timestamp(), tag, line);
+	}
+	va_end(args);
+}
+
+size_t async_log_read_text(char *buf, size_t len){
+
+	size_t pos = 0;
+
+	if(!async_log_started || len == 0) return 0;
+
+	xSemaphoreTake(async_log_consumer_mutex, portMAX_DELAY);
+
+	buf[0] = '\0';
+	for(;;){
+		if(!async_log_has_pending){
+			if(!log_ring_pop(&async_log_ring, &async_log_pending)) break;
+			async_log_has_pending = true;
+		}
+
+		/* linha + '\n' + terminador */
+		size_t sz = log_ring_format(&async_log_pending, NULL, 0);
+		if(pos + sz + 2 > len){
+			if(pos == 0){
+				/* não cabe nem sozinha: é descartada para não travar a leitura */
+				async_log_has_pending = false;
+				continue;
+			}
+			break;
+		}
+		log_ring_format(&async_log_pending, buf + pos, len - pos);
+		pos += sz;
+		buf[pos++] = '\n';
+		buf[pos] = '\0';
+		async_log_has_pending = false;
+	}
+
+	xSemaphoreGive(async_log_consumer_mutex);
+
+	return pos;
+}
+
+void async_log_set_level(log_subsystem_t subsystem, esp_log_level_t level){
+	log_ring_set_level(&async_log_ring, subsystem, (uint8_t)level);
+}
+
+void async_log_set_sampling(log_subsystem_t subsystem, uint16_t one_in){
+	log_ring_set_sampling(&async_log_ring, subsystem, one_in);
+}
+
+void async_log_get_stats(struct log_ring_stats_t *stats){
+	log_ring_get_stats(&async_log_ring, stats);
+}
@@ -0,0 +1,99 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file async_log.h
+@brief Log assíncrono dos caminhos quentes do componente (DNS, HTTP, loop do gerenciador)
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_ASYNC_LOG_H_INCLUDED
+#define WIFI_MANAGER_ASYNC_LOG_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h> /* para UBaseType_t */
+#include <esp_err.h>
+#include <esp_log.h>
+#include "log_ring.h"
+#include "task_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Cria o buffer e, se drain_to_uart, a tarefa que formata e envia os registros ao console a cada 100 ms.
+ * Sem a tarefa, os registros ficam no buffer até serem lidos com async_log_read_text (GET /logs).
+ * @param cells depth células de quem chama, ou NULL para alocar. Com cells, o mutex também não vem do heap.
+ */
+esp_err_t async_log_start(uint16_t depth, struct log_ring_cell_t *cells, bool drain_to_uart, const struct task_config_t *task);
+
+/**
+ * @brief A tarefa de escoamento, ou NULL se ela não estiver rodando.
+ */
+TaskHandle_t async_log_get_task();
+
+/**
+ * @brief Envia ao console o que restou no buffer, para a tarefa e libera a memória.
+ * Os produtores (DNS, HTTP, wifi_manager) já devem estar parados.
+ */
+void async_log_stop();
+
+/**
+ * @brief Grava um registro sem formatar a mensagem e sem bloquear. Antes de async_log_start, escreve direto no console.
+ *
+ * O formato deve ser uma string literal. Conversões suportadas: %d %i %u %x %X %o %c %p, com flags, largura e precisão
+ * numéricas e modificadores h, l, ll, z, j e t (os valores são guardados em 32 bits), e no máximo um %s, guardado
+ * truncado em LOG_RING_STR_SIZE - 1 caracteres. Largura ou precisão com '*' e conversões de ponto flutuante não são
+ * suportadas: o registro sai com o formato cru, sem nenhum argumento.
+ */
+void async_log_write(log_subsystem_t subsystem, esp_log_level_t level, const char *tag, const char *format, ...) __attribute__((format(printf, 4, 5)));
+
+/**
+ * @brief Retira e formata registros, uma linha por registro, enquanto couberem em buf.
+ * @return o número de bytes escritos, sem o terminador. 0 quando o buffer de log está vazio.
+ */
+size_t async_log_read_text(char *buf, size_t len);
+
+/**
+ * @brief Nível máximo gravado para um subsistema. O padrão é ESP_LOG_INFO. Vale a partir de async_log_start.
+ */
+void async_log_set_level(log_subsystem_t subsystem, esp_log_level_t level);
+
+/**
+ * @brief Mantém apenas 1 em cada one_in registros INFO ou mais detalhados do subsistema. 1 desativa a amostragem.
+ * Vale a partir de async_log_start.
+ */
+void async_log_set_sampling(log_subsystem_t subsystem, uint16_t one_in);
+
+void async_log_get_stats(struct log_ring_stats_t *stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_ASYNC_LOG_H_INCLUDED */
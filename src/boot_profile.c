@@ -0,0 +1,100 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file boot_profile.c
+@brief Marcadores de fase do boot até o primeiro IP, exportáveis como trace JSON do Chrome
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include "text_writer.h"
+#include "boot_profile.h"
+
+
+void boot_profile_init(struct boot_profile_t *profile){
+	memset(profile, 0x00, sizeof(struct boot_profile_t));
+}
+
+int boot_profile_begin(struct boot_profile_t *profile, const char *name, uint8_t track, int64_t now_us){
+
+	if(profile->count >= BOOT_PROFILE_MAX_PHASES){
+		if(profile->dropped < UINT8_MAX) profile->dropped++;
+		return -1;
+	}
+
+	struct boot_phase_t *p = &profile->phases[profile->count];
+	p->name = name;
+	p->start_us = now_us;
+	p->end_us = -1;
+	p->track = track;
+
+	return profile->count++;
+}
+
+void boot_profile_end(struct boot_profile_t *profile, int idx, int64_t now_us){
+	if(idx >= 0 && idx < profile->count){
+		profile->phases[idx].end_us = now_us;
+	}
+}
+
+void boot_profile_mark(struct boot_profile_t *profile, const char *name, uint8_t track, int64_t now_us){
+	boot_profile_end(profile, boot_profile_begin(profile, name, track, now_us), now_us);
+}
+
+
+size_t boot_profile_to_chrome_trace(const struct boot_profile_t *profile, const char *const *track_names, size_t track_count, int64_t now_us, char *buf, size_t len){
+
+	size_t pos = 0;
+	const char *sep = "";
+
+	text_append(buf, len, &pos, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%u},\"traceEvents\":[", (unsigned)profile->dropped);
+
+	/* nomes das linhas */
+	for(size_t t=0; track_names && t<track_count; t++){
+		if(track_names[t] == NULL) continue;
+		text_append(buf, len, &pos, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+				sep, (unsigned)t, track_names[t]);
+		sep = ",";
+	}
+
+	for(uint8_t i=0; i<profile->count; i++){
+		const struct boot_phase_t *p = &profile->phases[i];
+		int64_t end = p->end_us < 0 ? now_us : p->end_us;
+
+		if(end == p->start_us){
+			text_append(buf, len, &pos, "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"p\",\"ts\":%lld,\"pid\":1,\"tid\":%u}",
+					sep, p->name, (long long)p->start_us, (unsigned)p->track);
+		}
+		else{
+			text_append(buf, len, &pos, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%u%s}",
+					sep, p->name, (long long)p->start_us, (long long)(end - p->start_us), (unsigned)p->track,
+					p->end_us < 0 ? ",\"args\":{\"open\":true}" : "");
+		}
+		sep = ",";
+	}
+
+	text_append(buf, len, &pos, "]}");
+
+	return text_finish(buf, len, pos);
+}
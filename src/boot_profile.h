@@ -0,0 +1,94 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file boot_profile.h
+@brief Marcadores de fase do boot até o primeiro IP, exportáveis como trace JSON do Chrome
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_BOOT_PROFILE_H_INCLUDED
+#define WIFI_MANAGER_BOOT_PROFILE_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** @brief número máximo de fases: as fases além disso são descartadas e contadas */
+#define BOOT_PROFILE_MAX_PHASES				32
+
+
+/**
+ * @brief Um intervalo de tempo com nome. end_us < 0 enquanto a fase não terminou; end_us == start_us para um marcador instantâneo.
+ */
+struct boot_phase_t{
+	const char *name;		/* deve ser uma string estática */
+	int64_t start_us;
+	int64_t end_us;
+	uint8_t track;			/* linha do trace: a tarefa ou o fluxo em que a fase ocorre */
+};
+
+struct boot_profile_t{
+	struct boot_phase_t phases[BOOT_PROFILE_MAX_PHASES];
+	uint8_t count;
+	uint8_t dropped;
+};
+
+
+void boot_profile_init(struct boot_profile_t *profile);
+
+/**
+ * @brief Abre uma fase. Não é protegido: quem chama serializa os acessos.
+ * @return o índice da fase, para boot_profile_end, ou -1 se o perfil estiver cheio.
+ */
+int boot_profile_begin(struct boot_profile_t *profile, const char *name, uint8_t track, int64_t now_us);
+
+/**
+ * @brief Fecha a fase aberta por boot_profile_begin. Um índice negativo é ignorado.
+ */
+void boot_profile_end(struct boot_profile_t *profile, int idx, int64_t now_us);
+
+/**
+ * @brief Acrescenta um marcador instantâneo.
+ */
+void boot_profile_mark(struct boot_profile_t *profile, const char *name, uint8_t track, int64_t now_us);
+
+/**
+ * @brief Serializa o perfil no formato JSON de trace do Chrome (chrome://tracing, ui.perfetto.dev).
+ * Cada fase vira um evento completo ("X"), cada marcador um evento instantâneo ("i"), e cada linha uma "thread".
+ * As fases ainda abertas terminam em now_us.
+ * @param track_names nome de cada linha, indexado pelo número da linha; NULL para usar o número.
+ * @return o tamanho do JSON, sem o terminador. Nada é escrito se buf for NULL ou menor que esse tamanho + 1.
+ */
+size_t boot_profile_to_chrome_trace(const struct boot_profile_t *profile, const char *const *track_names, size_t track_count, int64_t now_us, char *buf, size_t len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_BOOT_PROFILE_H_INCLUDED */
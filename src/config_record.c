@@ -0,0 +1,201 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file config_record.c
+@brief Registro único, versionado e protegido por CRC com toda a configuração do wifi_manager
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "config_record.h"
+
+
+/* @brief "WMCR" */
+#define CONFIG_RECORD_MAGIC					0x52434D57UL
+
+
+/**
+ * @brief Cursor de escrita e leitura. Uma operação fora dos limites marca o cursor como inválido.
+ */
+struct config_record_cursor_t{
+	uint8_t *buf;
+	size_t len;
+	size_t pos;
+	int overflow;
+};
+
+static void cursor_put(struct config_record_cursor_t *c, const void *data, size_t n){
+	if(c->overflow || c->pos + n > c->len){
+		c->overflow = 1;
+		return;
+	}
+	memcpy(c->buf + c->pos, data, n);
+	c->pos += n;
+}
+
+static void cursor_put_uint(struct config_record_cursor_t *c, uint64_t v, size_t n){
+	uint8_t b[8];
+	for(size_t i=0; i<n; i++){
+		b[i] = (uint8_t)(v >> (8 * i));
+	}
+	cursor_put(c, b, n);
+}
+
+static void cursor_get(struct config_record_cursor_t *c, void *data, size_t n){
+	if(c->overflow || c->pos + n > c->len){
+		c->overflow = 1;
+		return;
+	}
+	memcpy(data, c->buf + c->pos, n);
+	c->pos += n;
+}
+
+static uint64_t cursor_get_uint(struct config_record_cursor_t *c, size_t n){
+	uint8_t b[8];
+	uint64_t v = 0;
+	cursor_get(c, b, n);
+	if(c->overflow) return 0;
+	for(size_t i=0; i<n; i++){
+		v |= (uint64_t)b[i] << (8 * i);
+	}
+	return v;
+}
+
+uint32_t config_record_crc32(uint32_t crc, const uint8_t *data, size_t len){
+	crc = ~crc;
+	while(len--){
+		crc ^= *data++;
+		for(int k=0; k<8; k++){
+			crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+		}
+	}
+	return ~crc;
+}
+
+size_t config_record_encode(const struct config_record_t *record, uint8_t *buf, size_t len){
+
+	struct config_record_cursor_t c = { buf, len, CONFIG_RECORD_HEADER_SIZE, 0 };
+	uint8_t count = record->profile_count > CONFIG_RECORD_MAX_PROFILES ? CONFIG_RECORD_MAX_PROFILES : record->profile_count;
+
+	if(len < CONFIG_RECORD_HEADER_SIZE) return 0;
+
+	/* versão 1 */
+	cursor_put(&c, record->sta_ssid, CONFIG_RECORD_SSID_SIZE);
+	cursor_put(&c, record->sta_password, CONFIG_RECORD_PASSWORD_SIZE);
+	cursor_put(&c, record->ap_ssid, CONFIG_RECORD_SSID_SIZE);
+	cursor_put(&c, record->ap_pwd, CONFIG_RECORD_PASSWORD_SIZE);
+	cursor_put_uint(&c, record->ap_channel, 1);
+	cursor_put_uint(&c, record->ap_ssid_hidden, 1);
+	cursor_put_uint(&c, record->ap_bandwidth, 1);
+	cursor_put_uint(&c, record->sta_only, 1);
+	cursor_put_uint(&c, record->sta_power_save, 1);
+	cursor_put_uint(&c, record->sta_static_ip, 1);
+	cursor_put_uint(&c, record->sta_ip, 4);
+	cursor_put_uint(&c, record->sta_netmask, 4);
+	cursor_put_uint(&c, record->sta_gw, 4);
+	cursor_put_uint(&c, count, 1);
+	for(uint8_t i=0; i<count; i++){
+		const struct config_record_profile_t *p = &record->profiles[i];
+		cursor_put(&c, p->ssid, CONFIG_RECORD_SSID_SIZE);
+		cursor_put(&c, p->password, CONFIG_RECORD_PASSWORD_SIZE);
+		cursor_put_uint(&c, (uint64_t)p->last_success, 8);
+		cursor_put_uint(&c, p->failures, 2);
+		cursor_put_uint(&c, p->avg_latency_ms, 2);
+	}
+
+	/* novos campos de versões futuras entram aqui */
+
+	if(c.overflow) return 0;
+
+	size_t payload = c.pos - CONFIG_RECORD_HEADER_SIZE;
+	struct config_record_cursor_t h = { buf, CONFIG_RECORD_HEADER_SIZE, 0, 0 };
+	cursor_put_uint(&h, CONFIG_RECORD_MAGIC, 4);
+	cursor_put_uint(&h, CONFIG_RECORD_VERSION, 2);
+	cursor_put_uint(&h, payload, 2);
+	cursor_put_uint(&h, config_record_crc32(0, buf + CONFIG_RECORD_HEADER_SIZE, payload), 4);
+
+	return c.pos;
+}
+
+config_record_err_t config_record_decode(const uint8_t *buf, size_t len, struct config_record_t *record){
+
+	struct config_record_t tmp;
+	struct config_record_cursor_t h = { (uint8_t*)buf, len, 0, 0 };
+
+	uint32_t magic = (uint32_t)cursor_get_uint(&h, 4);
+	uint16_t version = (uint16_t)cursor_get_uint(&h, 2);
+	uint16_t payload = (uint16_t)cursor_get_uint(&h, 2);
+	uint32_t crc = (uint32_t)cursor_get_uint(&h, 4);
+
+	if(h.overflow) return CONFIG_RECORD_ERR_LENGTH;
+	if(magic != CONFIG_RECORD_MAGIC) return CONFIG_RECORD_ERR_MAGIC;
+	if(version == 0) return CONFIG_RECORD_ERR_VERSION;
+	if(CONFIG_RECORD_HEADER_SIZE + (size_t)payload > len) return CONFIG_RECORD_ERR_LENGTH;
+	if(config_record_crc32(0, buf + CONFIG_RECORD_HEADER_SIZE, payload) != crc) return CONFIG_RECORD_ERR_CRC;
+
+	struct config_record_cursor_t c = { (uint8_t*)buf + CONFIG_RECORD_HEADER_SIZE, payload, 0, 0 };
+	memset(&tmp, 0x00, sizeof(tmp));
+
+	/* versão 1 */
+	cursor_get(&c, tmp.sta_ssid, CONFIG_RECORD_SSID_SIZE);
+	cursor_get(&c, tmp.sta_password, CONFIG_RECORD_PASSWORD_SIZE);
+	cursor_get(&c, tmp.ap_ssid, CONFIG_RECORD_SSID_SIZE);
+	cursor_get(&c, tmp.ap_pwd, CONFIG_RECORD_PASSWORD_SIZE);
+	tmp.ap_channel = (uint8_t)cursor_get_uint(&c, 1);
+	tmp.ap_ssid_hidden = (uint8_t)cursor_get_uint(&c, 1);
+	tmp.ap_bandwidth = (uint8_t)cursor_get_uint(&c, 1);
+	tmp.sta_only = (uint8_t)cursor_get_uint(&c, 1);
+	tmp.sta_power_save = (uint8_t)cursor_get_uint(&c, 1);
+	tmp.sta_static_ip = (uint8_t)cursor_get_uint(&c, 1);
+	tmp.sta_ip = (uint32_t)cursor_get_uint(&c, 4);
+	tmp.sta_netmask = (uint32_t)cursor_get_uint(&c, 4);
+	tmp.sta_gw = (uint32_t)cursor_get_uint(&c, 4);
+	uint8_t count = (uint8_t)cursor_get_uint(&c, 1);
+	for(uint8_t i=0; i<count; i++){
+		struct config_record_profile_t p;
+		memset(&p, 0x00, sizeof(p));
+		cursor_get(&c, p.ssid, CONFIG_RECORD_SSID_SIZE);
+		cursor_get(&c, p.password, CONFIG_RECORD_PASSWORD_SIZE);
+		p.last_success = (int64_t)cursor_get_uint(&c, 8);
+		p.failures = (uint16_t)cursor_get_uint(&c, 2);
+		p.avg_latency_ms = (uint16_t)cursor_get_uint(&c, 2);
+		/* redes além do que esta versão guarda são descartadas */
+		if(!c.overflow && tmp.profile_count < CONFIG_RECORD_MAX_PROFILES){
+			tmp.profiles[tmp.profile_count++] = p;
+		}
+	}
+
+	if(c.overflow) return CONFIG_RECORD_ERR_LENGTH;
+
+	/* campos de versões futuras: if(version >= 2){ ... } senão valor padrão */
+
+	*record = tmp;
+	return CONFIG_RECORD_OK;
+}
+
+uint32_t config_record_crc(const uint8_t *buf, size_t len){
+	if(len < CONFIG_RECORD_HEADER_SIZE) return 0;
+	return (uint32_t)buf[8] | ((uint32_t)buf[9] << 8) | ((uint32_t)buf[10] << 16) | ((uint32_t)buf[11] << 24);
+}
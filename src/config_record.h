@@ -0,0 +1,137 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file config_record.h
+@brief Registro único, versionado e protegido por CRC com toda a configuração do wifi_manager
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_CONFIG_RECORD_H_INCLUDED
+#define WIFI_MANAGER_CONFIG_RECORD_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Versão atual do formato do registro.
+ *
+ * Regra de evolução: uma nova versão apenas acrescenta campos ao fim do registro. Um registro de versão anterior é
+ * lido normalmente e os campos que ele não tem recebem o valor padrão; um registro de versão posterior (firmware
+ * rebaixado) é lido até onde esta versão conhece e o resto é ignorado.
+ */
+#define CONFIG_RECORD_VERSION				1
+
+#define CONFIG_RECORD_SSID_SIZE				32
+#define CONFIG_RECORD_PASSWORD_SIZE			64
+#define CONFIG_RECORD_MAX_PROFILES			16
+
+/** @brief magia + versão + tamanho do conteúdo + CRC32 do conteúdo */
+#define CONFIG_RECORD_HEADER_SIZE			12
+
+/** @brief tamanho de uma rede salva no registro */
+#define CONFIG_RECORD_PROFILE_SIZE			(CONFIG_RECORD_SSID_SIZE + CONFIG_RECORD_PASSWORD_SIZE + 8 + 2 + 2)
+
+/** @brief tamanho do conteúdo da versão 1 sem as redes salvas */
+#define CONFIG_RECORD_V1_FIXED_SIZE			(2 * CONFIG_RECORD_SSID_SIZE + 2 * CONFIG_RECORD_PASSWORD_SIZE + 6 + 3 * 4 + 1)
+
+/** @brief maior registro possível nesta versão */
+#define CONFIG_RECORD_MAX_SIZE				(CONFIG_RECORD_HEADER_SIZE + CONFIG_RECORD_V1_FIXED_SIZE + CONFIG_RECORD_MAX_PROFILES * CONFIG_RECORD_PROFILE_SIZE)
+
+
+/**
+ * @brief Resultado da leitura de um registro.
+ */
+typedef enum config_record_err_t{
+	CONFIG_RECORD_OK = 0,
+	CONFIG_RECORD_ERR_LENGTH = 1,		/* registro truncado */
+	CONFIG_RECORD_ERR_MAGIC = 2,		/* não é um registro do wifi_manager */
+	CONFIG_RECORD_ERR_VERSION = 3,		/* versão 0 ou desconhecida */
+	CONFIG_RECORD_ERR_CRC = 4			/* conteúdo corrompido */
+}config_record_err_t;
+
+/**
+ * @brief Uma rede salva, na forma independente de plataforma.
+ */
+struct config_record_profile_t{
+	uint8_t ssid[CONFIG_RECORD_SSID_SIZE];
+	uint8_t password[CONFIG_RECORD_PASSWORD_SIZE];
+	int64_t last_success;
+	uint16_t failures;
+	uint16_t avg_latency_ms;
+};
+
+/**
+ * @brief Toda a configuração persistente do wifi_manager, na forma independente de plataforma.
+ * Os endereços IP são guardados como em esp_ip4_addr_t (ordem de rede).
+ */
+struct config_record_t{
+	uint8_t sta_ssid[CONFIG_RECORD_SSID_SIZE];
+	uint8_t sta_password[CONFIG_RECORD_PASSWORD_SIZE];
+	uint8_t ap_ssid[CONFIG_RECORD_SSID_SIZE];
+	uint8_t ap_pwd[CONFIG_RECORD_PASSWORD_SIZE];
+	uint8_t ap_channel;
+	uint8_t ap_ssid_hidden;
+	uint8_t ap_bandwidth;
+	uint8_t sta_only;
+	uint8_t sta_power_save;
+	uint8_t sta_static_ip;
+	uint32_t sta_ip;
+	uint32_t sta_netmask;
+	uint32_t sta_gw;
+	uint8_t profile_count;
+	struct config_record_profile_t profiles[CONFIG_RECORD_MAX_PROFILES];
+};
+
+/**
+ * @brief Serializa o registro em buf, campo a campo, em little-endian.
+ * @return o tamanho do registro, ou 0 se buf for pequeno demais.
+ */
+size_t config_record_encode(const struct config_record_t *record, uint8_t *buf, size_t len);
+
+/**
+ * @brief Lê um registro. Em caso de erro, record não é alterado.
+ */
+config_record_err_t config_record_decode(const uint8_t *buf, size_t len, struct config_record_t *record);
+
+/**
+ * @brief CRC32 do registro serializado, como gravado no cabeçalho. Permite saber se duas serializações são iguais sem compará-las.
+ */
+uint32_t config_record_crc(const uint8_t *buf, size_t len);
+
+/**
+ * @brief CRC-32 (IEEE 802.3).
+ */
+uint32_t config_record_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_CONFIG_RECORD_H_INCLUDED */
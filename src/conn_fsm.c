@@ -0,0 +1,313 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file conn_fsm.c
+@brief Máquina de estados da conexão STA, dirigida por tabela e independente de plataforma
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "conn_fsm.h"
+
+
+/**
+ * @brief Uma linha da tabela de transições.
+ */
+struct conn_fsm_transition_t{
+	uint8_t from;								/* conn_state_t ou CONN_STATE_ANY */
+	uint8_t code;								/* message_code_t */
+	bool (*guard)(const struct conn_fsm_t *fsm);	/* NULL: sempre */
+	uint8_t to;									/* conn_state_t ou CONN_STATE_SAME */
+	void (*action)(struct conn_fsm_t *fsm);
+	conn_outcome_t outcome;
+};
+
+/**
+ * @brief Ações de entrada e de saída de um estado.
+ */
+struct conn_fsm_state_t{
+	const char *name;
+	void (*entry)(struct conn_fsm_t *fsm);
+	void (*exit)(struct conn_fsm_t *fsm);
+};
+
+
+/* condições */
+
+static bool guard_nothing_saved(const struct conn_fsm_t *fsm){
+	return fsm->param == 0;
+}
+
+static bool guard_many_saved(const struct conn_fsm_t *fsm){
+	return fsm->param > 1;
+}
+
+static bool guard_user_attempt(const struct conn_fsm_t *fsm){
+	return fsm->origin == CONNECTION_REQUEST_USER;
+}
+
+static bool guard_user_disconnect(const struct conn_fsm_t *fsm){
+	return fsm->user_disconnect;
+}
+
+static bool guard_direct_attempt(const struct conn_fsm_t *fsm){
+	return fsm->direct;
+}
+
+static bool guard_give_up_select(const struct conn_fsm_t *fsm){
+	return fsm->give_up && fsm->saved_networks > 1;
+}
+
+static bool guard_give_up(const struct conn_fsm_t *fsm){
+	return fsm->give_up;
+}
+
+static bool guard_retry_now(const struct conn_fsm_t *fsm){
+	/* primeira queda de um enlace transitório (perda de beacons, por exemplo) */
+	return fsm->action == DISCONNECT_ACTION_RETRY && fsm->retry_attempt == 0;
+}
+
+static bool guard_network_selected(const struct conn_fsm_t *fsm){
+	return fsm->param != 0;
+}
+
+static bool guard_selecting_for_restore(const struct conn_fsm_t *fsm){
+	return fsm->selection == CONNECTION_REQUEST_RESTORE_CONNECTION;
+}
+
+
+/* ações das transições */
+
+static void act_start_ap(struct conn_fsm_t *fsm){
+	fsm->ops->post(fsm->ctx, WM_ORDER_START_AP, 0);
+}
+
+static void act_select_for_restore(struct conn_fsm_t *fsm){
+	fsm->selection = CONNECTION_REQUEST_RESTORE_CONNECTION;
+}
+
+static void act_post_restore(struct conn_fsm_t *fsm){
+	fsm->ops->post(fsm->ctx, WM_ORDER_CONNECT_STA, CONNECTION_REQUEST_RESTORE_CONNECTION);
+}
+
+static void act_connect(struct conn_fsm_t *fsm){
+	/* restaurações e reconexões automáticas vão direto ao BSSID/canal conhecidos, a menos que a última tentativa direta tenha falhado */
+	bool use_hint = fsm->param != CONNECTION_REQUEST_USER && !fsm->fallback;
+	fsm->origin = (uint8_t)fsm->param;
+	fsm->fallback = false;
+	fsm->direct = fsm->ops->connect(fsm->ctx, fsm->origin, use_hint);
+}
+
+static void act_user_attempt_failed(struct conn_fsm_t *fsm){
+	/* não há novas tentativas quando a conexão foi pedida pelo usuário: uma senha errada não o deixa esperando */
+	fsm->origin = CONNECTION_REQUEST_NONE;
+	fsm->direct = false;
+}
+
+static void act_user_disconnect(struct conn_fsm_t *fsm){
+	fsm->user_disconnect = false;
+	fsm->origin = CONNECTION_REQUEST_NONE;
+	fsm->direct = false;
+	fsm->ops->post(fsm->ctx, WM_ORDER_START_AP, 0);
+}
+
+static void act_request_disconnect(struct conn_fsm_t *fsm){
+	fsm->user_disconnect = true;
+}
+
+static void act_direct_fallback(struct conn_fsm_t *fsm){
+	/* o AP pode ter mudado de canal ou sido substituído: nova tentativa imediata, sem contar como falha */
+	uint8_t origin = fsm->origin == CONNECTION_REQUEST_RESTORE_CONNECTION ? CONNECTION_REQUEST_RESTORE_CONNECTION : CONNECTION_REQUEST_AUTO_RECONNECT;
+	fsm->direct = false;
+	fsm->fallback = true;
+	fsm->ops->post(fsm->ctx, WM_ORDER_CONNECT_STA, origin);
+}
+
+/**
+ * @brief Parte comum de uma conexão perdida.
+ */
+static void act_lost_common(struct conn_fsm_t *fsm){
+	fsm->direct = false;
+	fsm->origin = CONNECTION_REQUEST_NONE;
+	if(fsm->action == DISCONNECT_ACTION_RESCAN){
+		fsm->fallback = true;
+	}
+}
+
+static void act_give_up_select(struct conn_fsm_t *fsm){
+	act_lost_common(fsm);
+	fsm->retries = 0;
+	fsm->selection = CONNECTION_REQUEST_AUTO_RECONNECT;
+}
+
+static void act_give_up(struct conn_fsm_t *fsm){
+	/* as tentativas continuam em segundo plano pelo temporizador, com o AP ativo */
+	act_lost_common(fsm);
+	fsm->retries = 0;
+	fsm->ops->post(fsm->ctx, WM_ORDER_START_AP, 0);
+}
+
+static void act_count_failure(struct conn_fsm_t *fsm){
+	act_lost_common(fsm);
+	if(!fsm->ap_started && fsm->retries < UINT8_MAX){
+		fsm->retries++;
+	}
+}
+
+static void act_retry_now(struct conn_fsm_t *fsm){
+	act_count_failure(fsm);
+	fsm->retry_attempt++;
+	fsm->ops->post(fsm->ctx, WM_ORDER_CONNECT_STA, CONNECTION_REQUEST_AUTO_RECONNECT);
+}
+
+static void act_connect_selected(struct conn_fsm_t *fsm){
+	uint8_t origin = fsm->selection;
+	fsm->selection = CONNECTION_REQUEST_NONE;
+	fsm->ops->post(fsm->ctx, WM_ORDER_CONNECT_STA, origin);
+}
+
+static void act_no_network(struct conn_fsm_t *fsm){
+	/* como em act_give_up: o AP é iniciado e as tentativas continuam em segundo plano na rede atual */
+	fsm->selection = CONNECTION_REQUEST_NONE;
+	fsm->ops->post(fsm->ctx, WM_ORDER_START_AP, 0);
+}
+
+
+/* ações de entrada e de saída */
+
+static void entry_selecting(struct conn_fsm_t *fsm){
+	fsm->ops->post(fsm->ctx, WM_ORDER_START_WIFI_SCAN, 0);
+}
+
+static void entry_connected(struct conn_fsm_t *fsm){
+	fsm->retries = 0;
+	fsm->retry_attempt = 0;
+	fsm->origin = CONNECTION_REQUEST_NONE;
+	fsm->direct = false;
+	fsm->fallback = false;
+}
+
+static void entry_wait_retry(struct conn_fsm_t *fsm){
+	fsm->ops->arm_retry(fsm->ctx, fsm->retry_attempt);
+	if(fsm->retry_attempt < UINT32_MAX) fsm->retry_attempt++;
+}
+
+static void exit_wait_retry(struct conn_fsm_t *fsm){
+	fsm->ops->cancel_retry(fsm->ctx);
+}
+
+
+static const struct conn_fsm_state_t conn_fsm_states[CONN_STATE_COUNT] = {
+	[CONN_STATE_IDLE] =			{ "IDLE",		NULL,				NULL },
+	[CONN_STATE_SELECTING] =	{ "SELECTING",	entry_selecting,	NULL },
+	[CONN_STATE_CONNECTING] =	{ "CONNECTING",	NULL,				NULL },
+	[CONN_STATE_CONNECTED] =	{ "CONNECTED",	entry_connected,	NULL },
+	[CONN_STATE_WAIT_RETRY] =	{ "WAIT_RETRY",	entry_wait_retry,	exit_wait_retry },
+};
+
+/**
+ * @brief A tabela. Para cada mensagem, as linhas são avaliadas em ordem e a primeira que combina é executada.
+ */
+static const struct conn_fsm_transition_t conn_fsm_table[] = {
+	/* carga da configuração salva na inicialização */
+	{ CONN_STATE_IDLE,		WM_ORDER_LOAD_AND_RESTORE_STA,	guard_nothing_saved,			CONN_STATE_SAME,		act_start_ap,				CONN_OUTCOME_NO_NETWORK },
+	{ CONN_STATE_IDLE,		WM_ORDER_LOAD_AND_RESTORE_STA,	guard_many_saved,				CONN_STATE_SELECTING,	act_select_for_restore,		CONN_OUTCOME_NONE },
+	{ CONN_STATE_IDLE,		WM_ORDER_LOAD_AND_RESTORE_STA,	NULL,							CONN_STATE_SAME,		act_post_restore,			CONN_OUTCOME_NONE },
+
+	/* pedidos de conexão: ignorados se a STA já está conectada */
+	{ CONN_STATE_CONNECTED,	WM_ORDER_CONNECT_STA,			NULL,							CONN_STATE_SAME,		NULL,						CONN_OUTCOME_IGNORED },
+	{ CONN_STATE_ANY,		WM_ORDER_CONNECT_STA,			NULL,							CONN_STATE_CONNECTING,	act_connect,				CONN_OUTCOME_NONE },
+	{ CONN_STATE_ANY,		WM_ORDER_DISCONNECT_STA,		NULL,							CONN_STATE_SAME,		act_request_disconnect,		CONN_OUTCOME_NONE },
+
+	/* desconexões, da causa mais específica para a mais geral */
+	{ CONN_STATE_ANY,		WM_EVENT_STA_DISCONNECTED,		guard_user_attempt,				CONN_STATE_IDLE,		act_user_attempt_failed,	CONN_OUTCOME_USER_ATTEMPT_FAILED },
+	{ CONN_STATE_ANY,		WM_EVENT_STA_DISCONNECTED,		guard_user_disconnect,			CONN_STATE_IDLE,		act_user_disconnect,		CONN_OUTCOME_USER_DISCONNECT },
+	{ CONN_STATE_ANY,		WM_EVENT_STA_DISCONNECTED,		guard_direct_attempt,			CONN_STATE_IDLE,		act_direct_fallback,		CONN_OUTCOME_DIRECT_FALLBACK },
+	{ CONN_STATE_ANY,		WM_EVENT_STA_DISCONNECTED,		guard_give_up_select,			CONN_STATE_SELECTING,	act_give_up_select,			CONN_OUTCOME_GIVE_UP },
+	{ CONN_STATE_ANY,		WM_EVENT_STA_DISCONNECTED,		guard_give_up,					CONN_STATE_WAIT_RETRY,	act_give_up,				CONN_OUTCOME_GIVE_UP },
+	{ CONN_STATE_ANY,		WM_EVENT_STA_DISCONNECTED,		guard_retry_now,				CONN_STATE_IDLE,		act_retry_now,				CONN_OUTCOME_LOST },
+	{ CONN_STATE_ANY,		WM_EVENT_STA_DISCONNECTED,		NULL,							CONN_STATE_WAIT_RETRY,	act_count_failure,			CONN_OUTCOME_LOST },
+
+	/* resultado da varredura de seleção de rede */
+	{ CONN_STATE_SELECTING,	WM_EVENT_SCAN_DONE,				guard_network_selected,			CONN_STATE_IDLE,		act_connect_selected,		CONN_OUTCOME_NONE },
+	{ CONN_STATE_SELECTING,	WM_EVENT_SCAN_DONE,				guard_selecting_for_restore,	CONN_STATE_IDLE,		act_connect_selected,		CONN_OUTCOME_NONE },
+	{ CONN_STATE_SELECTING,	WM_EVENT_SCAN_DONE,				NULL,							CONN_STATE_WAIT_RETRY,	act_no_network,				CONN_OUTCOME_NO_NETWORK },
+
+	{ CONN_STATE_ANY,		WM_EVENT_STA_GOT_IP,			NULL,							CONN_STATE_CONNECTED,	NULL,						CONN_OUTCOME_CONNECTED },
+};
+
+
+void conn_fsm_init(struct conn_fsm_t *fsm, uint8_t max_retries, const struct conn_fsm_ops_t *ops, void *ctx){
+	memset(fsm, 0x00, sizeof(struct conn_fsm_t));
+	fsm->state = CONN_STATE_IDLE;
+	fsm->max_retries = max_retries;
+	fsm->ops = ops;
+	fsm->ctx = ctx;
+}
+
+conn_outcome_t conn_fsm_dispatch(struct conn_fsm_t *fsm, uint8_t code, uint32_t param){
+
+	/* valores calculados uma vez, antes das condições */
+	fsm->param = param;
+	if(code == WM_EVENT_STA_DISCONNECTED){
+		/* o código de razão decide como seguir; falhas de autenticação não esperam o limite de tentativas.
+		 * Com o AP ativo, as tentativas continuam indefinidamente pelo temporizador */
+		fsm->action = disconnect_reason_classify((uint8_t)param);
+		fsm->give_up = !fsm->ap_started && (fsm->action == DISCONNECT_ACTION_START_AP || fsm->retries >= fsm->max_retries);
+	}
+
+	for(size_t i=0; i<sizeof(conn_fsm_table)/sizeof(conn_fsm_table[0]); i++){
+		const struct conn_fsm_transition_t *t = &conn_fsm_table[i];
+
+		if(t->code != code) continue;
+		if(t->from != CONN_STATE_ANY && t->from != fsm->state) continue;
+		if(t->guard && !t->guard(fsm)) continue;
+
+		if(t->to == CONN_STATE_SAME){
+			if(t->action) t->action(fsm);
+		}
+		else{
+			/* uma transição para o próprio estado também sai e entra de novo (o temporizador é rearmado, por exemplo) */
+			if(conn_fsm_states[fsm->state].exit) conn_fsm_states[fsm->state].exit(fsm);
+			if(t->action) t->action(fsm);
+			fsm->state = (conn_state_t)t->to;
+			if(conn_fsm_states[fsm->state].entry) conn_fsm_states[fsm->state].entry(fsm);
+		}
+
+		return t->outcome;
+	}
+
+	return CONN_OUTCOME_IGNORED;
+}
+
+const char* conn_fsm_state_to_str(conn_state_t state){
+	return state < CONN_STATE_COUNT ? conn_fsm_states[state].name : "?";
+}
+
+const char* conn_fsm_outcome_to_str(conn_outcome_t outcome){
+	static const char *names[] = { "NONE", "USER_ATTEMPT_FAILED", "USER_DISCONNECT", "DIRECT_FALLBACK", "LOST", "GIVE_UP", "NO_NETWORK", "CONNECTED", "IGNORED" };
+	return outcome <= CONN_OUTCOME_IGNORED ? names[outcome] : "?";
+}
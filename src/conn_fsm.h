@@ -0,0 +1,131 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file conn_fsm.h
+@brief Máquina de estados da conexão STA, dirigida por tabela e independente de plataforma
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_CONN_FSM_H_INCLUDED
+#define WIFI_MANAGER_CONN_FSM_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "message_codes.h"
+#include "disconnect_reason.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Estados da conexão STA. O ponto de acesso é independente (modo APSTA) e entra apenas como condição.
+ */
+typedef enum conn_state_t{
+	CONN_STATE_IDLE = 0,			/* nenhuma tentativa em andamento nem agendada */
+	CONN_STATE_SELECTING = 1,		/* varredura para escolher a melhor rede salva */
+	CONN_STATE_CONNECTING = 2,		/* associação em andamento */
+	CONN_STATE_CONNECTED = 3,		/* STA com IP */
+	CONN_STATE_WAIT_RETRY = 4,		/* temporizador de nova tentativa armado */
+	CONN_STATE_COUNT = 5,
+	CONN_STATE_ANY = 0xfe,			/* origem de uma transição: qualquer estado */
+	CONN_STATE_SAME = 0xff			/* destino de uma transição: permanece, sem ações de saída e de entrada */
+}conn_state_t;
+
+/**
+ * @brief O que uma mensagem significou, para as ações que ficam fora da máquina (páginas de status, gravação, log).
+ */
+typedef enum conn_outcome_t{
+	CONN_OUTCOME_NONE = 0,
+	CONN_OUTCOME_USER_ATTEMPT_FAILED = 1,	/* a conexão pedida pelo usuário falhou: sem novas tentativas */
+	CONN_OUTCOME_USER_DISCONNECT = 2,		/* desconexão pedida pelo usuário: a rede deve ser esquecida */
+	CONN_OUTCOME_DIRECT_FALLBACK = 3,		/* a tentativa direta no BSSID/canal em cache falhou: varredura completa */
+	CONN_OUTCOME_LOST = 4,					/* conexão perdida ou tentativa automática sem sucesso */
+	CONN_OUTCOME_GIVE_UP = 5,				/* tentativas esgotadas: seleção de outra rede ou ponto de acesso */
+	CONN_OUTCOME_NO_NETWORK = 6,			/* nenhuma rede salva utilizável: ponto de acesso */
+	CONN_OUTCOME_CONNECTED = 7,
+	CONN_OUTCOME_IGNORED = 8				/* nenhuma transição para esta mensagem neste estado */
+}conn_outcome_t;
+
+/**
+ * @brief Efeitos colaterais: no wifi_manager são chamadas ao esp-idf e mensagens na fila, no simulador são eventos agendados.
+ */
+struct conn_fsm_ops_t{
+	/**
+	 * @brief Inicia uma associação. use_hint: o BSSID/canal em cache pode ser usado.
+	 * @return true se a tentativa usa o BSSID/canal em cache.
+	 */
+	bool (*connect)(void *ctx, uint8_t origin, bool use_hint);
+	/** @brief Posta uma mensagem (message_code_t) na fila do gerenciador. */
+	void (*post)(void *ctx, uint8_t code, uint32_t param);
+	/** @brief Arma o temporizador de nova tentativa, que posta WM_ORDER_CONNECT_STA com CONNECTION_REQUEST_AUTO_RECONNECT. */
+	void (*arm_retry)(void *ctx, uint32_t attempt);
+	void (*cancel_retry)(void *ctx);
+};
+
+struct conn_fsm_t{
+	conn_state_t state;
+	uint8_t origin;					/* origem da tentativa em andamento (connection_request_made_by_code_t) */
+	uint8_t selection;				/* origem da seleção de rede em andamento */
+	uint8_t retries;				/* falhas seguidas antes de desistir */
+	uint8_t max_retries;
+	uint32_t retry_attempt;			/* posição na política de espera */
+	bool direct;					/* a tentativa em andamento usa o BSSID/canal em cache */
+	bool fallback;					/* a próxima tentativa faz uma varredura completa */
+	bool user_disconnect;			/* uma desconexão foi pedida pelo usuário */
+
+	/* entradas mantidas por quem usa a máquina */
+	bool ap_started;				/* o ponto de acesso está ativo: as falhas não contam para desistir */
+	uint8_t saved_networks;			/* número de redes salvas */
+
+	/* valores da mensagem em tratamento, calculados antes das condições */
+	uint32_t param;
+	disconnect_action_t action;
+	bool give_up;
+
+	const struct conn_fsm_ops_t *ops;
+	void *ctx;
+};
+
+
+void conn_fsm_init(struct conn_fsm_t *fsm, uint8_t max_retries, const struct conn_fsm_ops_t *ops, void *ctx);
+
+/**
+ * @brief Trata uma mensagem: a primeira transição da tabela cuja origem, código e condição combinam é executada,
+ * na ordem ação de saída, ação da transição, ação de entrada.
+ * @param param o parâmetro da mensagem: origem de WM_ORDER_CONNECT_STA, código de razão de WM_EVENT_STA_DISCONNECTED,
+ * número de redes salvas de WM_ORDER_LOAD_AND_RESTORE_STA, 1 se uma rede salva foi escolhida em WM_EVENT_SCAN_DONE.
+ */
+conn_outcome_t conn_fsm_dispatch(struct conn_fsm_t *fsm, uint8_t code, uint32_t param);
+
+const char* conn_fsm_state_to_str(conn_state_t state);
+const char* conn_fsm_outcome_to_str(conn_outcome_t outcome);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_CONN_FSM_H_INCLUDED */
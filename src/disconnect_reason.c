@@ -0,0 +1,123 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file disconnect_reason.c
+@brief Classificação dos códigos de razão de desconexão da STA e contadores por código
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include "disconnect_reason.h"
+
+
+/**
+ * @brief Uma linha da tabela de classificação.
+ */
+struct disconnect_reason_entry_t{
+	uint8_t reason;
+	disconnect_action_t action;
+	const char *name;
+};
+
+/**
+ * @brief Tabela de classificação. Códigos ausentes usam DISCONNECT_ACTION_BACKOFF.
+ *
+ * Falhas de autenticação (senha errada) iniciam o AP na hora: novas tentativas cegas não vão consertar uma senha
+ * e só atrasam a volta do instalador ao portal. As tentativas continuam em segundo plano pelo temporizador.
+ */
+static const struct disconnect_reason_entry_t disconnect_reason_table[] = {
+	{ 1,	DISCONNECT_ACTION_RETRY,	"UNSPECIFIED" },
+	{ 2,	DISCONNECT_ACTION_RETRY,	"AUTH_EXPIRE" },
+	{ 3,	DISCONNECT_ACTION_RETRY,	"AUTH_LEAVE" },
+	{ 4,	DISCONNECT_ACTION_RETRY,	"ASSOC_EXPIRE" },
+	{ 5,	DISCONNECT_ACTION_BACKOFF,	"ASSOC_TOOMANY" },
+	{ 6,	DISCONNECT_ACTION_RETRY,	"NOT_AUTHED" },
+	{ 7,	DISCONNECT_ACTION_RETRY,	"NOT_ASSOCED" },
+	{ 8,	DISCONNECT_ACTION_BACKOFF,	"ASSOC_LEAVE" },
+	{ 9,	DISCONNECT_ACTION_RETRY,	"ASSOC_NOT_AUTHED" },
+	{ 10,	DISCONNECT_ACTION_BACKOFF,	"DISASSOC_PWRCAP_BAD" },
+	{ 11,	DISCONNECT_ACTION_BACKOFF,	"DISASSOC_SUPCHAN_BAD" },
+	{ 13,	DISCONNECT_ACTION_BACKOFF,	"IE_INVALID" },
+	{ 14,	DISCONNECT_ACTION_START_AP,	"MIC_FAILURE" },
+	{ 15,	DISCONNECT_ACTION_START_AP,	"4WAY_HANDSHAKE_TIMEOUT" },
+	{ 16,	DISCONNECT_ACTION_BACKOFF,	"GROUP_KEY_UPDATE_TIMEOUT" },
+	{ 17,	DISCONNECT_ACTION_BACKOFF,	"IE_IN_4WAY_DIFFERS" },
+	{ 18,	DISCONNECT_ACTION_START_AP,	"GROUP_CIPHER_INVALID" },
+	{ 19,	DISCONNECT_ACTION_START_AP,	"PAIRWISE_CIPHER_INVALID" },
+	{ 20,	DISCONNECT_ACTION_START_AP,	"AKMP_INVALID" },
+	{ 21,	DISCONNECT_ACTION_START_AP,	"UNSUPP_RSN_IE_VERSION" },
+	{ 22,	DISCONNECT_ACTION_START_AP,	"INVALID_RSN_IE_CAP" },
+	{ 23,	DISCONNECT_ACTION_START_AP,	"802_1X_AUTH_FAILED" },
+	{ 24,	DISCONNECT_ACTION_START_AP,	"CIPHER_SUITE_REJECTED" },
+	{ 200,	DISCONNECT_ACTION_RETRY,	"BEACON_TIMEOUT" },
+	{ 201,	DISCONNECT_ACTION_RESCAN,	"NO_AP_FOUND" },
+	{ 202,	DISCONNECT_ACTION_START_AP,	"AUTH_FAIL" },
+	{ 203,	DISCONNECT_ACTION_BACKOFF,	"ASSOC_FAIL" },
+	{ 204,	DISCONNECT_ACTION_START_AP,	"HANDSHAKE_TIMEOUT" },
+	{ 205,	DISCONNECT_ACTION_BACKOFF,	"CONNECTION_FAIL" },
+};
+
+#define DISCONNECT_REASON_TABLE_SIZE		(sizeof(disconnect_reason_table) / sizeof(disconnect_reason_table[0]))
+
+/* @brief contadores por código de razão. Escritos apenas pela tarefa wifi_manager */
+static uint32_t disconnect_reason_counters[DISCONNECT_REASON_SLOTS];
+
+
+static const struct disconnect_reason_entry_t* disconnect_reason_lookup(uint8_t reason){
+	for(size_t i=0; i<DISCONNECT_REASON_TABLE_SIZE; i++){
+		if(disconnect_reason_table[i].reason == reason) return &disconnect_reason_table[i];
+	}
+	return NULL;
+}
+
+/**
+ * @brief posição de um código de razão na tabela de contadores
+ */
+static uint32_t disconnect_reason_slot(uint8_t reason){
+	if(reason < 64) return reason;
+	if(reason >= 200 && reason < 216) return 64 + (reason - 200);
+	return DISCONNECT_REASON_SLOTS - 1;
+}
+
+disconnect_action_t disconnect_reason_classify(uint8_t reason){
+	const struct disconnect_reason_entry_t *entry = disconnect_reason_lookup(reason);
+	return entry ? entry->action : DISCONNECT_ACTION_BACKOFF;
+}
+
+void disconnect_reason_record(uint8_t reason){
+	disconnect_reason_counters[disconnect_reason_slot(reason)]++;
+}
+
+uint32_t disconnect_reason_get_count(uint8_t reason){
+	return disconnect_reason_counters[disconnect_reason_slot(reason)];
+}
+
+void disconnect_reason_reset(){
+	memset(disconnect_reason_counters, 0x00, sizeof(disconnect_reason_counters));
+}
+
+const char* disconnect_reason_to_str(uint8_t reason){
+	const struct disconnect_reason_entry_t *entry = disconnect_reason_lookup(reason);
+	return entry ? entry->name : "UNKNOWN";
+}
@@ -0,0 +1,83 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file disconnect_reason.h
+@brief Classificação dos códigos de razão de desconexão da STA e contadores por código
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_DISCONNECT_REASON_H_INCLUDED
+#define WIFI_MANAGER_DISCONNECT_REASON_H_INCLUDED
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief O que fazer depois que a STA foi desconectada por um determinado código de razão.
+ */
+typedef enum disconnect_action_t{
+	DISCONNECT_ACTION_RETRY = 0,		/* falha transitória do enlace: nova tentativa imediata, depois recuo */
+	DISCONNECT_ACTION_BACKOFF = 1,		/* nova tentativa após o tempo dado pela política de espera */
+	DISCONNECT_ACTION_RESCAN = 2,		/* o AP não foi encontrado: nova tentativa com varredura completa */
+	DISCONNECT_ACTION_START_AP = 3		/* credenciais ou segurança incompatíveis: inicie o AP imediatamente */
+}disconnect_action_t;
+
+/** @brief Número de posições da tabela de contadores: códigos 0-63 do 802.11, 200-215 do esp-idf e uma posição para os demais */
+#define DISCONNECT_REASON_SLOTS				81
+
+/**
+ * @brief Retorna a ação associada a um código de razão de wifi_event_sta_disconnected_t.
+ */
+disconnect_action_t disconnect_reason_classify(uint8_t reason);
+
+/**
+ * @brief Incrementa o contador de um código de razão.
+ */
+void disconnect_reason_record(uint8_t reason);
+
+/**
+ * @brief Número de desconexões registradas para um código de razão.
+ */
+uint32_t disconnect_reason_get_count(uint8_t reason);
+
+/**
+ * @brief Zera todos os contadores.
+ */
+void disconnect_reason_reset();
+
+/**
+ * @brief Nome curto de um código de razão, por exemplo "4WAY_HANDSHAKE_TIMEOUT".
+ */
+const char* disconnect_reason_to_str(uint8_t reason);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_DISCONNECT_REASON_H_INCLUDED */
@@ -59,10 +59,14 @@ int socket_fd;
 
 void dns_server_start() {
 	if(task_dns_server == NULL){
-		xTaskCreate(&dns_server, "dns_server", 3072, NULL, WIFI_MANAGER_TASK_PRIORITY-1, &task_dns_server);
+		task_config_create(wifi_manager_get_task_config(WIFI_MANAGER_TASK_DNS), &dns_server, "dns_server", NULL, &task_dns_server);
 	}
 }
 
+TaskHandle_t dns_server_get_task(){
+	return task_dns_server;
+}
+
 void dns_server_stop(){
 	if(task_dns_server){
 		vTaskDelete(task_dns_server);
@@ -111,7 +115,6 @@ void dns_server(void *pvParameters) {
     int length;
     uint8_t data[DNS_QUERY_MAX_SIZE];	/* buffer de consulta DNS */
     uint8_t response[DNS_ANSWER_MAX_SIZE]; /* buffer de resposta dns */
-    char ip_address[INET_ADDRSTRLEN]; /* buffer para armazenar IPs como texto. Isso é usado apenas para depuração e não serve a nenhum outro propósito */
     char *domain; /* Isso é usado apenas para depuração e não serve a nenhum outro propósito */
     int err;
 
@@ -127,6 +130,7 @@ void dns_server(void *pvParameters) {
          * consultas dentro do mesmo pacote DNS e não é compatível com este simples sequestro de DNS. */
         if ( length > 0   &&  ((length + sizeof(dns_answer_t)-1) < DNS_ANSWER_MAX_SIZE)   ) {
 
+        	TASK_TRACE_BEGIN("dns query", (int16_t)length);
         	data[length] = '\0'; /*no caso de haver um nome de domínio falso que não tenha terminação nula */
 
             /* Gerar mensagem de cabeçalho */
@@ -148,12 +152,12 @@ void dns_server(void *pvParameters) {
 
 
             /* extrair o nome de domínio e solicitar IP para depuração */
-            inet_ntop(AF_INET, &(client.sin_addr), ip_address, INET_ADDRSTRLEN);
+            const uint8_t *ip_address = (const uint8_t*)&client.sin_addr.s_addr;
             domain = (char*) &data[sizeof(dns_header_t) + 1];
             for(char* c=domain; *c != '\0'; c++){
             	if(*c < ' ' || *c > 'z') *c = '.'; /* tecnicamente, devemos testar se os primeiros dois bits são 00 (por exemplo, if ((* c & 0xC0) == 0x00) * c = '.'), mas isso torna o código muito mais legível */
             }
-            ESP_LOGI(TAG, "Replying to DNS request for %s from %s", domain, ip_address);
+            WM_LOGI(LOG_SUBSYSTEM_DNS, TAG, "Replying to DNS request for %s from %d.%d.%d.%d", domain, ip_address[0], ip_address[1], ip_address[2], ip_address[3]);
 
 
             /* crie uma resposta DNS no final da consulta*/
@@ -165,10 +169,13 @@ void dns_server(void *pvParameters) {
             dns_answer->RDLENGTH = __bswap_16(0x0004); /* 4 byte => tamanho de um endereço ipv4 */
             dns_answer->RDATA = ip_resolved.addr;
 
+            TASK_TRACE_BEGIN("dns sendto", 0);
             err = sendto(socket_fd, response, length+sizeof(dns_answer_t), 0, (struct sockaddr *)&client, client_len);
+            TASK_TRACE_END("dns sendto", (int16_t)err);
             if (err < 0) {
-            	ESP_LOGE(TAG, "UDP sendto failed: %d", err);
+            	WM_LOGE(LOG_SUBSYSTEM_DNS, TAG, "UDP sendto failed: %d", err);
             }
+            TASK_TRACE_END("dns query", 0);
         }
 
         taskYIELD(); /* permite que o agendador freeRTOS assuma o controle, se necessário. O daemon DNS não deve sobrecarregar o sistema */
@@ -127,6 +127,11 @@ void dns_server(void *pvParameters);
 void dns_server_start();
 void dns_server_stop();
 
+/**
+ * @brief A tarefa do servidor DNS, ou NULL se ele não estiver rodando.
+ */
+TaskHandle_t dns_server_get_task();
+
 
 
 #ifdef __cplusplus
@@ -0,0 +1,331 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file event_bus.c
+@brief Barramento de eventos do wifi_manager: vários assinantes por código de mensagem
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "esp_wifi.h"
+#include "esp_netif.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "wifi_manager.h"
+#include "event_bus.h"
+
+
+/**
+ * @brief Um assinante do barramento.
+ */
+struct event_bus_subscriber_t{
+	bool in_use;						/* a posição está ocupada (até a tarefa do assinante terminar) */
+	bool active;						/* recebe mensagens */
+	bool legacy;						/* registrado por wifi_manager_set_callback */
+	message_code_t code;
+	void (*func_ptr)(void*);
+	wifi_manager_dispatch_t dispatch;
+	QueueHandle_t queue;
+	TaskHandle_t task;
+	struct wifi_manager_subscriber_stats_t stats;
+};
+
+/**
+ * @brief Mensagem na fila de um assinante.
+ */
+struct event_bus_item_t{
+	queue_message msg;
+	int64_t posted_us;
+};
+
+/* @brief código que pede à tarefa de um assinante para terminar */
+#define EVENT_BUS_STOP						WM_MESSAGE_CODE_COUNT
+
+static const char TAG[] = "event_bus";
+
+/* @brief recursivo: um retorno de chamada em linha pode assinar ou cancelar assinaturas */
+static SemaphoreHandle_t event_bus_mutex = NULL;
+static struct event_bus_subscriber_t event_bus_subscribers[EVENT_BUS_MAX_SUBSCRIBERS];
+
+
+/**
+ * @brief Parâmetro passado ao retorno de chamada: os dados do evento para eventos do driver, NULL para as ordens.
+ */
+static void* event_bus_callback_arg(queue_message *msg){
+	switch(msg->code){
+	case WM_EVENT_SCAN_DONE:
+	case WM_EVENT_STA_DISCONNECTED:
+	case WM_EVENT_STA_GOT_IP:
+		return &msg->event;
+	default:
+		return NULL;
+	}
+}
+
+static inline bool event_bus_lock(){
+	return event_bus_mutex && xSemaphoreTakeRecursive(event_bus_mutex, portMAX_DELAY) == pdTRUE;
+}
+
+static inline void event_bus_unlock(){
+	xSemaphoreGiveRecursive(event_bus_mutex);
+}
+
+/**
+ * @brief Atualiza as estatísticas de um assinante. Deve ser chamada com o lock.
+ */
+static void event_bus_record(struct event_bus_subscriber_t *sub, int64_t wait_us, int64_t run_us){
+	struct wifi_manager_subscriber_stats_t *stats = &sub->stats;
+	stats->calls++;
+	stats->last_us = run_us;
+	stats->total_us += run_us;
+	if(run_us > stats->max_us) stats->max_us = run_us;
+	if(wait_us > stats->max_wait_us) stats->max_wait_us = wait_us;
+}
+
+/**
+ * @brief Tarefa de um assinante WIFI_MANAGER_DISPATCH_TASK: esvazia a fila do assinante.
+ */
+static void event_bus_task(void *pvParameters){
+
+	struct event_bus_subscriber_t *sub = (struct event_bus_subscriber_t*)pvParameters;
+	struct event_bus_item_t item;
+
+	for(;;){
+		if(xQueueReceive(sub->queue, &item, portMAX_DELAY) != pdPASS) continue;
+		if(item.msg.code == EVENT_BUS_STOP) break;
+
+		int64_t start = esp_timer_get_time();
+		(*sub->func_ptr)(event_bus_callback_arg(&item.msg));
+		int64_t end = esp_timer_get_time();
+
+		if(event_bus_lock()){
+			event_bus_record(sub, start - item.posted_us, end - start);
+			event_bus_unlock();
+		}
+	}
+
+	/* libere a posição somente agora: ninguém mais usa a fila */
+	if(event_bus_lock()){
+		vQueueDelete(sub->queue);
+		sub->queue = NULL;
+		sub->task = NULL;
+		sub->in_use = false;
+		event_bus_unlock();
+	}
+
+	vTaskDelete(NULL);
+}
+
+esp_err_t event_bus_create(){
+	if(event_bus_mutex == NULL){
+		memset(event_bus_subscribers, 0x00, sizeof(event_bus_subscribers));
+#if WIFI_MANAGER_STATIC_ALLOC
+		static StaticSemaphore_t event_bus_mutex_buffer;
+		event_bus_mutex = xSemaphoreCreateRecursiveMutexStatic(&event_bus_mutex_buffer);
+#else
+		event_bus_mutex = xSemaphoreCreateRecursiveMutex();
+#endif
+		return event_bus_mutex ? ESP_OK : ESP_FAIL;
+	}
+	return ESP_OK;
+}
+
+void event_bus_destroy(){
+
+	if(event_bus_mutex == NULL) return;
+
+	for(int i=0; i<EVENT_BUS_MAX_SUBSCRIBERS; i++){
+		event_bus_unsubscribe(i);
+	}
+
+	/* espere as tarefas dos assinantes terminarem antes de apagar o mutex que elas usam */
+	for(int tries=0; tries<100; tries++){
+		bool running = false;
+		if(event_bus_lock()){
+			for(int i=0; i<EVENT_BUS_MAX_SUBSCRIBERS; i++){
+				running |= event_bus_subscribers[i].in_use;
+			}
+			event_bus_unlock();
+		}
+		if(!running) break;
+		vTaskDelay(pdMS_TO_TICKS(10));
+	}
+
+	vSemaphoreDelete(event_bus_mutex);
+	event_bus_mutex = NULL;
+}
+
+void event_bus_publish(const queue_message *msg){
+
+	if(!event_bus_lock()) return;
+
+	for(int i=0; i<EVENT_BUS_MAX_SUBSCRIBERS; i++){
+		struct event_bus_subscriber_t *sub = &event_bus_subscribers[i];
+		if(!sub->active || sub->code != msg->code) continue;
+
+		if(sub->dispatch == WIFI_MANAGER_DISPATCH_INLINE){
+			/* a cópia garante que um assinante não altere o que o próximo recebe */
+			queue_message copy = *msg;
+			int64_t start = esp_timer_get_time();
+			(*sub->func_ptr)(event_bus_callback_arg(&copy));
+			event_bus_record(sub, 0, esp_timer_get_time() - start);
+		}
+		else{
+			struct event_bus_item_t item;
+			item.msg = *msg;
+			item.posted_us = esp_timer_get_time();
+
+			/* nunca bloqueie o wifi_manager por causa de um assinante lento */
+			if(xQueueSend(sub->queue, &item, 0) != pdPASS){
+				sub->stats.dropped++;
+			}
+		}
+	}
+
+	event_bus_unlock();
+}
+
+int event_bus_subscribe(message_code_t code, void (*func_ptr)(void*), wifi_manager_dispatch_t dispatch, uint16_t queue_depth){
+
+	int ret = -1;
+
+	if(func_ptr == NULL || code >= WM_MESSAGE_CODE_COUNT) return -1;
+	if(!event_bus_lock()) return -1;
+
+	for(int i=0; i<EVENT_BUS_MAX_SUBSCRIBERS; i++){
+		struct event_bus_subscriber_t *sub = &event_bus_subscribers[i];
+		if(sub->in_use) continue;
+
+		memset(sub, 0x00, sizeof(struct event_bus_subscriber_t));
+		sub->code = code;
+		sub->func_ptr = func_ptr;
+		sub->dispatch = dispatch;
+		sub->stats.code = code;
+		sub->stats.dispatch = dispatch;
+
+		if(dispatch == WIFI_MANAGER_DISPATCH_TASK){
+			sub->queue = xQueueCreate(queue_depth ? queue_depth : 1, sizeof(struct event_bus_item_t));
+			if(sub->queue == NULL){
+				break;
+			}
+			/* uma tarefa por assinante: a pilha é sempre do heap */
+			struct task_config_t task = *wifi_manager_get_task_config(WIFI_MANAGER_TASK_SUBSCRIBER);
+			task.stack_buffer = NULL;
+			task.tcb_buffer = NULL;
+			if(task_config_create(&task, &event_bus_task, "wm_subscriber", sub, &sub->task) != pdPASS){
+				vQueueDelete(sub->queue);
+				sub->queue = NULL;
+				break;
+			}
+		}
+
+		sub->in_use = true;
+		sub->active = true;
+		ret = i;
+		break;
+	}
+
+	event_bus_unlock();
+
+	if(ret < 0){
+		ESP_LOGE(TAG, "could not subscribe to message code %d", code);
+	}
+
+	return ret;
+}
+
+void event_bus_unsubscribe(int subscriber){
+
+	if(subscriber < 0 || subscriber >= EVENT_BUS_MAX_SUBSCRIBERS) return;
+	if(!event_bus_lock()) return;
+
+	struct event_bus_subscriber_t *sub = &event_bus_subscribers[subscriber];
+	if(sub->in_use && sub->active){
+		sub->active = false;
+
+		if(sub->dispatch == WIFI_MANAGER_DISPATCH_TASK){
+			/* descarte o que ainda estava pendente e peça à tarefa para terminar; ela libera a posição */
+			struct event_bus_item_t stop;
+			memset(&stop, 0x00, sizeof(stop));
+			stop.msg.code = EVENT_BUS_STOP;
+			xQueueReset(sub->queue);
+			xQueueSend(sub->queue, &stop, 0);
+		}
+		else{
+			sub->in_use = false;
+		}
+	}
+
+	event_bus_unlock();
+}
+
+void event_bus_set_legacy_callback(message_code_t code, void (*func_ptr)(void*)){
+
+	if(code >= WM_MESSAGE_CODE_COUNT) return;
+	if(!event_bus_lock()) return;
+
+	int legacy = -1;
+	for(int i=0; i<EVENT_BUS_MAX_SUBSCRIBERS; i++){
+		if(event_bus_subscribers[i].active && event_bus_subscribers[i].legacy && event_bus_subscribers[i].code == code){
+			legacy = i;
+			break;
+		}
+	}
+
+	if(func_ptr == NULL){
+		event_bus_unsubscribe(legacy);
+	}
+	else if(legacy >= 0){
+		event_bus_subscribers[legacy].func_ptr = func_ptr;
+	}
+	else{
+		legacy = event_bus_subscribe(code, func_ptr, WIFI_MANAGER_DISPATCH_INLINE, 0);
+		if(legacy >= 0) event_bus_subscribers[legacy].legacy = true;
+	}
+
+	event_bus_unlock();
+}
+
+esp_err_t event_bus_get_stats(int subscriber, struct wifi_manager_subscriber_stats_t *stats){
+
+	esp_err_t ret = ESP_ERR_NOT_FOUND;
+
+	if(subscriber < 0 || subscriber >= EVENT_BUS_MAX_SUBSCRIBERS) return ESP_ERR_INVALID_ARG;
+	if(!event_bus_lock()) return ESP_ERR_INVALID_STATE;
+
+	if(event_bus_subscribers[subscriber].active){
+		*stats = event_bus_subscribers[subscriber].stats;
+		stats->stack_free_min = event_bus_subscribers[subscriber].task ? (uint32_t)uxTaskGetStackHighWaterMark(event_bus_subscribers[subscriber].task) : 0;
+		ret = ESP_OK;
+	}
+
+	event_bus_unlock();
+
+	return ret;
+}
@@ -0,0 +1,90 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file event_bus.h
+@brief Barramento de eventos do wifi_manager: vários assinantes por código de mensagem
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_EVENT_BUS_H_INCLUDED
+#define WIFI_MANAGER_EVENT_BUS_H_INCLUDED
+
+#include <stdbool.h>
+#include <esp_err.h>
+#include "wifi_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** @brief Número máximo de assinantes, incluindo os registrados por wifi_manager_set_callback */
+#define EVENT_BUS_MAX_SUBSCRIBERS			16
+
+
+
+/**
+ * @brief Cria o mutex do barramento.
+ * @return ESP_OK em caso de sucesso ou se o barramento já existe, ESP_FAIL caso contrário
+ */
+esp_err_t event_bus_create();
+
+/**
+ * @brief Remove todos os assinantes, espera as tarefas dos assinantes terminarem e libera o barramento.
+ */
+void event_bus_destroy();
+
+/**
+ * @brief Entrega uma mensagem processada pelo wifi_manager a todos os assinantes do seu código.
+ * Assinantes WIFI_MANAGER_DISPATCH_INLINE são chamados aqui; os demais recebem uma cópia na sua fila.
+ */
+void event_bus_publish(const queue_message *msg);
+
+/**
+ * @see wifi_manager_subscribe
+ */
+int event_bus_subscribe(message_code_t code, void (*func_ptr)(void*), wifi_manager_dispatch_t dispatch, uint16_t queue_depth);
+
+/**
+ * @see wifi_manager_unsubscribe
+ */
+void event_bus_unsubscribe(int subscriber);
+
+/**
+ * @brief Registra, troca ou remove (func_ptr NULL) o único retorno de chamada legado de um código.
+ * @see wifi_manager_set_callback
+ */
+void event_bus_set_legacy_callback(message_code_t code, void (*func_ptr)(void*));
+
+/**
+ * @see wifi_manager_get_subscriber_stats
+ */
+esp_err_t event_bus_get_stats(int subscriber, struct wifi_manager_subscriber_stats_t *stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_EVENT_BUS_H_INCLUDED */
@@ -42,8 +42,12 @@ função para processar solicitações, decodificar URLs, servir arquivos, etc.
 #include <esp_system.h>
 #include "esp_netif.h"
 #include <esp_http_server.h>
+#include <esp_timer.h>
+#include <lwip/sockets.h>
 
 #include "wifi_manager.h"
+#include "msg_trace.h"
+#include "http_metrics.h"
 #include "http_app.h"
 
 
@@ -65,6 +69,45 @@ static char* http_css_url = NULL;
 static char* http_connect_url = NULL;
 static char* http_ap_url = NULL;
 static char* http_status_url = NULL;
+static char* http_trace_url = NULL;
+static char* http_boot_url = NULL;
+static char* http_latency_url = NULL;
+static char* http_metrics_url = NULL;
+static char* http_loop_url = NULL;
+static char* http_logs_url = NULL;
+static char* http_timeline_url = NULL;
+static char* http_tasks_url = NULL;
+
+/* @brief métricas por rota. Escritas apenas pela tarefa do servidor; o mux protege as cópias feitas por outras tarefas */
+static struct http_metrics_t http_metrics;
+static portMUX_TYPE http_metrics_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* @brief rota da requisição em andamento e o instante em que o manipulador foi chamado. O servidor atende uma requisição por vez */
+static http_route_t http_current_route = HTTP_ROUTE_NOT_FOUND;
+
+/* @brief a tarefa criada pelo esp_http_server, vista de dentro de um manipulador */
+static TaskHandle_t http_app_task = NULL;
+static int64_t http_request_start_us = 0;
+
+/* @brief buffer de um pedaço de /metrics.json ou /logs: estático para não pesar na pilha da tarefa do servidor */
+static char http_chunk[1280];
+
+/* @brief bytes reservados para os URLs desde o último http_app_stop */
+static size_t http_url_bytes = 0;
+
+#if WIFI_MANAGER_STATIC_ALLOC
+/* @brief URLs até http_app_stop: WEBAPP_LOCATION com o nome de cada página, mais o redirecionamento */
+static char http_url_pool[HTTP_ROUTE_COUNT * (sizeof(WEBAPP_LOCATION) + 16) + 32];
+static size_t http_url_pool_used = 0;
+/* @brief memória de uma requisição, até o fim do manipulador */
+static char http_scratch[WIFI_MANAGER_HTTP_SCRATCH_SIZE];
+static size_t http_scratch_used = 0;
+#if WIFI_MANAGER_TRACE
+/* /trace.bin inteiro, depois do cabeçalho Host da requisição */
+_Static_assert(64 + MSG_TRACE_HEADER_SIZE + WIFI_MANAGER_TRACE_DEPTH * MSG_TRACE_RECORD_SIZE <= WIFI_MANAGER_HTTP_SCRATCH_SIZE,
+		"WIFI_MANAGER_HTTP_SCRATCH_SIZE is too small for /trace.bin: raise it or lower WIFI_MANAGER_TRACE_DEPTH");
+#endif
+#endif
 
 /**
  * @brief dados binários incorporados.
@@ -90,6 +133,8 @@ const static char http_content_type_html[] = "text/html";
 const static char http_content_type_js[] = "text/javascript";
 const static char http_content_type_css[] = "text/css";
 const static char http_content_type_json[] = "application/json";
+const static char http_content_type_binary[] = "application/octet-stream";
+const static char http_content_type_text[] = "text/plain";
 const static char http_cache_control_hdr[] = "Cache-Control";
 const static char http_cache_control_no_cache[] = "no-store, no-cache, must-revalidate, max-age=0";
 const static char http_cache_control_cache[] = "public, max-age=31536000";
@@ -115,12 +160,109 @@ esp_err_t http_app_set_handler_hook( httpd_method_t method,  esp_err_t (*handler
 }
 
 
+/**
+ * @brief substitui o envio da sessão para contar bytes e códigos de status de todas as respostas, incluindo as dos ganchos do usuário.
+ */
+static int http_app_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags){
+
+	int ret = send(sockfd, buf, buf_len, flags);
+	if(ret < 0){
+		return (errno == EAGAIN || errno == EWOULDBLOCK) ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+	}
+
+	portENTER_CRITICAL(&http_metrics_mux);
+	http_metrics_record_send(&http_metrics, http_current_route, buf, (size_t)ret);
+	portEXIT_CRITICAL(&http_metrics_mux);
+
+	return ret;
+}
+
+/**
+ * @brief Reserva sz bytes para um URL (url, até http_app_stop) ou para a requisição em andamento (até http_app_request_end).
+ * Com WIFI_MANAGER_STATIC_ALLOC vem de http_url_pool ou de http_scratch, e é NULL se não couber.
+ */
+static void* http_app_alloc(size_t sz, bool url){
+	if(url) http_url_bytes += sz;
+#if WIFI_MANAGER_STATIC_ALLOC
+	char *pool = url ? http_url_pool : http_scratch;
+	size_t *used = url ? &http_url_pool_used : &http_scratch_used;
+	size_t size = url ? sizeof(http_url_pool) : sizeof(http_scratch);
+
+	sz = (sz + 3) & ~(size_t)3;
+	if(*used + sz > size) return NULL;
+	*used += sz;
+	return pool + *used - sz;
+#else
+	return malloc(sz);
+#endif
+}
+
+/**
+ * @brief Libera a memória de http_app_alloc. Com WIFI_MANAGER_STATIC_ALLOC não faz nada: os buffers são esvaziados de uma vez.
+ */
+static void http_app_free(void *ptr){
+#if !WIFI_MANAGER_STATIC_ALLOC
+	free(ptr);
+#endif
+}
+
+static void http_app_request_begin(httpd_req_t *req, http_route_t route){
+	TASK_TRACE_BEGIN(req->method == HTTP_GET ? "http GET" : (req->method == HTTP_POST ? "http POST" : "http DELETE"), 0);
+	http_current_route = route;
+	http_request_start_us = esp_timer_get_time();
+	httpd_sess_set_send_override(req->handle, httpd_req_to_sockfd(req), http_app_send);
+}
+
+static void http_app_request_end(){
+	uint32_t latency_us = (uint32_t)(esp_timer_get_time() - http_request_start_us);
+	portENTER_CRITICAL(&http_metrics_mux);
+	http_metrics_record_request(&http_metrics, http_current_route, latency_us);
+	portEXIT_CRITICAL(&http_metrics_mux);
+	TASK_TRACE_END("http", (int16_t)http_current_route);
+#if WIFI_MANAGER_STATIC_ALLOC
+	http_scratch_used = 0;
+#endif
+}
+
+/**
+ * @brief wifi_manager_lock_json_buffer com a espera medida.
+ */
+static bool http_app_lock_json_buffer(TickType_t xTicksToWait){
+	int64_t t0 = esp_timer_get_time();
+	bool acquired = wifi_manager_lock_json_buffer(xTicksToWait);
+	uint32_t wait_us = (uint32_t)(esp_timer_get_time() - t0);
+	portENTER_CRITICAL(&http_metrics_mux);
+	http_metrics_record_json_wait(&http_metrics, wait_us, acquired);
+	portEXIT_CRITICAL(&http_metrics_mux);
+	return acquired;
+}
+
+/**
+ * @brief Executado pela tarefa do servidor logo depois de httpd_start: a tarefa é conhecida antes da primeira requisição.
+ */
+static void http_app_capture_task(void *arg){
+	http_app_task = xTaskGetCurrentTaskHandle();
+}
+
+TaskHandle_t http_app_get_task(){
+	return http_app_task;
+}
+
+void http_app_get_metrics(struct http_metrics_t *metrics){
+	portENTER_CRITICAL(&http_metrics_mux);
+	memcpy(metrics, &http_metrics, sizeof(struct http_metrics_t));
+	portEXIT_CRITICAL(&http_metrics_mux);
+}
+
+
 static esp_err_t http_server_delete_handler(httpd_req_t *req){
 
-	ESP_LOGI(TAG, "DELETE %s", req->uri);
+	WM_LOGI(LOG_SUBSYSTEM_HTTP, TAG, "DELETE %s", req->uri);
+	http_app_request_begin(req, HTTP_ROUTE_NOT_FOUND);
 
 	/* DELETE /connect.json */
 	if(strcmp(req->uri, http_connect_url) == 0){
+		http_current_route = HTTP_ROUTE_CONNECT_DELETE;
 		wifi_manager_disconnect_async();
 
 		httpd_resp_set_status(req, http_200_hdr);
@@ -134,6 +276,7 @@ static esp_err_t http_server_delete_handler(httpd_req_t *req){
 		httpd_resp_send(req, NULL, 0);
 	}
 
+	http_app_request_end();
 	return ESP_OK;
 }
 
@@ -143,15 +286,17 @@ static esp_err_t http_server_post_handler(httpd_req_t *req){
 
 	esp_err_t ret = ESP_OK;
 
-	ESP_LOGI(TAG, "POST %s", req->uri);
+	WM_LOGI(LOG_SUBSYSTEM_HTTP, TAG, "POST %s", req->uri);
+	http_app_request_begin(req, HTTP_ROUTE_NOT_FOUND);
 
 	/* POST /connect.json */
 	if(strcmp(req->uri, http_connect_url) == 0){
+		http_current_route = HTTP_ROUTE_CONNECT_POST;
 
 
-		/* buffers para os cabeçalhos */
+		/* buffers para os cabeçalhos: os tamanhos são limitados abaixo */
 		size_t ssid_len = 0, password_len = 0;
-		char *ssid = NULL, *password = NULL;
+		char ssid[MAX_SSID_SIZE + 1], password[MAX_PASSWORD_SIZE + 1];
 
 		/* len de valores fornecidos */
 		ssid_len = httpd_req_get_hdr_value_len(req, "X-Custom-ssid");
@@ -161,8 +306,6 @@ static esp_err_t http_server_post_handler(httpd_req_t *req){
 		if(ssid_len && ssid_len <= MAX_SSID_SIZE && password_len && password_len <= MAX_PASSWORD_SIZE){
 
 			/* obter o valor real dos cabeçalhos */
-			ssid = malloc(sizeof(char) * (ssid_len + 1));
-			password = malloc(sizeof(char) * (password_len + 1));
 			httpd_req_get_hdr_value_str(req, "X-Custom-ssid", ssid, ssid_len+1);
 			httpd_req_get_hdr_value_str(req, "X-Custom-pwd", password, password_len+1);
 
@@ -174,10 +317,6 @@ static esp_err_t http_server_post_handler(httpd_req_t *req){
 			ESP_LOGD(TAG, "http_server_post_handler: wifi_manager_connect_async() call");
 			wifi_manager_connect_async();
 
-			/* memoria livre */
-			free(ssid);
-			free(password);
-
 			httpd_resp_set_status(req, http_200_hdr);
 			httpd_resp_set_type(req, http_content_type_json);
 			httpd_resp_set_hdr(req, http_cache_control_hdr, http_cache_control_no_cache);
@@ -201,10 +340,12 @@ static esp_err_t http_server_post_handler(httpd_req_t *req){
 		else{
 
 			/* se houver um gancho, execute-o */
+			http_current_route = HTTP_ROUTE_CUSTOM_POST;
 			ret = (*custom_post_httpd_uri_handler)(req);
 		}
 	}
 
+	http_app_request_end();
 	return ret;
 }
 
@@ -215,14 +356,15 @@ static esp_err_t http_server_get_handler(httpd_req_t *req){
     size_t buf_len;
     esp_err_t ret = ESP_OK;
 
-    ESP_LOGD(TAG, "GET %s", req->uri);
+    WM_LOGD(LOG_SUBSYSTEM_HTTP, TAG, "GET %s", req->uri);
+    http_app_request_begin(req, HTTP_ROUTE_NOT_FOUND);
 
     /* Obtenha o comprimento da string do valor do cabeçalho e aloque memória para o comprimento + 1,
      * byte extra para terminação nula */
     buf_len = httpd_req_get_hdr_value_len(req, "Host") + 1;
     if (buf_len > 1) {
-    	host = malloc(buf_len);
-    	if(httpd_req_get_hdr_value_str(req, "Host", host, buf_len) != ESP_OK){
+    	host = http_app_alloc(buf_len, false);
+    	if(host && httpd_req_get_hdr_value_str(req, "Host", host, buf_len) != ESP_OK){
     		/* se algo está errado nós apenas 0 toda a memória */
     		memset(host, 0x00, buf_len);
     	}
@@ -238,6 +380,7 @@ static esp_err_t http_server_get_handler(httpd_req_t *req){
 
 		/* Funcionalidade do portal cativo */
 		/* 302 Redirecionar para IP do ponto de acesso */
+		http_current_route = HTTP_ROUTE_REDIRECT;
 		httpd_resp_set_status(req, http_302_hdr);
 		httpd_resp_set_hdr(req, http_location_hdr, http_redirect_url);
 		httpd_resp_send(req, NULL, 0);
@@ -247,18 +390,21 @@ static esp_err_t http_server_get_handler(httpd_req_t *req){
 
 		/* GET /  */
 		if(strcmp(req->uri, http_root_url) == 0){
+			http_current_route = HTTP_ROUTE_ROOT;
 			httpd_resp_set_status(req, http_200_hdr);
 			httpd_resp_set_type(req, http_content_type_html);
 			httpd_resp_send(req, (char*)index_html_start, index_html_end - index_html_start);
 		}
 		/* GET /code.js */
 		else if(strcmp(req->uri, http_js_url) == 0){
+			http_current_route = HTTP_ROUTE_JS;
 			httpd_resp_set_status(req, http_200_hdr);
 			httpd_resp_set_type(req, http_content_type_js);
 			httpd_resp_send(req, (char*)code_js_start, code_js_end - code_js_start);
 		}
 		/* GET /style.css */
 		else if(strcmp(req->uri, http_css_url) == 0){
+			http_current_route = HTTP_ROUTE_CSS;
 			httpd_resp_set_status(req, http_200_hdr);
 			httpd_resp_set_type(req, http_content_type_css);
 			httpd_resp_set_hdr(req, http_cache_control_hdr, http_cache_control_cache);
@@ -267,15 +413,16 @@ static esp_err_t http_server_get_handler(httpd_req_t *req){
 		/* GET /ap.json */
 		else if(strcmp(req->uri, http_ap_url) == 0){
 
+			http_current_route = HTTP_ROUTE_AP;
 			/* if we can get the mutex, write the last version of the AP list */
-			if(wifi_manager_lock_json_buffer(( TickType_t ) 10)){
+			if(http_app_lock_json_buffer(( TickType_t ) 10)){
 
 				httpd_resp_set_status(req, http_200_hdr);
 				httpd_resp_set_type(req, http_content_type_json);
 				httpd_resp_set_hdr(req, http_cache_control_hdr, http_cache_control_no_cache);
 				httpd_resp_set_hdr(req, http_pragma_hdr, http_pragma_no_cache);
 				char* ap_buf = wifi_manager_get_ap_list_json();
-				httpd_resp_send(req, ap_buf, strlen(ap_buf));
+				httpd_resp_send(req, ap_buf, ap_buf ? strlen(ap_buf) : 0);
 				wifi_manager_unlock_json_buffer();
 			}
 			else{
@@ -290,7 +437,8 @@ static esp_err_t http_server_get_handler(httpd_req_t *req){
 		/* GET /status.json */
 		else if(strcmp(req->uri, http_status_url) == 0){
 
-			if(wifi_manager_lock_json_buffer(( TickType_t ) 10)){
+			http_current_route = HTTP_ROUTE_STATUS;
+			if(http_app_lock_json_buffer(( TickType_t ) 10)){
 				char *buff = wifi_manager_get_ip_info_json();
 				if(buff){
 					httpd_resp_set_status(req, http_200_hdr);
@@ -298,12 +446,12 @@ static esp_err_t http_server_get_handler(httpd_req_t *req){
 					httpd_resp_set_hdr(req, http_cache_control_hdr, http_cache_control_no_cache);
 					httpd_resp_set_hdr(req, http_pragma_hdr, http_pragma_no_cache);
 					httpd_resp_send(req, buff, strlen(buff));
-					wifi_manager_unlock_json_buffer();
 				}
 				else{
 					httpd_resp_set_status(req, http_503_hdr);
 					httpd_resp_send(req, NULL, 0);
 				}
+				wifi_manager_unlock_json_buffer();
 			}
 			else{
 				httpd_resp_set_status(req, http_503_hdr);
@@ -311,6 +459,146 @@ static esp_err_t http_server_get_handler(httpd_req_t *req){
 				ESP_LOGE(TAG, "http_server_netconn_serve: GET /status.json failed to obtain mutex");
 			}
 		}
+		/* GET /trace.bin */
+		else if(WIFI_MANAGER_TRACE && strcmp(req->uri, http_trace_url) == 0){
+
+			http_current_route = HTTP_ROUTE_TRACE;
+			/* a maior serialização possível: o trace não pode crescer além da sua capacidade entre as chamadas */
+			size_t sz = MSG_TRACE_HEADER_SIZE + WIFI_MANAGER_TRACE_DEPTH * MSG_TRACE_RECORD_SIZE;
+			uint8_t *buff = (uint8_t*)http_app_alloc(sz, false);
+			if(buff){
+				sz = wifi_manager_get_trace(buff, sz);
+				httpd_resp_set_status(req, http_200_hdr);
+				httpd_resp_set_type(req, http_content_type_binary);
+				httpd_resp_set_hdr(req, http_cache_control_hdr, http_cache_control_no_cache);
+				httpd_resp_send(req, (char*)buff, sz);
+				http_app_free(buff);
+			}
+			else{
+				httpd_resp_set_status(req, http_503_hdr);
+				httpd_resp_send(req, NULL, 0);
+			}
+		}
+		/* GET /boot.json */
+		else if(strcmp(req->uri, http_boot_url) == 0){
+
+			http_current_route = HTTP_ROUTE_BOOT;
+			size_t sz = wifi_manager_get_boot_trace(NULL, 0) + 1;
+			char *buff = (char*)http_app_alloc(sz, false);
+			if(buff && wifi_manager_get_boot_trace(buff, sz) < sz){
+				httpd_resp_set_status(req, http_200_hdr);
+				httpd_resp_set_type(req, http_content_type_json);
+				httpd_resp_set_hdr(req, http_cache_control_hdr, http_cache_control_no_cache);
+				httpd_resp_send(req, buff, strlen(buff));
+			}
+			else{
+				httpd_resp_set_status(req, http_503_hdr);
+				httpd_resp_send(req, NULL, 0);
+			}
+			http_app_free(buff);
+		}
+		/* GET /latency.json */
+		else if(strcmp(req->uri, http_latency_url) == 0){
+
+			http_current_route = HTTP_ROUTE_LATENCY;
+			size_t sz = wifi_manager_get_conn_latency_json(NULL, 0) + 1;
+			char *buff = (char*)http_app_alloc(sz, false);
+			if(buff && wifi_manager_get_conn_latency_json(buff, sz) < sz){
+				httpd_resp_set_status(req, http_200_hdr);
+				httpd_resp_set_type(req, http_content_type_json);
+				httpd_resp_set_hdr(req, http_cache_control_hdr, http_cache_control_no_cache);
+				httpd_resp_send(req, buff, strlen(buff));
+			}
+			else{
+				httpd_resp_set_status(req, http_503_hdr);
+				httpd_resp_send(req, NULL, 0);
+			}
+			http_app_free(buff);
+		}
+		/* GET /loop.json */
+		else if(strcmp(req->uri, http_loop_url) == 0){
+
+			http_current_route = HTTP_ROUTE_LOOP;
+			size_t sz = wifi_manager_get_msg_stats_json(NULL, 0) + 1;
+			char *buff = (char*)http_app_alloc(sz, false);
+			if(buff && wifi_manager_get_msg_stats_json(buff, sz) < sz){
+				httpd_resp_set_status(req, http_200_hdr);
+				httpd_resp_set_type(req, http_content_type_json);
+				httpd_resp_set_hdr(req, http_cache_control_hdr, http_cache_control_no_cache);
+				httpd_resp_send(req, buff, strlen(buff));
+			}
+			else{
+				httpd_resp_set_status(req, http_503_hdr);
+				httpd_resp_send(req, NULL, 0);
+			}
+			http_app_free(buff);
+		}
+		/* GET /logs */
+		else if(WIFI_MANAGER_ASYNC_LOG_HTTP && strcmp(req->uri, http_logs_url) == 0){
+
+			/* retira os registros do buffer de log, que não vão mais ao console; um pedaço por vez, limitado para não prender o servidor sob carga */
+			http_current_route = HTTP_ROUTE_LOGS;
+			httpd_resp_set_status(req, http_200_hdr);
+			httpd_resp_set_type(req, http_content_type_text);
+			httpd_resp_set_hdr(req, http_cache_control_hdr, http_cache_control_no_cache);
+			for(int i = 0; i < 32; i++){
+				size_t sz = async_log_read_text(http_chunk, sizeof(http_chunk));
+				if(sz == 0 || httpd_resp_send_chunk(req, http_chunk, sz) != ESP_OK) break;
+			}
+			httpd_resp_send_chunk(req, NULL, 0);
+		}
+		/* GET /timeline.json */
+		else if(WIFI_MANAGER_TASK_TRACE && strcmp(req->uri, http_timeline_url) == 0){
+
+			/* a gravação fica suspensa durante o envio: a linha do tempo lida é a de antes do pedido */
+			struct task_trace_reader_t reader;
+			http_current_route = HTTP_ROUTE_TIMELINE;
+			httpd_resp_set_status(req, http_200_hdr);
+			httpd_resp_set_type(req, http_content_type_json);
+			httpd_resp_set_hdr(req, http_cache_control_hdr, http_cache_control_no_cache);
+			task_trace_reader_begin(&reader);
+			for(;;){
+				size_t sz = task_trace_read_chrome(&reader, http_chunk, sizeof(http_chunk));
+				if(sz == 0 || httpd_resp_send_chunk(req, http_chunk, sz) != ESP_OK) break;
+			}
+			task_trace_reader_end(&reader);
+			httpd_resp_send_chunk(req, NULL, 0);
+		}
+		/* GET /tasks.json */
+		else if(strcmp(req->uri, http_tasks_url) == 0){
+
+			http_current_route = HTTP_ROUTE_TASKS;
+			size_t sz = wifi_manager_get_task_stats_json(NULL, 0) + 1;
+			char *buff = (char*)http_app_alloc(sz, false);
+			if(buff && wifi_manager_get_task_stats_json(buff, sz) < sz){
+				httpd_resp_set_status(req, http_200_hdr);
+				httpd_resp_set_type(req, http_content_type_json);
+				httpd_resp_set_hdr(req, http_cache_control_hdr, http_cache_control_no_cache);
+				httpd_resp_send(req, buff, strlen(buff));
+			}
+			else{
+				httpd_resp_set_status(req, http_503_hdr);
+				httpd_resp_send(req, NULL, 0);
+			}
+			http_app_free(buff);
+		}
+		/* GET /metrics.json */
+		else if(strcmp(req->uri, http_metrics_url) == 0){
+
+			/* enviado em pedaços a partir de um buffer fixo: nenhuma alocação, mesmo com o heap esgotado */
+			http_current_route = HTTP_ROUTE_METRICS;
+			httpd_resp_set_status(req, http_200_hdr);
+			httpd_resp_set_type(req, http_content_type_json);
+			httpd_resp_set_hdr(req, http_cache_control_hdr, http_cache_control_no_cache);
+			for(uint8_t part = 0; part < HTTP_METRICS_JSON_PARTS; part++){
+				size_t sz = http_metrics_json_chunk(&http_metrics, part, http_chunk, sizeof(http_chunk));
+				if(sz >= sizeof(http_chunk) || httpd_resp_send_chunk(req, http_chunk, sz) != ESP_OK){
+					ESP_LOGE(TAG, "GET /metrics.json: failed to send part %d", part);
+					break;
+				}
+			}
+			httpd_resp_send_chunk(req, NULL, 0);
+		}
 		else{
 
 			if(custom_get_httpd_uri_handler == NULL){
@@ -320,6 +608,7 @@ static esp_err_t http_server_get_handler(httpd_req_t *req){
 			else{
 
 				/* se houver um gancho, execute-o */
+				http_current_route = HTTP_ROUTE_CUSTOM_GET;
 				ret = (*custom_get_httpd_uri_handler)(req);
 			}
 		}
@@ -328,9 +617,10 @@ static esp_err_t http_server_get_handler(httpd_req_t *req){
 
     /* limpeza de memória */
     if(host != NULL){
-    	free(host);
+    	http_app_free(host);
     }
 
+    http_app_request_end();
     return ret;
 
 }
@@ -355,6 +645,10 @@ static const httpd_uri_t http_server_delete_request = {
 };
 
 
+size_t http_app_get_url_bytes(){
+	return http_url_bytes;
+}
+
 void http_app_stop(){
 
 	if(httpd_handle != NULL){
@@ -362,37 +656,75 @@ void http_app_stop(){
 
 		/* dealloc URLs */
 		if(http_root_url) {
-			free(http_root_url);
+			http_app_free(http_root_url);
 			http_root_url = NULL;
 		}
 		if(http_redirect_url){
-			free(http_redirect_url);
+			http_app_free(http_redirect_url);
 			http_redirect_url = NULL;
 		}
 		if(http_js_url){
-			free(http_js_url);
+			http_app_free(http_js_url);
 			http_js_url = NULL;
 		}
 		if(http_css_url){
-			free(http_css_url);
+			http_app_free(http_css_url);
 			http_css_url = NULL;
 		}
 		if(http_connect_url){
-			free(http_connect_url);
+			http_app_free(http_connect_url);
 			http_connect_url = NULL;
 		}
 		if(http_ap_url){
-			free(http_ap_url);
+			http_app_free(http_ap_url);
 			http_ap_url = NULL;
 		}
 		if(http_status_url){
-			free(http_status_url);
+			http_app_free(http_status_url);
 			http_status_url = NULL;
 		}
+		if(http_boot_url){
+			http_app_free(http_boot_url);
+			http_boot_url = NULL;
+		}
+		if(http_latency_url){
+			http_app_free(http_latency_url);
+			http_latency_url = NULL;
+		}
+		if(http_metrics_url){
+			http_app_free(http_metrics_url);
+			http_metrics_url = NULL;
+		}
+		if(http_loop_url){
+			http_app_free(http_loop_url);
+			http_loop_url = NULL;
+		}
+		if(http_logs_url){
+			http_app_free(http_logs_url);
+			http_logs_url = NULL;
+		}
+		if(http_timeline_url){
+			http_app_free(http_timeline_url);
+			http_timeline_url = NULL;
+		}
+		if(http_tasks_url){
+			http_app_free(http_tasks_url);
+			http_tasks_url = NULL;
+		}
+		if(http_trace_url){
+			http_app_free(http_trace_url);
+			http_trace_url = NULL;
+		}
+
+#if WIFI_MANAGER_STATIC_ALLOC
+		http_url_pool_used = 0;
+#endif
+		http_url_bytes = 0;
 
 		/* stop server */
 		httpd_stop(httpd_handle);
 		httpd_handle = NULL;
+		http_app_task = NULL;
 	}
 }
 
@@ -407,7 +739,7 @@ static char* http_app_generate_url(const char* page){
 	int root_len = strlen(WEBAPP_LOCATION);
 	const size_t url_sz = sizeof(char) * ( (root_len+1) + ( strlen(page) + 1) );
 
-	ret = malloc(url_sz);
+	ret = http_app_alloc(url_sz, true);
 	memset(ret, 0x00, url_sz);
 	strcpy(ret, WEBAPP_LOCATION);
 	ret = strcat(ret, page);
@@ -428,6 +760,12 @@ void http_app_start(bool lru_purge_enable){
 		config.uri_match_fn = httpd_uri_match_wildcard;
 		config.lru_purge_enable = lru_purge_enable;
 
+		/* pilha, prioridade e núcleo da topologia do wifi_manager */
+		const struct task_config_t *task = wifi_manager_get_task_config(WIFI_MANAGER_TASK_HTTPD);
+		config.stack_size = task->stack_size;
+		config.task_priority = task->priority;
+		config.core_id = task->core_id;
+
 		/* gerar os URLs */
 		if(http_root_url == NULL){
 			int root_len = strlen(WEBAPP_LOCATION);
@@ -438,16 +776,24 @@ void http_app_start(bool lru_purge_enable){
 			const char page_connect[] = "connect.json";
 			const char page_ap[] = "ap.json";
 			const char page_status[] = "status.json";
+			const char page_trace[] = "trace.bin";
+			const char page_boot[] = "boot.json";
+			const char page_latency[] = "latency.json";
+			const char page_metrics[] = "metrics.json";
+			const char page_loop[] = "loop.json";
+			const char page_logs[] = "logs";
+			const char page_timeline[] = "timeline.json";
+			const char page_tasks[] = "tasks.json";
 
 			/* root url, eg "/"   */
 			const size_t http_root_url_sz = sizeof(char) * (root_len+1);
-			http_root_url = malloc(http_root_url_sz);
+			http_root_url = http_app_alloc(http_root_url_sz, true);
 			memset(http_root_url, 0x00, http_root_url_sz);
 			strcpy(http_root_url, WEBAPP_LOCATION);
 
 			/* redirect url */
 			size_t redirect_sz = 22 + root_len + 1; /* strlen(http://255.255.255.255) + strlen("/") + 1 for \0 */
-			http_redirect_url = malloc(sizeof(char) * redirect_sz);
+			http_redirect_url = http_app_alloc(sizeof(char) * redirect_sz, true);
 			*http_redirect_url = '\0';
 
 			if(root_len == 1){
@@ -463,6 +809,14 @@ void http_app_start(bool lru_purge_enable){
 			http_connect_url = http_app_generate_url(page_connect);
 			http_ap_url = http_app_generate_url(page_ap);
 			http_status_url = http_app_generate_url(page_status);
+			http_trace_url = http_app_generate_url(page_trace);
+			http_boot_url = http_app_generate_url(page_boot);
+			http_latency_url = http_app_generate_url(page_latency);
+			http_metrics_url = http_app_generate_url(page_metrics);
+			http_loop_url = http_app_generate_url(page_loop);
+			http_logs_url = http_app_generate_url(page_logs);
+			http_timeline_url = http_app_generate_url(page_timeline);
+			http_tasks_url = http_app_generate_url(page_tasks);
 
 		}
 
@@ -473,6 +827,7 @@ void http_app_start(bool lru_purge_enable){
 	        httpd_register_uri_handler(httpd_handle, &http_server_get_request);
 	        httpd_register_uri_handler(httpd_handle, &http_server_post_request);
 	        httpd_register_uri_handler(httpd_handle, &http_server_delete_request);
+	        httpd_queue_work(httpd_handle, http_app_capture_task, NULL);
 	    }
 	}
 
@@ -36,6 +36,7 @@ função para processar solicitações, decodificar URLs, servir arquivos, etc.
 
 #include <stdbool.h>
 #include <esp_http_server.h>
+#include "http_metrics.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -59,12 +60,28 @@ void http_app_start(bool lru_purge_enable);
  */
 void http_app_stop();
 
+/**
+ * @brief Bytes usados pelos URLs das páginas, liberados por http_app_stop.
+ */
+size_t http_app_get_url_bytes();
+
 /** 
  * @brief define um gancho para os manipuladores de URI do gerenciador de wi-fi. Definir o manipulador como NULL desativa o gancho.
  * @return ESP_OK em caso de sucesso, ESP_ERR_INVALID_ARG se o método não for compatível.
  */
 esp_err_t http_app_set_handler_hook( httpd_method_t method,  esp_err_t (*handler)(httpd_req_t *r)  );
 
+/**
+ * @brief copia as métricas por rota do servidor: requisições, classes de status, bytes enviados e latência
+ * da entrada no manipulador até o fim do envio. Também servidas em GET /metrics.json.
+ */
+void http_app_get_metrics(struct http_metrics_t *metrics);
+
+/**
+ * @brief A tarefa do servidor HTTP, conhecida logo depois de http_app_start; NULL com o servidor parado.
+ */
+TaskHandle_t http_app_get_task();
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,115 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file http_metrics.c
+@brief Contadores por rota do servidor HTTP, de tamanho fixo
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include "text_writer.h"
+#include "http_metrics.h"
+
+
+static const char* const http_metrics_route_names[HTTP_ROUTE_COUNT] = {
+	"GET /",
+	"GET /code.js",
+	"GET /style.css",
+	"GET /ap.json",
+	"GET /status.json",
+	"GET /trace.bin",
+	"GET /boot.json",
+	"GET /latency.json",
+	"GET /metrics.json",
+	"GET /loop.json",
+	"GET /logs",
+	"GET /timeline.json",
+	"GET /tasks.json",
+	"POST /connect.json",
+	"DELETE /connect.json",
+	"GET redirect",
+	"GET custom",
+	"POST custom",
+	"not found"
+};
+
+
+void http_metrics_reset(struct http_metrics_t *metrics){
+	memset(metrics, 0x00, sizeof(struct http_metrics_t));
+}
+
+const char* http_metrics_route_to_str(http_route_t route){
+	return route < HTTP_ROUTE_COUNT ? http_metrics_route_names[route] : "?";
+}
+
+void http_metrics_record_request(struct http_metrics_t *metrics, http_route_t route, uint32_t latency_us){
+	if(route >= HTTP_ROUTE_COUNT) return;
+	metrics->routes[route].requests++;
+	latency_hist_record(&metrics->routes[route].latency_us, latency_us);
+}
+
+void http_metrics_record_send(struct http_metrics_t *metrics, http_route_t route, const char *buf, size_t len){
+
+	if(route >= HTTP_ROUTE_COUNT) return;
+	struct http_route_metrics_t *r = &metrics->routes[route];
+
+	r->bytes_sent += len;
+
+	/* "HTTP/1.1 200 OK": o primeiro envio de uma resposta é a linha de status */
+	if(len >= 12 && memcmp(buf, "HTTP/1.", 7) == 0 && buf[8] == ' '){
+		char c = buf[9];
+		r->status[(c >= '1' && c <= '5') ? c - '0' : 0]++;
+	}
+}
+
+void http_metrics_record_json_wait(struct http_metrics_t *metrics, uint32_t wait_us, bool acquired){
+	latency_hist_record(&metrics->json_wait_us, wait_us);
+	if(!acquired) metrics->json_wait_timeouts++;
+}
+
+size_t http_metrics_json_chunk(const struct http_metrics_t *metrics, uint8_t part, char *buf, size_t len){
+
+	size_t pos = 0;
+
+	if(part == 0){
+		text_append(buf, len, &pos, "{\"routes\":{");
+	}
+	else if(part == HTTP_METRICS_JSON_PARTS - 1){
+		text_append(buf, len, &pos, "},\"json_mutex_timeouts\":%u,\"json_mutex_wait_us\":", (unsigned)metrics->json_wait_timeouts);
+		pos += latency_hist_to_json(&metrics->json_wait_us, text_cursor(buf, len, pos), text_room(buf, len, pos));
+		text_append(buf, len, &pos, "}");
+	}
+	else if(part < HTTP_METRICS_JSON_PARTS){
+		http_route_t route = (http_route_t)(part - 1);
+		const struct http_route_metrics_t *r = &metrics->routes[route];
+		text_append(buf, len, &pos, "%s\"%s\":{\"requests\":%u,\"status\":{\"1xx\":%u,\"2xx\":%u,\"3xx\":%u,\"4xx\":%u,\"5xx\":%u,\"other\":%u},\"bytes_sent\":%llu,\"latency_us\":",
+				route == 0 ? "" : ",", http_metrics_route_names[route], (unsigned)r->requests,
+				(unsigned)r->status[1], (unsigned)r->status[2], (unsigned)r->status[3], (unsigned)r->status[4], (unsigned)r->status[5], (unsigned)r->status[0],
+				(unsigned long long)r->bytes_sent);
+		pos += latency_hist_to_json(&r->latency_us, text_cursor(buf, len, pos), text_room(buf, len, pos));
+		text_append(buf, len, &pos, "}");
+	}
+
+	return text_finish(buf, len, pos);
+}
@@ -0,0 +1,117 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file http_metrics.h
+@brief Contadores por rota do servidor HTTP, de tamanho fixo
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_HTTP_METRICS_H_INCLUDED
+#define WIFI_MANAGER_HTTP_METRICS_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "latency_hist.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Rotas contadas separadamente. As rotas dos ganchos do usuário são contadas juntas, por método.
+ */
+typedef enum http_route_t{
+	HTTP_ROUTE_ROOT = 0,
+	HTTP_ROUTE_JS = 1,
+	HTTP_ROUTE_CSS = 2,
+	HTTP_ROUTE_AP = 3,
+	HTTP_ROUTE_STATUS = 4,
+	HTTP_ROUTE_TRACE = 5,
+	HTTP_ROUTE_BOOT = 6,
+	HTTP_ROUTE_LATENCY = 7,
+	HTTP_ROUTE_METRICS = 8,
+	HTTP_ROUTE_LOOP = 9,
+	HTTP_ROUTE_LOGS = 10,
+	HTTP_ROUTE_TIMELINE = 11,
+	HTTP_ROUTE_TASKS = 12,
+	HTTP_ROUTE_CONNECT_POST = 13,
+	HTTP_ROUTE_CONNECT_DELETE = 14,
+	HTTP_ROUTE_REDIRECT = 15,		/* portal cativo: 302 para o IP do AP */
+	HTTP_ROUTE_CUSTOM_GET = 16,
+	HTTP_ROUTE_CUSTOM_POST = 17,
+	HTTP_ROUTE_NOT_FOUND = 18,
+	HTTP_ROUTE_COUNT = 19
+}http_route_t;
+
+/** @brief classes de código de status: 1xx a 5xx, e "other" para respostas sem linha de status reconhecível */
+#define HTTP_METRICS_STATUS_CLASSES			6
+
+struct http_route_metrics_t{
+	uint32_t requests;
+	uint32_t status[HTTP_METRICS_STATUS_CLASSES];	/* índice 0: outros; 1 a 5: 1xx a 5xx */
+	uint64_t bytes_sent;							/* cabeçalhos incluídos */
+	struct latency_hist_t latency_us;				/* da entrada no manipulador até o fim do envio */
+};
+
+struct http_metrics_t{
+	struct http_route_metrics_t routes[HTTP_ROUTE_COUNT];
+	struct latency_hist_t json_wait_us;		/* espera pelo mutex do buffer JSON do wifi_manager */
+	uint32_t json_wait_timeouts;
+};
+
+/** @brief número de partes de http_metrics_json_chunk: abertura, uma por rota, fechamento */
+#define HTTP_METRICS_JSON_PARTS				(HTTP_ROUTE_COUNT + 2)
+
+
+void http_metrics_reset(struct http_metrics_t *metrics);
+
+const char* http_metrics_route_to_str(http_route_t route);
+
+/**
+ * @brief Conta uma requisição terminada. Não é protegido: quem chama serializa os acessos.
+ */
+void http_metrics_record_request(struct http_metrics_t *metrics, http_route_t route, uint32_t latency_us);
+
+/**
+ * @brief Conta os bytes enviados para a rota. Se buf começa com uma linha de status HTTP, a classe do código também é contada.
+ */
+void http_metrics_record_send(struct http_metrics_t *metrics, http_route_t route, const char *buf, size_t len);
+
+void http_metrics_record_json_wait(struct http_metrics_t *metrics, uint32_t wait_us, bool acquired);
+
+/**
+ * @brief Serializa uma parte do JSON das métricas, para envio em pedaços sem alocação.
+ * @param part de 0 a HTTP_METRICS_JSON_PARTS - 1.
+ * @return o tamanho da parte, sem o terminador. Nada é escrito se buf for NULL ou menor que esse tamanho + 1.
+ */
+size_t http_metrics_json_chunk(const struct http_metrics_t *metrics, uint8_t part, char *buf, size_t len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_HTTP_METRICS_H_INCLUDED */
@@ -0,0 +1,110 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file latency_hist.c
+@brief Histograma de latência com baldes fixos, sem alocação
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include "text_writer.h"
+#include "latency_hist.h"
+
+
+void latency_hist_reset(struct latency_hist_t *hist){
+	memset(hist, 0x00, sizeof(struct latency_hist_t));
+}
+
+uint8_t latency_hist_bucket(uint32_t value){
+
+	if(value < 2) return (uint8_t)value;
+
+	/* posição do bit mais alto e o bit logo abaixo dele */
+	uint8_t octave = 31 - (uint8_t)__builtin_clz(value);
+	uint8_t idx = 2 * octave + ((value >> (octave - 1)) & 1);
+
+	return idx < LATENCY_HIST_BUCKETS ? idx : LATENCY_HIST_BUCKETS - 1;
+}
+
+/**
+ * @brief Menor valor contado no balde idx.
+ */
+static uint32_t latency_hist_bucket_lower(uint8_t idx){
+	if(idx < 2) return idx;
+	uint8_t octave = idx / 2;
+	return (1UL << octave) + (idx & 1) * (1UL << (octave - 1));
+}
+
+uint32_t latency_hist_bucket_upper(uint8_t idx){
+	if(idx >= LATENCY_HIST_BUCKETS - 1) return UINT32_MAX;
+	return latency_hist_bucket_lower(idx + 1) - 1;
+}
+
+void latency_hist_record(struct latency_hist_t *hist, uint32_t value){
+	hist->count++;
+	hist->sum += value;
+	if(value > hist->max) hist->max = value;
+	hist->buckets[latency_hist_bucket(value)]++;
+}
+
+uint32_t latency_hist_percentile(const struct latency_hist_t *hist, uint16_t per_mille){
+
+	if(hist->count == 0) return 0;
+
+	/* posição do percentil, arredondada para cima */
+	uint64_t rank = ((uint64_t)hist->count * per_mille + 999) / 1000;
+	uint64_t seen = 0;
+	if(rank == 0) rank = 1;
+
+	for(uint8_t i=0; i<LATENCY_HIST_BUCKETS; i++){
+		seen += hist->buckets[i];
+		if(seen >= rank){
+			uint32_t upper = latency_hist_bucket_upper(i);
+			return upper < hist->max ? upper : hist->max;
+		}
+	}
+
+	return hist->max;
+}
+
+size_t latency_hist_to_json(const struct latency_hist_t *hist, char *buf, size_t len){
+
+	size_t pos = 0;
+
+	text_append(buf, len, &pos, "{\"count\":%u,\"sum\":%llu,\"max\":%u,\"p50\":%u,\"p90\":%u,\"p99\":%u,\"buckets\":[",
+			(unsigned)hist->count, (unsigned long long)hist->sum, (unsigned)hist->max,
+			(unsigned)latency_hist_percentile(hist, 500), (unsigned)latency_hist_percentile(hist, 900), (unsigned)latency_hist_percentile(hist, 990));
+
+	const char *sep = "";
+	for(uint8_t i=0; i<LATENCY_HIST_BUCKETS; i++){
+		if(hist->buckets[i] == 0) continue;
+		long long upper = i == LATENCY_HIST_BUCKETS - 1 ? -1 : (long long)latency_hist_bucket_upper(i);
+		text_append(buf, len, &pos, "%s[%lld,%u]", sep, upper, (unsigned)hist->buckets[i]);
+		sep = ",";
+	}
+
+	text_append(buf, len, &pos, "]}");
+
+	return text_finish(buf, len, pos);
+}
@@ -0,0 +1,92 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file latency_hist.h
+@brief Histograma de latência com baldes fixos, sem alocação
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_LATENCY_HIST_H_INCLUDED
+#define WIFI_MANAGER_LATENCY_HIST_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Número de baldes. Dois baldes por potência de 2 (resolução de 50%): os valores 0 e 1 têm um balde cada,
+ * e o último balde recebe tudo a partir de 786432 unidades. A unidade (us, ms) é escolhida por quem registra.
+ */
+#define LATENCY_HIST_BUCKETS				40
+
+
+struct latency_hist_t{
+	uint32_t count;
+	uint32_t max;
+	uint64_t sum;
+	uint32_t buckets[LATENCY_HIST_BUCKETS];
+};
+
+
+void latency_hist_reset(struct latency_hist_t *hist);
+
+/**
+ * @brief Registra um valor. Não é protegido: quem chama serializa os acessos.
+ */
+void latency_hist_record(struct latency_hist_t *hist, uint32_t value);
+
+/**
+ * @brief Índice do balde que recebe um valor.
+ */
+uint8_t latency_hist_bucket(uint32_t value);
+
+/**
+ * @brief Maior valor contado no balde idx; UINT32_MAX para o último balde.
+ */
+uint32_t latency_hist_bucket_upper(uint8_t idx);
+
+/**
+ * @brief Estimativa conservadora de um percentil: o limite superior do balde que o contém, limitado ao máximo registrado.
+ * @param per_mille o percentil em milésimos: 500 para p50, 990 para p99, 999 para p99.9.
+ * @return 0 se o histograma estiver vazio.
+ */
+uint32_t latency_hist_percentile(const struct latency_hist_t *hist, uint16_t per_mille);
+
+/**
+ * @brief Serializa como um objeto JSON: count, sum, max, p50, p90, p99 e os baldes não vazios como pares [limite superior, contagem].
+ * O último balde usa -1 como limite.
+ * @return o tamanho do JSON, sem o terminador. Nada é escrito se buf for NULL ou menor que esse tamanho + 1.
+ */
+size_t latency_hist_to_json(const struct latency_hist_t *hist, char *buf, size_t len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_LATENCY_HIST_H_INCLUDED */
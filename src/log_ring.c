@@ -0,0 +1,284 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file log_ring.c
+@brief Registros de log binários em um buffer circular sem trava, formatados depois
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "text_writer.h"
+#include "log_ring.h"
+
+
+bool log_ring_init(struct log_ring_t *ring, uint16_t capacity){
+
+	struct log_ring_cell_t *cells;
+	uint16_t size = 1;
+
+	memset(ring, 0x00, sizeof(struct log_ring_t));
+	if(capacity < 2) return false;
+	while(size * 2 <= capacity) size *= 2;
+
+	cells = (struct log_ring_cell_t*)calloc(size, sizeof(struct log_ring_cell_t));
+	if(cells == NULL) return false;
+	log_ring_init_static(ring, cells, size);
+	ring->owned = true;
+
+	return true;
+}
+
+bool log_ring_init_static(struct log_ring_t *ring, struct log_ring_cell_t *cells, uint16_t capacity){
+
+	uint32_t size = 1;
+
+	memset(ring, 0x00, sizeof(struct log_ring_t));
+	if(cells == NULL || capacity < 2) return false;
+	while(size * 2 <= capacity) size *= 2;
+
+	ring->cells = cells;
+	for(uint32_t i=0; i<size; i++){
+		ring->cells[i].seq = i;
+	}
+	ring->mask = size - 1;
+
+	for(int s=0; s<LOG_SUBSYSTEM_COUNT; s++){
+		ring->levels[s] = LOG_RING_LEVEL_INFO;
+		ring->sampling[s] = 1;
+	}
+
+	return true;
+}
+
+void log_ring_free(struct log_ring_t *ring){
+	if(ring->owned) free(ring->cells);
+	memset(ring, 0x00, sizeof(struct log_ring_t));
+}
+
+void log_ring_set_level(struct log_ring_t *ring, log_subsystem_t subsystem, uint8_t level){
+	if(subsystem < LOG_SUBSYSTEM_COUNT) ring->levels[subsystem] = level;
+}
+
+void log_ring_set_sampling(struct log_ring_t *ring, log_subsystem_t subsystem, uint16_t one_in){
+	if(subsystem < LOG_SUBSYSTEM_COUNT) ring->sampling[subsystem] = one_in ? one_in : 1;
+}
+
+/**
+ * @brief Avança p além de uma especificação de conversão de printf, a partir do caractere depois de '%'.
+ * @param supported recebe false para largura ou precisão '*' e conversões de ponto flutuante, que consomem
+ * argumentos que não são guardados.
+ * @return o caractere de conversão, ou '\0' se o formato terminar antes dele.
+ */
+static char log_ring_skip_spec(const char **p, bool *wide, bool *supported){
+
+	const char *c = *p;
+
+	*wide = false;
+	*supported = true;
+	while(*c && strchr("-+ #0", *c)) c++;
+	while(*c && ((*c >= '0' && *c <= '9') || *c == '.' || *c == '*')){
+		if(*c == '*') *supported = false;
+		c++;
+	}
+	while(*c && strchr("hlzjt", *c)){
+		if(c[0] == 'l' && c[1] == 'l') *wide = true;
+		c++;
+	}
+	if(*c && strchr("LfFeEgGaA", *c)) *supported = false;
+	*p = *c ? c + 1 : c;
+
+	return *c;
+}
+
+bool log_ring_vwrite(struct log_ring_t *ring, log_subsystem_t subsystem, uint8_t level, uint32_t time_ms, const char *tag, const char *format, va_list args){
+
+	struct log_ring_cell_t *cell;
+	uint32_t pos;
+
+	if(ring->cells == NULL || subsystem >= LOG_SUBSYSTEM_COUNT || level > ring->levels[subsystem]) return false;
+
+	if(level >= LOG_RING_LEVEL_INFO && ring->sampling[subsystem] > 1){
+		if(__sync_fetch_and_add(&ring->sample_counter[subsystem], 1) % ring->sampling[subsystem] != 0){
+			__sync_fetch_and_add(&ring->stats.sampled_out, 1);
+			return false;
+		}
+	}
+
+	/* reserva de uma célula: ela está livre quando seq == pos */
+	pos = ring->enqueue_pos;
+	for(;;){
+		cell = &ring->cells[pos & ring->mask];
+		int32_t diff = (int32_t)(cell->seq - pos);
+		if(diff == 0){
+			if(__sync_bool_compare_and_swap(&ring->enqueue_pos, pos, pos + 1)) break;
+		}
+		else if(diff < 0){
+			/* o consumidor ainda não liberou esta célula: buffer cheio */
+			__sync_fetch_and_add(&ring->stats.dropped, 1);
+			return false;
+		}
+		pos = ring->enqueue_pos;
+	}
+
+	struct log_ring_record_t *r = &cell->record;
+	r->time_ms = time_ms;
+	r->tag = tag;
+	r->format = format;
+	r->subsystem = (uint8_t)subsystem;
+	r->level = level;
+	r->nargs = 0;
+	r->raw = 0;
+	r->str[0] = '\0';
+
+	/* só os argumentos são guardados; o formato é lido de novo na formatação */
+	bool has_str = false;
+	for(const char *p = format; *p; ){
+		if(*p++ != '%') continue;
+		if(*p == '%'){ p++; continue; }
+		bool wide, supported;
+		char conv = log_ring_skip_spec(&p, &wide, &supported);
+		uint32_t value;
+		if(conv == '\0') break;
+		if(!supported){
+			/* os argumentos seguintes não podem ser lidos com segurança */
+			r->nargs = 0;
+			r->str[0] = '\0';
+			r->raw = 1;
+			break;
+		}
+		if(conv == 's'){
+			const char *s = va_arg(args, const char*);
+			if(!has_str){
+				strncpy(r->str, s ? s : "(null)", LOG_RING_STR_SIZE - 1);
+				r->str[LOG_RING_STR_SIZE - 1] = '\0';
+				has_str = true;
+			}
+			continue;
+		}
+		else if(conv == 'p'){
+			value = (uint32_t)(uintptr_t)va_arg(args, void*);
+		}
+		else if(wide){
+			value = (uint32_t)va_arg(args, long long);
+		}
+		else{
+			value = (uint32_t)va_arg(args, unsigned int);
+		}
+		if(r->nargs < LOG_RING_MAX_ARGS) r->args[r->nargs++] = value;
+	}
+
+	__sync_synchronize();
+	cell->seq = pos + 1;
+
+	__sync_fetch_and_add(&ring->stats.written, 1);
+
+	return true;
+}
+
+bool log_ring_pop(struct log_ring_t *ring, struct log_ring_record_t *record){
+
+	if(ring->cells == NULL) return false;
+
+	uint32_t pos = ring->dequeue_pos;
+	struct log_ring_cell_t *cell = &ring->cells[pos & ring->mask];
+
+	/* pronta quando seq == pos + 1 */
+	if((int32_t)(cell->seq - (pos + 1)) < 0) return false;
+	__sync_synchronize();
+
+	memcpy(record, &cell->record, sizeof(struct log_ring_record_t));
+
+	__sync_synchronize();
+	cell->seq = pos + ring->mask + 1;
+	ring->dequeue_pos = pos + 1;
+
+	return true;
+}
+
+size_t log_ring_format(const struct log_ring_record_t *record, char *buf, size_t len){
+
+	static const char levels[] = "NEWIDV";
+	char spec[16];
+	size_t pos = 0;
+	uint8_t arg = 0;
+	bool str_used = false;
+
+	text_append(buf, len, &pos, "%c (%u) %s: ", record->level <= LOG_RING_LEVEL_VERBOSE ? levels[record->level] : '?', (unsigned)record->time_ms, record->tag ? record->tag : "");
+	if(record->raw) text_append(buf, len, &pos, "%s", record->format);
+
+	for(const char *p = record->raw ? "" : record->format; *p; ){
+
+		/* texto literal até o próximo '%' */
+		const char *start = p;
+		while(*p && *p != '%') p++;
+		if(p > start) text_append(buf, len, &pos, "%.*s", (int)(p - start), start);
+		if(*p == '\0') break;
+
+		if(p[1] == '%'){
+			text_append(buf, len, &pos, "%%");
+			p += 2;
+			continue;
+		}
+
+		/* cópia da especificação sem os modificadores de tamanho: todos os argumentos guardados têm 32 bits */
+		const char *spec_start = p++;
+		bool wide, supported;
+		char conv = log_ring_skip_spec(&p, &wide, &supported);
+		size_t n = 0;
+		for(const char *c = spec_start; c < p && n < sizeof(spec) - 1; c++){
+			if(!strchr("hlzjt", *c)) spec[n++] = *c;
+		}
+		spec[n] = '\0';
+
+		if(conv == 's'){
+			text_append(buf, len, &pos, spec, str_used ? "?" : record->str);
+			str_used = true;
+		}
+		else if(conv == '\0'){
+			break;
+		}
+		else{
+			uint32_t value = arg < record->nargs ? record->args[arg] : 0;
+			arg++;
+			if(conv == 'd' || conv == 'i'){
+				text_append(buf, len, &pos, spec, (int)value);
+			}
+			else if(conv == 'p'){
+				text_append(buf, len, &pos, "0x%08x", (unsigned)value);
+			}
+			else{
+				text_append(buf, len, &pos, spec, (unsigned)value);
+			}
+		}
+	}
+
+	return text_finish(buf, len, pos);
+}
+
+void log_ring_get_stats(const struct log_ring_t *ring, struct log_ring_stats_t *stats){
+	stats->written = ring->stats.written;
+	stats->dropped = ring->stats.dropped;
+	stats->sampled_out = ring->stats.sampled_out;
+}
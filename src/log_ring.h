@@ -0,0 +1,153 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file log_ring.h
+@brief Registros de log binários em um buffer circular sem trava, formatados depois
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_LOG_RING_H_INCLUDED
+#define WIFI_MANAGER_LOG_RING_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdarg.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** @brief número máximo de argumentos inteiros guardados por registro; os seguintes são ignorados */
+#define LOG_RING_MAX_ARGS					4
+
+/** @brief espaço para o argumento %s de um registro, incluindo o terminador. Strings maiores são truncadas */
+#define LOG_RING_STR_SIZE					32
+
+/** @brief níveis, com os mesmos valores de esp_log_level_t */
+#define LOG_RING_LEVEL_NONE					0
+#define LOG_RING_LEVEL_ERROR				1
+#define LOG_RING_LEVEL_WARN					2
+#define LOG_RING_LEVEL_INFO					3
+#define LOG_RING_LEVEL_DEBUG				4
+#define LOG_RING_LEVEL_VERBOSE				5
+
+
+/**
+ * @brief Subsistemas com nível e amostragem próprios.
+ */
+typedef enum log_subsystem_t{
+	LOG_SUBSYSTEM_MANAGER = 0,
+	LOG_SUBSYSTEM_HTTP = 1,
+	LOG_SUBSYSTEM_DNS = 2,
+	LOG_SUBSYSTEM_COUNT = 3
+}log_subsystem_t;
+
+/**
+ * @brief Um registro: o formato é guardado por endereço (ele precisa existir para sempre, como uma string literal)
+ * e os argumentos em binário. Suporta inteiros de até 32 bits e um único %s; um formato com largura ou precisão '*'
+ * ou com ponto flutuante é guardado sem argumentos e formatado cru.
+ */
+struct log_ring_record_t{
+	uint32_t time_ms;
+	const char *tag;
+	const char *format;
+	uint8_t subsystem;
+	uint8_t level;
+	uint8_t nargs;
+	uint8_t raw;				/* o formato tem uma conversão não suportada */
+	uint32_t args[LOG_RING_MAX_ARGS];
+	char str[LOG_RING_STR_SIZE];
+};
+
+struct log_ring_cell_t{
+	volatile uint32_t seq;
+	struct log_ring_record_t record;
+};
+
+struct log_ring_stats_t{
+	uint32_t written;
+	uint32_t dropped;			/* buffer cheio */
+	uint32_t sampled_out;		/* descartados pela amostragem */
+};
+
+/**
+ * @brief Fila limitada com vários produtores e um consumidor, sem trava: cada célula tem um número de sequência
+ * que diz se ela está livre para o próximo produtor ou pronta para o consumidor. Com o buffer cheio, o registro novo é descartado.
+ */
+struct log_ring_t{
+	struct log_ring_cell_t *cells;
+	uint32_t mask;
+	volatile uint32_t enqueue_pos;
+	volatile uint32_t dequeue_pos;
+	uint8_t levels[LOG_SUBSYSTEM_COUNT];
+	uint16_t sampling[LOG_SUBSYSTEM_COUNT];			/* 1 registro INFO ou mais detalhado em cada N é mantido */
+	volatile uint32_t sample_counter[LOG_SUBSYSTEM_COUNT];
+	volatile struct log_ring_stats_t stats;
+	bool owned;											/* cells foi alocado por log_ring_init */
+};
+
+
+/**
+ * @brief Aloca o buffer. A capacidade é arredondada para baixo até uma potência de 2.
+ * Todos os subsistemas começam no nível INFO, sem amostragem.
+ */
+bool log_ring_init(struct log_ring_t *ring, uint16_t capacity);
+/** @brief Como log_ring_init, sobre um buffer de quem chama com capacity células. */
+bool log_ring_init_static(struct log_ring_t *ring, struct log_ring_cell_t *cells, uint16_t capacity);
+void log_ring_free(struct log_ring_t *ring);
+
+void log_ring_set_level(struct log_ring_t *ring, log_subsystem_t subsystem, uint8_t level);
+
+/**
+ * @brief Mantém 1 em cada one_in registros INFO, DEBUG e VERBOSE do subsistema. Erros e avisos são sempre mantidos.
+ */
+void log_ring_set_sampling(struct log_ring_t *ring, log_subsystem_t subsystem, uint16_t one_in);
+
+/**
+ * @brief Grava um registro sem formatar a mensagem. Pode ser chamado por várias tarefas ao mesmo tempo, nunca bloqueia.
+ * @return false se o registro foi filtrado pelo nível, pela amostragem ou descartado com o buffer cheio.
+ */
+bool log_ring_vwrite(struct log_ring_t *ring, log_subsystem_t subsystem, uint8_t level, uint32_t time_ms, const char *tag, const char *format, va_list args);
+
+/**
+ * @brief Retira o registro mais antigo. Um único consumidor por vez.
+ */
+bool log_ring_pop(struct log_ring_t *ring, struct log_ring_record_t *record);
+
+/**
+ * @brief Formata um registro como uma linha do esp_log, sem a quebra de linha: "I (1234) tag: mensagem".
+ * @return o tamanho da linha, sem o terminador. Nada é escrito se buf for NULL ou menor que esse tamanho + 1.
+ */
+size_t log_ring_format(const struct log_ring_record_t *record, char *buf, size_t len);
+
+void log_ring_get_stats(const struct log_ring_t *ring, struct log_ring_stats_t *stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_LOG_RING_H_INCLUDED */
@@ -0,0 +1,85 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file message_codes.h
+@brief Códigos das mensagens do wifi_manager, sem dependência do esp-idf
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_MESSAGE_CODES_H_INCLUDED
+#define WIFI_MANAGER_MESSAGE_CODES_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Define a lista completa de todas as mensagens que o wifi_manager pode processar.
+ *
+ * Algumas dessas mensagens são eventos ("EVENTO") e algumas delas são ações ("PEDIDO")
+ * Cada uma dessas mensagens pode acionar funções de retorno de chamada, indexadas pelo código da mensagem.
+ * Por causa desse comportamento, é extremamente importante
+ * para manter uma sequência estrita e o elemento especial de nível superior 'MESSAGE_CODE_COUNT'
+ *
+ * @see wifi_manager_set_callback
+ * @see wifi_manager_subscribe
+ */
+typedef enum message_code_t {
+	NONE = 0,
+	WM_ORDER_START_HTTP_SERVER = 1,
+	WM_ORDER_STOP_HTTP_SERVER = 2,
+	WM_ORDER_START_DNS_SERVICE = 3,
+	WM_ORDER_STOP_DNS_SERVICE = 4,
+	WM_ORDER_START_WIFI_SCAN = 5,
+	WM_ORDER_LOAD_AND_RESTORE_STA = 6,
+	WM_ORDER_CONNECT_STA = 7,
+	WM_ORDER_DISCONNECT_STA = 8,
+	WM_ORDER_START_AP = 9,
+	WM_EVENT_STA_DISCONNECTED = 10,
+	WM_EVENT_SCAN_DONE = 11,
+	WM_EVENT_STA_GOT_IP = 12,
+	WM_ORDER_STOP_AP = 13,
+	WM_EVENT_STA_LEASE_EXPIRED = 14,
+	WM_MESSAGE_CODE_COUNT = 15 /* important for the callback array */
+
+}message_code_t;
+
+/**
+ * @brief Quem pediu uma conexão: o parâmetro de WM_ORDER_CONNECT_STA.
+ */
+typedef enum connection_request_made_by_code_t{
+	CONNECTION_REQUEST_NONE = 0,
+	CONNECTION_REQUEST_USER = 1,
+	CONNECTION_REQUEST_AUTO_RECONNECT = 2,
+	CONNECTION_REQUEST_RESTORE_CONNECTION = 3,
+	CONNECTION_REQUEST_MAX = 0x7fffffff /*forçar a criação deste enum como um 32 bit int */
+}connection_request_made_by_code_t;
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_MESSAGE_CODES_H_INCLUDED */
@@ -0,0 +1,138 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file message_ring.c
+@brief Fila de mensagens de tamanho fixo que nunca bloqueia quem posta e funde ordens repetidas
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "message_ring.h"
+
+
+bool message_ring_init(struct message_ring_t *ring, uint16_t capacity, size_t item_size, uint32_t coalesce_mask, message_ring_merge_fn merge){
+
+	uint8_t *items = (uint8_t*)malloc(capacity * item_size);
+	uint8_t *codes = (uint8_t*)malloc(capacity);
+	if(items == NULL || codes == NULL){
+		free(items);
+		free(codes);
+		memset(ring, 0x00, sizeof(struct message_ring_t));
+		return false;
+	}
+
+	message_ring_init_static(ring, capacity, item_size, items, codes, coalesce_mask, merge);
+	ring->owned = true;
+
+	return true;
+}
+
+void message_ring_init_static(struct message_ring_t *ring, uint16_t capacity, size_t item_size, uint8_t *items, uint8_t *codes, uint32_t coalesce_mask, message_ring_merge_fn merge){
+
+	memset(ring, 0x00, sizeof(struct message_ring_t));
+	ring->items = items;
+	ring->codes = codes;
+	ring->capacity = capacity;
+	ring->item_size = item_size;
+	ring->coalesce_mask = coalesce_mask;
+	ring->merge = merge;
+}
+
+void message_ring_free(struct message_ring_t *ring){
+	if(ring->owned){
+		free(ring->items);
+		free(ring->codes);
+	}
+	ring->owned = false;
+	ring->items = NULL;
+	ring->codes = NULL;
+	ring->capacity = 0;
+	ring->count = 0;
+}
+
+static inline bool message_ring_coalesces(const struct message_ring_t *ring, uint8_t code){
+	return code < 32 && (ring->coalesce_mask & (1UL << code));
+}
+
+/**
+ * @brief A nova mensagem só pode ser fundida com a última da fila, se ela tiver o mesmo código.
+ * Fundir com uma mensagem mais antiga faria a nova passar à frente das que vieram depois dela,
+ * por exemplo um CONNECT_STA à frente de um STA_DISCONNECTED.
+ * @return a posição na fila ou -1.
+ */
+static int message_ring_find_coalesce_slot(const struct message_ring_t *ring, uint8_t code){
+
+	if(ring->count == 0) return -1;
+
+	uint16_t slot = (ring->head + ring->count - 1) % ring->capacity;
+
+	return ring->codes[slot] == code ? slot : -1;
+}
+
+message_ring_result_t message_ring_push(struct message_ring_t *ring, uint8_t code, const void *item, bool to_front){
+
+	if(!to_front && message_ring_coalesces(ring, code)){
+		int slot = message_ring_find_coalesce_slot(ring, code);
+		if(slot >= 0){
+			if(ring->merge) ring->merge(code, ring->items + slot * ring->item_size, item);
+			ring->coalesced++;
+			return MESSAGE_RING_COALESCED;
+		}
+	}
+
+	if(ring->count >= ring->capacity){
+		ring->dropped++;
+		return MESSAGE_RING_DROPPED;
+	}
+
+	uint16_t slot;
+	if(to_front){
+		ring->head = (ring->head + ring->capacity - 1) % ring->capacity;
+		slot = ring->head;
+	}
+	else{
+		slot = (ring->head + ring->count) % ring->capacity;
+	}
+
+	memcpy(ring->items + slot * ring->item_size, item, ring->item_size);
+	ring->codes[slot] = code;
+	ring->count++;
+	ring->queued++;
+	if(ring->count > ring->high_water) ring->high_water = ring->count;
+
+	return MESSAGE_RING_QUEUED;
+}
+
+bool message_ring_pop(struct message_ring_t *ring, void *item){
+
+	if(ring->count == 0) return false;
+
+	memcpy(item, ring->items + ring->head * ring->item_size, ring->item_size);
+	ring->head = (ring->head + 1) % ring->capacity;
+	ring->count--;
+
+	return true;
+}
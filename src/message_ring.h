@@ -0,0 +1,113 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file message_ring.h
+@brief Fila de mensagens de tamanho fixo que nunca bloqueia quem posta e funde ordens repetidas
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_MESSAGE_RING_H_INCLUDED
+#define WIFI_MANAGER_MESSAGE_RING_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Resultado de message_ring_push.
+ */
+typedef enum message_ring_result_t{
+	MESSAGE_RING_QUEUED = 0,		/* a mensagem entrou na fila */
+	MESSAGE_RING_COALESCED = 1,		/* a mensagem foi fundida com uma igual que já estava na fila */
+	MESSAGE_RING_DROPPED = 2		/* a fila estava cheia: a mensagem foi descartada */
+}message_ring_result_t;
+
+/**
+ * @brief Funde uma mensagem que chega (incoming) com a mensagem de mesmo código que já está na fila (queued).
+ * Não fazer nada mantém a primeira.
+ */
+typedef void (*message_ring_merge_fn)(uint8_t code, void *queued, const void *incoming);
+
+/**
+ * @brief Fila circular de mensagens de tamanho fixo.
+ *
+ * Os códigos marcados em coalesce_mask não se repetem em sequência: uma nova mensagem é fundida com a última
+ * da fila se ela tiver o mesmo código. Qualquer mensagem de outro código, fundível ou não, interrompe a fusão.
+ * Isso mantém a ordem em relação às demais mensagens (uma conexão nunca passa à frente de uma desconexão, por exemplo).
+ *
+ * O módulo não faz sincronização: quem chama protege push e pop com o mesmo lock.
+ */
+struct message_ring_t{
+	uint8_t *items;					/* capacity * item_size bytes */
+	uint8_t *codes;					/* código de cada posição */
+	size_t item_size;
+	uint16_t capacity;
+	uint16_t head;
+	uint16_t count;
+	uint16_t high_water;			/* maior ocupação já vista */
+	uint32_t coalesce_mask;			/* bit n: o código n é fundido. Apenas códigos 0 a 31 */
+	message_ring_merge_fn merge;
+	uint32_t queued;
+	uint32_t coalesced;
+	uint32_t dropped;
+	bool owned;						/* items e codes foram alocados por message_ring_init */
+};
+
+/**
+ * @brief Aloca a fila. Retorna false se faltar memória.
+ */
+bool message_ring_init(struct message_ring_t *ring, uint16_t capacity, size_t item_size, uint32_t coalesce_mask, message_ring_merge_fn merge);
+
+/**
+ * @brief Como message_ring_init, sobre buffers de quem chama: items com capacity * item_size bytes e codes com capacity bytes.
+ */
+void message_ring_init_static(struct message_ring_t *ring, uint16_t capacity, size_t item_size, uint8_t *items, uint8_t *codes, uint32_t coalesce_mask, message_ring_merge_fn merge);
+
+/**
+ * @brief Libera a memória da fila. Os buffers de message_ring_init_static não são liberados.
+ */
+void message_ring_free(struct message_ring_t *ring);
+
+/**
+ * @brief Posta uma mensagem sem nunca bloquear.
+ * @param to_front a mensagem é posta na frente da fila e nunca é fundida.
+ */
+message_ring_result_t message_ring_push(struct message_ring_t *ring, uint8_t code, const void *item, bool to_front);
+
+/**
+ * @brief Retira a mensagem mais antiga. Retorna false se a fila estiver vazia.
+ */
+bool message_ring_pop(struct message_ring_t *ring, void *item);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_MESSAGE_RING_H_INCLUDED */
@@ -0,0 +1,122 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file msg_trace.c
+@brief Gravação compacta das mensagens tratadas pelo wifi_manager, para reprodução no host
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "record_ring.h"
+#include "msg_trace.h"
+
+
+static void msg_trace_put(uint8_t *p, uint32_t value, int bytes){
+	for(int i=0; i<bytes; i++){
+		p[i] = (uint8_t)(value >> (8 * i));
+	}
+}
+
+static uint32_t msg_trace_get(const uint8_t *p, int bytes){
+	uint32_t value = 0;
+	for(int i=0; i<bytes; i++){
+		value |= (uint32_t)p[i] << (8 * i);
+	}
+	return value;
+}
+
+bool msg_trace_init(struct msg_trace_t *trace, uint16_t capacity){
+	return record_ring_init(&trace->ring, sizeof(struct msg_trace_record_t), capacity);
+}
+
+void msg_trace_init_static(struct msg_trace_t *trace, struct msg_trace_record_t *records, uint16_t capacity){
+	record_ring_init_static(&trace->ring, records, sizeof(struct msg_trace_record_t), capacity);
+}
+
+void msg_trace_free(struct msg_trace_t *trace){
+	record_ring_free(&trace->ring);
+}
+
+void msg_trace_push(struct msg_trace_t *trace, const struct msg_trace_record_t *record){
+	record_ring_push(&trace->ring, record);
+}
+
+const struct msg_trace_record_t* msg_trace_get_seq(const struct msg_trace_t *trace, uint32_t seq){
+	return (const struct msg_trace_record_t*)record_ring_get_seq(&trace->ring, seq);
+}
+
+size_t msg_trace_serialize(const struct msg_trace_t *trace, uint8_t *buf, size_t len){
+
+	size_t needed = MSG_TRACE_HEADER_SIZE + (size_t)trace->ring.count * MSG_TRACE_RECORD_SIZE;
+	if(buf == NULL || len < needed) return needed;
+
+	msg_trace_put(buf, MSG_TRACE_MAGIC, 4);
+	msg_trace_put(buf + 4, MSG_TRACE_VERSION, 2);
+	msg_trace_put(buf + 6, MSG_TRACE_RECORD_SIZE, 2);
+	msg_trace_put(buf + 8, trace->ring.count, 4);
+	msg_trace_put(buf + 12, trace->ring.lost, 4);
+
+	uint8_t *p = buf + MSG_TRACE_HEADER_SIZE;
+	for(uint16_t i=0; i<trace->ring.count; i++, p += MSG_TRACE_RECORD_SIZE){
+		const struct msg_trace_record_t *r = (const struct msg_trace_record_t*)record_ring_get(&trace->ring, i);
+		msg_trace_put(p, r->time_ms, 4);
+		p[4] = r->code;
+		p[5] = r->param;
+		msg_trace_put(p + 6, r->bits, 2);
+		msg_trace_put(p + 8, r->arg, 2);
+		p[10] = r->pending;
+		p[11] = r->reserved;
+	}
+
+	return needed;
+}
+
+int msg_trace_parse(const uint8_t *buf, size_t len, uint32_t *lost, void (*cb)(const struct msg_trace_record_t *record, void *arg), void *arg){
+
+	if(len < MSG_TRACE_HEADER_SIZE || msg_trace_get(buf, 4) != MSG_TRACE_MAGIC) return -1;
+
+	uint16_t version = (uint16_t)msg_trace_get(buf + 4, 2);
+	uint16_t record_size = (uint16_t)msg_trace_get(buf + 6, 2);
+	uint32_t count = msg_trace_get(buf + 8, 4);
+
+	/* versões futuras só acrescentam campos ao fim de cada registro */
+	if(version == 0 || record_size < MSG_TRACE_RECORD_SIZE) return -1;
+	if((len - MSG_TRACE_HEADER_SIZE) / record_size < count) return -1;
+	if(lost) *lost = msg_trace_get(buf + 12, 4);
+
+	const uint8_t *p = buf + MSG_TRACE_HEADER_SIZE;
+	for(uint32_t i=0; i<count; i++, p += record_size){
+		struct msg_trace_record_t r;
+		r.time_ms = msg_trace_get(p, 4);
+		r.code = p[4];
+		r.param = p[5];
+		r.bits = (uint16_t)msg_trace_get(p + 6, 2);
+		r.arg = (uint16_t)msg_trace_get(p + 8, 2);
+		r.pending = p[10];
+		r.reserved = p[11];
+		if(cb) cb(&r, arg);
+	}
+
+	return (int)count;
+}
@@ -0,0 +1,108 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file msg_trace.h
+@brief Gravação compacta das mensagens tratadas pelo wifi_manager, para reprodução no host
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_MSG_TRACE_H_INCLUDED
+#define WIFI_MANAGER_MSG_TRACE_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "record_ring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define MSG_TRACE_MAGIC						0x52544d57 /* "WMTR" */
+#define MSG_TRACE_VERSION					1
+
+/** @brief magia + versão + tamanho de um registro + número de registros + registros perdidos */
+#define MSG_TRACE_HEADER_SIZE				16
+
+/** @brief tamanho de um registro serializado */
+#define MSG_TRACE_RECORD_SIZE				12
+
+
+/**
+ * @brief Uma mensagem retirada da fila, no momento em que começa a ser tratada.
+ */
+struct msg_trace_record_t{
+	uint32_t time_ms;		/* desde o boot; volta a zero depois de 49 dias */
+	uint8_t code;			/* message_code_t */
+	uint8_t param;			/* origem do pedido de conexão (connection_request_made_by_code_t), ou 0 */
+	uint16_t bits;			/* bits do grupo de eventos do wifi_manager antes do tratamento */
+	uint16_t arg;			/* código de razão de uma desconexão, número de redes de uma varredura, ou 0 */
+	uint8_t pending;		/* mensagens ainda na fila */
+	uint8_t reserved;
+};
+
+/**
+ * @brief Buffer circular de registros: quando cheio, o mais antigo é substituído.
+ */
+struct msg_trace_t{
+	struct record_ring_t ring;
+};
+
+
+bool msg_trace_init(struct msg_trace_t *trace, uint16_t capacity);
+/** @brief Como msg_trace_init, sobre um buffer de quem chama com capacity registros. */
+void msg_trace_init_static(struct msg_trace_t *trace, struct msg_trace_record_t *records, uint16_t capacity);
+void msg_trace_free(struct msg_trace_t *trace);
+
+/**
+ * @brief Acrescenta um registro. Não é protegido: quem chama serializa os acessos.
+ */
+void msg_trace_push(struct msg_trace_t *trace, const struct msg_trace_record_t *record);
+
+/**
+ * @brief O registro de número de sequência seq, ou NULL se ele já foi substituído ou ainda não foi gravado.
+ * @see record_ring_get_seq
+ */
+const struct msg_trace_record_t* msg_trace_get_seq(const struct msg_trace_t *trace, uint32_t seq);
+
+/**
+ * @brief Serializa os registros, do mais antigo para o mais novo, em little-endian.
+ * @return o tamanho necessário. Nada é escrito se buf for NULL ou pequeno demais.
+ */
+size_t msg_trace_serialize(const struct msg_trace_t *trace, uint8_t *buf, size_t len);
+
+/**
+ * @brief Lê um trace serializado, chamando cb para cada registro em ordem.
+ * @param lost recebe o número de registros perdidos antes do primeiro, se não for NULL.
+ * @return o número de registros lidos, ou -1 se o trace for inválido.
+ */
+int msg_trace_parse(const uint8_t *buf, size_t len, uint32_t *lost, void (*cb)(const struct msg_trace_record_t *record, void *arg), void *arg);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_MSG_TRACE_H_INCLUDED */
@@ -31,6 +31,8 @@ PROGRAMAS.
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 #include <esp_err.h>
+#include "task_trace.h"
+#include "wifi_manager.h"
 #include "nvs_sync.h"
 
 
@@ -39,7 +41,12 @@ static SemaphoreHandle_t nvs_sync_mutex = NULL;
 esp_err_t nvs_sync_create(){
     if(nvs_sync_mutex == NULL){
 
+#if WIFI_MANAGER_STATIC_ALLOC
+        static StaticSemaphore_t nvs_sync_mutex_buffer;
+        nvs_sync_mutex = xSemaphoreCreateMutexStatic(&nvs_sync_mutex_buffer);
+#else
         nvs_sync_mutex = xSemaphoreCreateMutex();
+#endif
 
 		if(nvs_sync_mutex){
 			return ESP_OK;
@@ -62,10 +69,14 @@ void nvs_sync_free(){
 
 bool nvs_sync_lock(TickType_t xTicksToWait){
 	if(nvs_sync_mutex){
+		TASK_TRACE_BEGIN("nvs wait", 0);
 		if( xSemaphoreTake( nvs_sync_mutex, xTicksToWait ) == pdTRUE ) {
+			TASK_TRACE_END("nvs wait", 1);
+			TASK_TRACE_BEGIN("nvs held", 0);
 			return true;
 		}
 		else{
+			TASK_TRACE_END("nvs wait", 0);
 			return false;
 		}
 	}
@@ -75,5 +86,6 @@ bool nvs_sync_lock(TickType_t xTicksToWait){
 }
 
 void nvs_sync_unlock(){
+	TASK_TRACE_END("nvs held", 0);
 	xSemaphoreGive( nvs_sync_mutex );
 }
\ No newline at end of file
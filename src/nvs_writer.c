@@ -0,0 +1,453 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file nvs_writer.c
+@brief Gravação adiada no NVS: uma tarefa de baixa prioridade agrupa e grava os blobs, os leitores usam uma cópia em RAM
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+#include <esp_err.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "nvs_sync.h"
+#include "storage.h"
+#include "wifi_manager.h"
+#include "nvs_writer.h"
+
+
+/**
+ * @brief Uma chave gerenciada: a cópia em RAM é sempre o valor mais novo, gravado ou não.
+ */
+struct nvs_writer_slot_t{
+	char key[NVS_WRITER_KEY_SIZE];
+	uint8_t *data;
+	size_t len;
+	bool dirty;
+};
+
+/* @brief nenhuma gravação pendente ou em andamento */
+#define NVS_WRITER_IDLE_BIT					( 1 << 0 )
+/* @brief gravação imediata pedida por nvs_writer_flush */
+#define NVS_WRITER_FLUSH_BIT				( 1 << 1 )
+/* @brief pedido de parada da tarefa */
+#define NVS_WRITER_STOP_BIT					( 1 << 2 )
+
+static const char TAG[] = "nvs_writer";
+
+static struct nvs_writer_slot_t nvs_writer_slots[NVS_WRITER_MAX_KEYS];
+/* @brief protege as cópias em RAM. Nunca é mantido durante um acesso ao flash */
+static SemaphoreHandle_t nvs_writer_mutex = NULL;
+static EventGroupHandle_t nvs_writer_events = NULL;
+static TaskHandle_t nvs_writer_task_handle = NULL;
+static const struct storage_backend_t *nvs_writer_backend = NULL;
+static TickType_t nvs_writer_debounce = 0;
+static esp_err_t nvs_writer_last_err = ESP_OK;
+static struct nvs_writer_stats_t nvs_writer_stats;
+
+#if WIFI_MANAGER_STATIC_ALLOC
+/* @brief cópias em RAM das chaves, as cópias de um commit e a primeira leitura de uma chave, reservadas no link */
+static uint8_t nvs_writer_slot_data[NVS_WRITER_MAX_KEYS][NVS_WRITER_VALUE_SIZE];
+static uint8_t nvs_writer_commit_data[NVS_WRITER_MAX_KEYS][NVS_WRITER_VALUE_SIZE];
+static uint8_t nvs_writer_read_data[NVS_WRITER_VALUE_SIZE];
+static StaticSemaphore_t nvs_writer_mutex_buffer;
+static StaticEventGroup_t nvs_writer_events_buffer;
+#endif
+
+
+/**
+ * @brief Converte um erro de armazenamento para os códigos de nvs_get_blob/nvs_set_blob.
+ */
+static esp_err_t nvs_writer_esp_err(storage_err_t err){
+	switch(err){
+	case STORAGE_OK:
+		return ESP_OK;
+	case STORAGE_ERR_NOT_FOUND:
+		return ESP_ERR_NVS_NOT_FOUND;
+	case STORAGE_ERR_TOO_SMALL:
+		return ESP_ERR_NVS_INVALID_LENGTH;
+	case STORAGE_ERR_INVALID_ARG:
+		return ESP_ERR_INVALID_ARG;
+	case STORAGE_ERR_NO_MEM:
+		return ESP_ERR_NO_MEM;
+	default:
+		return ESP_FAIL;
+	}
+}
+
+/**
+ * @brief Procura a posição de uma chave; se create for verdadeiro, reserva uma posição livre. Deve ser chamada com o mutex.
+ */
+static struct nvs_writer_slot_t* nvs_writer_find(const char *key, bool create){
+
+	struct nvs_writer_slot_t *free_slot = NULL;
+
+	for(int i=0; i<NVS_WRITER_MAX_KEYS; i++){
+		if(nvs_writer_slots[i].key[0] == '\0'){
+			if(free_slot == NULL) free_slot = &nvs_writer_slots[i];
+		}
+		else if(strncmp(nvs_writer_slots[i].key, key, NVS_WRITER_KEY_SIZE) == 0){
+			return &nvs_writer_slots[i];
+		}
+	}
+
+	if(create && free_slot){
+		strncpy(free_slot->key, key, NVS_WRITER_KEY_SIZE - 1);
+		return free_slot;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Troca a cópia em RAM de uma chave. Deve ser chamada com o mutex.
+ */
+static esp_err_t nvs_writer_store(struct nvs_writer_slot_t *slot, const void *data, size_t len){
+
+#if WIFI_MANAGER_STATIC_ALLOC
+	uint8_t *copy = nvs_writer_slot_data[slot - nvs_writer_slots];
+	if(len > NVS_WRITER_VALUE_SIZE) return ESP_ERR_NVS_INVALID_LENGTH;
+
+	memmove(copy, data, len);
+#else
+	uint8_t *copy = (uint8_t*)malloc(len ? len : 1);
+	if(copy == NULL) return ESP_ERR_NO_MEM;
+
+	memcpy(copy, data, len);
+	free(slot->data);
+#endif
+	slot->data = copy;
+	slot->len = len;
+
+	return ESP_OK;
+}
+
+/**
+ * @brief Grava todas as chaves pendentes em um único commit.
+ */
+static void nvs_writer_commit(){
+
+	struct nvs_writer_slot_t pending[NVS_WRITER_MAX_KEYS];
+	int count = 0;
+	struct storage_item_t items[NVS_WRITER_MAX_KEYS];
+	esp_err_t esp_err = ESP_OK;
+	int64_t start = esp_timer_get_time();
+
+	/* copie os dados pendentes: o mutex não pode ficar preso durante o acesso ao flash */
+	xSemaphoreTake(nvs_writer_mutex, portMAX_DELAY);
+	for(int i=0; i<NVS_WRITER_MAX_KEYS; i++){
+		struct nvs_writer_slot_t *slot = &nvs_writer_slots[i];
+		if(!slot->dirty) continue;
+
+		pending[count] = *slot;
+#if WIFI_MANAGER_STATIC_ALLOC
+		pending[count].data = nvs_writer_commit_data[count];
+#else
+		pending[count].data = (uint8_t*)malloc(slot->len ? slot->len : 1);
+#endif
+		if(pending[count].data == NULL){
+			esp_err = ESP_ERR_NO_MEM;
+			continue;
+		}
+		memcpy(pending[count].data, slot->data, slot->len);
+		items[count].key = pending[count].key;
+		items[count].data = pending[count].data;
+		items[count].len = pending[count].len;
+		slot->dirty = false;
+		count++;
+	}
+	xSemaphoreGive(nvs_writer_mutex);
+
+	if(count > 0 && esp_err == ESP_OK){
+		if(nvs_sync_lock( portMAX_DELAY )){
+			esp_err = nvs_writer_esp_err(nvs_writer_backend->write(nvs_writer_backend->ctx, items, count));
+			nvs_sync_unlock();
+		}
+		else{
+			esp_err = ESP_ERR_TIMEOUT;
+		}
+	}
+
+	int64_t elapsed = esp_timer_get_time() - start;
+
+	xSemaphoreTake(nvs_writer_mutex, portMAX_DELAY);
+	if(esp_err != ESP_OK){
+		/* tente de novo no próximo pedido ou flush, a menos que um valor mais novo já esteja pendente */
+		for(int i=0; i<count; i++){
+			struct nvs_writer_slot_t *slot = nvs_writer_find(pending[i].key, false);
+			if(slot) slot->dirty = true;
+		}
+		nvs_writer_stats.errors++;
+	}
+	else if(count > 0){
+		nvs_writer_stats.commits++;
+		nvs_writer_stats.last_commit_us = elapsed;
+		if(elapsed > nvs_writer_stats.max_commit_us) nvs_writer_stats.max_commit_us = elapsed;
+	}
+	nvs_writer_last_err = esp_err;
+
+	bool dirty = false;
+	for(int i=0; i<NVS_WRITER_MAX_KEYS; i++){
+		dirty |= nvs_writer_slots[i].dirty;
+	}
+	if(!dirty || esp_err != ESP_OK){
+		/* um flush que chegou durante este commit continua valendo se ainda houver algo pendente */
+		xEventGroupClearBits(nvs_writer_events, NVS_WRITER_FLUSH_BIT);
+		xEventGroupSetBits(nvs_writer_events, NVS_WRITER_IDLE_BIT);
+	}
+	xSemaphoreGive(nvs_writer_mutex);
+
+#if !WIFI_MANAGER_STATIC_ALLOC
+	for(int i=0; i<count; i++){
+		free(pending[i].data);
+	}
+#endif
+
+	if(esp_err != ESP_OK){
+		ESP_LOGE(TAG, "commit of %d key(s) failed with error %d", count, esp_err);
+	}
+	else if(count > 0){
+		ESP_LOGD(TAG, "committed %d key(s) in %d us", count, (int)elapsed);
+	}
+}
+
+static void nvs_writer_task(void *pvParameters){
+
+	for(;;){
+		/* espere o primeiro pedido */
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+		/* espere um intervalo sem pedidos novos, limitado a 4 x debounce, a menos que um flush seja pedido */
+		TickType_t first = xTaskGetTickCount();
+		while( !(xEventGroupGetBits(nvs_writer_events) & (NVS_WRITER_FLUSH_BIT | NVS_WRITER_STOP_BIT)) &&
+				xTaskGetTickCount() - first < 4 * nvs_writer_debounce ){
+			if(ulTaskNotifyTake(pdTRUE, nvs_writer_debounce) == 0) break;
+		}
+
+		nvs_writer_commit();
+
+		if(xEventGroupGetBits(nvs_writer_events) & NVS_WRITER_STOP_BIT) break;
+	}
+
+	nvs_writer_task_handle = NULL;
+	vTaskDelete(NULL);
+}
+
+esp_err_t nvs_writer_start(const struct storage_backend_t *backend, uint32_t debounce_ms, const struct task_config_t *task){
+
+	if(nvs_writer_mutex != NULL) return ESP_OK;
+	if(backend == NULL) return ESP_ERR_INVALID_ARG;
+
+	memset(nvs_writer_slots, 0x00, sizeof(nvs_writer_slots));
+	memset(&nvs_writer_stats, 0x00, sizeof(nvs_writer_stats));
+	nvs_writer_backend = backend;
+	nvs_writer_debounce = pdMS_TO_TICKS(debounce_ms) ? pdMS_TO_TICKS(debounce_ms) : 1;
+	nvs_writer_last_err = ESP_OK;
+
+#if WIFI_MANAGER_STATIC_ALLOC
+	nvs_writer_mutex = xSemaphoreCreateMutexStatic(&nvs_writer_mutex_buffer);
+	nvs_writer_events = xEventGroupCreateStatic(&nvs_writer_events_buffer);
+#else
+	nvs_writer_mutex = xSemaphoreCreateMutex();
+	nvs_writer_events = xEventGroupCreate();
+#endif
+	if(nvs_writer_mutex == NULL || nvs_writer_events == NULL){
+		return ESP_FAIL;
+	}
+	xEventGroupSetBits(nvs_writer_events, NVS_WRITER_IDLE_BIT);
+
+	if(task_config_create(task, &nvs_writer_task, "nvs_writer", NULL, &nvs_writer_task_handle) != pdPASS){
+		return ESP_FAIL;
+	}
+
+	return ESP_OK;
+}
+
+TaskHandle_t nvs_writer_get_task(){
+	return nvs_writer_task_handle;
+}
+
+void nvs_writer_stop(){
+
+	if(nvs_writer_mutex == NULL) return;
+
+	nvs_writer_flush(portMAX_DELAY);
+
+	/* a tarefa termina depois de um último commit */
+	xEventGroupSetBits(nvs_writer_events, NVS_WRITER_STOP_BIT);
+	xEventGroupClearBits(nvs_writer_events, NVS_WRITER_IDLE_BIT);
+	if(nvs_writer_task_handle) xTaskNotifyGive(nvs_writer_task_handle);
+	xEventGroupWaitBits(nvs_writer_events, NVS_WRITER_IDLE_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+	while(nvs_writer_task_handle != NULL){
+		vTaskDelay(1);
+	}
+
+#if !WIFI_MANAGER_STATIC_ALLOC
+	for(int i=0; i<NVS_WRITER_MAX_KEYS; i++){
+		free(nvs_writer_slots[i].data);
+	}
+#endif
+	memset(nvs_writer_slots, 0x00, sizeof(nvs_writer_slots));
+
+	vSemaphoreDelete(nvs_writer_mutex);
+	nvs_writer_mutex = NULL;
+	vEventGroupDelete(nvs_writer_events);
+	nvs_writer_events = NULL;
+}
+
+esp_err_t nvs_writer_set_blob(const char *key, const void *data, size_t len){
+
+	esp_err_t esp_err;
+
+	if(nvs_writer_mutex == NULL) return ESP_ERR_INVALID_STATE;
+	if(key == NULL || strlen(key) >= NVS_WRITER_KEY_SIZE) return ESP_ERR_INVALID_ARG;
+
+	xSemaphoreTake(nvs_writer_mutex, portMAX_DELAY);
+	struct nvs_writer_slot_t *slot = nvs_writer_find(key, true);
+	if(slot == NULL){
+		esp_err = ESP_ERR_NO_MEM;
+	}
+	else{
+		if(slot->dirty) nvs_writer_stats.coalesced++;
+		esp_err = nvs_writer_store(slot, data, len);
+		if(esp_err == ESP_OK){
+			slot->dirty = true;
+			nvs_writer_stats.requests++;
+			xEventGroupClearBits(nvs_writer_events, NVS_WRITER_IDLE_BIT);
+		}
+	}
+	xSemaphoreGive(nvs_writer_mutex);
+
+	if(esp_err == ESP_OK){
+		xTaskNotifyGive(nvs_writer_task_handle);
+	}
+
+	return esp_err;
+}
+
+esp_err_t nvs_writer_get_blob(const char *key, void *out, size_t *len){
+
+	esp_err_t esp_err;
+	size_t sz = 0;
+	uint8_t *buff = NULL;
+
+	if(nvs_writer_mutex == NULL) return ESP_ERR_INVALID_STATE;
+
+	/* cópia em RAM */
+	xSemaphoreTake(nvs_writer_mutex, portMAX_DELAY);
+	struct nvs_writer_slot_t *slot = nvs_writer_find(key, false);
+	if(slot && slot->data){
+		if(out == NULL){
+			esp_err = ESP_OK;
+		}
+		else if(*len < slot->len){
+			esp_err = ESP_ERR_NVS_INVALID_LENGTH;
+		}
+		else{
+			memcpy(out, slot->data, slot->len);
+			esp_err = ESP_OK;
+		}
+		*len = slot->len;
+		xSemaphoreGive(nvs_writer_mutex);
+		return esp_err;
+	}
+	xSemaphoreGive(nvs_writer_mutex);
+
+	/* primeira leitura: armazenamento, e a cópia fica em RAM para as próximas */
+	if(!nvs_sync_lock( portMAX_DELAY )) return ESP_ERR_TIMEOUT;
+	esp_err = nvs_writer_esp_err(nvs_writer_backend->read(nvs_writer_backend->ctx, key, NULL, &sz));
+	if(esp_err == ESP_OK){
+#if WIFI_MANAGER_STATIC_ALLOC
+		/* o buffer de leitura é único: ele fica protegido pelo nvs_sync até a cópia abaixo */
+		buff = sz <= sizeof(nvs_writer_read_data) ? nvs_writer_read_data : NULL;
+		esp_err = buff ? nvs_writer_esp_err(nvs_writer_backend->read(nvs_writer_backend->ctx, key, buff, &sz)) : ESP_ERR_NVS_INVALID_LENGTH;
+#else
+		buff = (uint8_t*)malloc(sz ? sz : 1);
+		esp_err = buff ? nvs_writer_esp_err(nvs_writer_backend->read(nvs_writer_backend->ctx, key, buff, &sz)) : ESP_ERR_NO_MEM;
+#endif
+	}
+#if !WIFI_MANAGER_STATIC_ALLOC
+	nvs_sync_unlock();
+#endif
+
+	if(esp_err == ESP_OK){
+		xSemaphoreTake(nvs_writer_mutex, portMAX_DELAY);
+		slot = nvs_writer_find(key, true);
+		/* um pedido de gravação pode ter chegado durante a leitura: ele é mais novo */
+		if(slot && slot->data == NULL){
+			nvs_writer_store(slot, buff, sz);
+		}
+		xSemaphoreGive(nvs_writer_mutex);
+
+		if(out == NULL){
+			*len = sz;
+		}
+		else if(*len < sz){
+			*len = sz;
+			esp_err = ESP_ERR_NVS_INVALID_LENGTH;
+		}
+		else{
+			memcpy(out, buff, sz);
+			*len = sz;
+		}
+	}
+
+#if WIFI_MANAGER_STATIC_ALLOC
+	nvs_sync_unlock();
+#else
+	free(buff);
+#endif
+
+	return esp_err;
+}
+
+esp_err_t nvs_writer_flush(TickType_t xTicksToWait){
+
+	if(nvs_writer_mutex == NULL) return ESP_ERR_INVALID_STATE;
+
+	xEventGroupSetBits(nvs_writer_events, NVS_WRITER_FLUSH_BIT);
+	xTaskNotifyGive(nvs_writer_task_handle);
+
+	if( !(xEventGroupWaitBits(nvs_writer_events, NVS_WRITER_IDLE_BIT, pdFALSE, pdTRUE, xTicksToWait) & NVS_WRITER_IDLE_BIT) ){
+		return ESP_ERR_TIMEOUT;
+	}
+
+	return nvs_writer_last_err;
+}
+
+void nvs_writer_get_stats(struct nvs_writer_stats_t *stats){
+	if(nvs_writer_mutex == NULL){
+		memset(stats, 0x00, sizeof(struct nvs_writer_stats_t));
+		return;
+	}
+	xSemaphoreTake(nvs_writer_mutex, portMAX_DELAY);
+	*stats = nvs_writer_stats;
+	xSemaphoreGive(nvs_writer_mutex);
+}
@@ -0,0 +1,114 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file nvs_writer.h
+@brief Gravação adiada no NVS: uma tarefa de baixa prioridade agrupa e grava os blobs, os leitores usam uma cópia em RAM
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_NVS_WRITER_H_INCLUDED
+#define WIFI_MANAGER_NVS_WRITER_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <freertos/FreeRTOS.h> /* para TickType_t */
+#include <esp_err.h> /* para esp_err_t */
+#include "storage.h"
+#include "config_record.h"
+#include "task_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** @brief Número máximo de chaves gerenciadas */
+#define NVS_WRITER_MAX_KEYS					4
+
+/** @brief Tamanho máximo de um nome de chave NVS, incluindo o terminador */
+#define NVS_WRITER_KEY_SIZE					STORAGE_KEY_SIZE
+
+/** @brief Maior valor de uma chave com WIFI_MANAGER_STATIC_ALLOC: o registro de configuração é o maior */
+#define NVS_WRITER_VALUE_SIZE				CONFIG_RECORD_MAX_SIZE
+
+/**
+ * @brief Estatísticas do gravador.
+ */
+struct nvs_writer_stats_t{
+	uint32_t requests;			/* chamadas a nvs_writer_set_blob */
+	uint32_t coalesced;			/* pedidos substituídos por um mais novo antes de serem gravados */
+	uint32_t commits;			/* commits NVS realizados */
+	uint32_t errors;
+	int64_t last_commit_us;		/* duração do último commit, incluindo a espera pelo nvs_sync */
+	int64_t max_commit_us;
+};
+
+/**
+ * @brief Inicia a tarefa de gravação.
+ * @param backend onde as chaves são gravadas (NVS, RAM...). Os acessos são serializados com nvs_sync_lock.
+ * @param debounce_ms a gravação acontece quando nenhum pedido novo chega durante este tempo,
+ * e nunca mais de 4 x debounce_ms depois do primeiro pedido pendente.
+ * @param task pilha, prioridade, núcleo e alocação da tarefa de gravação.
+ */
+esp_err_t nvs_writer_start(const struct storage_backend_t *backend, uint32_t debounce_ms, const struct task_config_t *task);
+
+/**
+ * @brief A tarefa de gravação, ou NULL se ela não estiver rodando.
+ */
+TaskHandle_t nvs_writer_get_task();
+
+/**
+ * @brief Grava o que estiver pendente, para a tarefa e libera a memória.
+ */
+void nvs_writer_stop();
+
+/**
+ * @brief Pede a gravação de um blob. Não acessa o flash: copia os dados e retorna.
+ * Um pedido ainda não gravado para a mesma chave é substituído.
+ */
+esp_err_t nvs_writer_set_blob(const char *key, const void *data, size_t len);
+
+/**
+ * @brief Lê um blob, com a mesma semântica de nvs_get_blob.
+ * Uma chave já lida ou gravada é servida da cópia em RAM, inclusive quando a gravação ainda está pendente.
+ */
+esp_err_t nvs_writer_get_blob(const char *key, void *out, size_t *len);
+
+/**
+ * @brief Grava imediatamente o que estiver pendente e espera o commit.
+ * @return o resultado do último commit, ou ESP_ERR_TIMEOUT.
+ */
+esp_err_t nvs_writer_flush(TickType_t xTicksToWait);
+
+/**
+ * @brief Lê as estatísticas do gravador.
+ */
+void nvs_writer_get_stats(struct nvs_writer_stats_t *stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_NVS_WRITER_H_INCLUDED */
@@ -0,0 +1,97 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file record_ring.c
+@brief Buffer circular de registros de tamanho fixo que substitui o mais antigo quando cheio
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "record_ring.h"
+
+
+bool record_ring_init(struct record_ring_t *ring, size_t size, uint16_t capacity){
+
+	void *records;
+
+	memset(ring, 0x00, sizeof(struct record_ring_t));
+	if(size == 0 || capacity == 0) return false;
+
+	records = calloc(capacity, size);
+	if(records == NULL) return false;
+	record_ring_init_static(ring, records, size, capacity);
+	ring->owned = true;
+
+	return true;
+}
+
+bool record_ring_init_static(struct record_ring_t *ring, void *records, size_t size, uint16_t capacity){
+
+	memset(ring, 0x00, sizeof(struct record_ring_t));
+	if(records == NULL || size == 0 || capacity == 0) return false;
+
+	ring->records = (uint8_t*)records;
+	ring->size = size;
+	ring->capacity = capacity;
+
+	return true;
+}
+
+void record_ring_free(struct record_ring_t *ring){
+	if(ring->owned) free(ring->records);
+	memset(ring, 0x00, sizeof(struct record_ring_t));
+}
+
+void record_ring_push(struct record_ring_t *ring, const void *record){
+
+	if(ring->records == NULL) return;
+
+	if(ring->count < ring->capacity){
+		memcpy(ring->records + (size_t)((ring->head + ring->count) % ring->capacity) * ring->size, record, ring->size);
+		ring->count++;
+	}
+	else{
+		memcpy(ring->records + (size_t)ring->head * ring->size, record, ring->size);
+		ring->head = (ring->head + 1) % ring->capacity;
+		ring->lost++;
+	}
+}
+
+const void* record_ring_get(const struct record_ring_t *ring, uint16_t i){
+	if(i >= ring->count) return NULL;
+	return ring->records + (size_t)((ring->head + i) % ring->capacity) * ring->size;
+}
+
+const void* record_ring_get_seq(const struct record_ring_t *ring, uint32_t seq){
+	uint32_t i = seq - ring->lost;
+	if(seq < ring->lost || i >= ring->count) return NULL;
+	return record_ring_get(ring, (uint16_t)i);
+}
+
+void record_ring_clear(struct record_ring_t *ring){
+	ring->head = 0;
+	ring->count = 0;
+	ring->lost = 0;
+}
@@ -0,0 +1,83 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file record_ring.h
+@brief Buffer circular de registros de tamanho fixo que substitui o mais antigo quando cheio
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_RECORD_RING_H_INCLUDED
+#define WIFI_MANAGER_RECORD_RING_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Buffer circular de registros de size bytes: quando cheio, o mais antigo é substituído.
+ * Base de msg_trace e de task_trace. Não é protegido: quem usa serializa os acessos.
+ */
+struct record_ring_t{
+	uint8_t *records;
+	size_t size;			/* tamanho de um registro */
+	uint16_t capacity;
+	uint16_t head;			/* posição do registro mais antigo */
+	uint16_t count;
+	uint32_t lost;			/* registros substituídos: também o número de sequência do mais antigo */
+	bool owned;				/* records foi alocado por record_ring_init */
+};
+
+
+bool record_ring_init(struct record_ring_t *ring, size_t size, uint16_t capacity);
+/** @brief Como record_ring_init, sobre um buffer de quem chama com capacity registros de size bytes. */
+bool record_ring_init_static(struct record_ring_t *ring, void *records, size_t size, uint16_t capacity);
+void record_ring_free(struct record_ring_t *ring);
+
+void record_ring_push(struct record_ring_t *ring, const void *record);
+
+/**
+ * @brief O i-ésimo registro, do mais antigo para o mais novo, ou NULL.
+ */
+const void* record_ring_get(const struct record_ring_t *ring, uint16_t i);
+
+/**
+ * @brief O registro de número de sequência seq (0 é o primeiro já gravado), ou NULL se ele já foi substituído
+ * ou ainda não foi gravado. Permite ler o buffer aos poucos enquanto ele recebe registros.
+ */
+const void* record_ring_get_seq(const struct record_ring_t *ring, uint32_t seq);
+
+/** @brief Esvazia o buffer e zera a contagem de perdidos. */
+void record_ring_clear(struct record_ring_t *ring);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_RECORD_RING_H_INCLUDED */
@@ -0,0 +1,59 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file retry_policy.h
+@brief Políticas de espera entre as tentativas de reconexão
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_RETRY_POLICY_H_INCLUDED
+#define WIFI_MANAGER_RETRY_POLICY_H_INCLUDED
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Recuo exponencial com jitter completo.
+ *
+ * Retorna um valor uniforme entre 0 e min(cap_ms, base_ms * 2^attempt). Espalhar as tentativas pela janela inteira
+ * evita que muitos dispositivos que perderam a conexão ao mesmo tempo voltem a tentar todos juntos.
+ *
+ * @param attempt número da tentativa, 0 para a primeira.
+ * @param base_ms janela da primeira tentativa.
+ * @param cap_ms limite superior da janela.
+ * @param random valor aleatório de 32 bits (por exemplo, esp_random()).
+ * @return o tempo de espera em ms.
+ */
+uint32_t retry_policy_backoff_full_jitter(uint32_t attempt, uint32_t base_ms, uint32_t cap_ms, uint32_t random);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_RETRY_POLICY_H_INCLUDED */
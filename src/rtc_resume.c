@@ -0,0 +1,90 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file rtc_resume.c
+@brief Bloco de retomada rápida na memória RTC, preservado durante o deep sleep
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "esp_attr.h"
+#include "esp_system.h"
+
+#include "config_record.h"
+#include "rtc_resume.h"
+
+
+/**
+ * @brief O bloco. RTC_NOINIT_ATTR: não é zerado na inicialização, então sobrevive ao deep sleep.
+ * Depois de um power-on ele contém lixo, recusado pelo número mágico e pelo CRC.
+ */
+static RTC_NOINIT_ATTR struct rtc_resume_t rtc_resume_block;
+
+
+static uint32_t rtc_resume_crc(const struct rtc_resume_t *block){
+	return config_record_crc32(0, (const uint8_t*)block, offsetof(struct rtc_resume_t, crc));
+}
+
+static bool rtc_resume_is_valid(){
+	return rtc_resume_block.magic == RTC_RESUME_MAGIC &&
+			rtc_resume_block.version == RTC_RESUME_VERSION &&
+			rtc_resume_block.size == sizeof(struct rtc_resume_t) &&
+			rtc_resume_block.crc == rtc_resume_crc(&rtc_resume_block);
+}
+
+bool rtc_resume_load(struct rtc_resume_t *block){
+
+	/* somente ao acordar do deep sleep: após um reset ou uma atualização o NVS é a única fonte confiável */
+	if(esp_reset_reason() != ESP_RST_DEEPSLEEP || !rtc_resume_is_valid()){
+		rtc_resume_invalidate();
+		return false;
+	}
+
+	memcpy(block, &rtc_resume_block, sizeof(struct rtc_resume_t));
+	return true;
+}
+
+void rtc_resume_store(struct rtc_resume_t *block){
+	block->magic = RTC_RESUME_MAGIC;
+	block->version = RTC_RESUME_VERSION;
+	block->size = sizeof(struct rtc_resume_t);
+	block->crc = rtc_resume_crc(block);
+	memcpy(&rtc_resume_block, block, sizeof(struct rtc_resume_t));
+}
+
+void rtc_resume_set_retry(uint8_t retries, uint32_t retry_attempt){
+	if(!rtc_resume_is_valid()) return;
+
+	rtc_resume_block.retries = retries;
+	rtc_resume_block.retry_attempt = retry_attempt;
+	rtc_resume_block.crc = rtc_resume_crc(&rtc_resume_block);
+}
+
+void rtc_resume_invalidate(){
+	rtc_resume_block.magic = 0;
+	rtc_resume_block.crc = 0;
+}
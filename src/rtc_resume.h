@@ -0,0 +1,93 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file rtc_resume.h
+@brief Bloco de retomada rápida na memória RTC, preservado durante o deep sleep
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_RTC_RESUME_H_INCLUDED
+#define WIFI_MANAGER_RTC_RESUME_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "wifi_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define RTC_RESUME_MAGIC				0x52524d57 /* "WMRR" */
+#define RTC_RESUME_VERSION				1
+
+
+/**
+ * @brief Tudo o que é preciso para reconectar ao acordar do deep sleep sem ler o NVS.
+ * O bloco fica na memória RTC lenta, que não é apagada durante o deep sleep, e é validado por um CRC32.
+ */
+struct rtc_resume_t{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t size;
+	uint8_t sta_ssid[MAX_SSID_SIZE];
+	uint8_t sta_password[MAX_PASSWORD_SIZE];
+	struct wifi_settings_t settings;
+	struct wifi_sta_cache_t cache;
+	struct wifi_sta_lease_t lease;
+	uint32_t retry_attempt;			/* posição na política de novas tentativas */
+	uint8_t retries;				/* tentativas antes de iniciar o AP */
+	uint8_t reserved[3];
+	uint32_t crc;					/* CRC32 de todos os campos anteriores */
+};
+
+
+/**
+ * @brief Copia o bloco da memória RTC para block.
+ * @return true apenas ao acordar do deep sleep com um bloco íntegro e da versão atual. Em qualquer outro caso o bloco é invalidado.
+ */
+bool rtc_resume_load(struct rtc_resume_t *block);
+
+/**
+ * @brief Preenche o cabeçalho e o CRC de block e o grava na memória RTC.
+ * block deve ter sido zerado com memset antes de ser preenchido para que o preenchimento entre os campos tenha um valor conhecido.
+ */
+void rtc_resume_store(struct rtc_resume_t *block);
+
+/**
+ * @brief Atualiza apenas o estado das novas tentativas, se houver um bloco válido.
+ */
+void rtc_resume_set_retry(uint8_t retries, uint32_t retry_attempt);
+
+/**
+ * @brief Invalida o bloco: o próximo despertar passa pelo NVS.
+ */
+void rtc_resume_invalidate();
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_RTC_RESUME_H_INCLUDED */
@@ -0,0 +1,171 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file sta_profiles.c
+@brief Tabela de redes salvas e seleção da melhor rede com base na varredura e no histórico de conexões
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "sta_profiles.h"
+
+
+/* uma conexão mais antiga que isto é regravada no flash para manter o histórico útil */
+#define STA_PROFILES_PERSIST_AGE			(24 * 60 * 60)
+
+/* pesos da pontuação */
+#define STA_PROFILES_RSSI_WEIGHT			10
+#define STA_PROFILES_FAILURE_PENALTY		150
+#define STA_PROFILES_MAX_FAILURE_PENALTY	600
+#define STA_PROFILES_LATENCY_DIVIDER		50
+#define STA_PROFILES_MAX_LATENCY_PENALTY	200
+#define STA_PROFILES_RECENT_BONUS			100
+
+
+int sta_profiles_find(const struct wifi_sta_profile_t *table, size_t n, const uint8_t *ssid){
+
+	if(ssid == NULL || ssid[0] == '\0') return -1;
+
+	for(size_t i=0; i<n; i++){
+		if(table[i].ssid[0] != '\0' && strncmp((const char*)table[i].ssid, (const char*)ssid, MAX_SSID_SIZE) == 0){
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+size_t sta_profiles_count(const struct wifi_sta_profile_t *table, size_t n){
+	size_t count = 0;
+	for(size_t i=0; i<n; i++){
+		if(table[i].ssid[0] != '\0') count++;
+	}
+	return count;
+}
+
+int sta_profiles_upsert(struct wifi_sta_profile_t *table, size_t n, const uint8_t *ssid, const uint8_t *password, bool *changed){
+
+	int idx = sta_profiles_find(table, n, ssid);
+	*changed = false;
+
+	if(ssid == NULL || ssid[0] == '\0' || n == 0) return -1;
+
+	if(idx >= 0){
+		/* rede conhecida: apenas a senha pode ter mudado */
+		if(memcmp(table[idx].password, password, MAX_PASSWORD_SIZE) != 0){
+			memcpy(table[idx].password, password, MAX_PASSWORD_SIZE);
+			table[idx].failures = 0;
+			*changed = true;
+		}
+		return idx;
+	}
+
+	/* procure um espaço livre, senão substitua a rede menos recentemente usada */
+	idx = 0;
+	for(size_t i=0; i<n; i++){
+		if(table[i].ssid[0] == '\0'){
+			idx = (int)i;
+			break;
+		}
+		if(table[i].last_success < table[idx].last_success){
+			idx = (int)i;
+		}
+	}
+
+	memset(&table[idx], 0x00, sizeof(struct wifi_sta_profile_t));
+	memcpy(table[idx].ssid, ssid, MAX_SSID_SIZE);
+	memcpy(table[idx].password, password, MAX_PASSWORD_SIZE);
+	*changed = true;
+
+	return idx;
+}
+
+bool sta_profiles_remove(struct wifi_sta_profile_t *table, size_t n, const uint8_t *ssid){
+
+	int idx = sta_profiles_find(table, n, ssid);
+	if(idx < 0) return false;
+
+	memset(&table[idx], 0x00, sizeof(struct wifi_sta_profile_t));
+	return true;
+}
+
+bool sta_profiles_record_success(struct wifi_sta_profile_t *profile, uint32_t latency_ms, int64_t now){
+
+	bool persist = profile->failures != 0 || now < profile->last_success || now - profile->last_success > STA_PROFILES_PERSIST_AGE;
+
+	if(latency_ms > UINT16_MAX) latency_ms = UINT16_MAX;
+	if(profile->avg_latency_ms == 0){
+		profile->avg_latency_ms = (uint16_t)latency_ms;
+	}
+	else{
+		/* média móvel exponencial com peso 1/4 para a nova amostra */
+		profile->avg_latency_ms = (uint16_t)( ((uint32_t)profile->avg_latency_ms * 3 + latency_ms) / 4 );
+	}
+	profile->failures = 0;
+	profile->last_success = now;
+
+	return persist;
+}
+
+void sta_profiles_record_failure(struct wifi_sta_profile_t *profile){
+	if(profile->failures < UINT16_MAX) profile->failures++;
+}
+
+int32_t sta_profiles_score(const struct wifi_sta_profile_t *profile, int8_t rssi, int64_t now){
+
+	/* o sinal domina: -30 dBm => 700, -90 dBm => 100 */
+	int32_t score = ((int32_t)rssi + 100) * STA_PROFILES_RSSI_WEIGHT;
+
+	int32_t failure_penalty = (int32_t)profile->failures * STA_PROFILES_FAILURE_PENALTY;
+	score -= failure_penalty > STA_PROFILES_MAX_FAILURE_PENALTY ? STA_PROFILES_MAX_FAILURE_PENALTY : failure_penalty;
+
+	int32_t latency_penalty = profile->avg_latency_ms / STA_PROFILES_LATENCY_DIVIDER;
+	score -= latency_penalty > STA_PROFILES_MAX_LATENCY_PENALTY ? STA_PROFILES_MAX_LATENCY_PENALTY : latency_penalty;
+
+	/* uma rede que funcionou recentemente é mais provável de funcionar de novo */
+	if(profile->last_success != 0 && now >= profile->last_success && now - profile->last_success < STA_PROFILES_PERSIST_AGE){
+		score += STA_PROFILES_RECENT_BONUS;
+	}
+
+	return score;
+}
+
+int sta_profiles_select(const struct wifi_sta_profile_t *table, size_t n, const wifi_ap_record_t *aps, uint16_t ap_num, uint32_t exclude_mask, int64_t now){
+
+	int best = -1;
+	int32_t best_score = INT32_MIN;
+
+	for(uint16_t i=0; i<ap_num; i++){
+		int idx = sta_profiles_find(table, n, aps[i].ssid);
+		if(idx < 0 || (exclude_mask & (1UL << idx))) continue;
+
+		int32_t score = sta_profiles_score(&table[idx], aps[i].rssi, now);
+		if(score > best_score){
+			best_score = score;
+			best = idx;
+		}
+	}
+
+	return best;
+}
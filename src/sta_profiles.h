@@ -0,0 +1,112 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file sta_profiles.h
+@brief Tabela de redes salvas e seleção da melhor rede com base na varredura e no histórico de conexões
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_STA_PROFILES_H_INCLUDED
+#define WIFI_MANAGER_STA_PROFILES_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <freertos/FreeRTOS.h>
+#include "esp_wifi.h"
+#include "esp_netif.h"
+#include "wifi_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Uma rede salva e o seu histórico de conexões.
+ *
+ * A tabela inteira é gravada no flash como um único blob. O histórico é atualizado em RAM a cada tentativa e
+ * só é gravado junto com uma conexão bem-sucedida, para não desgastar o flash a cada falha.
+ */
+struct wifi_sta_profile_t{
+	uint8_t ssid[MAX_SSID_SIZE];
+	uint8_t password[MAX_PASSWORD_SIZE];
+	int64_t last_success;		/* time() da última conexão bem-sucedida, 0 se nunca */
+	uint16_t failures;			/* falhas consecutivas desde a última conexão bem-sucedida */
+	uint16_t avg_latency_ms;	/* média móvel do tempo entre a ordem de conexão e o IP */
+};
+
+
+/**
+ * @brief Procura uma rede salva pelo SSID.
+ * @return o índice na tabela ou -1 se não encontrada.
+ */
+int sta_profiles_find(const struct wifi_sta_profile_t *table, size_t n, const uint8_t *ssid);
+
+/**
+ * @brief Número de entradas usadas na tabela.
+ */
+size_t sta_profiles_count(const struct wifi_sta_profile_t *table, size_t n);
+
+/**
+ * @brief Adiciona ou atualiza uma rede salva. Se a tabela estiver cheia, a rede menos recentemente usada é substituída.
+ * @return o índice da rede na tabela. changed é definido como verdadeiro se a tabela foi modificada.
+ */
+int sta_profiles_upsert(struct wifi_sta_profile_t *table, size_t n, const uint8_t *ssid, const uint8_t *password, bool *changed);
+
+/**
+ * @brief Remove uma rede salva.
+ * @return verdadeiro se a rede existia.
+ */
+bool sta_profiles_remove(struct wifi_sta_profile_t *table, size_t n, const uint8_t *ssid);
+
+/**
+ * @brief Registra uma conexão bem-sucedida.
+ * @return verdadeiro se a mudança justifica uma gravação no flash (falhas zeradas ou última conexão muito antiga).
+ */
+bool sta_profiles_record_success(struct wifi_sta_profile_t *profile, uint32_t latency_ms, int64_t now);
+
+/**
+ * @brief Registra uma tentativa de conexão fracassada. Só atualiza a RAM.
+ */
+void sta_profiles_record_failure(struct wifi_sta_profile_t *profile);
+
+/**
+ * @brief Pontuação de uma rede salva visível com um determinado RSSI. Quanto maior, melhor.
+ */
+int32_t sta_profiles_score(const struct wifi_sta_profile_t *profile, int8_t rssi, int64_t now);
+
+/**
+ * @brief Escolhe a melhor rede salva entre as encontradas na última varredura.
+ * @param exclude_mask bit i definido exclui a entrada i da tabela (por exemplo, redes já tentadas).
+ * @return o índice na tabela ou -1 se nenhuma rede salva estiver visível.
+ */
+int sta_profiles_select(const struct wifi_sta_profile_t *table, size_t n, const wifi_ap_record_t *aps, uint16_t ap_num, uint32_t exclude_mask, int64_t now);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_STA_PROFILES_H_INCLUDED */
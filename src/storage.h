@@ -0,0 +1,112 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file storage.h
+@brief Interface de armazenamento persistente do wifi_manager: NVS, somente RAM ou arquivo no host
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_STORAGE_H_INCLUDED
+#define WIFI_MANAGER_STORAGE_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** @brief Tamanho máximo de um nome de chave, incluindo o terminador (o mesmo limite do NVS) */
+#define STORAGE_KEY_SIZE					16
+
+
+typedef enum storage_err_t{
+	STORAGE_OK = 0,
+	STORAGE_ERR_NOT_FOUND = 1,		/* a chave nunca foi gravada */
+	STORAGE_ERR_TOO_SMALL = 2,		/* o buffer é menor que o valor; *len recebe o tamanho necessário */
+	STORAGE_ERR_INVALID_ARG = 3,
+	STORAGE_ERR_NO_MEM = 4,
+	STORAGE_ERR_IO = 5				/* falha do meio de armazenamento */
+}storage_err_t;
+
+
+/**
+ * @brief Um valor a gravar.
+ */
+struct storage_item_t{
+	const char *key;
+	const void *data;
+	size_t len;
+};
+
+
+/**
+ * @brief Uma implementação de armazenamento. As funções não são reentrantes: quem chama serializa os acessos.
+ */
+struct storage_backend_t{
+	const char *name;
+
+	/**
+	 * @brief Lê uma chave. Com out NULL, apenas devolve o tamanho em *len.
+	 */
+	storage_err_t (*read)(void *ctx, const char *key, void *out, size_t *len);
+
+	/**
+	 * @brief Grava todas as chaves em uma única operação (um commit no NVS).
+	 * Em caso de erro, as chaves podem ter sido gravadas em parte, mas nenhuma fica com um valor incompleto.
+	 */
+	storage_err_t (*write)(void *ctx, const struct storage_item_t *items, size_t count);
+
+	/**
+	 * @brief Apaga uma chave. Apagar uma chave inexistente não é um erro.
+	 */
+	storage_err_t (*erase)(void *ctx, const char *key);
+
+	/**
+	 * @brief Libera a memória da implementação.
+	 */
+	void (*destroy)(void *ctx);
+
+	void *ctx;
+};
+
+
+/**
+ * @brief Armazenamento somente em RAM: nada é gravado no flash e tudo se perde no reset.
+ * Para bancadas de teste e unidades que nunca devem gravar o flash.
+ */
+storage_err_t storage_ram_create(struct storage_backend_t *backend);
+
+/**
+ * @brief Armazenamento no NVS, no namespace indicado. nvs_flash_init deve ter sido chamado.
+ */
+storage_err_t storage_nvs_create(struct storage_backend_t *backend, const char *nvs_namespace);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_STORAGE_H_INCLUDED */
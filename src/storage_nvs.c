@@ -0,0 +1,128 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file storage_nvs.c
+@brief Armazenamento no NVS
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <esp_err.h>
+#include "esp_log.h"
+#include "nvs.h"
+#include "storage.h"
+
+
+static const char TAG[] = "storage_nvs";
+
+
+/**
+ * @brief Converte um erro NVS. O código original é registrado no log.
+ */
+static storage_err_t storage_nvs_err(esp_err_t esp_err){
+	switch(esp_err){
+	case ESP_OK:
+		return STORAGE_OK;
+	case ESP_ERR_NVS_NOT_FOUND:
+		return STORAGE_ERR_NOT_FOUND;
+	case ESP_ERR_NVS_INVALID_LENGTH:
+		return STORAGE_ERR_TOO_SMALL;
+	case ESP_ERR_NVS_INVALID_NAME:
+	case ESP_ERR_NVS_KEY_TOO_LONG:
+		return STORAGE_ERR_INVALID_ARG;
+	case ESP_ERR_NO_MEM:
+		return STORAGE_ERR_NO_MEM;
+	default:
+		ESP_LOGE(TAG, "NVS error %d", esp_err);
+		return STORAGE_ERR_IO;
+	}
+}
+
+static storage_err_t storage_nvs_read(void *ctx, const char *key, void *out, size_t *len){
+
+	nvs_handle handle;
+
+	esp_err_t esp_err = nvs_open((const char*)ctx, NVS_READONLY, &handle);
+	if(esp_err == ESP_OK){
+		esp_err = nvs_get_blob(handle, key, out, len);
+		nvs_close(handle);
+	}
+
+	return storage_nvs_err(esp_err);
+}
+
+static storage_err_t storage_nvs_write(void *ctx, const struct storage_item_t *items, size_t count){
+
+	nvs_handle handle;
+
+	esp_err_t esp_err = nvs_open((const char*)ctx, NVS_READWRITE, &handle);
+	if(esp_err == ESP_OK){
+		for(size_t i=0; i<count && esp_err == ESP_OK; i++){
+			esp_err = nvs_set_blob(handle, items[i].key, items[i].data, items[i].len);
+		}
+		if(esp_err == ESP_OK){
+			esp_err = nvs_commit(handle);
+		}
+		nvs_close(handle);
+	}
+
+	return storage_nvs_err(esp_err);
+}
+
+static storage_err_t storage_nvs_erase(void *ctx, const char *key){
+
+	nvs_handle handle;
+
+	esp_err_t esp_err = nvs_open((const char*)ctx, NVS_READWRITE, &handle);
+	if(esp_err == ESP_OK){
+		esp_err = nvs_erase_key(handle, key);
+		if(esp_err == ESP_ERR_NVS_NOT_FOUND){
+			esp_err = ESP_OK;
+		}
+		else if(esp_err == ESP_OK){
+			esp_err = nvs_commit(handle);
+		}
+		nvs_close(handle);
+	}
+
+	return storage_nvs_err(esp_err);
+}
+
+static void storage_nvs_destroy(void *ctx){
+	/* o namespace não é uma cópia: nada a liberar */
+}
+
+storage_err_t storage_nvs_create(struct storage_backend_t *backend, const char *nvs_namespace){
+
+	if(nvs_namespace == NULL) return STORAGE_ERR_INVALID_ARG;
+
+	backend->name = "nvs";
+	backend->read = storage_nvs_read;
+	backend->write = storage_nvs_write;
+	backend->erase = storage_nvs_erase;
+	backend->destroy = storage_nvs_destroy;
+	backend->ctx = (void*)nvs_namespace;
+
+	return STORAGE_OK;
+}
@@ -0,0 +1,147 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file storage_ram.c
+@brief Armazenamento somente em RAM
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "storage.h"
+
+
+/**
+ * @brief Uma chave guardada em RAM. Lista encadeada: são poucas chaves.
+ */
+struct storage_ram_entry_t{
+	char key[STORAGE_KEY_SIZE];
+	uint8_t *data;
+	size_t len;
+	struct storage_ram_entry_t *next;
+};
+
+struct storage_ram_t{
+	struct storage_ram_entry_t *head;
+};
+
+
+static struct storage_ram_entry_t* storage_ram_find(struct storage_ram_t *ram, const char *key){
+	for(struct storage_ram_entry_t *e = ram->head; e != NULL; e = e->next){
+		if(strncmp(e->key, key, STORAGE_KEY_SIZE) == 0) return e;
+	}
+	return NULL;
+}
+
+static storage_err_t storage_ram_read(void *ctx, const char *key, void *out, size_t *len){
+
+	struct storage_ram_entry_t *e = storage_ram_find((struct storage_ram_t*)ctx, key);
+	if(e == NULL) return STORAGE_ERR_NOT_FOUND;
+
+	if(out != NULL){
+		if(*len < e->len){
+			*len = e->len;
+			return STORAGE_ERR_TOO_SMALL;
+		}
+		memcpy(out, e->data, e->len);
+	}
+	*len = e->len;
+
+	return STORAGE_OK;
+}
+
+static storage_err_t storage_ram_write(void *ctx, const struct storage_item_t *items, size_t count){
+
+	struct storage_ram_t *ram = (struct storage_ram_t*)ctx;
+
+	for(size_t i=0; i<count; i++){
+		if(items[i].key == NULL || strlen(items[i].key) >= STORAGE_KEY_SIZE) return STORAGE_ERR_INVALID_ARG;
+
+		uint8_t *copy = (uint8_t*)malloc(items[i].len ? items[i].len : 1);
+		if(copy == NULL) return STORAGE_ERR_NO_MEM;
+		memcpy(copy, items[i].data, items[i].len);
+
+		struct storage_ram_entry_t *e = storage_ram_find(ram, items[i].key);
+		if(e == NULL){
+			e = (struct storage_ram_entry_t*)calloc(1, sizeof(struct storage_ram_entry_t));
+			if(e == NULL){
+				free(copy);
+				return STORAGE_ERR_NO_MEM;
+			}
+			strncpy(e->key, items[i].key, STORAGE_KEY_SIZE - 1);
+			e->next = ram->head;
+			ram->head = e;
+		}
+
+		free(e->data);
+		e->data = copy;
+		e->len = items[i].len;
+	}
+
+	return STORAGE_OK;
+}
+
+static storage_err_t storage_ram_erase(void *ctx, const char *key){
+
+	struct storage_ram_t *ram = (struct storage_ram_t*)ctx;
+
+	for(struct storage_ram_entry_t **p = &ram->head; *p != NULL; p = &(*p)->next){
+		if(strncmp((*p)->key, key, STORAGE_KEY_SIZE) == 0){
+			struct storage_ram_entry_t *e = *p;
+			*p = e->next;
+			free(e->data);
+			free(e);
+			break;
+		}
+	}
+
+	return STORAGE_OK;
+}
+
+static void storage_ram_destroy(void *ctx){
+
+	struct storage_ram_t *ram = (struct storage_ram_t*)ctx;
+
+	while(ram->head){
+		struct storage_ram_entry_t *e = ram->head;
+		ram->head = e->next;
+		free(e->data);
+		free(e);
+	}
+	free(ram);
+}
+
+storage_err_t storage_ram_create(struct storage_backend_t *backend){
+
+	struct storage_ram_t *ram = (struct storage_ram_t*)calloc(1, sizeof(struct storage_ram_t));
+	if(ram == NULL) return STORAGE_ERR_NO_MEM;
+
+	backend->name = "ram";
+	backend->read = storage_ram_read;
+	backend->write = storage_ram_write;
+	backend->erase = storage_ram_erase;
+	backend->destroy = storage_ram_destroy;
+	backend->ctx = ram;
+
+	return STORAGE_OK;
+}
@@ -0,0 +1,46 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file task_config.c
+@brief Parâmetros de criação de uma tarefa: pilha, prioridade, núcleo e alocação
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "task_config.h"
+
+
+BaseType_t task_config_create(const struct task_config_t *config, TaskFunction_t function, const char *name, void *param, TaskHandle_t *handle){
+
+	TaskHandle_t task;
+
+	if(config->stack_buffer != NULL && config->tcb_buffer != NULL){
+		task = xTaskCreateStaticPinnedToCore(function, name, config->stack_size, param, config->priority, config->stack_buffer, config->tcb_buffer, config->core_id);
+		if(handle) *handle = task;
+		return task != NULL ? pdPASS : pdFAIL;
+	}
+
+	return xTaskCreatePinnedToCore(function, name, config->stack_size, param, config->priority, handle, config->core_id);
+}
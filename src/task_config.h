@@ -0,0 +1,66 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file task_config.h
+@brief Parâmetros de criação de uma tarefa: pilha, prioridade, núcleo e alocação
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_TASK_CONFIG_H_INCLUDED
+#define WIFI_MANAGER_TASK_CONFIG_H_INCLUDED
+
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Como criar uma tarefa do componente.
+ * Uma tarefa estática que se apaga só libera o TCB quando a tarefa ociosa roda: os buffers não devem ser reusados antes disso.
+ */
+struct task_config_t{
+	uint32_t stack_size;			/* em bytes */
+	UBaseType_t priority;
+	BaseType_t core_id;				/* 0, 1 ou tskNO_AFFINITY */
+	StackType_t *stack_buffer;		/* com tcb_buffer, a tarefa é criada com alocação estática. A memória é de quem chama e tem stack_size bytes */
+	StaticTask_t *tcb_buffer;
+};
+
+
+/**
+ * @brief Cria a tarefa com xTaskCreateStaticPinnedToCore se config tiver os buffers, senão com xTaskCreatePinnedToCore.
+ * @return pdPASS em caso de sucesso.
+ */
+BaseType_t task_config_create(const struct task_config_t *config, TaskFunction_t function, const char *name, void *param, TaskHandle_t *handle);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_TASK_CONFIG_H_INCLUDED */
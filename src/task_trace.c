@@ -0,0 +1,243 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file task_trace.c
+@brief Linha do tempo da atividade das tarefas do componente, exportada como Chrome trace
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_err.h>
+#include <esp_timer.h>
+#include "record_ring.h"
+#include "trace_ring.h"
+#include "task_trace.h"
+
+
+static struct record_ring_t task_trace_ring;
+static portMUX_TYPE task_trace_mux = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool task_trace_started = false;
+static volatile bool task_trace_paused = false;
+
+/* @brief eventos descartados durante uma leitura */
+static uint32_t task_trace_dropped = 0;
+
+static TaskHandle_t task_trace_source_task = NULL;
+static task_trace_source_t task_trace_source = NULL;
+static void *task_trace_source_arg = NULL;
+
+/**
+ * @brief Tarefas vistas, na ordem do primeiro evento. O nome é copiado porque a tarefa pode ser apagada antes da leitura.
+ */
+static TaskHandle_t task_trace_tasks[TASK_TRACE_MAX_TASKS];
+static char task_trace_task_names[TASK_TRACE_MAX_TASKS][configMAX_TASK_NAME_LEN];
+static uint8_t task_trace_task_count = 0;
+
+
+/**
+ * @brief Índice da tarefa na linha do tempo. Chamado dentro da seção crítica.
+ */
+static uint8_t task_trace_tid(TaskHandle_t task){
+
+	for(uint8_t i = 0; i < task_trace_task_count; i++){
+		if(task_trace_tasks[i] == task) return i;
+	}
+
+	if(task_trace_task_count < TASK_TRACE_MAX_TASKS){
+		uint8_t i = task_trace_task_count++;
+		task_trace_tasks[i] = task;
+		strncpy(task_trace_task_names[i], pcTaskGetName(task), configMAX_TASK_NAME_LEN - 1);
+		task_trace_task_names[i][configMAX_TASK_NAME_LEN - 1] = '\0';
+		return i;
+	}
+
+	return TASK_TRACE_MAX_TASKS - 1;
+}
+
+esp_err_t task_trace_start(uint16_t depth, struct trace_event_t *events){
+
+	if(task_trace_started) return ESP_OK;
+
+	if(events ? !record_ring_init_static(&task_trace_ring, events, sizeof(struct trace_event_t), depth) : !record_ring_init(&task_trace_ring, sizeof(struct trace_event_t), depth)) return ESP_ERR_NO_MEM;
+	task_trace_task_count = 0;
+	task_trace_dropped = 0;
+	task_trace_paused = false;
+	task_trace_started = true;
+
+	return ESP_OK;
+}
+
+void task_trace_stop(){
+
+	if(!task_trace_started) return;
+
+	portENTER_CRITICAL(&task_trace_mux);
+	task_trace_started = false;
+	portEXIT_CRITICAL(&task_trace_mux);
+
+	record_ring_free(&task_trace_ring);
+}
+
+void task_trace_set_source(TaskHandle_t task, task_trace_source_t source, void *arg){
+	portENTER_CRITICAL(&task_trace_mux);
+	task_trace_source_task = task;
+	task_trace_source = source;
+	task_trace_source_arg = arg;
+	portEXIT_CRITICAL(&task_trace_mux);
+}
+
+void task_trace_event(const char *name, char phase, int16_t arg){
+
+	struct trace_event_t event;
+
+	if(!task_trace_started) return;
+
+	event.name = name;
+	event.phase = phase;
+	event.arg = arg;
+
+	portENTER_CRITICAL(&task_trace_mux);
+	if(task_trace_started && !task_trace_paused){
+		/* o instante é lido dentro da seção crítica: os eventos ficam em ordem de tempo no buffer */
+		event.time_us = (uint32_t)esp_timer_get_time();
+		event.tid = task_trace_tid(xTaskGetCurrentTaskHandle());
+		record_ring_push(&task_trace_ring, &event);
+	}
+	else if(task_trace_started){
+		task_trace_dropped++;
+	}
+	portEXIT_CRITICAL(&task_trace_mux);
+}
+
+void task_trace_reader_begin(struct task_trace_reader_t *reader){
+
+	const struct trace_event_t *e;
+	uint32_t wraps = 0, last_us = 0;
+
+	memset(reader, 0x00, sizeof(struct task_trace_reader_t));
+
+	portENTER_CRITICAL(&task_trace_mux);
+	task_trace_paused = true;
+	portEXIT_CRITICAL(&task_trace_mux);
+
+	/* instantes desde o boot, como os da fonte externa: o evento mais novo é anterior a agora e as voltas
+	 * do relógio de 32 bits são contadas dele para trás. A gravação está suspensa, o buffer não muda */
+	if(!task_trace_started || task_trace_ring.count == 0) return;
+	for(uint16_t i = 0; (e = (const struct trace_event_t*)record_ring_get(&task_trace_ring, i)) != NULL; i++){
+		if(i > 0 && e->time_us < last_us) wraps++;
+		last_us = e->time_us;
+	}
+	uint64_t now_us = (uint64_t)esp_timer_get_time();
+	uint64_t newest_us = now_us - (uint32_t)((uint32_t)now_us - last_us);
+	reader->high_us = (newest_us - last_us) - ((uint64_t)wraps << 32);
+}
+
+size_t task_trace_read_chrome(struct task_trace_reader_t *reader, char *buf, size_t len){
+
+	const char *names[TASK_TRACE_MAX_TASKS];
+	struct trace_event_t event;
+	uint64_t ts_us;
+	size_t pos = 0, sz;
+
+	if(!task_trace_started || len == 0) return 0;
+	buf[0] = '\0';
+
+	while(reader->stage < 4){
+
+		if(reader->stage == 0){
+			/* a tarefa da fonte externa precisa ser nomeada no início */
+			portENTER_CRITICAL(&task_trace_mux);
+			if(task_trace_source) reader->source_tid = task_trace_tid(task_trace_source_task);
+			portEXIT_CRITICAL(&task_trace_mux);
+			for(uint8_t i = 0; i < task_trace_task_count; i++) names[i] = task_trace_task_names[i];
+			sz = trace_ring_chrome_header("wifi_manager", names, task_trace_task_count, NULL, 0);
+			if(pos + sz >= len) break;
+			pos += trace_ring_chrome_header("wifi_manager", names, task_trace_task_count, buf + pos, len - pos);
+			reader->stage = 1;
+		}
+		else if(reader->stage == 1){
+			portENTER_CRITICAL(&task_trace_mux);
+			const struct trace_event_t *e = (const struct trace_event_t*)record_ring_get(&task_trace_ring, reader->next);
+			if(e) event = *e;
+			portEXIT_CRITICAL(&task_trace_mux);
+			if(e == NULL){
+				reader->stage = 2;
+				continue;
+			}
+
+			/* desdobramento do relógio de 32 bits: os eventos estão em ordem de tempo */
+			uint64_t high = reader->high_us;
+			if(reader->next > 0 && event.time_us < reader->last_us) high += (1ULL << 32);
+
+			sz = trace_ring_chrome_event(&event, high + event.time_us, NULL, 0);
+			if(pos + sz >= len) break;
+			pos += trace_ring_chrome_event(&event, high + event.time_us, buf + pos, len - pos);
+			if(reader->next == 0) reader->first_us = high + event.time_us;
+			reader->high_us = high;
+			reader->last_us = event.time_us;
+			reader->next++;
+		}
+		else if(reader->stage == 2){
+			/* a ordem no JSON não importa: o visualizador ordena os eventos pelo instante */
+			if(task_trace_source == NULL || !task_trace_source(&reader->seq, &event, &ts_us, task_trace_source_arg)){
+				reader->stage = 3;
+				continue;
+			}
+			if(reader->next > 0 && ts_us < reader->first_us){
+				/* anterior à linha do tempo: já lido ou sem contexto */
+				reader->seq++;
+				continue;
+			}
+			event.tid = reader->source_tid;
+			sz = trace_ring_chrome_event(&event, ts_us, NULL, 0);
+			if(pos + sz >= len) break;
+			pos += trace_ring_chrome_event(&event, ts_us, buf + pos, len - pos);
+			reader->seq++;
+		}
+		else{
+			sz = trace_ring_chrome_footer(task_trace_ring.lost + task_trace_dropped, NULL, 0);
+			if(pos + sz >= len) break;
+			pos += trace_ring_chrome_footer(task_trace_ring.lost + task_trace_dropped, buf + pos, len - pos);
+			reader->stage = 4;
+		}
+	}
+
+	return pos;
+}
+
+void task_trace_reader_end(struct task_trace_reader_t *reader){
+
+	portENTER_CRITICAL(&task_trace_mux);
+	if(task_trace_started){
+		/* os eventos lidos saem da linha do tempo; a próxima leitura mostra só o que veio depois */
+		if(reader->stage == 4){
+			record_ring_clear(&task_trace_ring);
+			task_trace_dropped = 0;
+		}
+	}
+	task_trace_paused = false;
+	portEXIT_CRITICAL(&task_trace_mux);
+}
@@ -0,0 +1,122 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file task_trace.h
+@brief Linha do tempo da atividade das tarefas do componente, exportada como Chrome trace
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_TASK_TRACE_H_INCLUDED
+#define WIFI_MANAGER_TASK_TRACE_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_err.h>
+#include "trace_ring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** @brief número de tarefas diferentes nomeadas na linha do tempo; as seguintes dividem a última linha */
+#define TASK_TRACE_MAX_TASKS				8
+
+/**
+ * @brief Pontos de trace. Sem CONFIG_WIFI_MANAGER_TASK_TRACE, não geram código.
+ * O nome deve ser uma string literal. Um fim fecha o último início da mesma tarefa.
+ */
+#ifdef CONFIG_WIFI_MANAGER_TASK_TRACE
+#define TASK_TRACE_BEGIN(name, arg)			task_trace_event(name, TRACE_PHASE_BEGIN, arg)
+#define TASK_TRACE_END(name, arg)			task_trace_event(name, TRACE_PHASE_END, arg)
+#define TASK_TRACE_INSTANT(name, arg)		task_trace_event(name, TRACE_PHASE_INSTANT, arg)
+#else
+#define TASK_TRACE_BEGIN(name, arg)			do{}while(0)
+#define TASK_TRACE_END(name, arg)			do{}while(0)
+#define TASK_TRACE_INSTANT(name, arg)		do{}while(0)
+#endif
+
+/**
+ * @brief Estado de uma leitura da linha do tempo em pedaços.
+ */
+struct task_trace_reader_t{
+	uint8_t stage;			/* 0: início, 1: eventos, 2: fonte externa, 3: fim, 4: terminado */
+	uint16_t next;			/* próximo evento */
+	uint32_t last_us;		/* instante de 32 bits do evento anterior */
+	uint64_t high_us;		/* voltas do relógio de 32 bits já vistas, desde o boot */
+	uint64_t first_us;		/* instante do evento mais antigo */
+	uint32_t seq;			/* próximo registro da fonte externa */
+	uint8_t source_tid;		/* linha da tarefa da fonte externa */
+};
+
+/**
+ * @brief Lê um registro de outra gravação como um evento instantâneo.
+ * @param seq número de sequência do registro; a fonte o avança se ele já foi perdido.
+ * @param ts_us recebe o instante do registro desde o boot.
+ * @return false se não há registro seq.
+ */
+typedef bool (*task_trace_source_t)(uint32_t *seq, struct trace_event_t *event, uint64_t *ts_us, void *arg);
+
+
+/** @brief Cria o buffer de depth eventos. events é um buffer de quem chama, ou NULL para alocar. */
+esp_err_t task_trace_start(uint16_t depth, struct trace_event_t *events);
+void task_trace_stop();
+
+/**
+ * @brief Grava um evento da tarefa que chama. Uma seção crítica curta; nada acontece antes de task_trace_start ou durante uma leitura.
+ */
+void task_trace_event(const char *name, char phase, int16_t arg);
+
+/**
+ * @brief Acrescenta à linha do tempo os registros de outra gravação, na linha da tarefa task: um instante que já é
+ * gravado em outro lugar (a retirada de uma mensagem da fila do gerenciador) não é gravado duas vezes.
+ * Só os registros a partir do evento mais antigo da linha do tempo são lidos. NULL remove a fonte.
+ */
+void task_trace_set_source(TaskHandle_t task, task_trace_source_t source, void *arg);
+
+/**
+ * @brief Começa uma leitura: a gravação fica suspensa até task_trace_reader_end, para que a linha do tempo lida seja coerente.
+ */
+void task_trace_reader_begin(struct task_trace_reader_t *reader);
+
+/**
+ * @brief Escreve o próximo pedaço do JSON, com tantos eventos inteiros quanto couberem em buf.
+ * @return o número de bytes escritos, sem o terminador. 0 quando a leitura terminou.
+ */
+size_t task_trace_read_chrome(struct task_trace_reader_t *reader, char *buf, size_t len);
+
+/**
+ * @brief Termina a leitura, descarta os eventos lidos e retoma a gravação.
+ */
+void task_trace_reader_end(struct task_trace_reader_t *reader);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_TASK_TRACE_H_INCLUDED */
@@ -0,0 +1,57 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file text_writer.c
+@brief Montagem de texto (JSON, linhas de log) em um buffer de tamanho fixo, com cálculo do tamanho necessário
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include "text_writer.h"
+
+
+void text_append(char *buf, size_t len, size_t *pos, const char *fmt, ...){
+
+	va_list ap;
+
+	va_start(ap, fmt);
+	int n = vsnprintf(text_cursor(buf, len, *pos), text_room(buf, len, *pos), fmt, ap);
+	va_end(ap);
+
+	if(n > 0) *pos += (size_t)n;
+}
+
+char* text_cursor(char *buf, size_t len, size_t pos){
+	return (buf && pos < len) ? buf + pos : NULL;
+}
+
+size_t text_room(const char *buf, size_t len, size_t pos){
+	return (buf && pos < len) ? len - pos : 0;
+}
+
+size_t text_finish(char *buf, size_t len, size_t pos){
+	if(buf && pos >= len && len > 0) buf[0] = '\0';
+	return pos;
+}
@@ -0,0 +1,68 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file text_writer.h
+@brief Montagem de texto (JSON, linhas de log) em um buffer de tamanho fixo, com cálculo do tamanho necessário
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_TEXT_WRITER_H_INCLUDED
+#define WIFI_MANAGER_TEXT_WRITER_H_INCLUDED
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Acrescenta texto formatado como em printf na posição pos de buf.
+ * A posição avança mesmo quando o buffer acaba, para que text_finish devolva o tamanho necessário.
+ * buf pode ser NULL: só o tamanho é calculado.
+ */
+void text_append(char *buf, size_t len, size_t *pos, const char *fmt, ...) __attribute__((format(printf, 4, 5)));
+
+/**
+ * @brief Onde um serializador aninhado com a mesma convenção escreve: NULL quando o buffer já acabou.
+ */
+char* text_cursor(char *buf, size_t len, size_t pos);
+
+/**
+ * @brief Espaço que resta depois de pos, 0 quando o buffer já acabou.
+ */
+size_t text_room(const char *buf, size_t len, size_t pos);
+
+/**
+ * @brief Termina o texto: o conteúdo só é válido se coube inteiro, senão buf fica vazio.
+ * @return pos, o tamanho necessário sem o terminador.
+ */
+size_t text_finish(char *buf, size_t len, size_t pos);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_TEXT_WRITER_H_INCLUDED */
@@ -0,0 +1,65 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file trace_ring.c
+@brief Eventos de início e fim de uma linha do tempo e sua exportação no formato Chrome trace
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdint.h>
+#include "text_writer.h"
+#include "trace_ring.h"
+
+size_t trace_ring_chrome_header(const char *process_name, const char *const *thread_names, uint8_t thread_count, char *buf, size_t len){
+
+	size_t pos = 0;
+
+	text_append(buf, len, &pos, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"%s\"}}", process_name);
+
+	for(uint8_t t = 0; t < thread_count; t++){
+		text_append(buf, len, &pos, ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", (unsigned)t + 1, thread_names[t] ? thread_names[t] : "?");
+	}
+
+	return text_finish(buf, len, pos);
+}
+
+size_t trace_ring_chrome_event(const struct trace_event_t *event, uint64_t ts_us, char *buf, size_t len){
+
+	size_t pos = 0;
+
+	/* tid 0 é o dos metadados do processo: as tarefas começam em 1 */
+	text_append(buf, len, &pos, ",{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":1,\"tid\":%u%s,\"args\":{\"arg\":%d}}",
+			event->name ? event->name : "?", event->phase, (unsigned long long)ts_us, (unsigned)event->tid + 1,
+			event->phase == TRACE_PHASE_INSTANT ? ",\"s\":\"t\"" : "", (int)event->arg);
+
+	return text_finish(buf, len, pos);
+}
+
+size_t trace_ring_chrome_footer(uint32_t lost, char *buf, size_t len){
+
+	size_t pos = 0;
+
+	text_append(buf, len, &pos, "],\"otherData\":{\"lost\":%u}}", (unsigned)lost);
+
+	return text_finish(buf, len, pos);
+}
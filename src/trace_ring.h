@@ -0,0 +1,83 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file trace_ring.h
+@brief Eventos de início e fim de uma linha do tempo e sua exportação no formato Chrome trace
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_TRACE_RING_H_INCLUDED
+#define WIFI_MANAGER_TRACE_RING_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** @brief fases do formato Chrome trace usadas */
+#define TRACE_PHASE_BEGIN					'B'
+#define TRACE_PHASE_END						'E'
+#define TRACE_PHASE_INSTANT					'i'
+
+/**
+ * @brief Um evento. O nome é guardado por endereço: ele precisa existir para sempre, como uma string literal.
+ */
+struct trace_event_t{
+	uint32_t time_us;		/* 32 bits do esp_timer; volta a zero a cada 71 minutos */
+	const char *name;
+	int16_t arg;
+	char phase;
+	uint8_t tid;			/* índice da tarefa que gravou o evento */
+};
+
+
+/**
+ * @brief Início do JSON: abre a lista de eventos e nomeia o processo e as tarefas (thread_name).
+ * @return o tamanho, sem o terminador. Nada é escrito se buf for NULL ou menor que esse tamanho + 1.
+ */
+size_t trace_ring_chrome_header(const char *process_name, const char *const *thread_names, uint8_t thread_count, char *buf, size_t len);
+
+/**
+ * @brief Um evento, precedido da vírgula que o separa dos metadados do início.
+ * @param ts_us o instante do evento já desdobrado para 64 bits.
+ * @return o tamanho, como em trace_ring_chrome_header.
+ */
+size_t trace_ring_chrome_event(const struct trace_event_t *event, uint64_t ts_us, char *buf, size_t len);
+
+/**
+ * @brief Fim do JSON, com o número de eventos perdidos.
+ * @return o tamanho, como em trace_ring_chrome_header.
+ */
+size_t trace_ring_chrome_footer(uint32_t lost, char *buf, size_t len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_TRACE_RING_H_INCLUDED */
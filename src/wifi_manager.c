@@ -34,6 +34,7 @@ Contém a tarefa freeRTOS e todo o suporte necessário
 #include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <time.h>
 #include "esp_system.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
@@ -46,6 +47,7 @@ Contém a tarefa freeRTOS e todo o suporte necessário
 #include "esp_netif.h"
 #include "esp_wifi_types.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs.h"
 #include "nvs_flash.h"
 #include "mdns.h"
@@ -53,17 +55,40 @@ Contém a tarefa freeRTOS e todo o suporte necessário
 #include "lwip/err.h"
 #include "lwip/netdb.h"
 #include "lwip/ip4_addr.h"
+#include "lwip/dhcp.h"
 
 
 #include "json.h"
+#include "text_writer.h"
 #include "dns_server.h"
 #include "nvs_sync.h"
 #include "wifi_manager.h"
-
-
-
-/* objetos usados ​​para manipular a fila principal de eventos */
-QueueHandle_t wifi_manager_queue;
+#include "sta_profiles.h"
+#include "retry_policy.h"
+#include "disconnect_reason.h"
+#include "message_ring.h"
+#include "event_bus.h"
+#include "config_record.h"
+#include "storage.h"
+#include "nvs_writer.h"
+#include "rtc_resume.h"
+#include "msg_trace.h"
+#include "conn_fsm.h"
+#include "boot_profile.h"
+#include "latency_hist.h"
+#include "task_trace.h"
+
+
+
+/* objetos usados ​​para manipular a fila principal de eventos.
+ * A fila nunca bloqueia quem posta (loop de eventos do esp, servidor http, temporizadores): o semáforo conta as mensagens
+ * e a tarefa wifi_manager espera nele. */
+static struct message_ring_t wifi_manager_queue;
+static portMUX_TYPE wifi_manager_queue_mux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t wifi_manager_queue_sem = NULL;
+
+/* @brief ordens idempotentes e eventos em que só o último importa: não se repetem em sequência na fila */
+#define WIFI_MANAGER_COALESCE_MASK			( (1UL << WM_ORDER_START_WIFI_SCAN) | (1UL << WM_ORDER_CONNECT_STA) | (1UL << WM_EVENT_STA_DISCONNECTED) )
 
 /* @brief temporizador de software para esperar entre cada tentativa de conexão.
  * Não faz sentido monopolizar um cronômetro de hardware para uma funcionalidade como esta, que só precisa ser 'accurate enough' */
@@ -73,6 +98,9 @@ TimerHandle_t wifi_manager_retry_timer = NULL;
  * Não faz sentido monopolizar um cronômetro de hardware para uma funcionalidade como esta, que só precisa ser "precisa o suficiente" */
 TimerHandle_t wifi_manager_shutdown_ap_timer = NULL;
 
+/* @brief temporizador de software que devolve a STA ao cliente DHCP quando um aluguel reutilizado expira */
+TimerHandle_t wifi_manager_lease_timer = NULL;
+
 SemaphoreHandle_t wifi_manager_json_mutex = NULL;
 SemaphoreHandle_t wifi_manager_sta_ip_mutex = NULL;
 char *wifi_manager_sta_ip = NULL;
@@ -82,8 +110,6 @@ char *accessp_json = NULL;
 char *ip_info_json = NULL;
 wifi_config_t* wifi_manager_config_sta = NULL;
 
-/* @brief Matriz de ponteiros de função de retorno de chamada */
-void (**cb_ptr_arr)(void*) = NULL;
 
 /* @brief tag usada para mensagens do console serial ESP */
 static const char TAG[] = "wifi_manager";
@@ -91,6 +117,22 @@ static const char TAG[] = "wifi_manager";
 /* @brief identificador de tarefa para a tarefa wifi_manager principal */
 static TaskHandle_t task_wifi_manager = NULL;
 
+/* @brief topologia das tarefas em uso */
+static struct wifi_manager_topology_t wifi_manager_topology;
+static bool wifi_manager_topology_set = false;
+
+#if WIFI_MANAGER_TASK_STATIC
+/* @brief pilhas reservadas no link para as tarefas com alocação estática */
+static StackType_t wifi_manager_task_stack[WIFI_MANAGER_TASK_STACK];
+static StaticTask_t wifi_manager_task_tcb;
+static StackType_t wifi_manager_dns_task_stack[WIFI_MANAGER_DNS_TASK_STACK];
+static StaticTask_t wifi_manager_dns_task_tcb;
+static StackType_t wifi_manager_nvs_writer_task_stack[WIFI_MANAGER_NVS_WRITER_TASK_STACK];
+static StaticTask_t wifi_manager_nvs_writer_task_tcb;
+static StackType_t wifi_manager_async_log_task_stack[WIFI_MANAGER_ASYNC_LOG_TASK_STACK];
+static StaticTask_t wifi_manager_async_log_task_tcb;
+#endif
+
 /* @brief objeto netif para a ESTAÇÃO */
 static esp_netif_t* esp_netif_sta = NULL;
 
@@ -113,21 +155,188 @@ struct wifi_settings_t wifi_settings = {
 
 const char wifi_manager_nvs_namespace[] = "espwifimgr";
 
+/* @brief cópia em RAM do cache da última associação bem-sucedida, como está gravado no flash */
+static struct wifi_sta_cache_t wifi_manager_sta_cache;
+
+/* @brief cópia em RAM do último aluguel DHCP, como está gravado no flash */
+static struct wifi_sta_lease_t wifi_manager_sta_lease;
+
+/* @brief origem da configuração IP usada pela tentativa de conexão em andamento */
+static sta_ip_source_code_t wifi_manager_sta_ip_source = STA_IP_SOURCE_DHCP;
+
+/* @brief muda a cada tentativa de conexão: um aviso de expiração de uma tentativa anterior é ignorado */
+static uint32_t wifi_manager_lease_generation = 0;
+
+/* @brief instante (esp_timer) em que a tentativa de conexão em andamento foi iniciada */
+static int64_t wifi_manager_connect_start_us = 0;
+
+/* @brief instante de WIFI_EVENT_STA_CONNECTED da tentativa em andamento (0 se ainda não houve), escrito pela tarefa de eventos */
+static int64_t wifi_manager_connect_link_us = 0;
+static portMUX_TYPE wifi_manager_latency_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* @brief origem da tentativa em andamento */
+static connection_request_made_by_code_t wifi_manager_connect_origin = CONNECTION_REQUEST_NONE;
+
+/* @brief histogramas de latência por tentativa, por origem (índice origem - 1) e por fase, em ms */
+static struct wifi_manager_conn_latency_t wifi_manager_conn_latency[WIFI_MANAGER_LATENCY_ORIGINS];
+
+/* @brief estatísticas de tempo até o IP, por origem da configuração IP */
+static struct wifi_manager_time_to_ip_t wifi_manager_time_to_ip[STA_IP_SOURCE_COUNT];
+static portMUX_TYPE wifi_manager_time_to_ip_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* @brief redes salvas. O histórico de falhas é mantido em RAM e só é gravado junto com uma conexão bem-sucedida */
+static struct wifi_sta_profile_t wifi_manager_sta_profiles[WIFI_MANAGER_MAX_SAVED_NETWORKS];
+
+/* @brief verdadeiro quando a tabela de redes salvas em RAM difere da gravada no flash */
+static bool wifi_manager_sta_profiles_dirty = false;
+
+/* @brief chave NVS do registro único com toda a configuração */
+static const char wifi_manager_config_key[] = "config";
+
+/* @brief chaves do formato anterior, apagadas na migração */
+static const char* const wifi_manager_legacy_keys[] = { "ssid", "password", "settings", "profiles" };
+
+/* @brief verdadeiro se a configuração foi lida no formato anterior e ainda precisa ser migrada */
+static bool wifi_manager_config_legacy = false;
+
+/* @brief tamanho e CRC do registro gravado no flash, para evitar gravações sem mudança */
+static size_t wifi_manager_config_record_size = 0;
+static uint32_t wifi_manager_config_record_crc = 0;
+
+static struct wifi_manager_nvs_stats_t wifi_manager_nvs_stats;
+
+/**
+ * @brief Onde a configuração é gravada: NVS ou somente RAM (WIFI_MANAGER_STORAGE_RAM).
+ */
+static struct storage_backend_t wifi_manager_storage;
+
+/**
+ * @brief Tempo até a primeira conexão desde o boot.
+ */
+static struct wifi_manager_wake_stats_t wifi_manager_wake_stats;
+
+/**
+ * @brief Fases do boot até o primeiro IP, por linha: wifi_manager_start (tarefa de quem chama), tarefa wifi_manager e conexão.
+ */
+#define WIFI_MANAGER_BOOT_TRACK_START		1
+#define WIFI_MANAGER_BOOT_TRACK_TASK		2
+#define WIFI_MANAGER_BOOT_TRACK_CONNECT		3
+static struct boot_profile_t wifi_manager_boot_profile;
+static portMUX_TYPE wifi_manager_boot_profile_mux = portMUX_INITIALIZER_UNLOCKED;
+static const char* const wifi_manager_boot_tracks[] = { NULL, "wifi_manager_start", "wifi_manager task", "connection" };
+
+/* @brief fase "connect" em aberto: do primeiro pedido de conexão até o primeiro IP */
+static int wifi_manager_boot_connect_phase = -1;
+
+/**
+ * @brief Trace das mensagens tratadas (WIFI_MANAGER_TRACE) e o mutex que o protege.
+ */
+static struct msg_trace_t wifi_manager_trace;
+static SemaphoreHandle_t wifi_manager_trace_mutex = NULL;
+
+/* @brief memória devolvida pelo modo WIFI_MANAGER_PORTAL_RELEASE */
+static struct wifi_manager_portal_stats_t wifi_manager_portal_stats;
+
+/* @brief heap livre logo antes da última liberação do portal */
+static uint32_t wifi_manager_portal_heap_before = 0;
+
+/**
+ * @brief Registro de configuração e seu formato codificado, preparados juntos para gravar ou ler.
+ */
+struct wifi_manager_record_work_t{
+	struct config_record_t record;
+	uint8_t buff[CONFIG_RECORD_MAX_SIZE];
+};
+
+#if WIFI_MANAGER_STATIC_ALLOC
+/* @brief memória do componente reservada no link: wifi_manager_start não usa o heap */
+static uint8_t wifi_manager_queue_items[WIFI_MANAGER_QUEUE_DEPTH * sizeof(queue_message)];
+static uint8_t wifi_manager_queue_codes[WIFI_MANAGER_QUEUE_DEPTH];
+#if WIFI_MANAGER_TRACE
+static struct msg_trace_record_t wifi_manager_trace_records[WIFI_MANAGER_TRACE_DEPTH];
+#endif
+#if WIFI_MANAGER_ASYNC_LOG
+static struct log_ring_cell_t wifi_manager_async_log_cells[WIFI_MANAGER_ASYNC_LOG_DEPTH];
+#endif
+#if WIFI_MANAGER_TASK_TRACE
+static struct trace_event_t wifi_manager_task_trace_events[WIFI_MANAGER_TASK_TRACE_DEPTH];
+#endif
+static wifi_ap_record_t wifi_manager_accessp_records_buffer[MAX_AP_NUM];
+static char wifi_manager_accessp_json_buffer[MAX_AP_NUM * JSON_ONE_APP_SIZE + 4];
+static char wifi_manager_ip_info_json_buffer[JSON_IP_INFO_SIZE];
+static wifi_config_t wifi_manager_config_sta_buffer;
+static char wifi_manager_sta_ip_buffer[IP4ADDR_STRLEN_MAX];
+static StaticSemaphore_t wifi_manager_queue_sem_buffer;
+static StaticSemaphore_t wifi_manager_json_mutex_buffer;
+static StaticSemaphore_t wifi_manager_trace_mutex_buffer;
+static StaticSemaphore_t wifi_manager_sta_ip_mutex_buffer;
+static StaticEventGroup_t wifi_manager_event_group_buffer;
+static StaticTimer_t wifi_manager_retry_timer_buffer;
+static StaticTimer_t wifi_manager_shutdown_ap_timer_buffer;
+static StaticTimer_t wifi_manager_lease_timer_buffer;
+
+/**
+ * @brief Memória de trabalho das operações grandes demais para a pilha: uma por vez, protegida por wifi_manager_scratch_mutex.
+ */
+union wifi_manager_scratch_t{
+	struct wifi_manager_record_work_t config;
+	struct wifi_manager_conn_latency_t latency[WIFI_MANAGER_LATENCY_ORIGINS];
+	struct boot_profile_t boot;
+};
+static union wifi_manager_scratch_t wifi_manager_scratch;
+static StaticSemaphore_t wifi_manager_scratch_mutex_buffer;
+static SemaphoreHandle_t wifi_manager_scratch_mutex = NULL;
+#endif
+
+/* @brief nomes dos códigos de mensagem, para /loop.json e a linha do tempo */
+static const char* const wifi_manager_msg_names[WM_MESSAGE_CODE_COUNT] = {
+	"NONE", "ORDER_START_HTTP_SERVER", "ORDER_STOP_HTTP_SERVER", "ORDER_START_DNS_SERVICE", "ORDER_STOP_DNS_SERVICE",
+	"ORDER_START_WIFI_SCAN", "ORDER_LOAD_AND_RESTORE_STA", "ORDER_CONNECT_STA", "ORDER_DISCONNECT_STA", "ORDER_START_AP",
+	"EVENT_STA_DISCONNECTED", "EVENT_SCAN_DONE", "EVENT_STA_GOT_IP", "ORDER_STOP_AP", "EVENT_STA_LEASE_EXPIRED"
+};
+
+/* @brief tempo do loop por código de mensagem. Escrito só pela tarefa wifi_manager; o mux protege as cópias */
+static struct wifi_manager_msg_stats_t wifi_manager_msg_stats[WM_MESSAGE_CODE_COUNT];
+static portMUX_TYPE wifi_manager_msg_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* @brief tempo gasto nos callbacks da mensagem em tratamento */
+static uint32_t wifi_manager_callback_us = 0;
+
+/**
+ * @brief A configuração veio da memória RTC e as redes salvas ainda não foram lidas do NVS.
+ */
+static bool wifi_manager_resume_pending = false;
+
+/* @brief redes salvas já tentadas desde a última conexão bem-sucedida (bit i = entrada i da tabela) */
+static uint32_t wifi_manager_sta_profiles_tried = 0;
+
+/**
+ * @brief Máquina de estados da conexão STA: tentativas, reconexão rápida, seleção de rede e desistência (ver conn_fsm.c).
+ * Os bits do grupo de eventos continuam mantidos para quem os observa de fora.
+ */
+static struct conn_fsm_t wifi_manager_fsm;
+
+/* @brief política de espera entre as tentativas de reconexão definida pelo usuário, NULL para a política do menuconfig */
+static uint32_t (*wifi_manager_retry_policy)(uint32_t attempt) = NULL;
+
+/* @brief código de razão da última desconexão da STA */
+static uint8_t wifi_manager_last_disconnect_reason = 0;
+
 static EventGroupHandle_t wifi_manager_event_group;
 
 /* @brief indicar que o ESP32 está conectado no momento. */
-const int WIFI_MANAGER_WIFI_CONNECTED_BIT = BIT0;
+const int WIFI_MANAGER_WIFI_CONNECTED_BIT = WIFI_MANAGER_STATE_CONNECTED;
 
 const int WIFI_MANAGER_AP_STA_CONNECTED_BIT = BIT1;
 
 /* @brief Definido automaticamente assim que o SoftAP é iniciado */
-const int WIFI_MANAGER_AP_STARTED_BIT = BIT2;
+const int WIFI_MANAGER_AP_STARTED_BIT = WIFI_MANAGER_STATE_AP_STARTED;
 
 /* @brief Quando definido, significa que um cliente solicitou a conexão a um ponto de acesso.*/
 const int WIFI_MANAGER_REQUEST_STA_CONNECT_BIT = BIT3;
 
-/* @brief Este bit é definido automaticamente assim que uma conexão for perdida */
-const int WIFI_MANAGER_STA_DISCONNECT_BIT = BIT4;
+/* @brief Este bit é definido automaticamente assim que uma conexão for perdida, e apagado quando um IP é obtido */
+const int WIFI_MANAGER_STA_DISCONNECT_BIT = WIFI_MANAGER_STATE_DISCONNECTED;
 
 /* @brief Quando definido, significa que o gerenciador wi-fi tenta restaurar uma conexão salva anteriormente na inicialização. */
 const int WIFI_MANAGER_REQUEST_RESTORE_STA_BIT = BIT5;
@@ -136,11 +345,18 @@ const int WIFI_MANAGER_REQUEST_RESTORE_STA_BIT = BIT5;
 const int WIFI_MANAGER_REQUEST_WIFI_DISCONNECT_BIT = BIT6;
 
 /* @brief Quando definido, significa que uma varredura está em andamento */
-const int WIFI_MANAGER_SCAN_BIT = BIT7;
+const int WIFI_MANAGER_SCAN_BIT = WIFI_MANAGER_STATE_SCANNING;
 
 /* @brief Quando definido, significa que o usuário solicitou uma desconexão */
 const int WIFI_MANAGER_REQUEST_DISCONNECT_BIT = BIT8;
 
+/* @brief retrato do estado da conexão, protegido por um seqlock: os leitores nunca bloqueiam.
+ * Um número de sequência ímpar significa que uma escrita está em andamento. */
+static struct wifi_manager_status_t wifi_manager_status;
+static volatile uint32_t wifi_manager_status_seq = 0;
+static portMUX_TYPE wifi_manager_status_mux = portMUX_INITIALIZER_UNLOCKED;
+static int64_t wifi_manager_status_connected_at = 0;
+
 
 
 void wifi_manager_timer_retry_cb( TimerHandle_t xTimer ){
@@ -155,6 +371,48 @@ void wifi_manager_timer_retry_cb( TimerHandle_t xTimer ){
 
 }
 
+/**
+ * @brief Política de espera definida no menuconfig: fixa ou recuo exponencial com jitter completo.
+ */
+static uint32_t wifi_manager_default_retry_policy(uint32_t attempt){
+	if(WIFI_MANAGER_RETRY_BACKOFF){
+		return retry_policy_backoff_full_jitter(attempt, WIFI_MANAGER_RETRY_TIMER, WIFI_MANAGER_RETRY_BACKOFF_CAP, esp_random());
+	}
+	else{
+		return WIFI_MANAGER_RETRY_TIMER;
+	}
+}
+
+/**
+ * @brief Arma o temporizador de nova tentativa com o tempo dado pela política de espera.
+ */
+static void wifi_manager_fsm_arm_retry(void *ctx, uint32_t attempt){
+
+	uint32_t delay_ms = wifi_manager_retry_policy ? wifi_manager_retry_policy(attempt) : wifi_manager_default_retry_policy(attempt);
+	TickType_t t = pdMS_TO_TICKS(delay_ms);
+
+	/* um temporizador FreeRTOS não pode ter período 0 */
+	if(t == 0) t = 1;
+
+	ESP_LOGI(TAG, "Retry %u in %u ms", (unsigned)attempt, (unsigned)delay_ms);
+
+	/* xTimerChangePeriod também inicia o temporizador */
+	xTimerChangePeriod( wifi_manager_retry_timer, t, (TickType_t)0 );
+}
+
+static void wifi_manager_fsm_cancel_retry(void *ctx){
+	xTimerStop( wifi_manager_retry_timer, (TickType_t)0 );
+}
+
+static void wifi_manager_fsm_post(void *ctx, uint8_t code, uint32_t param){
+	wifi_manager_send_message((message_code_t)code, (void*)(uintptr_t)param);
+}
+
+
+void wifi_manager_set_retry_policy(uint32_t (*policy)(uint32_t attempt)){
+	wifi_manager_retry_policy = policy;
+}
+
 void wifi_manager_timer_shutdown_ap_cb( TimerHandle_t xTimer){
 
 	/* pare o timer */
@@ -164,6 +422,15 @@ void wifi_manager_timer_shutdown_ap_cb( TimerHandle_t xTimer){
 	wifi_manager_send_message(WM_ORDER_STOP_AP, NULL);
 }
 
+void wifi_manager_timer_lease_cb( TimerHandle_t xTimer ){
+
+	/* pare o timer */
+	xTimerStop( xTimer, (TickType_t) 0 );
+
+	/* a troca para o cliente DHCP é feita pela tarefa wifi_manager; o ID do timer é a geração do aluguel */
+	wifi_manager_send_message(WM_EVENT_STA_LEASE_EXPIRED, pvTimerGetTimerID(xTimer));
+}
+
 void wifi_manager_scan_async(){
 	wifi_manager_send_message(WM_ORDER_START_WIFI_SCAN, NULL);
 }
@@ -173,33 +440,298 @@ void wifi_manager_disconnect_async(){
 }
 
 
+/**
+ * @brief Funde uma mensagem com a de mesmo código que ainda está na fila.
+ * Uma varredura pendente basta; uma conexão pedida pelo usuário nunca é trocada por uma automática;
+ * de uma sequência de desconexões, só o código de razão da última importa; de avisos de expiração, só a geração do último.
+ */
+static void wifi_manager_merge_message(uint8_t code, void *queued, const void *incoming){
+
+	queue_message *queued_msg = (queue_message*)queued;
+	const queue_message *incoming_msg = (const queue_message*)incoming;
+
+	switch(code){
+	case WM_ORDER_CONNECT_STA:
+		if((BaseType_t)queued_msg->param != CONNECTION_REQUEST_USER){
+			queued_msg->param = incoming_msg->param;
+		}
+		break;
+	case WM_EVENT_STA_DISCONNECTED:
+		queued_msg->event = incoming_msg->event;
+		break;
+	case WM_EVENT_STA_LEASE_EXPIRED:
+		queued_msg->param = incoming_msg->param;
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * @brief Início e fim de uma escrita no retrato do estado. O spinlock serializa os escritores (loop de eventos e tarefa wifi_manager).
+ */
+static void wifi_manager_status_write_begin(){
+	portENTER_CRITICAL(&wifi_manager_status_mux);
+	wifi_manager_status_seq++;
+	__sync_synchronize();
+}
+
+static void wifi_manager_status_write_end(){
+	__sync_synchronize();
+	wifi_manager_status_seq++;
+	portEXIT_CRITICAL(&wifi_manager_status_mux);
+}
+
+/**
+ * @brief Atualiza o retrato do estado com os dados do AP ao qual a STA está conectada.
+ */
+static void wifi_manager_status_update_ap_info(){
+	wifi_ap_record_t ap;
+	if(esp_wifi_sta_get_ap_info(&ap) == ESP_OK){
+		wifi_manager_status_write_begin();
+		memcpy(wifi_manager_status.ssid, ap.ssid, MAX_SSID_SIZE);
+		wifi_manager_status.ssid[MAX_SSID_SIZE] = '\0';
+		memcpy(wifi_manager_status.bssid, ap.bssid, sizeof(wifi_manager_status.bssid));
+		wifi_manager_status.channel = ap.primary;
+		wifi_manager_status.rssi = ap.rssi;
+		wifi_manager_status_write_end();
+	}
+}
+
+void wifi_manager_get_status(struct wifi_manager_status_t *status){
+
+	uint32_t seq;
+	int64_t connected_at;
+
+	do{
+		while( (seq = wifi_manager_status_seq) & 1 ){
+			/* um escritor na outra CPU: a escrita leva poucos ciclos */
+		}
+		__sync_synchronize();
+		memcpy(status, (const void*)&wifi_manager_status, sizeof(struct wifi_manager_status_t));
+		connected_at = wifi_manager_status_connected_at;
+		__sync_synchronize();
+	} while(seq != wifi_manager_status_seq);
+
+	status->uptime_us = esp_timer_get_time();
+	status->connected_us = status->connected ? status->uptime_us - connected_at : 0;
+}
+
+uint32_t wifi_manager_wait_for(uint32_t state_mask, TickType_t timeout){
+	/* xEventGroupWaitBits não aceita uma máscara vazia nem um grupo que ainda não existe */
+	state_mask &= WIFI_MANAGER_STATE_ALL;
+	if(state_mask == 0 || wifi_manager_event_group == NULL) return 0;
+	return xEventGroupWaitBits(wifi_manager_event_group, state_mask, pdFALSE, pdFALSE, timeout) & WIFI_MANAGER_STATE_ALL;
+}
+
+static int wifi_manager_boot_begin(const char *name, uint8_t track){
+	int idx;
+	portENTER_CRITICAL(&wifi_manager_boot_profile_mux);
+	idx = boot_profile_begin(&wifi_manager_boot_profile, name, track, esp_timer_get_time());
+	portEXIT_CRITICAL(&wifi_manager_boot_profile_mux);
+	return idx;
+}
+
+static void wifi_manager_boot_end(int idx){
+	portENTER_CRITICAL(&wifi_manager_boot_profile_mux);
+	boot_profile_end(&wifi_manager_boot_profile, idx, esp_timer_get_time());
+	portEXIT_CRITICAL(&wifi_manager_boot_profile_mux);
+}
+
+void wifi_manager_get_default_topology(struct wifi_manager_topology_t *topology){
+
+	static const uint32_t stacks[WIFI_MANAGER_TASK_COUNT] = {
+		WIFI_MANAGER_TASK_STACK, WIFI_MANAGER_DNS_TASK_STACK, WIFI_MANAGER_HTTPD_TASK_STACK,
+		WIFI_MANAGER_SUBSCRIBER_TASK_STACK, WIFI_MANAGER_NVS_WRITER_TASK_STACK, WIFI_MANAGER_ASYNC_LOG_TASK_STACK
+	};
+	const UBaseType_t priorities[WIFI_MANAGER_TASK_COUNT] = {
+		WIFI_MANAGER_TASK_PRIORITY, WIFI_MANAGER_TASK_PRIORITY-1, tskIDLE_PRIORITY+5,
+		WIFI_MANAGER_TASK_PRIORITY-1, tskIDLE_PRIORITY+1, tskIDLE_PRIORITY+1
+	};
+
+	memset(topology, 0x00, sizeof(struct wifi_manager_topology_t));
+	for(int i=0; i<WIFI_MANAGER_TASK_COUNT; i++){
+		topology->tasks[i].stack_size = stacks[i];
+		topology->tasks[i].priority = priorities[i];
+		topology->tasks[i].core_id = WIFI_MANAGER_TASK_CORE < 0 ? tskNO_AFFINITY : WIFI_MANAGER_TASK_CORE;
+	}
+
+#if WIFI_MANAGER_TASK_STATIC
+	topology->tasks[WIFI_MANAGER_TASK_MANAGER].stack_buffer = wifi_manager_task_stack;
+	topology->tasks[WIFI_MANAGER_TASK_MANAGER].tcb_buffer = &wifi_manager_task_tcb;
+	topology->tasks[WIFI_MANAGER_TASK_DNS].stack_buffer = wifi_manager_dns_task_stack;
+	topology->tasks[WIFI_MANAGER_TASK_DNS].tcb_buffer = &wifi_manager_dns_task_tcb;
+	topology->tasks[WIFI_MANAGER_TASK_NVS_WRITER].stack_buffer = wifi_manager_nvs_writer_task_stack;
+	topology->tasks[WIFI_MANAGER_TASK_NVS_WRITER].tcb_buffer = &wifi_manager_nvs_writer_task_tcb;
+	topology->tasks[WIFI_MANAGER_TASK_ASYNC_LOG].stack_buffer = wifi_manager_async_log_task_stack;
+	topology->tasks[WIFI_MANAGER_TASK_ASYNC_LOG].tcb_buffer = &wifi_manager_async_log_task_tcb;
+#endif
+}
+
+const struct task_config_t* wifi_manager_get_task_config(wifi_manager_task_t task){
+
+	if(!wifi_manager_topology_set){
+		wifi_manager_get_default_topology(&wifi_manager_topology);
+		wifi_manager_topology_set = true;
+	}
+
+	return &wifi_manager_topology.tasks[task < WIFI_MANAGER_TASK_COUNT ? task : WIFI_MANAGER_TASK_MANAGER];
+}
+
+void wifi_manager_get_task_stats(struct wifi_manager_task_stats_t stats[WIFI_MANAGER_TASK_COUNT]){
+
+	static const char* const names[WIFI_MANAGER_TASK_COUNT] = { "wifi_manager", "dns_server", "httpd", "wm_subscriber", "nvs_writer", "async_log" };
+	const TaskHandle_t handles[WIFI_MANAGER_TASK_COUNT] = {
+		task_wifi_manager, dns_server_get_task(), http_app_get_task(), NULL, nvs_writer_get_task(), async_log_get_task()
+	};
+
+	for(int i=0; i<WIFI_MANAGER_TASK_COUNT; i++){
+		const struct task_config_t *config = wifi_manager_get_task_config((wifi_manager_task_t)i);
+		stats[i].name = names[i];
+		stats[i].running = handles[i] != NULL;
+		stats[i].static_alloc = config->stack_buffer != NULL && config->tcb_buffer != NULL;
+		stats[i].core_id = config->core_id;
+		stats[i].priority = config->priority;
+		stats[i].stack_size = config->stack_size;
+		stats[i].stack_free_min = handles[i] ? (uint32_t)uxTaskGetStackHighWaterMark(handles[i]) : 0;
+	}
+}
+
+/**
+ * @brief Fonte da linha do tempo (task_trace): a retirada de cada mensagem da fila vem do trace de mensagens,
+ * que já a grava, em vez de um segundo evento.
+ */
+static bool wifi_manager_trace_timeline(uint32_t *seq, struct trace_event_t *event, uint64_t *ts_us, void *arg){
+
+	const struct msg_trace_record_t *record;
+	bool found = false;
+
+	xSemaphoreTake(wifi_manager_trace_mutex, portMAX_DELAY);
+	if(*seq < wifi_manager_trace.ring.lost) *seq = wifi_manager_trace.ring.lost;
+	record = msg_trace_get_seq(&wifi_manager_trace, *seq);
+	if(record){
+		event->name = "dequeue";
+		event->phase = TRACE_PHASE_INSTANT;
+		event->arg = (int16_t)record->pending;
+		*ts_us = (uint64_t)record->time_ms * 1000;
+		found = true;
+	}
+	xSemaphoreGive(wifi_manager_trace_mutex);
+
+	return found;
+}
+
 void wifi_manager_start(){
+	wifi_manager_start_with_topology(NULL);
+}
+
+void wifi_manager_start_with_topology(const struct wifi_manager_topology_t *topology){
+
+	int phase_start = wifi_manager_boot_begin("wifi_manager_start", WIFI_MANAGER_BOOT_TRACK_START);
+	int phase;
 
 	/* desative o registro de wi-fi padrão */
 	esp_log_level_set("wifi", ESP_LOG_NONE);
 
+	/* topologia das tarefas: as pilhas estáticas do componente não podem ser usadas com um tamanho maior que o reservado */
+	if(topology){
+		memcpy(&wifi_manager_topology, topology, sizeof(struct wifi_manager_topology_t));
+	}
+	else{
+		wifi_manager_get_default_topology(&wifi_manager_topology);
+	}
+	wifi_manager_topology_set = true;
+	for(int i=0; i<WIFI_MANAGER_TASK_COUNT; i++){
+		/* um núcleo que não existe (1 num chip de um núcleo só) faria a criação da tarefa falhar */
+		struct task_config_t *config = &wifi_manager_topology.tasks[i];
+		if(config->core_id != tskNO_AFFINITY && (config->core_id < 0 || config->core_id >= portNUM_PROCESSORS)){
+			ESP_LOGW(TAG, "task %d: core %d does not exist, running on any core", i, (int)config->core_id);
+			config->core_id = tskNO_AFFINITY;
+		}
+	}
+#if WIFI_MANAGER_TASK_STATIC
+	{
+		struct wifi_manager_topology_t defaults;
+		wifi_manager_get_default_topology(&defaults);
+		for(int i=0; i<WIFI_MANAGER_TASK_COUNT; i++){
+			struct task_config_t *config = &wifi_manager_topology.tasks[i];
+			if(config->stack_buffer && config->stack_buffer == defaults.tasks[i].stack_buffer && config->stack_size > defaults.tasks[i].stack_size){
+				ESP_LOGW(TAG, "task %d: stack of %d bytes does not fit the static stack, using %d", i, (int)config->stack_size, (int)defaults.tasks[i].stack_size);
+				config->stack_size = defaults.tasks[i].stack_size;
+			}
+		}
+	}
+#endif
+
+	/* log assíncrono e linha do tempo antes de qualquer tarefa que os use */
+#if WIFI_MANAGER_STATIC_ALLOC && WIFI_MANAGER_ASYNC_LOG
+	ESP_ERROR_CHECK(async_log_start(WIFI_MANAGER_ASYNC_LOG_DEPTH, wifi_manager_async_log_cells, WIFI_MANAGER_ASYNC_LOG_UART, wifi_manager_get_task_config(WIFI_MANAGER_TASK_ASYNC_LOG)));
+#else
+	if(WIFI_MANAGER_ASYNC_LOG){
+		ESP_ERROR_CHECK(async_log_start(WIFI_MANAGER_ASYNC_LOG_DEPTH, NULL, WIFI_MANAGER_ASYNC_LOG_UART, wifi_manager_get_task_config(WIFI_MANAGER_TASK_ASYNC_LOG)));
+	}
+#endif
+#if WIFI_MANAGER_STATIC_ALLOC && WIFI_MANAGER_TASK_TRACE
+	ESP_ERROR_CHECK(task_trace_start(WIFI_MANAGER_TASK_TRACE_DEPTH, wifi_manager_task_trace_events));
+#else
+	if(WIFI_MANAGER_TASK_TRACE){
+		ESP_ERROR_CHECK(task_trace_start(WIFI_MANAGER_TASK_TRACE_DEPTH, NULL));
+	}
+#endif
+
 	/* inicializar memória flash */
+	phase = wifi_manager_boot_begin("nvs_flash_init", WIFI_MANAGER_BOOT_TRACK_START);
 	nvs_flash_init();
+	wifi_manager_boot_end(phase);
+	phase = wifi_manager_boot_begin("storage", WIFI_MANAGER_BOOT_TRACK_START);
 	ESP_ERROR_CHECK(nvs_sync_create()); /* semáforo para sincronização de thread na memória NVS */
+	if(WIFI_MANAGER_STORAGE_RAM){
+		/* nenhuma gravação no flash: a configuração se perde no reset */
+		ESP_ERROR_CHECK(storage_ram_create(&wifi_manager_storage) == STORAGE_OK ? ESP_OK : ESP_ERR_NO_MEM);
+	}
+	else{
+		ESP_ERROR_CHECK(storage_nvs_create(&wifi_manager_storage, wifi_manager_nvs_namespace) == STORAGE_OK ? ESP_OK : ESP_ERR_INVALID_ARG);
+	}
+	ESP_ERROR_CHECK(nvs_writer_start(&wifi_manager_storage, WIFI_MANAGER_PERSIST_DEBOUNCE, wifi_manager_get_task_config(WIFI_MANAGER_TASK_NVS_WRITER))); /* gravação adiada */
+	wifi_manager_boot_end(phase);
 
 	/* alocação de memória */
-	wifi_manager_queue = xQueueCreate( 3, sizeof( queue_message) );
+	phase = wifi_manager_boot_begin("alloc", WIFI_MANAGER_BOOT_TRACK_START);
+#if WIFI_MANAGER_STATIC_ALLOC
+	/* a mesma inicialização, sobre a memória reservada no link */
+	message_ring_init_static(&wifi_manager_queue, WIFI_MANAGER_QUEUE_DEPTH, sizeof(queue_message), wifi_manager_queue_items, wifi_manager_queue_codes, WIFI_MANAGER_COALESCE_MASK, wifi_manager_merge_message);
+	wifi_manager_queue_sem = xSemaphoreCreateCountingStatic(WIFI_MANAGER_QUEUE_DEPTH, 0, &wifi_manager_queue_sem_buffer);
+	wifi_manager_json_mutex = xSemaphoreCreateMutexStatic(&wifi_manager_json_mutex_buffer);
+	wifi_manager_scratch_mutex = xSemaphoreCreateMutexStatic(&wifi_manager_scratch_mutex_buffer);
+#if WIFI_MANAGER_TRACE
+	msg_trace_init_static(&wifi_manager_trace, wifi_manager_trace_records, WIFI_MANAGER_TRACE_DEPTH);
+	wifi_manager_trace_mutex = xSemaphoreCreateMutexStatic(&wifi_manager_trace_mutex_buffer);
+#endif
+	accessp_records = wifi_manager_accessp_records_buffer;
+	accessp_json = wifi_manager_accessp_json_buffer;
+	ip_info_json = wifi_manager_ip_info_json_buffer;
+	wifi_manager_config_sta = &wifi_manager_config_sta_buffer;
+	wifi_manager_sta_ip_mutex = xSemaphoreCreateMutexStatic(&wifi_manager_sta_ip_mutex_buffer);
+	wifi_manager_sta_ip = wifi_manager_sta_ip_buffer;
+	wifi_manager_event_group = xEventGroupCreateStatic(&wifi_manager_event_group_buffer);
+	wifi_manager_retry_timer = xTimerCreateStatic( NULL, pdMS_TO_TICKS(WIFI_MANAGER_RETRY_TIMER), pdFALSE, ( void * ) 0, wifi_manager_timer_retry_cb, &wifi_manager_retry_timer_buffer);
+	wifi_manager_shutdown_ap_timer = xTimerCreateStatic( NULL, pdMS_TO_TICKS(WIFI_MANAGER_SHUTDOWN_AP_TIMER), pdFALSE, ( void * ) 0, wifi_manager_timer_shutdown_ap_cb, &wifi_manager_shutdown_ap_timer_buffer);
+	if(WIFI_MANAGER_LEASE_REUSE){
+		wifi_manager_lease_timer = xTimerCreateStatic( NULL, pdMS_TO_TICKS(1000), pdFALSE, ( void * ) 0, wifi_manager_timer_lease_cb, &wifi_manager_lease_timer_buffer);
+	}
+#else
+	message_ring_init(&wifi_manager_queue, WIFI_MANAGER_QUEUE_DEPTH, sizeof(queue_message), WIFI_MANAGER_COALESCE_MASK, wifi_manager_merge_message);
+	wifi_manager_queue_sem = xSemaphoreCreateCounting(WIFI_MANAGER_QUEUE_DEPTH, 0);
 	wifi_manager_json_mutex = xSemaphoreCreateMutex();
+	if(WIFI_MANAGER_TRACE && msg_trace_init(&wifi_manager_trace, WIFI_MANAGER_TRACE_DEPTH)){
+		wifi_manager_trace_mutex = xSemaphoreCreateMutex();
+	}
 	accessp_records = (wifi_ap_record_t*)malloc(sizeof(wifi_ap_record_t) * MAX_AP_NUM);
 	accessp_json = (char*)malloc(MAX_AP_NUM * JSON_ONE_APP_SIZE + 4); /* 4 bytes para encapsulamento json de "[\n" and "]\0" */
-	wifi_manager_clear_access_points_json();
 	ip_info_json = (char*)malloc(sizeof(char) * JSON_IP_INFO_SIZE);
-	wifi_manager_clear_ip_info_json();
 	wifi_manager_config_sta = (wifi_config_t*)malloc(sizeof(wifi_config_t));
-	memset(wifi_manager_config_sta, 0x00, sizeof(wifi_config_t));
-	memset(&wifi_settings.sta_static_ip_config, 0x00, sizeof(esp_netif_ip_info_t));
-	cb_ptr_arr = malloc(sizeof(void (*)(void*)) * WM_MESSAGE_CODE_COUNT);
-	for(int i=0; i<WM_MESSAGE_CODE_COUNT; i++){
-		cb_ptr_arr[i] = NULL;
-	}
 	wifi_manager_sta_ip_mutex = xSemaphoreCreateMutex();
 	wifi_manager_sta_ip = (char*)malloc(sizeof(char) * IP4ADDR_STRLEN_MAX);
-	wifi_manager_safe_update_sta_ip_string((uint32_t)0);
 	wifi_manager_event_group = xEventGroupCreate();
 
 	/* crie um cronômetro para manter o controle de novas tentativas */
@@ -208,197 +740,723 @@ void wifi_manager_start(){
 	/* crie um cronômetro para acompanhar o desligamento do AP */
 	wifi_manager_shutdown_ap_timer = xTimerCreate( NULL, pdMS_TO_TICKS(WIFI_MANAGER_SHUTDOWN_AP_TIMER), pdFALSE, ( void * ) 0, wifi_manager_timer_shutdown_ap_cb);
 
+	/* crie um cronômetro para acompanhar a expiração de um aluguel DHCP reutilizado */
+	if(WIFI_MANAGER_LEASE_REUSE){
+		wifi_manager_lease_timer = xTimerCreate( NULL, pdMS_TO_TICKS(1000), pdFALSE, ( void * ) 0, wifi_manager_timer_lease_cb);
+	}
+#endif
+	wifi_manager_clear_access_points_json();
+	wifi_manager_clear_ip_info_json();
+	memset(wifi_manager_config_sta, 0x00, sizeof(wifi_config_t));
+	memset(&wifi_settings.sta_static_ip_config, 0x00, sizeof(esp_netif_ip_info_t));
+	ESP_ERROR_CHECK(event_bus_create()); /* assinantes das mensagens */
+	wifi_manager_safe_update_sta_ip_string((uint32_t)0);
+	xEventGroupSetBits(wifi_manager_event_group, WIFI_MANAGER_STA_DISCONNECT_BIT);
+	wifi_manager_boot_end(phase);
+
 	/* iniciar tarefa de gerenciamento de wi-fi */
-	xTaskCreate(&wifi_manager, "wifi_manager", 4096, NULL, WIFI_MANAGER_TASK_PRIORITY, &task_wifi_manager);
+	phase = wifi_manager_boot_begin("xTaskCreate", WIFI_MANAGER_BOOT_TRACK_START);
+	task_config_create(wifi_manager_get_task_config(WIFI_MANAGER_TASK_MANAGER), &wifi_manager, "wifi_manager", NULL, &task_wifi_manager);
+	if(WIFI_MANAGER_TASK_TRACE && wifi_manager_trace_mutex){
+		task_trace_set_source(task_wifi_manager, wifi_manager_trace_timeline, NULL);
+	}
+	wifi_manager_boot_end(phase);
+
+	wifi_manager_boot_end(phase_start);
+}
+
+/**
+ * @brief Aplica o bloco da memória RTC: rede em uso, configurações, BSSID/canal e aluguel DHCP, sem leitura do NVS.
+ */
+static void wifi_manager_apply_rtc_resume(const struct rtc_resume_t *block){
+
+	memset(wifi_manager_config_sta, 0x00, sizeof(wifi_config_t));
+	memcpy(wifi_manager_config_sta->sta.ssid, block->sta_ssid, sizeof(block->sta_ssid));
+	memcpy(wifi_manager_config_sta->sta.password, block->sta_password, sizeof(block->sta_password));
+	memcpy(&wifi_settings, &block->settings, sizeof(wifi_settings));
+	memcpy(&wifi_manager_sta_cache, &block->cache, sizeof(wifi_manager_sta_cache));
+	memcpy(&wifi_manager_sta_lease, &block->lease, sizeof(wifi_manager_sta_lease));
+	wifi_manager_fsm.retry_attempt = block->retry_attempt;
+	wifi_manager_fsm.retries = block->retries;
+
+	ESP_LOGI(TAG, "Fast resume from RTC memory: ssid:%s channel:%d retry:%u", wifi_manager_config_sta->sta.ssid, wifi_manager_sta_cache.channel, (unsigned)block->retry_attempt);
+}
+
+/**
+ * @brief Guarda na memória RTC o que é preciso para reconectar no próximo despertar do deep sleep.
+ */
+static void wifi_manager_store_rtc_resume(){
+
+	if(!WIFI_MANAGER_FAST_RESUME || wifi_manager_config_sta == NULL) return;
+
+	struct rtc_resume_t block;
+	memset(&block, 0x00, sizeof(block));
+	memcpy(block.sta_ssid, wifi_manager_config_sta->sta.ssid, sizeof(block.sta_ssid));
+	memcpy(block.sta_password, wifi_manager_config_sta->sta.password, sizeof(block.sta_password));
+	memcpy(&block.settings, &wifi_settings, sizeof(block.settings));
+	memcpy(&block.cache, &wifi_manager_sta_cache, sizeof(block.cache));
+	memcpy(&block.lease, &wifi_manager_sta_lease, sizeof(block.lease));
+	block.retry_attempt = wifi_manager_fsm.retry_attempt;
+	block.retries = wifi_manager_fsm.retries;
+	rtc_resume_store(&block);
+}
+
+/**
+ * @brief Depois de uma retomada rápida, lê do NVS o que a memória RTC não guarda (as redes salvas).
+ * A rede em uso é mantida: o usuário pode tê-la trocado nesse meio tempo.
+ */
+static void wifi_manager_finish_fast_resume(){
+
+	if(!wifi_manager_resume_pending) return;
+	wifi_manager_resume_pending = false;
+
+	wifi_config_t current;
+	memcpy(&current, wifi_manager_config_sta, sizeof(wifi_config_t));
+	wifi_manager_fetch_wifi_sta_config();
+	memcpy(wifi_manager_config_sta, &current, sizeof(wifi_config_t));
+}
+
+/**
+ * @brief Memória de trabalho de sz bytes, liberada com wifi_manager_scratch_free.
+ * Com WIFI_MANAGER_STATIC_ALLOC vem de wifi_manager_scratch: quem chama em seguida espera a liberação.
+ */
+static void* wifi_manager_scratch_alloc(size_t sz){
+#if WIFI_MANAGER_STATIC_ALLOC
+	if(sz > sizeof(wifi_manager_scratch) || wifi_manager_scratch_mutex == NULL) return NULL;
+	xSemaphoreTake(wifi_manager_scratch_mutex, portMAX_DELAY);
+	return &wifi_manager_scratch;
+#else
+	return malloc(sz);
+#endif
+}
+
+static void wifi_manager_scratch_free(void *ptr){
+#if WIFI_MANAGER_STATIC_ALLOC
+	if(ptr) xSemaphoreGive(wifi_manager_scratch_mutex);
+#else
+	free(ptr);
+#endif
+}
+
+/**
+ * @brief Copia a configuração em uso para o registro gravado no flash. As redes salvas são compactadas.
+ */
+static void wifi_manager_config_to_record(struct config_record_t *record){
+
+	memset(record, 0x00, sizeof(struct config_record_t));
+
+	memcpy(record->sta_ssid, wifi_manager_config_sta->sta.ssid, CONFIG_RECORD_SSID_SIZE);
+	memcpy(record->sta_password, wifi_manager_config_sta->sta.password, CONFIG_RECORD_PASSWORD_SIZE);
+	memcpy(record->ap_ssid, wifi_settings.ap_ssid, CONFIG_RECORD_SSID_SIZE);
+	memcpy(record->ap_pwd, wifi_settings.ap_pwd, CONFIG_RECORD_PASSWORD_SIZE);
+	record->ap_channel = wifi_settings.ap_channel;
+	record->ap_ssid_hidden = wifi_settings.ap_ssid_hidden;
+	record->ap_bandwidth = (uint8_t)wifi_settings.ap_bandwidth;
+	record->sta_only = wifi_settings.sta_only;
+	record->sta_power_save = (uint8_t)wifi_settings.sta_power_save;
+	record->sta_static_ip = wifi_settings.sta_static_ip;
+	record->sta_ip = wifi_settings.sta_static_ip_config.ip.addr;
+	record->sta_netmask = wifi_settings.sta_static_ip_config.netmask.addr;
+	record->sta_gw = wifi_settings.sta_static_ip_config.gw.addr;
+
+	for(int i=0; i<WIFI_MANAGER_MAX_SAVED_NETWORKS && record->profile_count < CONFIG_RECORD_MAX_PROFILES; i++){
+		const struct wifi_sta_profile_t *profile = &wifi_manager_sta_profiles[i];
+		if(profile->ssid[0] == '\0') continue;
+
+		struct config_record_profile_t *p = &record->profiles[record->profile_count++];
+		memcpy(p->ssid, profile->ssid, CONFIG_RECORD_SSID_SIZE);
+		memcpy(p->password, profile->password, CONFIG_RECORD_PASSWORD_SIZE);
+		p->last_success = profile->last_success;
+		p->failures = profile->failures;
+		p->avg_latency_ms = profile->avg_latency_ms;
+	}
+}
+
+/**
+ * @brief Aplica um registro lido do flash à configuração em uso.
+ */
+static void wifi_manager_config_from_record(const struct config_record_t *record){
+
+	memset(wifi_manager_config_sta, 0x00, sizeof(wifi_config_t));
+	memcpy(wifi_manager_config_sta->sta.ssid, record->sta_ssid, CONFIG_RECORD_SSID_SIZE);
+	memcpy(wifi_manager_config_sta->sta.password, record->sta_password, CONFIG_RECORD_PASSWORD_SIZE);
+
+	memcpy(wifi_settings.ap_ssid, record->ap_ssid, CONFIG_RECORD_SSID_SIZE);
+	memcpy(wifi_settings.ap_pwd, record->ap_pwd, CONFIG_RECORD_PASSWORD_SIZE);
+	wifi_settings.ap_channel = record->ap_channel;
+	wifi_settings.ap_ssid_hidden = record->ap_ssid_hidden;
+	wifi_settings.ap_bandwidth = (wifi_bandwidth_t)record->ap_bandwidth;
+	wifi_settings.sta_only = record->sta_only;
+	wifi_settings.sta_power_save = (wifi_ps_type_t)record->sta_power_save;
+	wifi_settings.sta_static_ip = record->sta_static_ip;
+	wifi_settings.sta_static_ip_config.ip.addr = record->sta_ip;
+	wifi_settings.sta_static_ip_config.netmask.addr = record->sta_netmask;
+	wifi_settings.sta_static_ip_config.gw.addr = record->sta_gw;
+
+	memset(wifi_manager_sta_profiles, 0x00, sizeof(wifi_manager_sta_profiles));
+	for(int i=0; i<record->profile_count && i<WIFI_MANAGER_MAX_SAVED_NETWORKS; i++){
+		const struct config_record_profile_t *p = &record->profiles[i];
+		memcpy(wifi_manager_sta_profiles[i].ssid, p->ssid, CONFIG_RECORD_SSID_SIZE);
+		memcpy(wifi_manager_sta_profiles[i].password, p->password, CONFIG_RECORD_PASSWORD_SIZE);
+		wifi_manager_sta_profiles[i].last_success = p->last_success;
+		wifi_manager_sta_profiles[i].failures = p->failures;
+		wifi_manager_sta_profiles[i].avg_latency_ms = p->avg_latency_ms;
+	}
 }
 
 esp_err_t wifi_manager_save_sta_config(){
 
 	nvs_handle handle;
-	esp_err_t esp_err;
+	esp_err_t esp_err = ESP_OK;
+	struct wifi_manager_record_work_t *work;
+	struct config_record_t *record;
+	uint8_t *buff;
 	size_t sz;
+	int64_t start = esp_timer_get_time();
 
-	/* variáveis ​​usadas para verificar se a gravação é realmente necessária */
-	wifi_config_t tmp_conf;
-	struct wifi_settings_t tmp_settings;
-	memset(&tmp_conf, 0x00, sizeof(tmp_conf));
-	memset(&tmp_settings, 0x00, sizeof(tmp_settings));
-	bool change = false;
+	if(wifi_manager_config_sta == NULL) return ESP_OK;
 
 	ESP_LOGI(TAG, "About to save config to flash!!");
 
-	if(wifi_manager_config_sta && nvs_sync_lock( portMAX_DELAY )){
+	work = (struct wifi_manager_record_work_t*)wifi_manager_scratch_alloc(sizeof(struct wifi_manager_record_work_t));
+	if(work == NULL){
+		return ESP_ERR_NO_MEM;
+	}
+	record = &work->record;
+	buff = work->buff;
 
-		esp_err = nvs_open(wifi_manager_nvs_namespace, NVS_READWRITE, &handle);
-		if (esp_err != ESP_OK){
-			nvs_sync_unlock();
-			return esp_err;
+	wifi_manager_config_to_record(record);
+	sz = config_record_encode(record, buff, CONFIG_RECORD_MAX_SIZE);
+
+	/* o CRC do registro gravado é mantido em RAM: detectar que nada mudou não custa nenhuma leitura do flash */
+	if(!wifi_manager_config_legacy && sz == wifi_manager_config_record_size && config_record_crc(buff, sz) == wifi_manager_config_record_crc){
+		ESP_LOGI(TAG, "Wifi config was not saved to flash because no change has been detected.");
+		wifi_manager_sta_profiles_dirty = false;
+		wifi_manager_nvs_stats.skipped_saves++;
+	}
+	else if(!wifi_manager_config_legacy){
+		/* gravação adiada: o commit acontece na tarefa nvs_writer e nunca bloqueia o wifi_manager no flash */
+		esp_err = nvs_writer_set_blob(wifi_manager_config_key, buff, sz);
+		if(esp_err == ESP_OK){
+			wifi_manager_config_record_size = sz;
+			wifi_manager_config_record_crc = config_record_crc(buff, sz);
+			wifi_manager_sta_profiles_dirty = false;
+			wifi_manager_nvs_stats.saves++;
+			wifi_manager_nvs_stats.last_save_bytes = sz;
+			wifi_manager_nvs_stats.last_save_us = esp_timer_get_time() - start;
+			ESP_LOGI(TAG, "wifi_manager queued config: ssid:%s, %d saved networks, %d bytes", wifi_manager_config_sta->sta.ssid, record->profile_count, (int)sz);
+		}
+		else{
+			ESP_LOGE(TAG, "wifi_manager_save_sta_config failed with error %d", esp_err);
 		}
+	}
+	else if(nvs_sync_lock( portMAX_DELAY )){
+
+		/* migração do formato anterior (uma única vez): gravação direta para apagar as chaves antigas no mesmo commit */
+		esp_err = nvs_open(wifi_manager_nvs_namespace, NVS_READWRITE, &handle);
+		if(esp_err == ESP_OK){
+			esp_err = nvs_set_blob(handle, wifi_manager_config_key, buff, sz);
+
+			if(esp_err == ESP_OK){
+				for(size_t i=0; i<sizeof(wifi_manager_legacy_keys)/sizeof(wifi_manager_legacy_keys[0]); i++){
+					nvs_erase_key(handle, wifi_manager_legacy_keys[i]);
+				}
+			}
 
-		sz = sizeof(tmp_conf.sta.ssid);
-		esp_err = nvs_get_blob(handle, "ssid", tmp_conf.sta.ssid, &sz);
-		if( (esp_err == ESP_OK  || esp_err == ESP_ERR_NVS_NOT_FOUND) && strcmp( (char*)tmp_conf.sta.ssid, (char*)wifi_manager_config_sta->sta.ssid) != 0){
-			/* SSID ou SSID diferente não existe no flash: salvar novo SSID */
-			esp_err = nvs_set_blob(handle, "ssid", wifi_manager_config_sta->sta.ssid, 32);
-			if (esp_err != ESP_OK){
-				nvs_sync_unlock();
-				return esp_err;
+			if(esp_err == ESP_OK){
+				esp_err = nvs_commit(handle);
 			}
-			change = true;
-			ESP_LOGI(TAG, "wifi_manager_wrote wifi_sta_config: ssid:%s",wifi_manager_config_sta->sta.ssid);
+			nvs_close(handle);
+		}
+		nvs_sync_unlock();
+
+		if(esp_err == ESP_OK){
+			wifi_manager_config_record_size = sz;
+			wifi_manager_config_record_crc = config_record_crc(buff, sz);
+			wifi_manager_config_legacy = false;
+			wifi_manager_sta_profiles_dirty = false;
+			wifi_manager_nvs_stats.saves++;
+			wifi_manager_nvs_stats.last_save_bytes = sz;
+			wifi_manager_nvs_stats.last_save_us = esp_timer_get_time() - start;
+			ESP_LOGI(TAG, "wifi_manager_wrote config: ssid:%s, %d saved networks, %d bytes in %d us", wifi_manager_config_sta->sta.ssid, record->profile_count, (int)sz, (int)wifi_manager_nvs_stats.last_save_us);
+		}
+		else{
+			ESP_LOGE(TAG, "wifi_manager_save_sta_config failed with error %d", esp_err);
+		}
+	}
+	else{
+		ESP_LOGE(TAG, "wifi_manager_save_sta_config failed to acquire nvs_sync mutex");
+	}
+
+	wifi_manager_scratch_free(work);
+
+	return esp_err;
+}
+
+/**
+ * @brief Copia uma rede salva para a configuração STA atual.
+ */
+static void wifi_manager_load_sta_profile(int idx){
+
+	if(wifi_manager_config_sta == NULL || idx < 0 || idx >= WIFI_MANAGER_MAX_SAVED_NETWORKS) return;
+
+	memset(wifi_manager_config_sta, 0x00, sizeof(wifi_config_t));
+	memcpy(wifi_manager_config_sta->sta.ssid, wifi_manager_sta_profiles[idx].ssid, sizeof(wifi_manager_config_sta->sta.ssid));
+	memcpy(wifi_manager_config_sta->sta.password, wifi_manager_sta_profiles[idx].password, sizeof(wifi_manager_config_sta->sta.password));
+}
+
+/**
+ * @brief Lê a configuração no formato anterior ao registro único: blobs "ssid", "password", "settings" e "profiles".
+ * A configuração é migrada para o registro único pela próxima gravação.
+ * @return verdadeiro se uma configuração antiga foi encontrada.
+ */
+static bool wifi_manager_fetch_legacy_config(nvs_handle handle){
+
+	size_t sz;
+	struct wifi_settings_t tmp_settings;
+
+	sz = sizeof(wifi_manager_config_sta->sta.ssid);
+	if(nvs_get_blob(handle, "ssid", wifi_manager_config_sta->sta.ssid, &sz) != ESP_OK) return false;
+
+	sz = sizeof(wifi_manager_config_sta->sta.password);
+	if(nvs_get_blob(handle, "password", wifi_manager_config_sta->sta.password, &sz) != ESP_OK) return false;
 
+	/* um despejo da estrutura: só é aceito se o tamanho corresponde a esta versão */
+	sz = sizeof(tmp_settings);
+	if(nvs_get_blob(handle, "settings", &tmp_settings, &sz) != ESP_OK || sz != sizeof(tmp_settings)) return false;
+	memcpy(&wifi_settings, &tmp_settings, sizeof(wifi_settings));
+
+	/* redes salvas: na ausência da tabela, ela é criada a partir da rede atual */
+	sz = sizeof(wifi_manager_sta_profiles);
+	if(nvs_get_blob(handle, "profiles", wifi_manager_sta_profiles, &sz) != ESP_OK || sz != sizeof(wifi_manager_sta_profiles)){
+		bool changed;
+		memset(wifi_manager_sta_profiles, 0x00, sizeof(wifi_manager_sta_profiles));
+		sta_profiles_upsert(wifi_manager_sta_profiles, WIFI_MANAGER_MAX_SAVED_NETWORKS, wifi_manager_config_sta->sta.ssid, wifi_manager_config_sta->sta.password, &changed);
+	}
+
+	ESP_LOGI(TAG, "Found configuration in the legacy format. It will be migrated.");
+	wifi_manager_config_legacy = true;
+
+	return true;
+}
+
+bool wifi_manager_fetch_wifi_sta_config(){
+
+	nvs_handle handle;
+	esp_err_t esp_err;
+	bool found = false;
+	size_t sz = 0;
+	struct wifi_manager_record_work_t *work = NULL;
+	int64_t start = esp_timer_get_time();
+
+	if(wifi_manager_config_sta == NULL){
+		wifi_manager_config_sta = (wifi_config_t*)malloc(sizeof(wifi_config_t));
+	}
+	memset(wifi_manager_config_sta, 0x00, sizeof(wifi_config_t));
+
+	/* toda a configuração em uma única leitura; depois da primeira, ela vem da cópia em RAM do nvs_writer */
+	esp_err = nvs_writer_get_blob(wifi_manager_config_key, NULL, &sz);
+	if(esp_err == ESP_OK){
+		work = (struct wifi_manager_record_work_t*)wifi_manager_scratch_alloc(sizeof(struct wifi_manager_record_work_t));
+		if(work == NULL){
+			esp_err = ESP_ERR_NO_MEM;
+		}
+		else{
+			/* um registro maior que o máximo é inválido: ESP_ERR_NVS_INVALID_LENGTH */
+			sz = sizeof(work->buff);
+			esp_err = nvs_writer_get_blob(wifi_manager_config_key, work->buff, &sz);
 		}
+	}
 
-		sz = sizeof(tmp_conf.sta.password);
-		esp_err = nvs_get_blob(handle, "password", tmp_conf.sta.password, &sz);
-		if( (esp_err == ESP_OK  || esp_err == ESP_ERR_NVS_NOT_FOUND) && strcmp( (char*)tmp_conf.sta.password, (char*)wifi_manager_config_sta->sta.password) != 0){
-			/* senha diferente ou senha não existe no flash: salvar nova senha */
-			esp_err = nvs_set_blob(handle, "password", wifi_manager_config_sta->sta.password, 64);
-			if (esp_err != ESP_OK){
-				nvs_sync_unlock();
-				return esp_err;
+	if(esp_err == ESP_OK){
+		uint8_t *buff = work->buff;
+		struct config_record_t *record = &work->record;
+		config_record_err_t err = config_record_decode(buff, sz, record);
+		if(err == CONFIG_RECORD_OK){
+			wifi_manager_config_from_record(record);
+			wifi_manager_config_record_size = sz;
+			wifi_manager_config_record_crc = config_record_crc(buff, sz);
+			found = true;
+		}
+		else{
+			ESP_LOGE(TAG, "Saved configuration is invalid (error %d) and was ignored", err);
+		}
+	}
+	else if(esp_err == ESP_ERR_NVS_NOT_FOUND && !WIFI_MANAGER_STORAGE_RAM && nvs_sync_lock( portMAX_DELAY )){
+		if(nvs_open(wifi_manager_nvs_namespace, NVS_READONLY, &handle) == ESP_OK){
+			found = wifi_manager_fetch_legacy_config(handle);
+			nvs_close(handle);
+		}
+		nvs_sync_unlock();
+	}
+
+	wifi_manager_scratch_free(work);
+
+	wifi_manager_nvs_stats.last_fetch_us = esp_timer_get_time() - start;
+	ESP_LOGI(TAG, "wifi_manager_fetch_wifi_sta_config took %d us", (int)wifi_manager_nvs_stats.last_fetch_us);
+
+	if(!found){
+		memset(wifi_manager_config_sta, 0x00, sizeof(wifi_config_t));
+		return false;
+	}
+
+	/* conversão imediata para o registro único */
+	if(wifi_manager_config_legacy){
+		wifi_manager_save_sta_config();
+	}
+
+	/* a rede atual foi esquecida pelo usuário, mas ainda há outras redes salvas: comece pela mais recente */
+	if(wifi_manager_config_sta->sta.ssid[0] == '\0'){
+		int best = -1;
+		for(int i=0; i<WIFI_MANAGER_MAX_SAVED_NETWORKS; i++){
+			if(wifi_manager_sta_profiles[i].ssid[0] != '\0' && (best < 0 || wifi_manager_sta_profiles[i].last_success > wifi_manager_sta_profiles[best].last_success)){
+				best = i;
 			}
-			change = true;
-			ESP_LOGI(TAG, "wifi_manager_wrote wifi_sta_config: password:%s",wifi_manager_config_sta->sta.password);
 		}
+		if(best >= 0){
+			wifi_manager_load_sta_profile(best);
+		}
+	}
+
+
+	ESP_LOGI(TAG, "wifi_manager_fetch_wifi_sta_config: ssid:%s password:%s",wifi_manager_config_sta->sta.ssid,wifi_manager_config_sta->sta.password);
+	ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_ssid:%s",wifi_settings.ap_ssid);
+	ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_pwd:%s",wifi_settings.ap_pwd);
+	ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_channel:%i",wifi_settings.ap_channel);
+	ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_hidden (1 = yes):%i",wifi_settings.ap_ssid_hidden);
+	ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_bandwidth (1 = 20MHz, 2 = 40MHz)%i",wifi_settings.ap_bandwidth);
+	ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: sta_only (0 = APSTA, 1 = STA when connected):%i",wifi_settings.sta_only);
+	ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: sta_power_save (1 = yes):%i",wifi_settings.sta_power_save);
+	ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: sta_static_ip (0 = dhcp client, 1 = static ip):%i",wifi_settings.sta_static_ip);
+
+	return wifi_manager_config_sta->sta.ssid[0] != '\0';
+}
+
+
+esp_err_t wifi_manager_save_sta_cache(){
+
+	esp_err_t esp_err;
+	wifi_ap_record_t ap_info;
+	struct wifi_sta_cache_t cache;
+
+	if(!WIFI_MANAGER_FAST_RECONNECT || wifi_manager_config_sta == NULL) return ESP_OK;
+
+	esp_err = esp_wifi_sta_get_ap_info(&ap_info);
+	if(esp_err != ESP_OK) return esp_err;
+
+	memset(&cache, 0x00, sizeof(cache));
+	memcpy(cache.ssid, wifi_manager_config_sta->sta.ssid, sizeof(cache.ssid));
+	memcpy(cache.bssid, ap_info.bssid, sizeof(cache.bssid));
+	cache.channel = ap_info.primary;
+	cache.authmode = ap_info.authmode;
 
-		sz = sizeof(tmp_settings);
-		esp_err = nvs_get_blob(handle, "settings", &tmp_settings, &sz);
-		if( (esp_err == ESP_OK  || esp_err == ESP_ERR_NVS_NOT_FOUND) &&
-				(
-				strcmp( (char*)tmp_settings.ap_ssid, (char*)wifi_settings.ap_ssid) != 0 ||
-				strcmp( (char*)tmp_settings.ap_pwd, (char*)wifi_settings.ap_pwd) != 0 ||
-				tmp_settings.ap_ssid_hidden != wifi_settings.ap_ssid_hidden ||
-				tmp_settings.ap_bandwidth != wifi_settings.ap_bandwidth ||
-				tmp_settings.sta_only != wifi_settings.sta_only ||
-				tmp_settings.sta_power_save != wifi_settings.sta_power_save ||
-				tmp_settings.ap_channel != wifi_settings.ap_channel
-				)
-		){
-			esp_err = nvs_set_blob(handle, "settings", &wifi_settings, sizeof(wifi_settings));
-			if (esp_err != ESP_OK){
-				nvs_sync_unlock();
-				return esp_err;
+	/* evite desgastar o flash: uma reconexão ao mesmo AP não muda nada */
+	if(memcmp(&cache, &wifi_manager_sta_cache, sizeof(cache)) == 0){
+		ESP_LOGD(TAG, "STA cache was not saved to flash because no change has been detected.");
+		return ESP_OK;
+	}
+
+	esp_err = nvs_writer_set_blob("sta_cache", &cache, sizeof(cache));
+	if(esp_err == ESP_OK){
+		memcpy(&wifi_manager_sta_cache, &cache, sizeof(cache));
+		ESP_LOGI(TAG, "wifi_manager queued sta_cache: bssid:%02x:%02x:%02x:%02x:%02x:%02x channel:%d authmode:%d",
+				cache.bssid[0], cache.bssid[1], cache.bssid[2], cache.bssid[3], cache.bssid[4], cache.bssid[5],
+				cache.channel, cache.authmode);
+	}
+
+	return esp_err;
+}
+
+bool wifi_manager_fetch_sta_cache(){
+
+	esp_err_t esp_err;
+	size_t sz = sizeof(wifi_manager_sta_cache);
+
+	memset(&wifi_manager_sta_cache, 0x00, sizeof(wifi_manager_sta_cache));
+
+	if(!WIFI_MANAGER_FAST_RECONNECT) return false;
+
+	esp_err = nvs_writer_get_blob("sta_cache", &wifi_manager_sta_cache, &sz);
+	if(esp_err != ESP_OK || sz != sizeof(wifi_manager_sta_cache)){
+		memset(&wifi_manager_sta_cache, 0x00, sizeof(wifi_manager_sta_cache));
+		return false;
+	}
+
+	ESP_LOGI(TAG, "wifi_manager_fetch_sta_cache: channel:%d authmode:%d", wifi_manager_sta_cache.channel, wifi_manager_sta_cache.authmode);
+	return wifi_manager_sta_cache.channel != 0;
+}
+
+/**
+ * @brief Preenche o BSSID, o canal e o modo de autenticação em cache na configuração STA para uma conexão direta.
+ * @return verdadeiro se o cache corresponde ao SSID da configuração e foi aplicado.
+ */
+static bool wifi_manager_apply_sta_cache(wifi_config_t *config){
+
+	if(!WIFI_MANAGER_FAST_RECONNECT || config == NULL || wifi_manager_sta_cache.channel == 0) return false;
+
+	if(memcmp(config->sta.ssid, wifi_manager_sta_cache.ssid, sizeof(config->sta.ssid)) != 0) return false;
+
+	memcpy(config->sta.bssid, wifi_manager_sta_cache.bssid, sizeof(config->sta.bssid));
+	config->sta.bssid_set = true;
+	config->sta.channel = wifi_manager_sta_cache.channel;
+	config->sta.scan_method = WIFI_FAST_SCAN;
+	config->sta.threshold.authmode = wifi_manager_sta_cache.authmode;
+
+	return true;
+}
+
+/**
+ * @brief tempo atual do relógio do sistema, em segundos.
+ */
+static int64_t wifi_manager_wall_clock(){
+	return (int64_t)time(NULL);
+}
+
+/**
+ * @brief Tempo de aluguel, em segundos, concedido pelo servidor DHCP à interface STA. 0 se não é conhecido.
+ */
+static uint32_t wifi_manager_dhcp_lease_time(){
+	struct netif *netif = (struct netif*)esp_netif_get_netif_impl(esp_netif_sta);
+	struct dhcp *dhcp = netif ? netif_dhcp_data(netif) : NULL;
+	return dhcp ? dhcp->offered_t0_lease : 0;
+}
+
+/**
+ * @brief salva o aluguel DHCP atual no flash para que ele possa ser reutilizado na próxima restauração.
+ * A validade é a menor entre WIFI_MANAGER_LEASE_REUSE_MAX_AGE e o aluguel concedido pelo servidor.
+ * Para não desgastar o flash a cada reconexão, a gravação só acontece se o endereço mudou ou se metade da validade já passou.
+ */
+static esp_err_t wifi_manager_save_sta_lease(const esp_netif_ip_info_t *ip_info){
+
+	esp_err_t esp_err = ESP_OK;
+	struct wifi_sta_lease_t lease;
+	esp_netif_dns_info_t dns;
+	int64_t now = wifi_manager_wall_clock();
+	int64_t valid = WIFI_MANAGER_LEASE_REUSE_MAX_AGE;
+	uint32_t granted;
+
+	if(!WIFI_MANAGER_LEASE_REUSE || wifi_manager_config_sta == NULL) return ESP_OK;
+
+	granted = wifi_manager_dhcp_lease_time();
+	if(granted > 0 && granted < valid) valid = granted;
+
+	memset(&lease, 0x00, sizeof(lease));
+	memcpy(lease.ssid, wifi_manager_config_sta->sta.ssid, sizeof(lease.ssid));
+	memcpy(&lease.ip_info, ip_info, sizeof(lease.ip_info));
+	if(esp_netif_get_dns_info(esp_netif_sta, ESP_NETIF_DNS_MAIN, &dns) == ESP_OK){
+		lease.dns = dns.ip.u_addr.ip4;
+	}
+	lease.acquired = now;
+	lease.expiry = now + valid;
+
+	if(memcmp(lease.ssid, wifi_manager_sta_lease.ssid, sizeof(lease.ssid)) == 0 &&
+		memcmp(&lease.ip_info, &wifi_manager_sta_lease.ip_info, sizeof(lease.ip_info)) == 0 &&
+		lease.dns.addr == wifi_manager_sta_lease.dns.addr &&
+		now >= wifi_manager_sta_lease.acquired &&
+		now < wifi_manager_sta_lease.acquired + (wifi_manager_sta_lease.expiry - wifi_manager_sta_lease.acquired) / 2 ){
+		ESP_LOGD(TAG, "DHCP lease was not saved to flash because no change has been detected.");
+		return ESP_OK;
+	}
+
+	esp_err = nvs_writer_set_blob("sta_lease", &lease, sizeof(lease));
+	if(esp_err == ESP_OK){
+		memcpy(&wifi_manager_sta_lease, &lease, sizeof(lease));
+		ESP_LOGI(TAG, "wifi_manager queued sta_lease, valid for %d s (granted: %u s)", (int)valid, (unsigned)granted);
+	}
+
+	return esp_err;
+}
+
+/**
+ * @brief busca o último aluguel DHCP no flash.
+ */
+static void wifi_manager_fetch_sta_lease(){
+
+	esp_err_t esp_err;
+	size_t sz = sizeof(wifi_manager_sta_lease);
+
+	memset(&wifi_manager_sta_lease, 0x00, sizeof(wifi_manager_sta_lease));
+
+	if(!WIFI_MANAGER_LEASE_REUSE) return;
+
+	esp_err = nvs_writer_get_blob("sta_lease", &wifi_manager_sta_lease, &sz);
+	if(esp_err != ESP_OK || sz != sizeof(wifi_manager_sta_lease)){
+		memset(&wifi_manager_sta_lease, 0x00, sizeof(wifi_manager_sta_lease));
+	}
+}
+
+/**
+ * @brief Configura a interface STA antes de uma tentativa de conexão: IP estático, aluguel reutilizado ou cliente DHCP.
+ * @return a origem da configuração IP que foi aplicada.
+ */
+static sta_ip_source_code_t wifi_manager_configure_sta_ip(connection_request_made_by_code_t origin){
+
+	int64_t now = wifi_manager_wall_clock();
+	esp_netif_dhcp_status_t dhcp_status;
+
+	/* IP estático: o cliente DHCP deve ser interrompido antes de definir novas informações de IP */
+	if(wifi_settings.sta_static_ip){
+		esp_netif_dhcpc_stop(esp_netif_sta);
+		if(esp_netif_set_ip_info(esp_netif_sta, &wifi_settings.sta_static_ip_config) == ESP_OK){
+			return STA_IP_SOURCE_STATIC;
+		}
+		ESP_LOGE(TAG, "Could not apply the static IP configuration. Falling back to DHCP.");
+	}
+	else if(WIFI_MANAGER_LEASE_REUSE &&
+			origin != CONNECTION_REQUEST_USER &&
+			wifi_manager_config_sta != NULL &&
+			wifi_manager_sta_lease.ip_info.ip.addr != 0 &&
+			memcmp(wifi_manager_sta_lease.ssid, wifi_manager_config_sta->sta.ssid, sizeof(wifi_manager_sta_lease.ssid)) == 0 &&
+			now >= wifi_manager_sta_lease.acquired && now < wifi_manager_sta_lease.expiry){
+
+		/* o aluguel salvo ainda é válido: aplique-o como IP estático até que expire */
+		esp_netif_dhcpc_stop(esp_netif_sta);
+		if(esp_netif_set_ip_info(esp_netif_sta, &wifi_manager_sta_lease.ip_info) == ESP_OK){
+			if(wifi_manager_sta_lease.dns.addr != 0){
+				esp_netif_dns_info_t dns;
+				memset(&dns, 0x00, sizeof(dns));
+				dns.ip.u_addr.ip4 = wifi_manager_sta_lease.dns;
+				dns.ip.type = ESP_IPADDR_TYPE_V4;
+				esp_netif_set_dns_info(esp_netif_sta, ESP_NETIF_DNS_MAIN, &dns);
 			}
-			change = true;
-
-			ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: SoftAP_ssid: %s",wifi_settings.ap_ssid);
-			ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: SoftAP_pwd: %s",wifi_settings.ap_pwd);
-			ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: SoftAP_channel: %i",wifi_settings.ap_channel);
-			ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: SoftAP_hidden (1 = yes): %i",wifi_settings.ap_ssid_hidden);
-			ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: SoftAP_bandwidth (1 = 20MHz, 2 = 40MHz): %i",wifi_settings.ap_bandwidth);
-			ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: sta_only (0 = APSTA, 1 = STA when connected): %i",wifi_settings.sta_only);
-			ESP_LOGD(TAG, "wifi_manager_wrote wifi_settings: sta_power_save (1 = yes): %i",wifi_settings.sta_power_save);
+			ESP_LOGI(TAG, "Reusing saved DHCP lease for another %d s", (int)(wifi_manager_sta_lease.expiry - now));
+			return STA_IP_SOURCE_LEASE_REUSE;
 		}
+		ESP_LOGE(TAG, "Could not apply the saved DHCP lease. Falling back to DHCP.");
+	}
+
+	/* DHCP: garanta que o cliente está rodando, pois uma conexão anterior pode tê-lo interrompido */
+	if(esp_netif_dhcpc_get_status(esp_netif_sta, &dhcp_status) == ESP_OK && dhcp_status != ESP_NETIF_DHCP_STARTED){
+		esp_netif_dhcpc_start(esp_netif_sta);
+	}
+	return STA_IP_SOURCE_DHCP;
+}
+
+/**
+ * @brief Registra as fases da tentativa de conexão que acabou de terminar nos histogramas da sua origem.
+ * Uma tentativa que falhou é encerrada aqui; uma que obteve o IP é encerrada por wifi_manager_record_time_to_ip.
+ */
+static void wifi_manager_record_attempt_latency(bool success){
 
-		if(change){
-			esp_err = nvs_commit(handle);
-		}
-		else{
-			ESP_LOGI(TAG, "Wifi config was not saved to flash because no change has been detected.");
-		}
+	int64_t now = esp_timer_get_time();
+	int64_t start, link;
+
+	portENTER_CRITICAL(&wifi_manager_latency_mux);
+	start = wifi_manager_connect_start_us;
+	link = wifi_manager_connect_link_us;
+	if(!success){
+		wifi_manager_connect_start_us = 0;
+	}
+	portEXIT_CRITICAL(&wifi_manager_latency_mux);
 
-		if (esp_err != ESP_OK) return esp_err;
+	if(start == 0 || wifi_manager_connect_origin < CONNECTION_REQUEST_USER || wifi_manager_connect_origin > CONNECTION_REQUEST_RESTORE_CONNECTION) return;
 
-		nvs_close(handle);
-		nvs_sync_unlock();
+	struct wifi_manager_conn_latency_t *lat = &wifi_manager_conn_latency[wifi_manager_connect_origin - 1];
 
+	portENTER_CRITICAL(&wifi_manager_latency_mux);
+	if(success){
+		if(link != 0){
+			latency_hist_record(&lat->phases[WIFI_MANAGER_LATENCY_LINK], (uint32_t)((link - start) / 1000));
+			latency_hist_record(&lat->phases[WIFI_MANAGER_LATENCY_DHCP], (uint32_t)((now - link) / 1000));
+		}
+		latency_hist_record(&lat->phases[WIFI_MANAGER_LATENCY_TOTAL], (uint32_t)((now - start) / 1000));
 	}
 	else{
-		ESP_LOGE(TAG, "wifi_manager_save_sta_config failed to acquire nvs_sync mutex");
+		latency_hist_record(&lat->phases[WIFI_MANAGER_LATENCY_FAILED], (uint32_t)((now - start) / 1000));
 	}
+	portEXIT_CRITICAL(&wifi_manager_latency_mux);
+}
 
-	return ESP_OK;
+void wifi_manager_get_conn_latency(struct wifi_manager_conn_latency_t latency[WIFI_MANAGER_LATENCY_ORIGINS]){
+	portENTER_CRITICAL(&wifi_manager_latency_mux);
+	memcpy(latency, wifi_manager_conn_latency, sizeof(wifi_manager_conn_latency));
+	portEXIT_CRITICAL(&wifi_manager_latency_mux);
 }
 
-bool wifi_manager_fetch_wifi_sta_config(){
+size_t wifi_manager_get_conn_latency_json(char *buf, size_t len){
 
-	nvs_handle handle;
-	esp_err_t esp_err;
-	if(nvs_sync_lock( portMAX_DELAY )){
+	static const char* const origins[WIFI_MANAGER_LATENCY_ORIGINS] = { "user", "auto_reconnect", "restore" };
+	static const char* const phases[WIFI_MANAGER_LATENCY_PHASE_COUNT] = { "link", "dhcp", "total", "failed" };
+	struct wifi_manager_conn_latency_t *lat = (struct wifi_manager_conn_latency_t*)wifi_manager_scratch_alloc(sizeof(wifi_manager_conn_latency));
+	size_t pos = 0;
 
-		esp_err = nvs_open(wifi_manager_nvs_namespace, NVS_READONLY, &handle);
+	if(lat == NULL) return 0;
+	wifi_manager_get_conn_latency(lat);
 
-		if(esp_err != ESP_OK){
-			nvs_sync_unlock();
-			return false;
+	text_append(buf, len, &pos, "{\"unit\":\"ms\"");
+	for(int o=0; o<WIFI_MANAGER_LATENCY_ORIGINS; o++){
+		text_append(buf, len, &pos, ",\"%s\":{", origins[o]);
+		for(int p=0; p<WIFI_MANAGER_LATENCY_PHASE_COUNT; p++){
+			text_append(buf, len, &pos, "%s\"%s\":", p == 0 ? "" : ",", phases[p]);
+			pos += latency_hist_to_json(&lat[o].phases[p], text_cursor(buf, len, pos), text_room(buf, len, pos));
 		}
+		text_append(buf, len, &pos, "}");
+	}
+	text_append(buf, len, &pos, "}");
+	wifi_manager_scratch_free(lat);
 
-		if(wifi_manager_config_sta == NULL){
-			wifi_manager_config_sta = (wifi_config_t*)malloc(sizeof(wifi_config_t));
-		}
-		memset(wifi_manager_config_sta, 0x00, sizeof(wifi_config_t));
+	return text_finish(buf, len, pos);
+}
 
-		/* alocar buffer */
-		size_t sz = sizeof(wifi_settings);
-		uint8_t *buff = (uint8_t*)malloc(sizeof(uint8_t) * sz);
-		memset(buff, 0x00, sizeof(sz));
-
-		/* ssid */
-		sz = sizeof(wifi_manager_config_sta->sta.ssid);
-		esp_err = nvs_get_blob(handle, "ssid", buff, &sz);
-		if(esp_err != ESP_OK){
-			free(buff);
-			nvs_sync_unlock();
-			return false;
-		}
-		memcpy(wifi_manager_config_sta->sta.ssid, buff, sz);
-
-		/* password */
-		sz = sizeof(wifi_manager_config_sta->sta.password);
-		esp_err = nvs_get_blob(handle, "password", buff, &sz);
-		if(esp_err != ESP_OK){
-			free(buff);
-			nvs_sync_unlock();
-			return false;
-		}
-		memcpy(wifi_manager_config_sta->sta.password, buff, sz);
-
-		/* settings */
-		sz = sizeof(wifi_settings);
-		esp_err = nvs_get_blob(handle, "settings", buff, &sz);
-		if(esp_err != ESP_OK){
-			free(buff);
-			nvs_sync_unlock();
-			return false;
-		}
-		memcpy(&wifi_settings, buff, sz);
+/**
+ * @brief Atualiza as estatísticas de tempo até o IP para a tentativa de conexão que acabou de obter um endereço.
+ * @return o tempo até o IP em microssegundos, ou 0 se nenhuma tentativa estava em andamento.
+ */
+static int64_t wifi_manager_record_time_to_ip(){
 
-		free(buff);
-		nvs_close(handle);
-		nvs_sync_unlock();
+	if(wifi_manager_connect_start_us == 0) return 0;
 
+	int64_t elapsed = esp_timer_get_time() - wifi_manager_connect_start_us;
+	struct wifi_manager_time_to_ip_t *stats = &wifi_manager_time_to_ip[wifi_manager_sta_ip_source];
+	wifi_manager_connect_start_us = 0;
 
-		ESP_LOGI(TAG, "wifi_manager_fetch_wifi_sta_config: ssid:%s password:%s",wifi_manager_config_sta->sta.ssid,wifi_manager_config_sta->sta.password);
-		ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_ssid:%s",wifi_settings.ap_ssid);
-		ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_pwd:%s",wifi_settings.ap_pwd);
-		ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_channel:%i",wifi_settings.ap_channel);
-		ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_hidden (1 = yes):%i",wifi_settings.ap_ssid_hidden);
-		ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: SoftAP_bandwidth (1 = 20MHz, 2 = 40MHz)%i",wifi_settings.ap_bandwidth);
-		ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: sta_only (0 = APSTA, 1 = STA when connected):%i",wifi_settings.sta_only);
-		ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: sta_power_save (1 = yes):%i",wifi_settings.sta_power_save);
-		ESP_LOGD(TAG, "wifi_manager_fetch_wifi_settings: sta_static_ip (0 = dhcp client, 1 = static ip):%i",wifi_settings.sta_static_ip);
+	portENTER_CRITICAL(&wifi_manager_time_to_ip_mux);
+	stats->count++;
+	stats->last_us = elapsed;
+	stats->total_us += elapsed;
+	if(stats->count == 1 || elapsed < stats->min_us) stats->min_us = elapsed;
+	if(elapsed > stats->max_us) stats->max_us = elapsed;
+	portEXIT_CRITICAL(&wifi_manager_time_to_ip_mux);
 
-		return wifi_manager_config_sta->sta.ssid[0] != '\0';
+	ESP_LOGI(TAG, "Time to IP: %d ms (ip source: %d, average: %d ms over %u connections)",
+			(int)(elapsed / 1000), (int)wifi_manager_sta_ip_source, (int)((stats->total_us / stats->count) / 1000), (unsigned)stats->count);
 
+	return elapsed;
+}
 
-	}
-	else{
-		return false;
-	}
+void wifi_manager_get_time_to_ip_stats(struct wifi_manager_time_to_ip_t stats[STA_IP_SOURCE_COUNT]){
+	portENTER_CRITICAL(&wifi_manager_time_to_ip_mux);
+	memcpy(stats, wifi_manager_time_to_ip, sizeof(wifi_manager_time_to_ip));
+	portEXIT_CRITICAL(&wifi_manager_time_to_ip_mux);
+}
 
+/**
+ * @brief Remove da configuração STA as dicas de BSSID/canal para que o driver faça uma varredura completa.
+ */
+static void wifi_manager_clear_sta_cache_hint(wifi_config_t *config){
+
+	if(config == NULL) return;
+
+	memset(config->sta.bssid, 0x00, sizeof(config->sta.bssid));
+	config->sta.bssid_set = false;
+	config->sta.channel = 0;
+	config->sta.threshold.authmode = WIFI_AUTH_OPEN;
 }
 
 
 void wifi_manager_clear_ip_info_json(){
-	strcpy(ip_info_json, "{}\n");
+	if(ip_info_json) strcpy(ip_info_json, "{}\n");
 }
 
 
 void wifi_manager_generate_ip_info_json(update_reason_code_t update_reason_code){
 
 	wifi_config_t *config = wifi_manager_get_wifi_sta_config();
-	if(config){
+	if(ip_info_json == NULL){
+		/* recursos do portal liberados: o JSON é refeito quando eles voltam */
+		return;
+	}
+	else if(config){
 
 		const char *ip_info_json_format = ",\"ip\":\"%s\",\"netmask\":\"%s\",\"gw\":\"%s\",\"urc\":%d}\n";
 
@@ -448,7 +1506,7 @@ void wifi_manager_generate_ip_info_json(update_reason_code_t update_reason_code)
 
 
 void wifi_manager_clear_access_points_json(){
-	strcpy(accessp_json, "[]\n");
+	if(accessp_json) strcpy(accessp_json, "[]\n");
 }
 void wifi_manager_generate_acess_points_json(){
 
@@ -525,10 +1583,14 @@ char* wifi_manager_get_sta_ip_string(){
 
 bool wifi_manager_lock_json_buffer(TickType_t xTicksToWait){
 	if(wifi_manager_json_mutex){
+		TASK_TRACE_BEGIN("json wait", 0);
 		if( xSemaphoreTake( wifi_manager_json_mutex, xTicksToWait ) == pdTRUE ) {
+			TASK_TRACE_END("json wait", 1);
+			TASK_TRACE_BEGIN("json held", 0);
 			return true;
 		}
 		else{
+			TASK_TRACE_END("json wait", 0);
 			return false;
 		}
 	}
@@ -538,6 +1600,7 @@ bool wifi_manager_lock_json_buffer(TickType_t xTicksToWait){
 
 }
 void wifi_manager_unlock_json_buffer(){
+	TASK_TRACE_END("json held", 0);
 	xSemaphoreGive( wifi_manager_json_mutex );
 }
 
@@ -577,9 +1640,7 @@ static void wifi_manager_event_handler(void* arg, esp_event_base_t event_base, i
 		case WIFI_EVENT_SCAN_DONE:
 			ESP_LOGD(TAG, "WIFI_EVENT_SCAN_DONE");
 	    	xEventGroupClearBits(wifi_manager_event_group, WIFI_MANAGER_SCAN_BIT);
-			wifi_event_sta_scan_done_t* event_sta_scan_done = (wifi_event_sta_scan_done_t*)malloc(sizeof(wifi_event_sta_scan_done_t));
-			*event_sta_scan_done = *((wifi_event_sta_scan_done_t*)event_data);
-	    	wifi_manager_send_message(WM_EVENT_SCAN_DONE, event_sta_scan_done);
+	    	wifi_manager_send_event(WM_EVENT_SCAN_DONE, event_data, sizeof(wifi_event_sta_scan_done_t));
 			break;
 
 		/* Se esp_wifi_start () retornar ESP_OK e o modo Wi-Fi atual for Estação ou AP + Estação, então este evento irá
@@ -604,6 +1665,13 @@ static void wifi_manager_event_handler(void* arg, esp_event_base_t event_base, i
 		 * o aplicativo é baseado em LwIP, então você precisa esperar até que o evento got ip chegue. */
 		case WIFI_EVENT_STA_CONNECTED:
 			ESP_LOGI(TAG, "WIFI_EVENT_STA_CONNECTED");
+
+			/* fim da fase de enlace da tentativa em andamento */
+			portENTER_CRITICAL(&wifi_manager_latency_mux);
+			if(wifi_manager_connect_start_us != 0 && wifi_manager_connect_link_us == 0){
+				wifi_manager_connect_link_us = esp_timer_get_time();
+			}
+			portEXIT_CRITICAL(&wifi_manager_latency_mux);
 			break;
 
 		/* Este evento pode ser gerado nas seguintes situações:
@@ -653,14 +1721,19 @@ static void wifi_manager_event_handler(void* arg, esp_event_base_t event_base, i
 		case WIFI_EVENT_STA_DISCONNECTED:
 			ESP_LOGI(TAG, "WIFI_EVENT_STA_DISCONNECTED");
 
-			wifi_event_sta_disconnected_t* wifi_event_sta_disconnected = (wifi_event_sta_disconnected_t*)malloc(sizeof(wifi_event_sta_disconnected_t));
-			*wifi_event_sta_disconnected =  *( (wifi_event_sta_disconnected_t*)event_data );
+			/* retrato do estado antes dos bits: quem acorda em wifi_manager_wait_for já vê o novo estado */
+			wifi_manager_status_write_begin();
+			wifi_manager_status.connected = false;
+			wifi_manager_status.last_disconnect_reason = ((wifi_event_sta_disconnected_t*)event_data)->reason;
+			memset(&wifi_manager_status.ip_info, 0x00, sizeof(esp_netif_ip_info_t));
+			wifi_manager_status_write_end();
 
 			/* se uma mensagem DISCONNECT for postada enquanto uma varredura estiver em andamento, ela NUNCA terminará, fazendo com que a varredura nunca funcione novamente. Por este motivo, SCAN_BIT também foi apagado */
 			xEventGroupClearBits(wifi_manager_event_group, WIFI_MANAGER_WIFI_CONNECTED_BIT | WIFI_MANAGER_SCAN_BIT);
+			xEventGroupSetBits(wifi_manager_event_group, WIFI_MANAGER_STA_DISCONNECT_BIT);
 
 			/* pós evento de desconexão com código de razão */
-			wifi_manager_send_message(WM_EVENT_STA_DISCONNECTED, (void*)wifi_event_sta_disconnected );
+			wifi_manager_send_event(WM_EVENT_STA_DISCONNECTED, event_data, sizeof(wifi_event_sta_disconnected_t));
 			break;
 
 		/* Este evento surge quando o AP ao qual a estação está conectada muda seu modo de autenticação, por exemplo, sem autenticação
@@ -672,11 +1745,17 @@ static void wifi_manager_event_handler(void* arg, esp_event_base_t event_base, i
 
 		case WIFI_EVENT_AP_START:
 			ESP_LOGI(TAG, "WIFI_EVENT_AP_START");
+			wifi_manager_status_write_begin();
+			wifi_manager_status.ap_started = true;
+			wifi_manager_status_write_end();
 			xEventGroupSetBits(wifi_manager_event_group, WIFI_MANAGER_AP_STARTED_BIT);
 			break;
 
 		case WIFI_EVENT_AP_STOP:
 			ESP_LOGI(TAG, "WIFI_EVENT_AP_STOP");
+			wifi_manager_status_write_begin();
+			wifi_manager_status.ap_started = false;
+			wifi_manager_status_write_end();
 			xEventGroupClearBits(wifi_manager_event_group, WIFI_MANAGER_AP_STARTED_BIT);
 			break;
 
@@ -722,10 +1801,15 @@ static void wifi_manager_event_handler(void* arg, esp_event_base_t event_base, i
 		 * a aplicação quando o IPV4 muda para um válido. */
 		case IP_EVENT_STA_GOT_IP:
 			ESP_LOGI(TAG, "IP_EVENT_STA_GOT_IP");
+			wifi_manager_status_update_ap_info();
+			wifi_manager_status_write_begin();
+			wifi_manager_status.connected = true;
+			wifi_manager_status.ip_info = ((ip_event_got_ip_t*)event_data)->ip_info;
+			wifi_manager_status_connected_at = esp_timer_get_time();
+			wifi_manager_status_write_end();
+			xEventGroupClearBits(wifi_manager_event_group, WIFI_MANAGER_STA_DISCONNECT_BIT);
 	        xEventGroupSetBits(wifi_manager_event_group, WIFI_MANAGER_WIFI_CONNECTED_BIT);
-	        ip_event_got_ip_t* ip_event_got_ip = (ip_event_got_ip_t*)malloc(sizeof(ip_event_got_ip_t));
-			*ip_event_got_ip =  *( (ip_event_got_ip_t*)event_data );
-	        wifi_manager_send_message(WM_EVENT_STA_GOT_IP, (void*)(ip_event_got_ip) );
+	        wifi_manager_send_event(WM_EVENT_STA_GOT_IP, event_data, sizeof(ip_event_got_ip_t));
 			break;
 
 		/* Este evento surge quando o suporte IPV6 SLAAC configura automaticamente um endereço para o ESP32, ou quando este endereço muda.
@@ -772,6 +1856,100 @@ char* wifi_manager_get_ip_info_json(){
 	return ip_info_json;
 }
 
+void wifi_manager_get_portal_stats(struct wifi_manager_portal_stats_t *stats){
+	memcpy(stats, &wifi_manager_portal_stats, sizeof(struct wifi_manager_portal_stats_t));
+
+	/* medido na leitura: a pilha do servidor HTTP só volta ao heap depois que a tarefa ociosa roda */
+	if(stats->released){
+		stats->heap_reclaimed = (int32_t)(esp_get_free_heap_size() - wifi_manager_portal_heap_before);
+	}
+}
+
+/**
+ * @brief Recria os registros de AP e os buffers JSON liberados por wifi_manager_portal_release. Não faz nada se eles existem.
+ * @return false se faltar memória: os recursos continuam liberados.
+ */
+static bool wifi_manager_portal_alloc(){
+
+	bool ok;
+
+	/* última medida antes de o portal voltar a ocupar o heap */
+	if(wifi_manager_portal_stats.released){
+		wifi_manager_portal_stats.heap_reclaimed = (int32_t)(esp_get_free_heap_size() - wifi_manager_portal_heap_before);
+	}
+
+	if(accessp_records && accessp_json && ip_info_json){
+		wifi_manager_portal_stats.released = false;
+		return true;
+	}
+	if(!wifi_manager_lock_json_buffer( portMAX_DELAY )) return false;
+
+	accessp_records = (wifi_ap_record_t*)malloc(sizeof(wifi_ap_record_t) * MAX_AP_NUM);
+	accessp_json = (char*)malloc(MAX_AP_NUM * JSON_ONE_APP_SIZE + 4);
+	ip_info_json = (char*)malloc(sizeof(char) * JSON_IP_INFO_SIZE);
+	ok = accessp_records && accessp_json && ip_info_json;
+	if(ok){
+		wifi_manager_portal_stats.released = false;
+		ap_num = 0;
+		wifi_manager_clear_access_points_json();
+		wifi_manager_clear_ip_info_json();
+		if(xEventGroupGetBits(wifi_manager_event_group) & WIFI_MANAGER_WIFI_CONNECTED_BIT){
+			wifi_manager_generate_ip_info_json( UPDATE_CONNECTION_OK );
+		}
+	}
+	else{
+		free(accessp_records);
+		free(accessp_json);
+		free(ip_info_json);
+		accessp_records = NULL;
+		accessp_json = NULL;
+		ip_info_json = NULL;
+		ESP_LOGE(TAG, "could not allocate the portal buffers");
+	}
+
+	wifi_manager_unlock_json_buffer();
+
+	return ok;
+}
+
+/**
+ * @brief Para o servidor HTTP e libera tudo o que só serve ao portal: registros de AP, buffers JSON e URLs.
+ */
+static void wifi_manager_portal_release(){
+
+	uint32_t bytes = http_app_get_url_bytes();
+
+	wifi_manager_portal_heap_before = esp_get_free_heap_size();
+
+	http_app_stop();
+
+	if(wifi_manager_lock_json_buffer( portMAX_DELAY )){
+		if(accessp_records){
+			free(accessp_records);
+			accessp_records = NULL;
+			bytes += sizeof(wifi_ap_record_t) * MAX_AP_NUM;
+		}
+		if(accessp_json){
+			free(accessp_json);
+			accessp_json = NULL;
+			bytes += MAX_AP_NUM * JSON_ONE_APP_SIZE + 4;
+		}
+		if(ip_info_json){
+			free(ip_info_json);
+			ip_info_json = NULL;
+			bytes += JSON_IP_INFO_SIZE;
+		}
+		ap_num = 0;
+		wifi_manager_unlock_json_buffer();
+	}
+
+	wifi_manager_portal_stats.released = true;
+	wifi_manager_portal_stats.releases++;
+	wifi_manager_portal_stats.buffer_bytes = bytes;
+	wifi_manager_portal_stats.heap_reclaimed = 0;
+	ESP_LOGI(TAG, "portal released: %d bytes of buffers", (int)bytes);
+}
+
 
 void wifi_manager_destroy(){
 
@@ -779,29 +1957,47 @@ void wifi_manager_destroy(){
 	task_wifi_manager = NULL;
 
 	/* heap buffers */
+#if !WIFI_MANAGER_STATIC_ALLOC
 	free(accessp_records);
-	accessp_records = NULL;
 	free(accessp_json);
-	accessp_json = NULL;
 	free(ip_info_json);
-	ip_info_json = NULL;
 	free(wifi_manager_sta_ip);
+	free(wifi_manager_config_sta);
+#endif
+	accessp_records = NULL;
+	accessp_json = NULL;
+	ip_info_json = NULL;
 	wifi_manager_sta_ip = NULL;
-	if(wifi_manager_config_sta){
-		free(wifi_manager_config_sta);
-		wifi_manager_config_sta = NULL;
-	}
+	wifi_manager_config_sta = NULL;
 
 	/* RTOS objects */
+	nvs_writer_stop(); /* grava o que ainda estiver pendente */
+	if(wifi_manager_storage.destroy){
+		wifi_manager_storage.destroy(wifi_manager_storage.ctx);
+		memset(&wifi_manager_storage, 0x00, sizeof(wifi_manager_storage));
+	}
+	event_bus_destroy();
 	vSemaphoreDelete(wifi_manager_json_mutex);
 	wifi_manager_json_mutex = NULL;
 	vSemaphoreDelete(wifi_manager_sta_ip_mutex);
 	wifi_manager_sta_ip_mutex = NULL;
 	vEventGroupDelete(wifi_manager_event_group);
 	wifi_manager_event_group = NULL;
-	vQueueDelete(wifi_manager_queue);
-	wifi_manager_queue = NULL;
-
+	vSemaphoreDelete(wifi_manager_queue_sem);
+	wifi_manager_queue_sem = NULL;
+#if WIFI_MANAGER_STATIC_ALLOC
+	vSemaphoreDelete(wifi_manager_scratch_mutex);
+	wifi_manager_scratch_mutex = NULL;
+#endif
+	message_ring_free(&wifi_manager_queue);
+	if(wifi_manager_trace_mutex){
+		task_trace_set_source(NULL, NULL, NULL);
+		vSemaphoreDelete(wifi_manager_trace_mutex);
+		wifi_manager_trace_mutex = NULL;
+		msg_trace_free(&wifi_manager_trace);
+	}
+	async_log_stop();
+	task_trace_stop();
 
 }
 
@@ -858,28 +2054,277 @@ void wifi_manager_filter_unique( wifi_ap_record_t * aplist, uint16_t * aps) {
 }
 
 
+/**
+ * @brief Posta uma mensagem na fila sem bloquear. Se a fila estiver cheia, a mensagem é descartada e contada.
+ */
+static BaseType_t wifi_manager_post_message(queue_message *msg, bool to_front){
+
+	message_ring_result_t result;
+
+	if(wifi_manager_queue_sem == NULL) return pdFAIL;
+
+	msg->enqueued_us = (uint32_t)esp_timer_get_time();
+
+	portENTER_CRITICAL(&wifi_manager_queue_mux);
+	result = message_ring_push(&wifi_manager_queue, (uint8_t)msg->code, msg, to_front);
+	portEXIT_CRITICAL(&wifi_manager_queue_mux);
+
+	switch(result){
+	case MESSAGE_RING_QUEUED:
+		xSemaphoreGive(wifi_manager_queue_sem);
+		return pdPASS;
+	case MESSAGE_RING_COALESCED:
+		return pdPASS;
+	default:
+		ESP_LOGW(TAG, "message queue full: dropped message code %d", msg->code);
+		return errQUEUE_FULL;
+	}
+}
+
+void wifi_manager_get_queue_stats(struct wifi_manager_queue_stats_t *stats){
+	portENTER_CRITICAL(&wifi_manager_queue_mux);
+	stats->depth = wifi_manager_queue.capacity;
+	stats->pending = wifi_manager_queue.count;
+	stats->high_water = wifi_manager_queue.high_water;
+	stats->queued = wifi_manager_queue.queued;
+	stats->coalesced = wifi_manager_queue.coalesced;
+	stats->dropped = wifi_manager_queue.dropped;
+	portEXIT_CRITICAL(&wifi_manager_queue_mux);
+}
+
+void wifi_manager_get_msg_stats(struct wifi_manager_msg_stats_t stats[WM_MESSAGE_CODE_COUNT]){
+	portENTER_CRITICAL(&wifi_manager_msg_stats_mux);
+	memcpy(stats, wifi_manager_msg_stats, sizeof(wifi_manager_msg_stats));
+	portEXIT_CRITICAL(&wifi_manager_msg_stats_mux);
+}
+
+size_t wifi_manager_get_msg_stats_json(char *buf, size_t len){
+
+	struct wifi_manager_msg_stats_t stats[WM_MESSAGE_CODE_COUNT];
+	struct wifi_manager_queue_stats_t queue;
+	size_t pos = 0;
+	bool first = true;
+
+	wifi_manager_get_msg_stats(stats);
+	wifi_manager_get_queue_stats(&queue);
+
+	text_append(buf, len, &pos, "{\"queue\":{\"depth\":%u,\"pending\":%u,\"high_water\":%u,\"queued\":%u,\"coalesced\":%u,\"dropped\":%u},\"messages\":{",
+			queue.depth, queue.pending, queue.high_water, (unsigned)queue.queued, (unsigned)queue.coalesced, (unsigned)queue.dropped);
+	for(int i=0; i<WM_MESSAGE_CODE_COUNT; i++){
+		if(stats[i].count == 0) continue;
+		text_append(buf, len, &pos, "%s\"%s\":{\"count\":%u,\"handler_us\":%llu,\"handler_max_us\":%u,\"callback_us\":%llu,\"callback_max_us\":%u,\"wait_us\":%llu,\"wait_max_us\":%u}",
+				first ? "" : ",", wifi_manager_msg_names[i], (unsigned)stats[i].count,
+				(unsigned long long)stats[i].handler_us, (unsigned)stats[i].handler_max_us,
+				(unsigned long long)stats[i].callback_us, (unsigned)stats[i].callback_max_us,
+				(unsigned long long)stats[i].wait_us, (unsigned)stats[i].wait_max_us);
+		first = false;
+	}
+	text_append(buf, len, &pos, "}}");
+
+	return text_finish(buf, len, pos);
+}
+
+size_t wifi_manager_get_task_stats_json(char *buf, size_t len){
+
+	struct wifi_manager_task_stats_t stats[WIFI_MANAGER_TASK_COUNT];
+	size_t pos = 0;
+
+	wifi_manager_get_task_stats(stats);
+
+	text_append(buf, len, &pos, "[");
+	for(int i=0; i<WIFI_MANAGER_TASK_COUNT; i++){
+		text_append(buf, len, &pos, "%s{\"name\":\"%s\",\"running\":%s,\"static\":%s,\"core\":%d,\"priority\":%u,\"stack_size\":%u,\"stack_free_min\":%u}",
+				i == 0 ? "" : ",", stats[i].name, stats[i].running ? "true" : "false", stats[i].static_alloc ? "true" : "false",
+				stats[i].core_id == tskNO_AFFINITY ? -1 : (int)stats[i].core_id, (unsigned)stats[i].priority,
+				(unsigned)stats[i].stack_size, (unsigned)stats[i].stack_free_min);
+	}
+	text_append(buf, len, &pos, "]");
+
+	return text_finish(buf, len, pos);
+}
+
+/**
+ * @brief event_bus_publish com o tempo gasto nos callbacks somado ao da mensagem em tratamento.
+ */
+static void wifi_manager_publish(const queue_message *msg){
+	uint32_t t0 = (uint32_t)esp_timer_get_time();
+	event_bus_publish(msg);
+	wifi_manager_callback_us += (uint32_t)esp_timer_get_time() - t0;
+}
+
+/**
+ * @brief Soma o tempo de uma mensagem tratada às estatísticas do seu código.
+ */
+static void wifi_manager_record_msg_stats(message_code_t code, uint32_t wait_us, uint32_t total_us){
+
+	if(code >= WM_MESSAGE_CODE_COUNT) return;
+
+	struct wifi_manager_msg_stats_t *s = &wifi_manager_msg_stats[code];
+	uint32_t handler_us = total_us > wifi_manager_callback_us ? total_us - wifi_manager_callback_us : 0;
+
+	portENTER_CRITICAL(&wifi_manager_msg_stats_mux);
+	s->count++;
+	s->handler_us += handler_us;
+	if(handler_us > s->handler_max_us) s->handler_max_us = handler_us;
+	s->callback_us += wifi_manager_callback_us;
+	if(wifi_manager_callback_us > s->callback_max_us) s->callback_max_us = wifi_manager_callback_us;
+	s->wait_us += wait_us;
+	if(wait_us > s->wait_max_us) s->wait_max_us = wait_us;
+	portEXIT_CRITICAL(&wifi_manager_msg_stats_mux);
+}
+
+/**
+ * @brief Grava no trace uma mensagem que vai ser tratada.
+ */
+static void wifi_manager_trace_message(const queue_message *msg, uint16_t pending){
+
+	struct msg_trace_record_t record;
+
+	if(wifi_manager_trace_mutex == NULL) return;
+
+	memset(&record, 0x00, sizeof(record));
+	record.time_ms = (uint32_t)(esp_timer_get_time() / 1000);
+	record.code = (uint8_t)msg->code;
+	record.bits = (uint16_t)xEventGroupGetBits(wifi_manager_event_group);
+	record.pending = pending > UINT8_MAX ? UINT8_MAX : (uint8_t)pending;
+	switch(msg->code){
+	case WM_ORDER_CONNECT_STA:
+		record.param = (uint8_t)(BaseType_t)msg->param;
+		break;
+	case WM_EVENT_STA_DISCONNECTED:
+		record.arg = msg->event.sta_disconnected.reason;
+		break;
+	case WM_EVENT_SCAN_DONE:
+		record.arg = msg->event.scan_done.number;
+		break;
+	default:
+		break;
+	}
+
+	xSemaphoreTake(wifi_manager_trace_mutex, portMAX_DELAY);
+	msg_trace_push(&wifi_manager_trace, &record);
+	xSemaphoreGive(wifi_manager_trace_mutex);
+}
+
+size_t wifi_manager_get_trace(uint8_t *buf, size_t len){
+
+	size_t sz;
+
+	if(wifi_manager_trace_mutex == NULL) return 0;
+
+	xSemaphoreTake(wifi_manager_trace_mutex, portMAX_DELAY);
+	sz = msg_trace_serialize(&wifi_manager_trace, buf, len);
+	xSemaphoreGive(wifi_manager_trace_mutex);
+
+	return sz;
+}
+
 BaseType_t wifi_manager_send_message_to_front(message_code_t code, void *param){
 	queue_message msg;
 	msg.code = code;
 	msg.param = param;
-	return xQueueSendToFront( wifi_manager_queue, &msg, portMAX_DELAY);
+	return wifi_manager_post_message(&msg, true);
 }
 
 BaseType_t wifi_manager_send_message(message_code_t code, void *param){
 	queue_message msg;
 	msg.code = code;
 	msg.param = param;
-	return xQueueSend( wifi_manager_queue, &msg, portMAX_DELAY);
+	return wifi_manager_post_message(&msg, false);
+}
+
+BaseType_t wifi_manager_send_event(message_code_t code, const void *event_data, size_t size){
+	queue_message msg;
+	msg.code = code;
+	msg.param = NULL;
+	if(size > sizeof(queue_message_event_t)){
+		ESP_LOGE(TAG, "event payload too large (%d bytes) for message code %d", (int)size, code);
+		return pdFAIL;
+	}
+	memcpy(&msg.event, event_data, size);
+	return wifi_manager_post_message(&msg, false);
 }
 
 
 void wifi_manager_set_callback(message_code_t message_code, void (*func_ptr)(void*) ){
+	event_bus_set_legacy_callback(message_code, func_ptr);
+}
+
+int wifi_manager_subscribe(message_code_t code, void (*func_ptr)(void*), wifi_manager_dispatch_t dispatch, uint16_t queue_depth){
+	return event_bus_subscribe(code, func_ptr, dispatch, queue_depth);
+}
+
+void wifi_manager_unsubscribe(int subscriber){
+	event_bus_unsubscribe(subscriber);
+}
+
+esp_err_t wifi_manager_get_subscriber_stats(int subscriber, struct wifi_manager_subscriber_stats_t *stats){
+	return event_bus_get_stats(subscriber, stats);
+}
+
+void wifi_manager_get_nvs_stats(struct wifi_manager_nvs_stats_t *stats){
+	struct nvs_writer_stats_t writer;
+	nvs_writer_get_stats(&writer);
+
+	*stats = wifi_manager_nvs_stats;
+	stats->commits = writer.commits;
+	stats->coalesced_saves = writer.coalesced;
+	stats->last_commit_us = writer.last_commit_us;
+	stats->max_commit_us = writer.max_commit_us;
+}
+
+void wifi_manager_get_boot_profile(struct boot_profile_t *profile){
+	portENTER_CRITICAL(&wifi_manager_boot_profile_mux);
+	memcpy(profile, &wifi_manager_boot_profile, sizeof(struct boot_profile_t));
+	portEXIT_CRITICAL(&wifi_manager_boot_profile_mux);
+}
+
+size_t wifi_manager_get_boot_trace(char *buf, size_t len){
+
+	/* cópia: a serialização é longa demais para uma seção crítica */
+	struct boot_profile_t *profile = (struct boot_profile_t*)wifi_manager_scratch_alloc(sizeof(struct boot_profile_t));
+	size_t sz;
+
+	if(profile == NULL) return 0;
+	wifi_manager_get_boot_profile(profile);
+	sz = boot_profile_to_chrome_trace(profile, wifi_manager_boot_tracks, sizeof(wifi_manager_boot_tracks) / sizeof(wifi_manager_boot_tracks[0]), esp_timer_get_time(), buf, len);
+	wifi_manager_scratch_free(profile);
+
+	return sz;
+}
 
-	if(cb_ptr_arr && message_code < WM_MESSAGE_CODE_COUNT){
-		cb_ptr_arr[message_code] = func_ptr;
+/**
+ * @brief Marca o primeiro IP no perfil de boot e mostra a duração de cada fase.
+ */
+static void wifi_manager_boot_mark_first_ip(){
+
+	portENTER_CRITICAL(&wifi_manager_boot_profile_mux);
+	boot_profile_mark(&wifi_manager_boot_profile, "first IP", WIFI_MANAGER_BOOT_TRACK_CONNECT, esp_timer_get_time());
+	portEXIT_CRITICAL(&wifi_manager_boot_profile_mux);
+
+	for(uint8_t i=0; i<wifi_manager_boot_profile.count; i++){
+		const struct boot_phase_t *p = &wifi_manager_boot_profile.phases[i];
+		ESP_LOGD(TAG, "Boot phase %-22s [%s] start:%d us duration:%d us", p->name, wifi_manager_boot_tracks[p->track],
+				(int)p->start_us, (int)(p->end_us >= 0 ? p->end_us - p->start_us : -1));
 	}
 }
 
+void wifi_manager_get_wake_stats(struct wifi_manager_wake_stats_t *stats){
+	*stats = wifi_manager_wake_stats;
+}
+
+esp_err_t wifi_manager_flush_config(TickType_t xTicksToWait){
+	return nvs_writer_flush(xTicksToWait);
+}
+
+uint32_t wifi_manager_get_disconnect_count(uint8_t reason){
+	return disconnect_reason_get_count(reason);
+}
+
+uint8_t wifi_manager_get_last_disconnect_reason(){
+	return wifi_manager_last_disconnect_reason;
+}
+
 esp_netif_t* wifi_manager_get_esp_netif_ap(){
 	return esp_netif_ap;
 }
@@ -888,29 +2333,92 @@ esp_netif_t* wifi_manager_get_esp_netif_sta(){
 	return esp_netif_sta;
 }
 
+/**
+ * @brief Inicia uma associação com a configuração STA atual.
+ * @return true se a tentativa vai direto ao BSSID/canal do cache (reconexão rápida).
+ */
+static bool wifi_manager_fsm_connect(void *ctx, uint8_t origin, bool use_hint){
+
+	bool direct = false;
+	EventBits_t uxBits = xEventGroupGetBits(wifi_manager_event_group);
+
+	/* reconexão rápida: sem a dica, a varredura completa é usada */
+	if(!use_hint){
+		wifi_manager_clear_sta_cache_hint(wifi_manager_get_wifi_sta_config());
+	}
+	else if(wifi_manager_apply_sta_cache(wifi_manager_get_wifi_sta_config())){
+		ESP_LOGI(TAG, "Fast reconnect: connecting directly on channel %d", wifi_manager_sta_cache.channel);
+		direct = true;
+	}
+
+	/* IP estático, aluguel DHCP reutilizado ou cliente DHCP */
+	if(wifi_manager_lease_timer) xTimerStop( wifi_manager_lease_timer, (TickType_t)0 );
+	wifi_manager_lease_generation++;
+	wifi_manager_sta_ip_source = wifi_manager_configure_sta_ip((connection_request_made_by_code_t)origin);
+	portENTER_CRITICAL(&wifi_manager_latency_mux);
+	wifi_manager_connect_start_us = esp_timer_get_time();
+	wifi_manager_connect_link_us = 0;
+	portEXIT_CRITICAL(&wifi_manager_latency_mux);
+	wifi_manager_connect_origin = (connection_request_made_by_code_t)origin;
+
+	/* atualize a configuração para a última e tente a conexão */
+	ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, wifi_manager_get_wifi_sta_config()));
+
+	/* se houver uma varredura de wi-fi em andamento, cancele-a primeiro
+	   Chamar esp_wifi_scan_stop irá disparar um evento SCAN_DONE que irá reiniciar este bit */
+	if(uxBits & WIFI_MANAGER_SCAN_BIT){
+		esp_wifi_scan_stop();
+	}
+	ESP_ERROR_CHECK(esp_wifi_connect());
+
+	return direct;
+}
+
+static const struct conn_fsm_ops_t wifi_manager_fsm_ops = {
+	.connect = wifi_manager_fsm_connect,
+	.post = wifi_manager_fsm_post,
+	.arm_retry = wifi_manager_fsm_arm_retry,
+	.cancel_retry = wifi_manager_fsm_cancel_retry,
+};
+
 void wifi_manager( void * pvParameters ){
 
 
 	queue_message msg;
 	BaseType_t xStatus;
 	EventBits_t uxBits;
-	uint8_t	retries = 0;
+	uint16_t pending = 0;
+	uint32_t dequeued_us = 0;
+	conn_outcome_t outcome;
+	int phase_task = wifi_manager_boot_begin("task init", WIFI_MANAGER_BOOT_TRACK_TASK);
+	int phase;
+
 
+	/* máquina de estados da conexão STA */
+	conn_fsm_init(&wifi_manager_fsm, WIFI_MANAGER_MAX_RETRY_START_AP, &wifi_manager_fsm_ops, NULL);
 
 	/* inicializar a pilha tcp */
+	phase = wifi_manager_boot_begin("esp_netif_init", WIFI_MANAGER_BOOT_TRACK_TASK);
 	ESP_ERROR_CHECK(esp_netif_init());
+	wifi_manager_boot_end(phase);
 
 	/* loop de eventos para o driver wi-fi */
+	phase = wifi_manager_boot_begin("esp_event_loop_create", WIFI_MANAGER_BOOT_TRACK_TASK);
 	ESP_ERROR_CHECK(esp_event_loop_create_default());
+	wifi_manager_boot_end(phase);
 
+	phase = wifi_manager_boot_begin("esp_netif_create", WIFI_MANAGER_BOOT_TRACK_TASK);
 	esp_netif_sta = esp_netif_create_default_wifi_sta();
 	esp_netif_ap = esp_netif_create_default_wifi_ap();
+	wifi_manager_boot_end(phase);
 
 
 	/* configuração wi-fi padrão */
+	phase = wifi_manager_boot_begin("esp_wifi_init", WIFI_MANAGER_BOOT_TRACK_TASK);
 	wifi_init_config_t wifi_init_config = WIFI_INIT_CONFIG_DEFAULT();
 	ESP_ERROR_CHECK(esp_wifi_init(&wifi_init_config));
 	ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
+	wifi_manager_boot_end(phase);
 
 	/* manipulador de eventos para a conexão */
     esp_event_handler_instance_t instance_wifi_event;
@@ -943,6 +2451,7 @@ void wifi_manager( void * pvParameters ){
 	
 
 	/* DHCP AP configuration */
+	phase = wifi_manager_boot_begin("ap_dhcp", WIFI_MANAGER_BOOT_TRACK_TASK);
 	esp_netif_dhcps_stop(esp_netif_ap); /* O cliente/servidor DHCP deve ser interrompido antes de definir novas informações de IP. */
 	esp_netif_ip_info_t ap_ip_info;
 	memset(&ap_ip_info, 0x00, sizeof(ap_ip_info));
@@ -951,19 +2460,26 @@ void wifi_manager( void * pvParameters ){
 	inet_pton(AF_INET, DEFAULT_AP_NETMASK, &ap_ip_info.netmask);
 	ESP_ERROR_CHECK(esp_netif_set_ip_info(esp_netif_ap, &ap_ip_info));
 	ESP_ERROR_CHECK(esp_netif_dhcps_start(esp_netif_ap));
+	wifi_manager_boot_end(phase);
 
+	phase = wifi_manager_boot_begin("ap_config", WIFI_MANAGER_BOOT_TRACK_TASK);
 	ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_APSTA));
 	ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_AP, &ap_config));
 	ESP_ERROR_CHECK(esp_wifi_set_bandwidth(WIFI_IF_AP, wifi_settings.ap_bandwidth));
 	ESP_ERROR_CHECK(esp_wifi_set_ps(wifi_settings.sta_power_save));
+	wifi_manager_boot_end(phase);
 
 
 	/* por padrão, o modo é STA porque wifi_manager não iniciará o ponto de acesso a menos que seja necessário! */
+	phase = wifi_manager_boot_begin("esp_wifi_start", WIFI_MANAGER_BOOT_TRACK_TASK);
 	ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
 	ESP_ERROR_CHECK(esp_wifi_start());
+	wifi_manager_boot_end(phase);
 
 	/* iniciar servidor http */
+	phase = wifi_manager_boot_begin("http_app_start", WIFI_MANAGER_BOOT_TRACK_TASK);
 	http_app_start(false);
+	wifi_manager_boot_end(phase);
 
 	/* configuração do scanner wi-fi */
 	wifi_scan_config_t scan_config = {
@@ -975,19 +2491,34 @@ void wifi_manager( void * pvParameters ){
 
 	/* enfileirar o primeiro evento: carregar a configuração anterior */
 	wifi_manager_send_message(WM_ORDER_LOAD_AND_RESTORE_STA, NULL);
+	wifi_manager_boot_end(phase_task);
 
 
 	/* loop de processamento principal */
 	for(;;){
-		xStatus = xQueueReceive( wifi_manager_queue, &msg, portMAX_DELAY );
+		xStatus = xSemaphoreTake( wifi_manager_queue_sem, portMAX_DELAY );
+
+		if( xStatus == pdPASS ){
+			portENTER_CRITICAL(&wifi_manager_queue_mux);
+			xStatus = message_ring_pop(&wifi_manager_queue, &msg) ? pdPASS : pdFAIL;
+			pending = wifi_manager_queue.count;
+			portEXIT_CRITICAL(&wifi_manager_queue_mux);
+			dequeued_us = (uint32_t)esp_timer_get_time();
+			wifi_manager_callback_us = 0;
+		}
+
+		if( xStatus == pdPASS && WIFI_MANAGER_TRACE ){
+			wifi_manager_trace_message(&msg, pending);
+		}
 
 		if( xStatus == pdPASS ){
+			TASK_TRACE_BEGIN(msg.code < WM_MESSAGE_CODE_COUNT ? wifi_manager_msg_names[msg.code] : "?", (int16_t)msg.code);
 			switch(msg.code){
 
 			case WM_EVENT_SCAN_DONE:{
-				wifi_event_sta_scan_done_t *evt_scan_done = (wifi_event_sta_scan_done_t*)msg.param;
-				/* apenas verifique se há AP se a varredura for bem-sucedida */
-				if(evt_scan_done->status == 0){
+				wifi_event_sta_scan_done_t *evt_scan_done = &msg.event.scan_done;
+				/* apenas verifique se há AP se a varredura for bem-sucedida. Com os recursos do portal liberados, a lista é recriada aqui */
+				if(evt_scan_done->status == 0 && wifi_manager_portal_alloc()){
 					/* Como parâmetro de entrada, ele armazena o número máximo de AP que ap_records podem conter. Como parâmetro de saída, ele recebe o número real do AP que esta API retorna.
 					* Como consequência, ap_num DEVE ser redefinido para MAX_AP_NUM a cada varredura */
 					ap_num = MAX_AP_NUM;
@@ -1002,16 +2533,44 @@ void wifi_manager( void * pvParameters ){
 					else{
 						ESP_LOGE(TAG, "could not get access to json mutex in wifi_scan");
 					}
+
+					/* RSSI atual para o retrato do estado */
+					if(xEventGroupGetBits(wifi_manager_event_group) & WIFI_MANAGER_WIFI_CONNECTED_BIT){
+						wifi_manager_status_update_ap_info();
+					}
+				}
+
+				/* escolha da melhor rede salva visível, se a máquina de estados espera por esta varredura */
+				if(wifi_manager_fsm.state == CONN_STATE_SELECTING){
+					int idx = -1;
+
+					if(evt_scan_done->status == 0 && accessp_records){
+						idx = sta_profiles_select(wifi_manager_sta_profiles, WIFI_MANAGER_MAX_SAVED_NETWORKS, accessp_records, ap_num, wifi_manager_sta_profiles_tried, wifi_manager_wall_clock());
+					}
+
+					if(idx >= 0){
+						ESP_LOGI(TAG, "Best saved network in range: %s", wifi_manager_sta_profiles[idx].ssid);
+						wifi_manager_load_sta_profile(idx);
+					}
+					else if(wifi_manager_fsm.selection == CONNECTION_REQUEST_RESTORE_CONNECTION){
+						/* nenhuma rede salva visível: tente a rede atual mesmo assim, ela pode estar oculta */
+						ESP_LOGI(TAG, "No saved network in range. Trying %s anyway.", wifi_manager_config_sta->sta.ssid);
+					}
+
+					if(conn_fsm_dispatch(&wifi_manager_fsm, WM_EVENT_SCAN_DONE, idx >= 0) == CONN_OUTCOME_NO_NETWORK){
+						/* todas as redes salvas visíveis já falharam: iniciar SoftAP */
+						ESP_LOGI(TAG, "No other saved network in range. Starting access point.");
+						wifi_manager_sta_profiles_tried = 0;
+					}
 				}
 
 				/* callback */
-				if(cb_ptr_arr[msg.code]) (*cb_ptr_arr[msg.code])( msg.param );
-				free(evt_scan_done);
+				wifi_manager_publish(&msg);
 				}
 				break;
 
 			case WM_ORDER_START_WIFI_SCAN:
-				ESP_LOGD(TAG, "MESSAGE: ORDER_START_WIFI_SCAN");
+				WM_LOGD(LOG_SUBSYSTEM_MANAGER, TAG, "MESSAGE: ORDER_START_WIFI_SCAN");
 
 				/* se uma varredura já estiver em andamento, esta mensagem será simplesmente ignorada graças ao WIFI_MANAGER_SCAN_BIT uxBit */
 				uxBits = xEventGroupGetBits(wifi_manager_event_group);
@@ -1021,29 +2580,53 @@ void wifi_manager( void * pvParameters ){
 				}
 
 				/* callback */
-				if(cb_ptr_arr[msg.code]) (*cb_ptr_arr[msg.code])(NULL);
+				wifi_manager_publish(&msg);
 
 				break;
 
 			case WM_ORDER_LOAD_AND_RESTORE_STA:
-				ESP_LOGI(TAG, "MESSAGE: ORDER_LOAD_AND_RESTORE_STA");
-				if(wifi_manager_fetch_wifi_sta_config()){
+				WM_LOGI(LOG_SUBSYSTEM_MANAGER, TAG, "MESSAGE: ORDER_LOAD_AND_RESTORE_STA");
+				int64_t restore_start = esp_timer_get_time();
+				phase = wifi_manager_boot_begin("restore", WIFI_MANAGER_BOOT_TRACK_CONNECT);
+				struct rtc_resume_t resume;
+				bool found = false;
+
+				if(WIFI_MANAGER_FAST_RESUME && rtc_resume_load(&resume) && resume.sta_ssid[0] != '\0'){
+					/* despertar do deep sleep: tudo vem da memória RTC, as redes salvas são lidas depois da primeira tentativa */
+					wifi_manager_apply_rtc_resume(&resume);
+					wifi_manager_resume_pending = true;
+					found = true;
+				}
+				else if(wifi_manager_fetch_wifi_sta_config()){
+					wifi_manager_fetch_sta_cache();
+					wifi_manager_fetch_sta_lease();
+					found = true;
+				}
+				wifi_manager_wake_stats.fast_resume = wifi_manager_resume_pending;
+				wifi_manager_wake_stats.restore_us = esp_timer_get_time() - restore_start;
+				wifi_manager_boot_end(phase);
+
+				if(found){
 					ESP_LOGI(TAG, "Saved wifi found on startup. Will attempt to connect.");
-					wifi_manager_send_message(WM_ORDER_CONNECT_STA, (void*)CONNECTION_REQUEST_RESTORE_CONNECTION);
+					wifi_manager_sta_profiles_tried = 0;
 				}
 				else{
 					/* nenhum wi-fi salvo: inicie o soft AP! Isso é o que deve acontecer durante a primeira execução */
 					ESP_LOGI(TAG, "No saved wifi found on startup. Starting access point.");
-					wifi_manager_send_message(WM_ORDER_START_AP, NULL);
 				}
 
+				/* várias redes salvas: a varredura decide qual delas usar. Na retomada rápida as redes salvas ainda não foram lidas */
+				uint8_t saved = found ? sta_profiles_count(wifi_manager_sta_profiles, WIFI_MANAGER_MAX_SAVED_NETWORKS) : 0;
+				if(found && saved == 0) saved = 1;
+				conn_fsm_dispatch(&wifi_manager_fsm, WM_ORDER_LOAD_AND_RESTORE_STA, saved);
+
 				/* callback */
-				if(cb_ptr_arr[msg.code]) (*cb_ptr_arr[msg.code])(NULL);
+				wifi_manager_publish(&msg);
 
 				break;
 
 			case WM_ORDER_CONNECT_STA:
-				ESP_LOGI(TAG, "MESSAGE: ORDER_CONNECT_STA");
+				WM_LOGI(LOG_SUBSYSTEM_MANAGER, TAG, "MESSAGE: ORDER_CONNECT_STA");
 
 				/* muito importante: preciso que esta tentativa de conexão seja especificamente solicitada.
 				 * O parâmetro nesse caso é um booleano que indica se a solicitação foi feita automaticamente
@@ -1056,27 +2639,32 @@ void wifi_manager( void * pvParameters ){
 					xEventGroupSetBits(wifi_manager_event_group, WIFI_MANAGER_REQUEST_RESTORE_STA_BIT);
 				}
 
-				uxBits = xEventGroupGetBits(wifi_manager_event_group);
-				if( ! (uxBits & WIFI_MANAGER_WIFI_CONNECTED_BIT) ){
-					/* atualize a configuração para a última e tente a conexão */
-					ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, wifi_manager_get_wifi_sta_config()));
-
-					/* se houver uma varredura de wi-fi em andamento, cancele-a primeiro
-					   Chamar esp_wifi_scan_stop irá disparar um evento SCAN_DONE que irá reiniciar este bit */
-					if(uxBits & WIFI_MANAGER_SCAN_BIT){
-						esp_wifi_scan_stop();
-					}
-					ESP_ERROR_CHECK(esp_wifi_connect());
+				/* fase "connect" do perfil de boot: do primeiro pedido até o primeiro IP, tentativas incluídas */
+				if(wifi_manager_wake_stats.connected_us == 0 && wifi_manager_boot_connect_phase < 0){
+					wifi_manager_boot_connect_phase = wifi_manager_boot_begin("connect", WIFI_MANAGER_BOOT_TRACK_CONNECT);
 				}
 
+				/* ignorado se a STA já está conectada (ver wifi_manager_fsm_connect) */
+				conn_fsm_dispatch(&wifi_manager_fsm, WM_ORDER_CONNECT_STA, (uint32_t)(BaseType_t)msg.param);
+
 				/* callback */
-				if(cb_ptr_arr[msg.code]) (*cb_ptr_arr[msg.code])(NULL);
+				wifi_manager_publish(&msg);
 
 				break;
 
 			case WM_EVENT_STA_DISCONNECTED:
-				;wifi_event_sta_disconnected_t* wifi_event_sta_disconnected = (wifi_event_sta_disconnected_t*)msg.param;
-				ESP_LOGI(TAG, "MESSAGE: EVENT_STA_DISCONNECTED with Reason code: %d", wifi_event_sta_disconnected->reason);
+				;wifi_event_sta_disconnected_t* wifi_event_sta_disconnected = &msg.event.sta_disconnected;
+				WM_LOGI(LOG_SUBSYSTEM_MANAGER, TAG, "MESSAGE: EVENT_STA_DISCONNECTED with Reason code: %d (%s)", wifi_event_sta_disconnected->reason, disconnect_reason_to_str(wifi_event_sta_disconnected->reason));
+
+				/* contadores por código de razão */
+				wifi_manager_last_disconnect_reason = wifi_event_sta_disconnected->reason;
+				disconnect_reason_record(wifi_event_sta_disconnected->reason);
+
+				/* latência da tentativa que falhou (nada se a STA estava conectada) */
+				wifi_manager_record_attempt_latency(false);
+
+				/* a tentativa direta da retomada rápida falhou: as redes salvas são necessárias para seguir */
+				wifi_manager_finish_fast_resume();
 
 				/* isso ainda pode ser postado em várias condições diferentes
 				 *
@@ -1095,7 +2683,8 @@ void wifi_manager( void * pvParameters ){
 				 *
 				 *  Se WIFI_MANAGER_REQUEST_STA_CONNECT_BIT e WIFI_MANAGER_REQUEST_STA_CONNECT_BIT NÃO estão configurados, é uma conexão perdida
 				 *
-				 *  Nesta versão do software, os códigos de razão não são usados. Eles são indicados aqui para uso futuro em potencial.
+				 *  Em uma conexão perdida, o código de razão decide o que fazer (ver disconnect_reason.c): nova tentativa imediata,
+				 *  recuo, nova varredura ou desistir e iniciar o AP. Uma senha errada não passa por WIFI_MANAGER_MAX_RETRY_START_AP tentativas.
 				 *
 				 *  CÓDIGO DE RAZÃO:
 				 *  1		UNSPECIFIED
@@ -1138,8 +2727,13 @@ void wifi_manager( void * pvParameters ){
 					xTimerStop( wifi_manager_shutdown_ap_timer, (TickType_t)0 );
 				}
 
+				/* o que fazer é decidido pela máquina de estados. Com o AP ativo, as falhas não contam para desistir */
 				uxBits = xEventGroupGetBits(wifi_manager_event_group);
-				if( uxBits & WIFI_MANAGER_REQUEST_STA_CONNECT_BIT ){
+				wifi_manager_fsm.ap_started = (uxBits & WIFI_MANAGER_AP_STARTED_BIT) != 0;
+				wifi_manager_fsm.saved_networks = sta_profiles_count(wifi_manager_sta_profiles, WIFI_MANAGER_MAX_SAVED_NETWORKS);
+				outcome = conn_fsm_dispatch(&wifi_manager_fsm, WM_EVENT_STA_DISCONNECTED, wifi_event_sta_disconnected->reason);
+
+				if( outcome == CONN_OUTCOME_USER_ATTEMPT_FAILED ){
 					/* não há novas tentativas quando é uma conexão solicitada pelo usuário por design. Isso evita que o usuário se pendure muito
 					 * no caso de terem digitado uma senha errada, por exemplo. Aqui, simplesmente limpamos o bit de solicitação e seguimos em frente */
 					xEventGroupClearBits(wifi_manager_event_group, WIFI_MANAGER_REQUEST_STA_CONNECT_BIT);
@@ -1150,10 +2744,15 @@ void wifi_manager( void * pvParameters ){
 					}
 
 				}
-				else if (uxBits & WIFI_MANAGER_REQUEST_DISCONNECT_BIT){
+				else if( outcome == CONN_OUTCOME_USER_DISCONNECT ){
 					/* o usuário solicitou manualmente uma desconexão para que a conexão perdida seja um evento normal. Limpe a bandeira e reinicie o AP */
 					xEventGroupClearBits(wifi_manager_event_group, WIFI_MANAGER_REQUEST_DISCONNECT_BIT);
 
+					/* esquecer a rede */
+					if(wifi_manager_config_sta && sta_profiles_remove(wifi_manager_sta_profiles, WIFI_MANAGER_MAX_SAVED_NETWORKS, wifi_manager_config_sta->sta.ssid)){
+						wifi_manager_sta_profiles_dirty = true;
+					}
+
 					/* apagar configuração */
 					if(wifi_manager_config_sta){
 						memset(wifi_manager_config_sta, 0x00, sizeof(wifi_config_t));
@@ -1165,11 +2764,15 @@ void wifi_manager( void * pvParameters ){
 						wifi_manager_unlock_json_buffer();
 					}
 
-					/* salvar memória NVS */
+					/* salvar memória NVS: a rede esquecida deve sair do flash agora, sem esperar o intervalo de agrupamento */
 					wifi_manager_save_sta_config();
-
-					/* iniciar SoftAP */
-					wifi_manager_send_message(WM_ORDER_START_AP, NULL);
+					nvs_writer_flush(0);
+					rtc_resume_invalidate();
+				}
+				else if( outcome == CONN_OUTCOME_DIRECT_FALLBACK ){
+					/* a conexão direta no BSSID/canal em cache falhou (o AP pode ter mudado de canal ou sido substituído).
+					 * A máquina de estados tenta de novo imediatamente com uma varredura completa, sem contar como uma nova tentativa */
+					ESP_LOGI(TAG, "Fast reconnect failed. Falling back to a full scan.");
 				}
 				else{
 					/* conexão perdida ? */
@@ -1178,55 +2781,64 @@ void wifi_manager( void * pvParameters ){
 						wifi_manager_unlock_json_buffer();
 					}
 
-					/* Inicie o cronômetro que tentará restaurar a configuração salva */
-					xTimerStart( wifi_manager_retry_timer, (TickType_t)0 );
+					/* histórico da rede salva: apenas em RAM, sem gravação no flash a cada tentativa */
+					int profile_idx = sta_profiles_find(wifi_manager_sta_profiles, WIFI_MANAGER_MAX_SAVED_NETWORKS, wifi_manager_config_sta->sta.ssid);
+					if(profile_idx >= 0){
+						sta_profiles_record_failure(&wifi_manager_sta_profiles[profile_idx]);
+						wifi_manager_sta_profiles_tried |= (1UL << profile_idx);
+					}
+
+					/* nova tentativa imediata, temporizador, seleção de outra rede salva ou AP: já decidido pela máquina de estados */
+					if(wifi_manager_fsm.state == CONN_STATE_SELECTING){
+						ESP_LOGI(TAG, "Giving up on %s. Looking for another saved network.", wifi_manager_config_sta->sta.ssid);
+					}
+					else if(outcome == CONN_OUTCOME_GIVE_UP){
+						ESP_LOGI(TAG, "Giving up on %s. Starting access point.", wifi_manager_config_sta->sta.ssid);
+					}
+					else if(wifi_manager_fsm.state == CONN_STATE_IDLE){
+						ESP_LOGI(TAG, "Transient disconnect. Retrying immediately.");
+					}
 
 					/* se foi uma tentativa de restauração de conexão, limpamos o bit */
 					xEventGroupClearBits(wifi_manager_event_group, WIFI_MANAGER_REQUEST_RESTORE_STA_BIT);
 
-					/* se o AP não for iniciado, verificamos se atingimos o limite de tentativa fracassada de iniciá-lo */
-					if(! (uxBits & WIFI_MANAGER_AP_STARTED_BIT) ){
-
-						/* se o número de tentativas estiver abaixo do limite para iniciar o AP, uma tentativa de reconexão é feita
-						 * Desta forma, evitamos reiniciar o AP diretamente no caso de a conexão ser momentaneamente perdida */
-						if(retries < WIFI_MANAGER_MAX_RETRY_START_AP){
-							retries++;
-						}
-						else{
-							/* Neste cenário, a conexão foi perdida sem possibilidade de reparo: inicie o AP! */
-							retries = 0;
-
-							/* iniciar SoftAP */
-							wifi_manager_send_message(WM_ORDER_START_AP, NULL);
-						}
+					/* o próximo despertar do deep sleep continua a contagem de tentativas */
+					if(WIFI_MANAGER_FAST_RESUME){
+						rtc_resume_set_retry(wifi_manager_fsm.retries, wifi_manager_fsm.retry_attempt);
 					}
 				}
 
 				/* callback */
-				if(cb_ptr_arr[msg.code]) (*cb_ptr_arr[msg.code])( msg.param );
-				free(wifi_event_sta_disconnected);
+				wifi_manager_publish(&msg);
 
 				break;
 
 			case WM_ORDER_START_AP:
-				ESP_LOGI(TAG, "MESSAGE: ORDER_START_AP");
+				WM_LOGI(LOG_SUBSYSTEM_MANAGER, TAG, "MESSAGE: ORDER_START_AP");
 
 				ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_APSTA));
 
-				/* reinicie o daemon HTTP */
-				http_app_stop();
-				http_app_start(true);
+				/* recursos do portal liberados por um WM_ORDER_STOP_AP anterior. Sem eles, o AP fica sem portal:
+				 * as páginas usariam os buffers JSON nulos */
+				if(WIFI_MANAGER_PORTAL_RELEASE && !wifi_manager_portal_alloc()){
+					ESP_LOGE(TAG, "Access point started without the portal: out of memory");
+				}
+				else{
+					/* reinicie o daemon HTTP */
+					http_app_stop();
+					http_app_start(true);
 
-				/* iniciar DNS */
-				dns_server_start();
+					/* iniciar DNS */
+					dns_server_start();
+				}
 
 				/* callback */
-				if(cb_ptr_arr[msg.code]) (*cb_ptr_arr[msg.code])(NULL);
+				wifi_manager_publish(&msg);
 
 				break;
 
 			case WM_ORDER_STOP_AP:
-				ESP_LOGI(TAG, "MESSAGE: ORDER_STOP_AP");
+				WM_LOGI(LOG_SUBSYSTEM_MANAGER, TAG, "MESSAGE: ORDER_STOP_AP");
 
 
 				uxBits = xEventGroupGetBits(wifi_manager_event_group);
@@ -1242,37 +2854,115 @@ void wifi_manager( void * pvParameters ){
 					/* parar DNS */
 					dns_server_stop();
 
-					/* reinicie o daemon HTTP */
-					http_app_stop();
-					http_app_start(false);
+					if(WIFI_MANAGER_PORTAL_RELEASE){
+						/* o portal só volta com o próximo WM_ORDER_START_AP */
+						wifi_manager_portal_release();
+					}
+					else{
+						/* reinicie o daemon HTTP */
+						http_app_stop();
+						http_app_start(false);
+					}
+
+					/* callback */
+					wifi_manager_publish(&msg);
+				}
+
+				break;
+
+			case WM_EVENT_STA_LEASE_EXPIRED:
+				WM_LOGI(LOG_SUBSYSTEM_MANAGER, TAG, "MESSAGE: EVENT_STA_LEASE_EXPIRED");
+
+				/* um aviso que chegou depois de uma nova tentativa de conexão é de um aluguel que não está mais em uso */
+				if((uint32_t)(uintptr_t)msg.param == wifi_manager_lease_generation && wifi_manager_sta_ip_source == STA_IP_SOURCE_LEASE_REUSE){
+
+					/* o aluguel reutilizado expirou: o cliente DHCP renova o endereço a partir de agora */
+					ESP_LOGI(TAG, "Reused DHCP lease expired. Handing the STA interface back to the DHCP client.");
+					wifi_manager_sta_ip_source = STA_IP_SOURCE_DHCP;
+					esp_netif_dhcpc_start(esp_netif_sta);
 
 					/* callback */
-					if(cb_ptr_arr[msg.code]) (*cb_ptr_arr[msg.code])(NULL);
+					wifi_manager_publish(&msg);
 				}
 
 				break;
 
 			case WM_EVENT_STA_GOT_IP:
 				ESP_LOGI(TAG, "WM_EVENT_STA_GOT_IP");
-				ip_event_got_ip_t* ip_event_got_ip = (ip_event_got_ip_t*)msg.param; 
+				ip_event_got_ip_t* ip_event_got_ip = &msg.event.got_ip;
 				uxBits = xEventGroupGetBits(wifi_manager_event_group);
 
 				/* redefinir a conexão solicita bits - não importa se foi definida ou não */
 				xEventGroupClearBits(wifi_manager_event_group, WIFI_MANAGER_REQUEST_STA_CONNECT_BIT);
 
+				/* tempo do boot (ou despertar) até o primeiro IP, com ou sem retomada rápida */
+				if(wifi_manager_wake_stats.connected_us == 0){
+					wifi_manager_wake_stats.connected_us = esp_timer_get_time();
+					ESP_LOGI(TAG, "Wake to connected: %d ms (%s, config loaded in %d us)", (int)(wifi_manager_wake_stats.connected_us / 1000),
+							wifi_manager_wake_stats.fast_resume ? "RTC fast resume" : "NVS restore", (int)wifi_manager_wake_stats.restore_us);
+					wifi_manager_boot_end(wifi_manager_boot_connect_phase);
+					wifi_manager_boot_mark_first_ip();
+				}
+
 				/* salvar o IP como uma string para o host do servidor HTTP */
 				wifi_manager_safe_update_sta_ip_string(ip_event_got_ip->ip_info.ip.addr);
 
+				/* redes salvas: ainda não lidas se a configuração veio da memória RTC */
+				wifi_manager_finish_fast_resume();
+
+				/* tempo até o IP e histórico da rede salva */
+				wifi_manager_record_attempt_latency(true);
+				int64_t time_to_ip = wifi_manager_record_time_to_ip();
+				bool profile_changed = false;
+				int profile_idx = sta_profiles_upsert(wifi_manager_sta_profiles, WIFI_MANAGER_MAX_SAVED_NETWORKS, wifi_manager_config_sta->sta.ssid, wifi_manager_config_sta->sta.password, &profile_changed);
+				if(profile_idx >= 0 && sta_profiles_record_success(&wifi_manager_sta_profiles[profile_idx], (uint32_t)(time_to_ip / 1000), wifi_manager_wall_clock())){
+					profile_changed = true;
+				}
+				if(profile_changed){
+					wifi_manager_sta_profiles_dirty = true;
+				}
+				wifi_manager_sta_profiles_tried = 0;
+
 				/* salvar configuração wi-fi em NVS se não foi restaurada de uma conexão */
 				if(uxBits & WIFI_MANAGER_REQUEST_RESTORE_STA_BIT){
 					xEventGroupClearBits(wifi_manager_event_group, WIFI_MANAGER_REQUEST_RESTORE_STA_BIT);
+
+					/* a rede atual pode ter mudado (seleção entre as redes salvas) ou o seu histórico precisa ser gravado */
+					if(wifi_manager_sta_profiles_dirty){
+						wifi_manager_save_sta_config();
+					}
 				}
 				else{
 					wifi_manager_save_sta_config();
+
+					/* credenciais novas digitadas pelo usuário: grave sem esperar o intervalo de agrupamento */
+					if(uxBits & WIFI_MANAGER_REQUEST_STA_CONNECT_BIT){
+						nvs_writer_flush(0);
+					}
 				}
 
 				/* redefinir o número de tentativas */
-				retries = 0;
+				conn_fsm_dispatch(&wifi_manager_fsm, WM_EVENT_STA_GOT_IP, 0);
+
+				/* guardar BSSID/canal/modo de autenticação para a próxima reconexão rápida */
+				wifi_manager_save_sta_cache();
+
+				/* aluguel DHCP */
+				if(wifi_manager_sta_ip_source == STA_IP_SOURCE_DHCP){
+					wifi_manager_save_sta_lease(&ip_event_got_ip->ip_info);
+				}
+				else if(wifi_manager_sta_ip_source == STA_IP_SOURCE_LEASE_REUSE && wifi_manager_lease_timer){
+					/* devolva a interface ao cliente DHCP quando o aluguel reutilizado expirar */
+					int64_t remaining = wifi_manager_sta_lease.expiry - wifi_manager_wall_clock();
+					int64_t ticks = (remaining > 0 ? remaining : 1) * (int64_t)configTICK_RATE_HZ;
+					/* o período cabe em TickType_t; um aviso antecipado só devolve a interface ao DHCP mais cedo */
+					if(ticks > (int64_t)(portMAX_DELAY / 2)) ticks = (int64_t)(portMAX_DELAY / 2);
+					vTimerSetTimerID( wifi_manager_lease_timer, (void*)(uintptr_t)wifi_manager_lease_generation );
+					xTimerChangePeriod( wifi_manager_lease_timer, (TickType_t)ticks, (TickType_t)0 );
+				}
+
+				/* memória RTC para o próximo despertar do deep sleep */
+				wifi_manager_store_rtc_resume();
 
 				/* atualize JSON com o novo IP */
 				if(wifi_manager_lock_json_buffer( portMAX_DELAY )){
@@ -1303,22 +2993,22 @@ void wifi_manager( void * pvParameters ){
 				}
 
 				/* retorno de chamada e memória livre alocada para o parâmetro void * */
-				if(cb_ptr_arr[msg.code]) (*cb_ptr_arr[msg.code])( msg.param );
-				free(ip_event_got_ip);
+				wifi_manager_publish(&msg);
 
 				break;
 
 			case WM_ORDER_DISCONNECT_STA:
-				ESP_LOGI(TAG, "MESSAGE: ORDER_DISCONNECT_STA");
+				WM_LOGI(LOG_SUBSYSTEM_MANAGER, TAG, "MESSAGE: ORDER_DISCONNECT_STA");
 
 				/* preciso, isso vem de uma solicitação do usuário */
 				xEventGroupSetBits(wifi_manager_event_group, WIFI_MANAGER_REQUEST_DISCONNECT_BIT);
+				conn_fsm_dispatch(&wifi_manager_fsm, WM_ORDER_DISCONNECT_STA, 0);
 
 				/* pedir disconect wi-fi */
 				ESP_ERROR_CHECK(esp_wifi_disconnect());
 
 				/* callback */
-				if(cb_ptr_arr[msg.code]) (*cb_ptr_arr[msg.code])(NULL);
+				wifi_manager_publish(&msg);
 
 				break;
 
@@ -1326,6 +3016,9 @@ void wifi_manager( void * pvParameters ){
 				break;
 
 			} /* end of switch/case */
+
+			wifi_manager_record_msg_stats(msg.code, dequeued_us - msg.enqueued_us, (uint32_t)esp_timer_get_time() - dequeued_us);
+			TASK_TRACE_END("dispatch", (int16_t)msg.code);
 		} /* end of if status=pdPASS */
 	} /* end of for loop */
 
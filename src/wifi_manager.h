@@ -33,6 +33,12 @@ Contém a tarefa freeRTOS e todo o suporte necessário
 #define WIFI_MANAGER_H_INCLUDED
 
 #include <stdbool.h>
+#include "message_codes.h"
+#include "boot_profile.h"
+#include "latency_hist.h"
+#include "async_log.h"
+#include "task_trace.h"
+#include "task_config.h"
 
 
 #ifdef __cplusplus
@@ -74,6 +80,26 @@ extern "C" {
  */
 #define WIFI_MANAGER_RETRY_TIMER			CONFIG_WIFI_MANAGER_RETRY_TIMER
 
+/**
+ * @brief Ativa o recuo exponencial com jitter completo entre as tentativas de reconexão.
+ * A tentativa n espera um tempo aleatório entre 0 e min(WIFI_MANAGER_RETRY_BACKOFF_CAP, WIFI_MANAGER_RETRY_TIMER * 2^n) ms.
+ * Caso contrário, toda tentativa espera WIFI_MANAGER_RETRY_TIMER ms.
+ * @see wifi_manager_set_retry_policy
+ */
+#ifdef CONFIG_WIFI_MANAGER_RETRY_POLICY_BACKOFF
+#define WIFI_MANAGER_RETRY_BACKOFF			1
+#define WIFI_MANAGER_RETRY_BACKOFF_CAP		CONFIG_WIFI_MANAGER_RETRY_BACKOFF_CAP
+#else
+#define WIFI_MANAGER_RETRY_BACKOFF			0
+#define WIFI_MANAGER_RETRY_BACKOFF_CAP		CONFIG_WIFI_MANAGER_RETRY_TIMER
+#endif
+
+/**
+ * @brief Número máximo de redes salvas.
+ * Na restauração, e antes de desistir e iniciar o próprio ponto de acesso, o gerenciador escolhe a melhor rede salva visível.
+ */
+#define WIFI_MANAGER_MAX_SAVED_NETWORKS	CONFIG_WIFI_MANAGER_MAX_SAVED_NETWORKS
+
 
 /**
  * @brief Time (in ms) esperar antes de desligar o AP
@@ -82,6 +108,172 @@ extern "C" {
 #define WIFI_MANAGER_SHUTDOWN_AP_TIMER		CONFIG_WIFI_MANAGER_SHUTDOWN_AP_TIMER
 
 
+/**
+ * @brief Ativa a reconexão rápida usando o BSSID, o canal e o modo de autenticação da última associação bem-sucedida.
+ * Quando ativado, a restauração e as reconexões automáticas conectam diretamente no AP conhecido, sem varredura de todos os canais.
+ * Se essa tentativa direta falhar, uma nova tentativa com varredura completa é feita imediatamente.
+ */
+#ifdef CONFIG_WIFI_MANAGER_FAST_RECONNECT
+#define WIFI_MANAGER_FAST_RECONNECT			1
+#else
+#define WIFI_MANAGER_FAST_RECONNECT			0
+#endif
+
+
+/**
+ * @brief Ativa a reutilização do último aluguel DHCP na restauração.
+ * O IP, a máscara, o gateway e o DNS são aplicados imediatamente e o cliente DHCP só volta a rodar quando o aluguel expira.
+ */
+#ifdef CONFIG_WIFI_MANAGER_LEASE_REUSE
+#define WIFI_MANAGER_LEASE_REUSE			1
+#define WIFI_MANAGER_LEASE_REUSE_MAX_AGE	CONFIG_WIFI_MANAGER_LEASE_REUSE_MAX_AGE
+#else
+#define WIFI_MANAGER_LEASE_REUSE			0
+#define WIFI_MANAGER_LEASE_REUSE_MAX_AGE	0
+#endif
+
+
+/**
+ * @brief Ativa a retomada rápida a partir da memória RTC ao acordar do deep sleep.
+ * A configuração necessária para reconectar é mantida na memória RTC e o NVS só é lido depois da primeira tentativa de conexão.
+ * @see rtc_resume.h
+ */
+#ifdef CONFIG_WIFI_MANAGER_FAST_RESUME
+#define WIFI_MANAGER_FAST_RESUME			1
+#else
+#define WIFI_MANAGER_FAST_RESUME			0
+#endif
+
+
+/**
+ * @brief Mantém a configuração somente em RAM, sem nenhuma gravação no flash. Ela se perde a cada reset.
+ * Caso contrário, a configuração é gravada no NVS.
+ * @see storage.h
+ */
+#ifdef CONFIG_WIFI_MANAGER_STORAGE_RAM
+#define WIFI_MANAGER_STORAGE_RAM			1
+#else
+#define WIFI_MANAGER_STORAGE_RAM			0
+#endif
+
+
+/**
+ * @brief Tempo, em ms, sem novas mudanças antes que a configuração pendente seja gravada no flash.
+ * @see wifi_manager_flush_config
+ */
+#define WIFI_MANAGER_PERSIST_DEBOUNCE		CONFIG_WIFI_MANAGER_PERSIST_DEBOUNCE
+
+/**
+ * @brief Capacidade da fila de mensagens do wifi_manager.
+ * Quem posta nunca bloqueia: quando a fila está cheia a mensagem é descartada e contada.
+ * @see wifi_manager_get_queue_stats
+ */
+#define WIFI_MANAGER_QUEUE_DEPTH			CONFIG_WIFI_MANAGER_QUEUE_DEPTH
+
+/**
+ * @brief Grava as mensagens tratadas pelo wifi_manager em um buffer circular, para reprodução no host.
+ * @see wifi_manager_get_trace
+ * @see msg_trace.h
+ */
+#ifdef CONFIG_WIFI_MANAGER_TRACE
+#define WIFI_MANAGER_TRACE					1
+#define WIFI_MANAGER_TRACE_DEPTH			CONFIG_WIFI_MANAGER_TRACE_DEPTH
+#else
+#define WIFI_MANAGER_TRACE					0
+#define WIFI_MANAGER_TRACE_DEPTH			0
+#endif
+
+/**
+ * @brief Linha do tempo da atividade das tarefas (mensagens, DNS, HTTP, mutexes), servida em /timeline.json.
+ * @see task_trace.h
+ */
+#ifdef CONFIG_WIFI_MANAGER_TASK_TRACE
+#define WIFI_MANAGER_TASK_TRACE				1
+#define WIFI_MANAGER_TASK_TRACE_DEPTH		CONFIG_WIFI_MANAGER_TASK_TRACE_DEPTH
+#else
+#define WIFI_MANAGER_TASK_TRACE				0
+#define WIFI_MANAGER_TASK_TRACE_DEPTH		0
+#endif
+
+/**
+ * @brief Log assíncrono dos caminhos quentes (DNS, HTTP, loop do gerenciador) em um buffer circular.
+ * Desativado, WM_LOGx é o ESP_LOGx de sempre.
+ * @see async_log.h
+ */
+#ifdef CONFIG_WIFI_MANAGER_ASYNC_LOG
+#define WIFI_MANAGER_ASYNC_LOG				1
+#define WIFI_MANAGER_ASYNC_LOG_DEPTH		CONFIG_WIFI_MANAGER_ASYNC_LOG_DEPTH
+#ifdef CONFIG_WIFI_MANAGER_ASYNC_LOG_UART
+#define WIFI_MANAGER_ASYNC_LOG_UART			1
+#else
+#define WIFI_MANAGER_ASYNC_LOG_UART			0
+#endif
+#ifdef CONFIG_WIFI_MANAGER_ASYNC_LOG_HTTP
+#define WIFI_MANAGER_ASYNC_LOG_HTTP			1
+#else
+#define WIFI_MANAGER_ASYNC_LOG_HTTP			0
+#endif
+#else
+#define WIFI_MANAGER_ASYNC_LOG				0
+#define WIFI_MANAGER_ASYNC_LOG_DEPTH		0
+#define WIFI_MANAGER_ASYNC_LOG_UART			0
+#define WIFI_MANAGER_ASYNC_LOG_HTTP			0
+#endif
+
+#if WIFI_MANAGER_ASYNC_LOG
+#define WM_LOGE(subsystem, tag, format, ...)	async_log_write(subsystem, ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define WM_LOGW(subsystem, tag, format, ...)	async_log_write(subsystem, ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define WM_LOGI(subsystem, tag, format, ...)	async_log_write(subsystem, ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define WM_LOGD(subsystem, tag, format, ...)	async_log_write(subsystem, ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#else
+#define WM_LOGE(subsystem, tag, format, ...)	ESP_LOGE(tag, format, ##__VA_ARGS__)
+#define WM_LOGW(subsystem, tag, format, ...)	ESP_LOGW(tag, format, ##__VA_ARGS__)
+#define WM_LOGI(subsystem, tag, format, ...)	ESP_LOGI(tag, format, ##__VA_ARGS__)
+#define WM_LOGD(subsystem, tag, format, ...)	ESP_LOGD(tag, format, ##__VA_ARGS__)
+#endif
+
+/**
+ * @brief Topologia padrão das tarefas: núcleo (-1 para nenhum), tamanhos das pilhas e alocação estática.
+ * @see wifi_manager_get_default_topology
+ */
+#define WIFI_MANAGER_TASK_CORE				CONFIG_WIFI_MANAGER_TASK_CORE
+#define WIFI_MANAGER_TASK_STACK				CONFIG_WIFI_MANAGER_TASK_STACK
+#define WIFI_MANAGER_DNS_TASK_STACK			CONFIG_WIFI_MANAGER_DNS_TASK_STACK
+#define WIFI_MANAGER_HTTPD_TASK_STACK		CONFIG_WIFI_MANAGER_HTTPD_TASK_STACK
+#define WIFI_MANAGER_SUBSCRIBER_TASK_STACK	CONFIG_WIFI_MANAGER_SUBSCRIBER_TASK_STACK
+#define WIFI_MANAGER_NVS_WRITER_TASK_STACK	CONFIG_WIFI_MANAGER_NVS_WRITER_TASK_STACK
+#ifdef CONFIG_WIFI_MANAGER_ASYNC_LOG_TASK_STACK
+#define WIFI_MANAGER_ASYNC_LOG_TASK_STACK	CONFIG_WIFI_MANAGER_ASYNC_LOG_TASK_STACK
+#else
+#define WIFI_MANAGER_ASYNC_LOG_TASK_STACK	3072
+#endif
+#ifdef CONFIG_WIFI_MANAGER_TASK_STATIC
+#define WIFI_MANAGER_TASK_STATIC			1
+#else
+#define WIFI_MANAGER_TASK_STATIC			0
+#endif
+
+/**
+ * @brief Libera o servidor HTTP, os registros de AP, os buffers JSON e os URLs quando o AP é desligado; tudo volta no próximo WM_ORDER_START_AP.
+ */
+#ifdef CONFIG_WIFI_MANAGER_PORTAL_RELEASE
+#define WIFI_MANAGER_PORTAL_RELEASE			1
+#else
+#define WIFI_MANAGER_PORTAL_RELEASE			0
+#endif
+
+/**
+ * @brief Toda a memória do componente reservada no link: nenhuma alocação do heap depois de wifi_manager_start.
+ * WIFI_MANAGER_HTTP_SCRATCH_SIZE é o buffer de uma requisição HTTP.
+ */
+#ifdef CONFIG_WIFI_MANAGER_STATIC_ALLOC
+#define WIFI_MANAGER_STATIC_ALLOC			1
+#define WIFI_MANAGER_HTTP_SCRATCH_SIZE		CONFIG_WIFI_MANAGER_HTTP_SCRATCH_SIZE
+#else
+#define WIFI_MANAGER_STATIC_ALLOC			0
+#define WIFI_MANAGER_HTTP_SCRATCH_SIZE		0
+#endif
+
 /** @brief Define a prioridade da tarefa do wifi_manager.
  *
  * As tarefas geradas pelo gerenciador terão prioridade WIFI_MANAGER_TASK_PRIORITY-1.
@@ -130,7 +322,7 @@ extern "C" {
 
 
 
-/** @brief Define o endereço IP padrão do ponto de acesso. Padrão: "10.10.0.1 * /
+/** @brief Define o endereço IP padrão do ponto de acesso. Padrão: "10.10.0.1" */
 #define DEFAULT_AP_IP						CONFIG_DEFAULT_AP_IP
 
 /** @brief Define o gateway do ponto de acesso. Deve ser igual ao seu IP. Padrão: "10.10.0.1" */
@@ -192,35 +384,6 @@ extern "C" {
 #define WPA2_MINIMUM_PASSWORD_LENGTH		8
 
 
-/**
- * @brief Define a lista completa de todas as mensagens que o wifi_manager pode processar.
- *
- * Algumas dessas mensagens são eventos ("EVENTO") e algumas delas são ações ("PEDIDO")
- * Cada uma dessas mensagens pode acionar uma função de retorno de chamada e cada função de retorno é armazenada
- * em uma matriz de ponteiro de função por conveniência. Por causa desse comportamento, é extremamente importante
- * para manter uma sequência estrita e o elemento especial de nível superior 'MESSAGE_CODE_COUNT'
- *
- * @see wifi_manager_set_callback
- */
-typedef enum message_code_t {
-	NONE = 0,
-	WM_ORDER_START_HTTP_SERVER = 1,
-	WM_ORDER_STOP_HTTP_SERVER = 2,
-	WM_ORDER_START_DNS_SERVICE = 3,
-	WM_ORDER_STOP_DNS_SERVICE = 4,
-	WM_ORDER_START_WIFI_SCAN = 5,
-	WM_ORDER_LOAD_AND_RESTORE_STA = 6,
-	WM_ORDER_CONNECT_STA = 7,
-	WM_ORDER_DISCONNECT_STA = 8,
-	WM_ORDER_START_AP = 9,
-	WM_EVENT_STA_DISCONNECTED = 10,
-	WM_EVENT_SCAN_DONE = 11,
-	WM_EVENT_STA_GOT_IP = 12,
-	WM_ORDER_STOP_AP = 13,
-	WM_MESSAGE_CODE_COUNT = 14 /* important for the callback array */
-
-}message_code_t;
-
 /**
  * @brief códigos de motivo simplificados para uma conexão perdida.
  *
@@ -233,13 +396,15 @@ typedef enum update_reason_code_t {
 	UPDATE_LOST_CONNECTION = 3
 }update_reason_code_t;
 
-typedef enum connection_request_made_by_code_t{
-	CONNECTION_REQUEST_NONE = 0,
-	CONNECTION_REQUEST_USER = 1,
-	CONNECTION_REQUEST_AUTO_RECONNECT = 2,
-	CONNECTION_REQUEST_RESTORE_CONNECTION = 3,
-	CONNECTION_REQUEST_MAX = 0x7fffffff /*forçar a criação deste enum como um 32 bit int */
-}connection_request_made_by_code_t;
+/**
+ * @brief Origem da configuração IP da STA em uma conexão.
+ */
+typedef enum sta_ip_source_code_t{
+	STA_IP_SOURCE_DHCP = 0,
+	STA_IP_SOURCE_STATIC = 1,
+	STA_IP_SOURCE_LEASE_REUSE = 2,
+	STA_IP_SOURCE_COUNT = 3
+}sta_ip_source_code_t;
 
 /**
  * As configurações reais de WiFi em uso
@@ -257,13 +422,205 @@ struct wifi_settings_t{
 };
 extern struct wifi_settings_t wifi_settings;
 
+/**
+ * @brief Dados da última associação bem-sucedida, usados para a reconexão rápida.
+ *
+ * Só são aplicados se o SSID guardado for igual ao SSID da configuração STA atual.
+ * @see WIFI_MANAGER_FAST_RECONNECT
+ */
+struct wifi_sta_cache_t{
+	uint8_t ssid[MAX_SSID_SIZE];
+	uint8_t bssid[6];
+	uint8_t channel;
+	wifi_auth_mode_t authmode;
+};
+
+
+/**
+ * @brief Último aluguel DHCP obtido, reaproveitado quando WIFI_MANAGER_LEASE_REUSE está ativado.
+ * expiry e acquired são em segundos, no relógio do sistema (time()). expiry é o fim do aluguel concedido pelo servidor,
+ * limitado a WIFI_MANAGER_LEASE_REUSE_MAX_AGE.
+ */
+struct wifi_sta_lease_t{
+	uint8_t ssid[MAX_SSID_SIZE];
+	esp_netif_ip_info_t ip_info;
+	esp_ip4_addr_t dns;
+	int64_t acquired;
+	int64_t expiry;
+};
+
+/**
+ * @brief Estatísticas do tempo entre a ordem de conexão e a obtenção do IP, por origem da configuração IP.
+ */
+struct wifi_manager_time_to_ip_t{
+	uint32_t count;
+	int64_t last_us;
+	int64_t min_us;
+	int64_t max_us;
+	int64_t total_us;
+};
+
+/**
+ * @brief Fases de uma tentativa de conexão. O driver não publica eventos entre a varredura/sondagem, a autenticação,
+ * a associação e o handshake de 4 vias: essas etapas formam juntas a fase de enlace, até WIFI_EVENT_STA_CONNECTED.
+ */
+typedef enum wifi_manager_latency_phase_t{
+	WIFI_MANAGER_LATENCY_LINK = 0,		/* esp_wifi_connect até WIFI_EVENT_STA_CONNECTED */
+	WIFI_MANAGER_LATENCY_DHCP = 1,		/* WIFI_EVENT_STA_CONNECTED até IP_EVENT_STA_GOT_IP */
+	WIFI_MANAGER_LATENCY_TOTAL = 2,		/* esp_wifi_connect até IP_EVENT_STA_GOT_IP */
+	WIFI_MANAGER_LATENCY_FAILED = 3,	/* esp_wifi_connect até WIFI_EVENT_STA_DISCONNECTED, para as tentativas que falharam */
+	WIFI_MANAGER_LATENCY_PHASE_COUNT = 4
+}wifi_manager_latency_phase_t;
+
+/** @brief uma entrada por origem de tentativa: CONNECTION_REQUEST_USER, _AUTO_RECONNECT e _RESTORE_CONNECTION, nesta ordem */
+#define WIFI_MANAGER_LATENCY_ORIGINS		3
+
+/**
+ * @brief Histogramas de latência por tentativa de conexão, em ms, para uma origem.
+ */
+struct wifi_manager_conn_latency_t{
+	struct latency_hist_t phases[WIFI_MANAGER_LATENCY_PHASE_COUNT];
+};
+
+
+/**
+ * @brief Contadores da fila de mensagens do wifi_manager.
+ */
+struct wifi_manager_queue_stats_t{
+	uint16_t depth;				/* capacidade da fila */
+	uint16_t pending;			/* mensagens aguardando agora */
+	uint16_t high_water;		/* maior ocupação já vista */
+	uint32_t queued;			/* mensagens que entraram na fila */
+	uint32_t coalesced;			/* mensagens fundidas com uma igual já pendente */
+	uint32_t dropped;			/* mensagens descartadas com a fila cheia */
+};
+
+/**
+ * @brief Tempo gasto pelo loop do wifi_manager com um código de mensagem.
+ */
+struct wifi_manager_msg_stats_t{
+	uint32_t count;				/* mensagens tratadas */
+	uint64_t handler_us;		/* tempo no tratamento, sem os callbacks */
+	uint32_t handler_max_us;
+	uint64_t callback_us;		/* tempo nos callbacks e assinantes síncronos */
+	uint32_t callback_max_us;
+	uint64_t wait_us;			/* espera na fila, do enfileiramento até a retirada */
+	uint32_t wait_max_us;
+};
+
+/**
+ * @brief Memória devolvida pelo modo WIFI_MANAGER_PORTAL_RELEASE.
+ */
+struct wifi_manager_portal_stats_t{
+	bool released;				/* os recursos do portal estão liberados agora */
+	uint32_t releases;			/* vezes que os recursos do portal foram liberados */
+	uint32_t buffer_bytes;		/* registros de AP, buffers JSON e URLs liberados da última vez, valor exato */
+	int32_t heap_reclaimed;		/* aumento do heap livre desde a última liberação, incluindo o servidor HTTP. Medido na leitura
+								 * enquanto o portal está liberado e congelado quando ele volta; outras alocações entram na conta */
+};
+
+/**
+ * @brief Tarefas criadas pelo componente.
+ */
+typedef enum wifi_manager_task_t{
+	WIFI_MANAGER_TASK_MANAGER = 0,
+	WIFI_MANAGER_TASK_DNS = 1,
+	WIFI_MANAGER_TASK_HTTPD = 2,		/* criada pelo esp_http_server: a alocação é sempre dinâmica */
+	WIFI_MANAGER_TASK_SUBSCRIBER = 3,	/* uma por assinante WIFI_MANAGER_DISPATCH_TASK: a alocação é sempre dinâmica */
+	WIFI_MANAGER_TASK_NVS_WRITER = 4,
+	WIFI_MANAGER_TASK_ASYNC_LOG = 5,
+	WIFI_MANAGER_TASK_COUNT = 6
+}wifi_manager_task_t;
+
+/**
+ * @brief Núcleo, pilha, prioridade e alocação de cada tarefa do componente.
+ */
+struct wifi_manager_topology_t{
+	struct task_config_t tasks[WIFI_MANAGER_TASK_COUNT];
+};
+
+/**
+ * @brief Estado de uma tarefa do componente, para dimensionar as pilhas a partir de dados.
+ */
+struct wifi_manager_task_stats_t{
+	const char *name;
+	bool running;
+	bool static_alloc;
+	BaseType_t core_id;
+	UBaseType_t priority;
+	uint32_t stack_size;
+	uint32_t stack_free_min;	/* menor folga de pilha já vista (high water mark), em bytes; 0 se a tarefa não está rodando */
+};
+
+/**
+ * @brief Bits de estado que podem ser esperados com wifi_manager_wait_for.
+ * São os mesmos bits do grupo de eventos interno do wifi_manager.
+ */
+#define WIFI_MANAGER_STATE_CONNECTED		( 1 << 0 )		/*!< a STA está conectada e tem um IP */
+#define WIFI_MANAGER_STATE_AP_STARTED		( 1 << 2 )		/*!< o ponto de acesso está ativo */
+#define WIFI_MANAGER_STATE_DISCONNECTED		( 1 << 4 )		/*!< a STA não está conectada */
+#define WIFI_MANAGER_STATE_SCANNING			( 1 << 7 )		/*!< uma varredura está em andamento */
+#define WIFI_MANAGER_STATE_ALL				( WIFI_MANAGER_STATE_CONNECTED | WIFI_MANAGER_STATE_AP_STARTED | WIFI_MANAGER_STATE_DISCONNECTED | WIFI_MANAGER_STATE_SCANNING )
+
+/**
+ * @brief Retrato do estado da conexão.
+ * @see wifi_manager_get_status
+ */
+struct wifi_manager_status_t{
+	bool connected;
+	bool ap_started;
+	char ssid[MAX_SSID_SIZE+1];
+	uint8_t bssid[6];
+	uint8_t channel;
+	int8_t rssi;						/* medido na conexão e a cada varredura */
+	esp_netif_ip_info_t ip_info;
+	uint8_t last_disconnect_reason;		/* 0 se a STA nunca foi desconectada */
+	int64_t connected_us;				/* há quanto tempo a STA está conectada, 0 se não está */
+	int64_t uptime_us;					/* tempo desde a inicialização */
+};
+
+/**
+ * @brief Onde o retorno de chamada de um assinante é executado.
+ */
+typedef enum wifi_manager_dispatch_t{
+	WIFI_MANAGER_DISPATCH_INLINE = 0,	/*!< na própria tarefa wifi_manager, que espera o retorno */
+	WIFI_MANAGER_DISPATCH_TASK = 1		/*!< em uma tarefa do assinante, alimentada por uma fila limitada */
+}wifi_manager_dispatch_t;
+
+/**
+ * @brief Estatísticas de um assinante: quanto tempo o seu retorno de chamada leva.
+ */
+struct wifi_manager_subscriber_stats_t{
+	message_code_t code;
+	wifi_manager_dispatch_t dispatch;
+	uint32_t calls;
+	uint32_t dropped;			/* mensagens descartadas com a fila do assinante cheia */
+	int64_t last_us;			/* duração da última chamada */
+	int64_t max_us;
+	int64_t total_us;
+	int64_t max_wait_us;		/* maior espera na fila do assinante antes da chamada, apenas WIFI_MANAGER_DISPATCH_TASK */
+	uint32_t stack_free_min;	/* menor folga de pilha já vista da tarefa do assinante, em bytes, apenas WIFI_MANAGER_DISPATCH_TASK */
+};
+
+/**
+ * @brief Cópia dos dados de um evento esp_event, transportada por valor dentro da mensagem.
+ * Evita um malloc/free por evento, o que fragmentava o heap em enlaces instáveis.
+ */
+typedef union{
+	wifi_event_sta_scan_done_t scan_done;				/*!< WM_EVENT_SCAN_DONE */
+	wifi_event_sta_disconnected_t sta_disconnected;		/*!< WM_EVENT_STA_DISCONNECTED */
+	ip_event_got_ip_t got_ip;							/*!< WM_EVENT_STA_GOT_IP */
+} queue_message_event_t;
 
 /**
  * @brief Estrutura usada para armazenar uma mensagem na fila.
+ * Ordens usam param; eventos do driver usam event.
  */
 typedef struct{
 	message_code_t code;
 	void *param;
+	queue_message_event_t event;
+	uint32_t enqueued_us;		/*!< instante (esp_timer, 32 bits) em que a mensagem entrou na fila */
 } queue_message;
 
 
@@ -283,6 +640,34 @@ esp_netif_t* wifi_manager_get_esp_netif_ap();
  */
 void wifi_manager_start();
 
+/**
+ * @brief Como wifi_manager_start, com núcleo, pilha, prioridade e alocação escolhidos para cada tarefa.
+ * @param topology copiada; NULL usa wifi_manager_get_default_topology.
+ */
+void wifi_manager_start_with_topology(const struct wifi_manager_topology_t *topology);
+
+/**
+ * @brief Preenche a topologia definida no menuconfig, para ser ajustada antes de wifi_manager_start_with_topology.
+ */
+void wifi_manager_get_default_topology(struct wifi_manager_topology_t *topology);
+
+/**
+ * @brief A configuração em uso para uma tarefa do componente.
+ */
+const struct task_config_t* wifi_manager_get_task_config(wifi_manager_task_t task);
+
+/**
+ * @brief Lê o estado das tarefas do componente, incluindo a menor folga de pilha já vista.
+ * A linha WIFI_MANAGER_TASK_SUBSCRIBER não tem tarefa: a folga de cada assinante está em wifi_manager_get_subscriber_stats.
+ */
+void wifi_manager_get_task_stats(struct wifi_manager_task_stats_t stats[WIFI_MANAGER_TASK_COUNT]);
+
+/**
+ * @brief Serializa o estado das tarefas em JSON, como servido em /tasks.json.
+ * @return o tamanho do JSON, sem o terminador. Nada é escrito se buf for NULL ou menor que esse tamanho + 1.
+ */
+size_t wifi_manager_get_task_stats_json(char *buf, size_t len);
+
 /**
  * Libera toda a memória alocada pelo wifi_manager e elimina a tarefa.
  */
@@ -299,18 +684,85 @@ void filter_unique( wifi_ap_record_t * aplist, uint16_t * ap_num);
 void wifi_manager( void * pvParameters );
 
 
+/**
+ * @brief Os buffers JSON. Com WIFI_MANAGER_PORTAL_RELEASE, NULL enquanto os recursos do portal estão liberados.
+ */
 char* wifi_manager_get_ap_list_json();
 char* wifi_manager_get_ip_info_json();
 
+/**
+ * @brief Lê quanto o modo WIFI_MANAGER_PORTAL_RELEASE devolveu ao heap.
+ */
+void wifi_manager_get_portal_stats(struct wifi_manager_portal_stats_t *stats);
+
 
 void wifi_manager_scan_async();
 
 
+/**
+ * @brief Tempo e volume das leituras e gravações da configuração no flash.
+ */
+struct wifi_manager_nvs_stats_t{
+	uint32_t saves;				/* gravações do registro pedidas */
+	uint32_t skipped_saves;		/* gravações evitadas porque nada mudou */
+	uint32_t coalesced_saves;	/* gravações substituídas por uma mais nova antes do commit */
+	uint32_t commits;			/* commits NVS feitos pela tarefa de gravação */
+	uint32_t last_save_bytes;
+	int64_t last_save_us;		/* tempo gasto pela chamada de wifi_manager_save_sta_config */
+	int64_t last_commit_us;		/* duração do último commit na tarefa de gravação */
+	int64_t max_commit_us;
+	int64_t last_fetch_us;
+};
+
 /**
  * @brief salva a configuração atual do STA wifi no armazenamento de memória flash.
+ *
+ * Toda a configuração (rede STA, configurações do AP, IP estático e redes salvas) é gravada como um único registro
+ * versionado e protegido por CRC (ver config_record.h), em uma única operação NVS e apenas se algo mudou.
+ * A gravação é adiada: o registro é entregue à tarefa nvs_writer, que agrupa as gravações próximas e faz o commit
+ * em baixa prioridade. Use wifi_manager_flush_config quando a gravação precisa estar no flash.
  */
 esp_err_t wifi_manager_save_sta_config();
 
+/**
+ * @brief Grava no flash, imediatamente, a configuração cuja gravação ainda está pendente.
+ * @param xTicksToWait tempo máximo de espera pelo commit; 0 apenas antecipa o commit, sem esperar.
+ * @return o resultado do commit, ou ESP_ERR_TIMEOUT.
+ */
+esp_err_t wifi_manager_flush_config(TickType_t xTicksToWait);
+
+/**
+ * @brief Lê as estatísticas de acesso ao flash da configuração.
+ */
+void wifi_manager_get_nvs_stats(struct wifi_manager_nvs_stats_t *stats);
+
+/**
+ * @brief Tempo do boot (ou do despertar do deep sleep) até a primeira conexão, para comparar a retomada rápida com a restauração pelo NVS.
+ * Os tempos são os de esp_timer_get_time(), que começa a contar na inicialização: o tempo do bootloader não está incluído.
+ */
+struct wifi_manager_wake_stats_t{
+	bool fast_resume;			/* a configuração veio da memória RTC, sem leitura do NVS */
+	int64_t restore_us;			/* duração da carga da configuração salva */
+	int64_t connected_us;		/* instante do primeiro IP; 0 enquanto não houver conexão */
+};
+
+/**
+ * @brief Lê o tempo até a primeira conexão desde o boot.
+ */
+void wifi_manager_get_wake_stats(struct wifi_manager_wake_stats_t *stats);
+
+/**
+ * @brief Lê o perfil do boot: as fases de wifi_manager_start, da inicialização da tarefa wifi_manager e da primeira
+ * conexão (restauração da configuração, tentativas até o primeiro IP), com os instantes de esp_timer_get_time().
+ */
+void wifi_manager_get_boot_profile(struct boot_profile_t *profile);
+
+/**
+ * @brief Serializa o perfil do boot como trace JSON do Chrome, para abrir em chrome://tracing ou ui.perfetto.dev.
+ * @return o tamanho do JSON, sem o terminador. Nada é escrito se buf for NULL ou menor que esse tamanho + 1.
+ */
+size_t wifi_manager_get_boot_trace(char *buf, size_t len);
+
 /**
  * @brief buscar uma configuração Wi-Fi STA anterior no armazenamento de memória flash.
  * @return verdadeiro se uma configuração salva anteriormente for encontrada, falso caso contrário.
@@ -319,6 +771,35 @@ bool wifi_manager_fetch_wifi_sta_config();
 
 wifi_config_t* wifi_manager_get_wifi_sta_config();
 
+/**
+ * @brief salva o BSSID, o canal e o modo de autenticação do AP atualmente associado no armazenamento de memória flash.
+ * A gravação só acontece se esses dados mudaram desde a última vez.
+ */
+esp_err_t wifi_manager_save_sta_cache();
+
+/**
+ * @brief buscar os dados da última associação bem-sucedida no armazenamento de memória flash.
+ * @return verdadeiro se um cache válido for encontrado, falso caso contrário.
+ */
+bool wifi_manager_fetch_sta_cache();
+
+/**
+ * @brief copia as estatísticas de tempo até o IP, uma entrada por sta_ip_source_code_t.
+ * @param stats vetor com pelo menos STA_IP_SOURCE_COUNT elementos.
+ */
+void wifi_manager_get_time_to_ip_stats(struct wifi_manager_time_to_ip_t stats[STA_IP_SOURCE_COUNT]);
+
+/**
+ * @brief Copia os histogramas de latência das tentativas de conexão, por origem (índice origem - 1) e por fase.
+ */
+void wifi_manager_get_conn_latency(struct wifi_manager_conn_latency_t latency[WIFI_MANAGER_LATENCY_ORIGINS]);
+
+/**
+ * @brief Serializa os histogramas de latência das tentativas de conexão em JSON, como servido em /latency.json.
+ * @return o tamanho do JSON, sem o terminador. Nada é escrito se buf for NULL ou menor que esse tamanho + 1.
+ */
+size_t wifi_manager_get_conn_latency_json(char *buf, size_t len);
+
 
 /**
  * @brief solicita uma conexão a um ponto de acesso que será processado no thread de tarefa principal.
@@ -403,11 +884,94 @@ void wifi_manager_safe_update_sta_ip_string(uint32_t ip);
 
 /**
  * @brief Registre um retorno de chamada para uma função personalizada quando um evento específico message_code acontecer.
+ * Há um único retorno de chamada deste tipo por código, executado na tarefa wifi_manager; um novo registro substitui o anterior
+ * e NULL o remove.
+ * @see wifi_manager_subscribe para vários assinantes ou para tirar um retorno de chamada lento da tarefa wifi_manager.
  */
 void wifi_manager_set_callback(message_code_t message_code, void (*func_ptr)(void*) );
 
+/**
+ * @brief Assina um código de mensagem. Vários assinantes podem assinar o mesmo código.
+ * @param dispatch WIFI_MANAGER_DISPATCH_INLINE executa func_ptr na tarefa wifi_manager. WIFI_MANAGER_DISPATCH_TASK executa
+ * func_ptr em uma tarefa própria, de modo que um retorno de chamada lento não atrasa a reconexão.
+ * @param queue_depth tamanho da fila do assinante (apenas WIFI_MANAGER_DISPATCH_TASK). Com a fila cheia, as mensagens são descartadas.
+ * @return o identificador do assinante, ou -1 em caso de erro.
+ */
+int wifi_manager_subscribe(message_code_t code, void (*func_ptr)(void*), wifi_manager_dispatch_t dispatch, uint16_t queue_depth);
+
+/**
+ * @brief Cancela uma assinatura. As mensagens ainda pendentes na fila do assinante são descartadas.
+ */
+void wifi_manager_unsubscribe(int subscriber);
+
+/**
+ * @brief Lê as estatísticas de um assinante.
+ * @return ESP_OK, ou ESP_ERR_NOT_FOUND se o assinante não existe.
+ */
+esp_err_t wifi_manager_get_subscriber_stats(int subscriber, struct wifi_manager_subscriber_stats_t *stats);
+
+/**
+ * @brief Substitui a política de espera entre as tentativas de reconexão.
+ * A função recebe o número da tentativa (0 para a primeira) e retorna o tempo de espera em ms.
+ * Passar NULL restaura a política definida no menuconfig.
+ * @note É chamada a partir da tarefa wifi_manager e não deve bloquear.
+ */
+void wifi_manager_set_retry_policy(uint32_t (*policy)(uint32_t attempt));
+
+/**
+ * @brief Bloqueia a tarefa chamadora até que um dos bits de estado em state_mask esteja ativo.
+ * Exemplo: wifi_manager_wait_for(WIFI_MANAGER_STATE_CONNECTED, portMAX_DELAY) espera uma conexão sem nenhum loop de espera.
+ * @param state_mask combinação de WIFI_MANAGER_STATE_*.
+ * @return os bits de estado no momento do retorno; nenhum bit de state_mask se o tempo esgotou.
+ * Retorna 0 sem esperar se state_mask não contém nenhum bit de estado ou se wifi_manager_start ainda não foi chamada.
+ */
+uint32_t wifi_manager_wait_for(uint32_t state_mask, TickType_t timeout);
+
+/**
+ * @brief Copia o estado atual da conexão. Não bloqueia nem usa mutex: pode ser chamada de qualquer tarefa com frequência.
+ */
+void wifi_manager_get_status(struct wifi_manager_status_t *status);
+
+/**
+ * @brief Número de desconexões da STA registradas para um código de razão (wifi_event_sta_disconnected_t.reason).
+ */
+uint32_t wifi_manager_get_disconnect_count(uint8_t reason);
+
+/**
+ * @brief Código de razão da última desconexão da STA, 0 se nenhuma aconteceu.
+ */
+uint8_t wifi_manager_get_last_disconnect_reason();
+
 
 BaseType_t wifi_manager_send_message(message_code_t code, void *param);
+
+/**
+ * @brief Lê os contadores da fila de mensagens.
+ */
+void wifi_manager_get_queue_stats(struct wifi_manager_queue_stats_t *stats);
+
+/**
+ * @brief Copia o tempo gasto pelo loop do wifi_manager com cada código de mensagem.
+ */
+void wifi_manager_get_msg_stats(struct wifi_manager_msg_stats_t stats[WM_MESSAGE_CODE_COUNT]);
+
+/**
+ * @brief Serializa os contadores da fila e o tempo por código de mensagem em JSON, como servido em /loop.json.
+ * @return o tamanho do JSON, sem o terminador. Nada é escrito se buf for NULL ou menor que esse tamanho + 1.
+ */
+size_t wifi_manager_get_msg_stats_json(char *buf, size_t len);
+
+/**
+ * @brief Serializa o trace das mensagens tratadas (ver msg_trace.h), do mais antigo para o mais novo.
+ * @return o tamanho necessário; nada é escrito se buf for NULL ou pequeno demais. 0 se WIFI_MANAGER_TRACE estiver desativado.
+ */
+size_t wifi_manager_get_trace(uint8_t *buf, size_t len);
+
+/**
+ * @brief Posta um evento na fila copiando event_data para dentro da mensagem.
+ * @param size tamanho de event_data, no máximo sizeof(queue_message_event_t).
+ */
+BaseType_t wifi_manager_send_event(message_code_t code, const void *event_data, size_t size);
 BaseType_t wifi_manager_send_message_to_front(message_code_t code, void *param);
 
 #ifdef __cplusplus
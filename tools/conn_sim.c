@@ -0,0 +1,478 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file conn_sim.c
+@brief Simulação em host, com tempo virtual, da máquina de estados da conexão STA
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+/*
+ * Compilação e execução no host (nenhuma dependência do esp-idf):
+ *
+ *   cc -O2 -I../src -o conn_sim conn_sim.c ../src/conn_fsm.c ../src/disconnect_reason.c ../src/retry_policy.c ../src/boot_profile.c ../src/text_writer.c
+ *   ./conn_sim [trials] [seed] [trace.json]
+ *
+ * Cada ensaio é um boot com redes salvas e um ambiente sorteado: redes que demoram a aparecer ou nunca aparecem
+ * (roteador reiniciando), senha errada, AP que mudou de canal (a dica de BSSID/canal em cache falha), falhas
+ * transitórias e latências de varredura, associação e DHCP. A mesma conn_fsm.c do firmware recebe as mensagens;
+ * os efeitos colaterais viram eventos numa fila ordenada pelo tempo virtual, então milhares de ensaios levam segundos.
+ *
+ * O programa imprime, para a política fixa e para o recuo exponencial com jitter completo, os percentis do tempo até
+ * o IP e do tempo até o portal (AP iniciado), o número médio de tentativas e os ensaios que ficaram sem nenhum evento
+ * pendente sem estarem conectados (máquina travada). Sai com 1 se houver algum ensaio travado.
+ * Com trace.json, o primeiro ensaio da política fixa é gravado como trace JSON do Chrome (estados e tentativas),
+ * no mesmo formato que /boot.json, para abrir em chrome://tracing ou ui.perfetto.dev.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "conn_fsm.h"
+#include "retry_policy.h"
+#include "boot_profile.h"
+
+/* valores padrão do menuconfig */
+#define RETRY_TIMER_MS			5000
+#define RETRY_BACKOFF_CAP_MS	300000
+#define MAX_RETRY_START_AP		3
+
+/* fim de um ensaio em tempo virtual */
+#define HORIZON_MS				(30 * 60 * 1000)
+
+#define MAX_NETWORKS			3
+#define MAX_EVENTS				32
+
+typedef enum { POLICY_FIXED = 0, POLICY_BACKOFF = 1 } policy_t;
+
+typedef enum{
+	EV_MESSAGE = 0,			/* mensagem na fila do gerenciador */
+	EV_RETRY_TIMER = 1,		/* temporizador de nova tentativa */
+	EV_ATTEMPT_DONE = 2		/* resultado de uma associação: WM_EVENT_STA_DISCONNECTED ou WM_EVENT_STA_GOT_IP */
+}event_type_t;
+
+struct event_t{
+	int64_t time_ms;
+	uint32_t seq;			/* desempate: mensagens no mesmo instante saem na ordem em que foram postadas */
+	uint32_t gen;			/* temporizadores e associações canceladas são descartados pela geração */
+	uint8_t type;
+	uint8_t code;
+	uint32_t param;
+};
+
+struct network_t{
+	int64_t present_at_ms;	/* INT64_MAX: nunca aparece */
+	bool wrong_password;
+	bool moved;				/* mudou de canal: a tentativa direta falha */
+};
+
+struct sim_t{
+	struct conn_fsm_t fsm;
+	policy_t policy;
+	int64_t now_ms;
+	struct event_t events[MAX_EVENTS];
+	int event_count;
+	uint32_t seq;
+	uint32_t retry_gen;
+	uint32_t attempt_gen;
+
+	struct network_t networks[MAX_NETWORKS];
+	int network_count;
+	int current;			/* rede em wifi_manager_config_sta */
+	uint32_t tried;			/* equivalente a wifi_manager_sta_profiles_tried */
+	double transient_p;
+	uint32_t scan_ms, assoc_ms, dhcp_ms;
+
+	bool ap_started;
+	int64_t connected_at_ms;
+	int64_t portal_at_ms;
+	uint32_t attempts;
+	uint32_t events_handled;
+
+	/* linha do tempo do ensaio, se pedida: estados na linha 1, tentativas na linha 2 */
+	struct boot_profile_t *profile;
+	int state_phase;
+	int attempt_phase;
+	conn_state_t traced_state;
+};
+
+#define SIM_TRACK_STATE		1
+#define SIM_TRACK_ATTEMPT	2
+
+static uint32_t xorshift_state = 2463534242UL;
+static uint32_t xorshift32(){
+	uint32_t x = xorshift_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return xorshift_state = x;
+}
+
+static uint32_t uniform(uint32_t lo, uint32_t hi){
+	return lo + xorshift32() % (hi - lo + 1);
+}
+
+static bool chance(double p){
+	return (xorshift32() / 4294967296.0) < p;
+}
+
+static void schedule(struct sim_t *sim, uint32_t delay_ms, uint8_t type, uint8_t code, uint32_t param, uint32_t gen){
+	if(sim->event_count >= MAX_EVENTS){
+		fprintf(stderr, "event queue overflow\n");
+		exit(2);
+	}
+	struct event_t *e = &sim->events[sim->event_count++];
+	e->time_ms = sim->now_ms + delay_ms;
+	e->seq = sim->seq++;
+	e->gen = gen;
+	e->type = type;
+	e->code = code;
+	e->param = param;
+}
+
+static bool next_event(struct sim_t *sim, struct event_t *out){
+	int best = -1;
+	for(int i=0; i<sim->event_count; i++){
+		if(best < 0 || sim->events[i].time_ms < sim->events[best].time_ms ||
+				(sim->events[i].time_ms == sim->events[best].time_ms && sim->events[i].seq < sim->events[best].seq)){
+			best = i;
+		}
+	}
+	if(best < 0) return false;
+	*out = sim->events[best];
+	sim->events[best] = sim->events[--sim->event_count];
+	return true;
+}
+
+
+/* operações da máquina de estados, como em wifi_manager.c */
+
+static bool op_connect(void *ctx, uint8_t origin, bool use_hint){
+	struct sim_t *sim = (struct sim_t*)ctx;
+	struct network_t *net = &sim->networks[sim->current];
+	bool direct = use_hint;		/* o cache sempre existe: todas as redes já conectaram antes */
+	uint32_t gen = ++sim->attempt_gen;
+	uint32_t search_ms = direct ? 50 : sim->scan_ms;
+
+	sim->attempts++;
+	if(sim->profile){
+		static const char* const origins[] = { "attempt", "attempt (user)", "attempt (auto)", "attempt (restore)" };
+		boot_profile_end(sim->profile, sim->attempt_phase, sim->now_ms * 1000);
+		sim->attempt_phase = boot_profile_begin(sim->profile, origins[origin & 3], SIM_TRACK_ATTEMPT, sim->now_ms * 1000);
+	}
+
+	if(sim->now_ms < net->present_at_ms){
+		schedule(sim, search_ms, EV_ATTEMPT_DONE, WM_EVENT_STA_DISCONNECTED, 201, gen);	/* NO_AP_FOUND */
+	}
+	else if(direct && net->moved){
+		schedule(sim, search_ms + 300, EV_ATTEMPT_DONE, WM_EVENT_STA_DISCONNECTED, 201, gen);
+	}
+	else if(net->wrong_password){
+		schedule(sim, search_ms + sim->assoc_ms + 1000, EV_ATTEMPT_DONE, WM_EVENT_STA_DISCONNECTED, 15, gen);	/* 4WAY_HANDSHAKE_TIMEOUT */
+	}
+	else if(chance(sim->transient_p)){
+		/* AUTH_EXPIRE (nova tentativa imediata) ou CONNECTION_FAIL (recuo) */
+		schedule(sim, search_ms + sim->assoc_ms, EV_ATTEMPT_DONE, WM_EVENT_STA_DISCONNECTED, chance(0.5) ? 2 : 205, gen);
+	}
+	else{
+		schedule(sim, search_ms + sim->assoc_ms + sim->dhcp_ms, EV_ATTEMPT_DONE, WM_EVENT_STA_GOT_IP, 0, gen);
+	}
+
+	return direct;
+}
+
+static void op_post(void *ctx, uint8_t code, uint32_t param){
+	schedule((struct sim_t*)ctx, 0, EV_MESSAGE, code, param, 0);
+}
+
+static void op_arm_retry(void *ctx, uint32_t attempt){
+	struct sim_t *sim = (struct sim_t*)ctx;
+	uint32_t delay_ms = RETRY_TIMER_MS;
+	if(sim->policy == POLICY_BACKOFF){
+		delay_ms = retry_policy_backoff_full_jitter(attempt, RETRY_TIMER_MS, RETRY_BACKOFF_CAP_MS, xorshift32());
+	}
+	schedule(sim, delay_ms, EV_RETRY_TIMER, 0, 0, ++sim->retry_gen);
+}
+
+static void op_cancel_retry(void *ctx){
+	((struct sim_t*)ctx)->retry_gen++;
+}
+
+static const struct conn_fsm_ops_t sim_ops = {
+	.connect = op_connect,
+	.post = op_post,
+	.arm_retry = op_arm_retry,
+	.cancel_retry = op_cancel_retry,
+};
+
+
+/**
+ * @brief Sorteia o ambiente de um ensaio.
+ */
+static void sim_init(struct sim_t *sim, policy_t policy){
+
+	memset(sim, 0x00, sizeof(struct sim_t));
+	sim->policy = policy;
+	sim->connected_at_ms = -1;
+	sim->portal_at_ms = -1;
+
+	sim->network_count = (int)uniform(1, MAX_NETWORKS);
+	for(int i=0; i<sim->network_count; i++){
+		struct network_t *net = &sim->networks[i];
+		uint32_t r = uniform(0, 99);
+		if(r < 10) net->present_at_ms = INT64_MAX;				/* rede que não existe mais */
+		else if(r < 40) net->present_at_ms = uniform(0, 120000);	/* roteador reiniciando */
+		else net->present_at_ms = 0;
+		net->wrong_password = chance(0.05);
+		net->moved = chance(0.15);
+	}
+	sim->transient_p = uniform(0, 40) / 100.0;
+	sim->scan_ms = uniform(1500, 3000);
+	sim->assoc_ms = uniform(300, 3000);
+	sim->dhcp_ms = uniform(100, 2000);
+
+	conn_fsm_init(&sim->fsm, MAX_RETRY_START_AP, &sim_ops, sim);
+}
+
+/**
+ * @brief Melhor rede salva visível ainda não tentada, como sta_profiles_select.
+ */
+static int sim_select(struct sim_t *sim){
+	for(int i=0; i<sim->network_count; i++){
+		if(!(sim->tried & (1UL << i)) && sim->now_ms >= sim->networks[i].present_at_ms) return i;
+	}
+	return -1;
+}
+
+/**
+ * @brief Trata uma mensagem como o laço de wifi_manager(): o que é da plataforma aqui, a decisão na máquina de estados.
+ */
+static void sim_handle(struct sim_t *sim, uint8_t code, uint32_t param){
+
+	conn_outcome_t outcome;
+
+	sim->events_handled++;
+
+	switch(code){
+	case WM_ORDER_LOAD_AND_RESTORE_STA:
+	case WM_ORDER_CONNECT_STA:
+	case WM_ORDER_DISCONNECT_STA:
+		conn_fsm_dispatch(&sim->fsm, code, param);
+		break;
+
+	case WM_ORDER_START_WIFI_SCAN:
+		schedule(sim, sim->scan_ms, EV_MESSAGE, WM_EVENT_SCAN_DONE, 0, 0);
+		break;
+
+	case WM_EVENT_SCAN_DONE:
+		if(sim->fsm.state == CONN_STATE_SELECTING){
+			int idx = sim_select(sim);
+			if(idx >= 0) sim->current = idx;
+			if(conn_fsm_dispatch(&sim->fsm, code, idx >= 0) == CONN_OUTCOME_NO_NETWORK){
+				sim->tried = 0;
+			}
+		}
+		break;
+
+	case WM_ORDER_START_AP:
+		sim->ap_started = true;
+		if(sim->portal_at_ms < 0) sim->portal_at_ms = sim->now_ms;
+		break;
+
+	case WM_EVENT_STA_DISCONNECTED:
+		sim->fsm.ap_started = sim->ap_started;
+		sim->fsm.saved_networks = (uint8_t)sim->network_count;
+		outcome = conn_fsm_dispatch(&sim->fsm, code, param);
+		if(outcome == CONN_OUTCOME_LOST || outcome == CONN_OUTCOME_GIVE_UP){
+			sim->tried |= (1UL << sim->current);
+		}
+		break;
+
+	case WM_EVENT_STA_GOT_IP:
+		conn_fsm_dispatch(&sim->fsm, code, param);
+		sim->networks[sim->current].moved = false;
+		sim->tried = 0;
+		if(sim->connected_at_ms < 0) sim->connected_at_ms = sim->now_ms;
+		break;
+
+	default:
+		break;
+	}
+
+	/* uma fase por estado visitado */
+	if(sim->profile && sim->fsm.state != sim->traced_state){
+		boot_profile_end(sim->profile, sim->state_phase, sim->now_ms * 1000);
+		sim->state_phase = boot_profile_begin(sim->profile, conn_fsm_state_to_str(sim->fsm.state), SIM_TRACK_STATE, sim->now_ms * 1000);
+		sim->traced_state = sim->fsm.state;
+	}
+	if(sim->profile && code == WM_ORDER_START_AP){
+		boot_profile_mark(sim->profile, "portal", SIM_TRACK_STATE, sim->now_ms * 1000);
+	}
+	if(sim->profile && (code == WM_EVENT_STA_DISCONNECTED || code == WM_EVENT_STA_GOT_IP)){
+		boot_profile_end(sim->profile, sim->attempt_phase, sim->now_ms * 1000);
+		sim->attempt_phase = -1;
+	}
+}
+
+/**
+ * @brief Executa um ensaio até o primeiro IP ou até HORIZON_MS.
+ * @return false se a máquina ficou sem nenhum evento pendente sem estar conectada.
+ */
+static bool sim_run(struct sim_t *sim){
+
+	struct event_t e;
+
+	/* boot: a primeira rede salva é a rede em uso */
+	sim->now_ms = 0;
+	sim->state_phase = -1;
+	sim->attempt_phase = -1;
+	sim->traced_state = CONN_STATE_COUNT;
+	op_post(sim, WM_ORDER_LOAD_AND_RESTORE_STA, (uint32_t)sim->network_count);
+
+	while(sim->connected_at_ms < 0){
+		if(!next_event(sim, &e)) return false;
+		if(e.time_ms > HORIZON_MS) break;
+		sim->now_ms = e.time_ms;
+
+		switch(e.type){
+		case EV_RETRY_TIMER:
+			if(e.gen == sim->retry_gen){
+				sim_handle(sim, WM_ORDER_CONNECT_STA, CONNECTION_REQUEST_AUTO_RECONNECT);
+			}
+			break;
+		case EV_ATTEMPT_DONE:
+			if(e.gen == sim->attempt_gen){
+				sim_handle(sim, e.code, e.param);
+			}
+			break;
+		default:
+			sim_handle(sim, e.code, e.param);
+			break;
+		}
+	}
+
+	return true;
+}
+
+static int cmp_i64(const void *a, const void *b){
+	int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+	return (x > y) - (x < y);
+}
+
+static void print_percentiles(const char *name, int64_t *v, int n, int trials){
+	if(n == 0){
+		printf("  %-16s  n/a (0 of %d trials)\n", name, trials);
+		return;
+	}
+	qsort(v, n, sizeof(int64_t), cmp_i64);
+	printf("  %-16s  p50 %7.1f s  p90 %7.1f s  p99 %7.1f s  (%d of %d trials)\n", name,
+			v[n / 2] / 1000.0, v[(n * 9) / 10] / 1000.0, v[(n * 99) / 100] / 1000.0, n, trials);
+}
+
+/**
+ * @brief Grava a linha do tempo de um ensaio como trace JSON do Chrome.
+ */
+static void write_trace(const char *path, const struct sim_t *sim){
+
+	static const char* const tracks[] = { NULL, "conn_fsm state", "association attempts" };
+	int64_t end_us = sim->now_ms * 1000;
+	size_t sz = boot_profile_to_chrome_trace(sim->profile, tracks, 3, end_us, NULL, 0) + 1;
+	char *buf = malloc(sz);
+	FILE *fp = fopen(path, "w");
+
+	if(buf == NULL || fp == NULL){
+		fprintf(stderr, "could not write %s\n", path);
+	}
+	else{
+		boot_profile_to_chrome_trace(sim->profile, tracks, 3, end_us, buf, sz);
+		fputs(buf, fp);
+		printf("trace of the first trial written to %s (%u phases, %u dropped)\n", path, sim->profile->count, sim->profile->dropped);
+	}
+	if(fp) fclose(fp);
+	free(buf);
+}
+
+static int simulate(policy_t policy, int trials, uint32_t seed, const char *trace_path){
+
+	int64_t *to_connect = calloc(trials, sizeof(int64_t));
+	int64_t *to_portal = calloc(trials, sizeof(int64_t));
+	int connected = 0, portal = 0, stuck = 0;
+	uint64_t attempts = 0, events = 0;
+	struct sim_t sim;
+	clock_t start = clock();
+
+	xorshift_state = seed ? seed : 2463534242UL;
+
+	for(int i=0; i<trials; i++){
+		sim_init(&sim, policy);
+		if(i == 0 && trace_path){
+			sim.profile = calloc(1, sizeof(struct boot_profile_t));
+		}
+		if(!sim_run(&sim)){
+			stuck++;
+			if(stuck <= 5){
+				fprintf(stderr, "  trial %d stuck in %s at %.1f s\n", i, conn_fsm_state_to_str(sim.fsm.state), sim.now_ms / 1000.0);
+			}
+		}
+		if(sim.connected_at_ms >= 0) to_connect[connected++] = sim.connected_at_ms;
+		if(sim.portal_at_ms >= 0) to_portal[portal++] = sim.portal_at_ms;
+		attempts += sim.attempts;
+		events += sim.events_handled;
+		if(sim.profile){
+			write_trace(trace_path, &sim);
+			free(sim.profile);
+		}
+	}
+
+	double wall_ms = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+
+	printf("\n== %s: %d trials ==\n", policy == POLICY_BACKOFF ? "exponential backoff + full jitter" : "fixed delay", trials);
+	print_percentiles("time to connect", to_connect, connected, trials);
+	print_percentiles("time to portal", to_portal, portal, trials);
+	printf("  attempts/trial: %.2f, messages/trial: %.1f, stuck: %d, wall time: %.0f ms\n",
+			(double)attempts / trials, (double)events / trials, stuck, wall_ms);
+
+	free(to_connect);
+	free(to_portal);
+
+	return stuck;
+}
+
+int main(int argc, char **argv){
+
+	int trials = argc > 1 ? atoi(argv[1]) : 10000;
+	uint32_t seed = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 0) : 1;
+	int stuck = 0;
+
+	if(trials <= 0){
+		fprintf(stderr, "usage: %s [trials] [seed] [trace.json]\n", argv[0]);
+		return 1;
+	}
+
+	stuck += simulate(POLICY_FIXED, trials, seed, argc > 3 ? argv[3] : NULL);
+	stuck += simulate(POLICY_BACKOFF, trials, seed, NULL);
+
+	return stuck ? 1 : 0;
+}
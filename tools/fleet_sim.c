@@ -0,0 +1,495 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file fleet_sim.c
+@brief Simulação em host de uma frota inteira reconectando ao mesmo AP depois de uma queda
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+/*
+ * Compilação e execução no host (nenhuma dependência do esp-idf):
+ *
+ *   cc -O2 -I../src -o fleet_sim fleet_sim.c ../src/conn_fsm.c ../src/disconnect_reason.c ../src/retry_policy.c
+ *   ./fleet_sim [-n devices] [-o outage_s] [-c assoc_per_s] [-d dhcp_pool] [-t duration_s] [-p percent]
+ *               [-r retry_ms] [-b backoff_cap_ms] [-m max_retry_start_ap] [-s seed] [-v]
+ *
+ * Diferente de retry_sim.c, cada dispositivo executa a mesma conn_fsm.c do firmware: nova tentativa imediata numa
+ * queda transitória, reconexão rápida no canal em cache, desistência e início do AP após -m falhas.
+ * Todos os dispositivos estão conectados em t=0, quando o AP some por outage_s segundos. Cada um percebe a queda
+ * após a perda de beacons (BEACON_TIMEOUT). Com o AP de volta, ele aceita no máximo assoc_per_s associações por
+ * segundo (as demais recebem ASSOC_TOOMANY) e tem um pool de dhcp_pool endereços: quem associa e não recebe um
+ * endereço é desconectado após o tempo limite do DHCP. Cada dispositivo guarda o seu endereço ao reconectar.
+ *
+ * O programa imprime, para a política fixa e para o recuo exponencial com jitter completo, o tempo até 50/90/99/100%
+ * e até -p% da frota estar online, o pico de tentativas de associação por segundo recebidas pelo AP e quantos
+ * dispositivos iniciaram o soft AP. Com -v, imprime também a linha do tempo por segundo.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "conn_fsm.h"
+#include "retry_policy.h"
+
+/* latências do driver */
+#define BEACON_LOSS_MIN_MS		1000
+#define BEACON_LOSS_MAX_MS		6000
+#define SCAN_MIN_MS				1500
+#define SCAN_MAX_MS				3000
+#define DIRECT_PROBE_MS			300
+#define ASSOC_MIN_MS			200
+#define ASSOC_MAX_MS			800
+#define DHCP_MIN_MS				100
+#define DHCP_MAX_MS				500
+#define DHCP_TIMEOUT_MS			10000
+
+/* códigos de razão usados pelo modelo */
+#define REASON_ASSOC_TOOMANY	5
+#define REASON_BEACON_TIMEOUT	200
+#define REASON_NO_AP_FOUND		201
+#define REASON_CONNECTION_FAIL	205
+
+typedef enum { POLICY_FIXED = 0, POLICY_BACKOFF = 1 } policy_t;
+
+typedef enum{
+	EV_MESSAGE = 0,
+	EV_RETRY_TIMER = 1,
+	EV_ATTEMPT_DONE = 2
+}event_type_t;
+
+struct event_t{
+	int64_t time_ms;
+	uint32_t seq;
+	uint32_t gen;
+	uint32_t dev;
+	uint8_t type;
+	uint8_t code;
+	uint32_t param;
+};
+
+struct device_t{
+	struct conn_fsm_t fsm;
+	uint32_t retry_gen;
+	uint32_t attempt_gen;
+	bool ap_started;
+	bool online;
+	bool lease;				/* o dispositivo tem um endereço do pool */
+	bool fell_back;			/* iniciou o soft AP pelo menos uma vez */
+};
+
+struct config_t{
+	int devices;
+	int outage_s;
+	int capacity;
+	int pool;
+	int duration_s;
+	int percent;
+	uint32_t retry_ms;
+	uint32_t backoff_cap_ms;
+	int max_retry;
+	uint32_t seed;
+	bool verbose;
+};
+
+struct fleet_t{
+	const struct config_t *cfg;
+	policy_t policy;
+	int64_t now_ms;
+	uint32_t current;		/* dispositivo em tratamento, para as operações da máquina de estados */
+
+	struct event_t *heap;
+	size_t heap_count, heap_size;
+	uint32_t seq;
+
+	struct device_t *dev;
+	uint32_t *accepted;		/* associações aceitas pelo AP, por segundo */
+	uint32_t *attempts;		/* tentativas de associação recebidas pelo AP, por segundo */
+	uint32_t *online;		/* dispositivos online ao fim de cada segundo */
+	int leases;
+	int online_count;
+};
+
+static uint32_t xorshift_state = 2463534242UL;
+static uint32_t xorshift32(){
+	uint32_t x = xorshift_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return xorshift_state = x;
+}
+
+static uint32_t uniform(uint32_t lo, uint32_t hi){
+	return lo + xorshift32() % (hi - lo + 1);
+}
+
+
+/* fila de eventos: heap binário ordenado por (time_ms, seq) */
+
+static bool event_before(const struct event_t *a, const struct event_t *b){
+	return a->time_ms < b->time_ms || (a->time_ms == b->time_ms && a->seq < b->seq);
+}
+
+static void schedule(struct fleet_t *fl, uint32_t dev, uint32_t delay_ms, uint8_t type, uint8_t code, uint32_t param, uint32_t gen){
+
+	if(fl->heap_count == fl->heap_size){
+		fl->heap_size = fl->heap_size ? fl->heap_size * 2 : 1024;
+		fl->heap = realloc(fl->heap, fl->heap_size * sizeof(struct event_t));
+		if(fl->heap == NULL){
+			fprintf(stderr, "out of memory\n");
+			exit(2);
+		}
+	}
+
+	struct event_t e = { fl->now_ms + delay_ms, fl->seq++, gen, dev, type, code, param };
+	size_t i = fl->heap_count++;
+	while(i > 0 && event_before(&e, &fl->heap[(i - 1) / 2])){
+		fl->heap[i] = fl->heap[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	fl->heap[i] = e;
+}
+
+static bool next_event(struct fleet_t *fl, struct event_t *out){
+
+	if(fl->heap_count == 0) return false;
+	*out = fl->heap[0];
+
+	struct event_t last = fl->heap[--fl->heap_count];
+	size_t i = 0;
+	for(;;){
+		size_t c = 2 * i + 1;
+		if(c >= fl->heap_count) break;
+		if(c + 1 < fl->heap_count && event_before(&fl->heap[c + 1], &fl->heap[c])) c++;
+		if(!event_before(&fl->heap[c], &last)) break;
+		fl->heap[i] = fl->heap[c];
+		i = c;
+	}
+	if(fl->heap_count) fl->heap[i] = last;
+
+	return true;
+}
+
+
+/* modelo do AP compartilhado */
+
+/**
+ * @brief Uma tentativa de associação chega ao AP em at_ms: aceita se houver capacidade naquele segundo.
+ */
+static bool ap_associate(struct fleet_t *fl, int64_t at_ms){
+	int64_t s = at_ms / 1000;
+	if(s >= fl->cfg->duration_s) return false;
+	fl->attempts[s]++;
+	if(fl->accepted[s] >= (uint32_t)fl->cfg->capacity) return false;
+	fl->accepted[s]++;
+	return true;
+}
+
+static bool ap_dhcp(struct fleet_t *fl, struct device_t *d){
+	if(d->lease) return true;
+	if(fl->leases >= fl->cfg->pool) return false;
+	fl->leases++;
+	d->lease = true;
+	return true;
+}
+
+
+/* operações da máquina de estados */
+
+static bool op_connect(void *ctx, uint8_t origin, bool use_hint){
+	struct fleet_t *fl = (struct fleet_t*)ctx;
+	struct device_t *d = &fl->dev[fl->current];
+	uint32_t gen = ++d->attempt_gen;
+	uint32_t search_ms = use_hint ? DIRECT_PROBE_MS : uniform(SCAN_MIN_MS, SCAN_MAX_MS);
+	int64_t at_ms = fl->now_ms + search_ms;
+
+	(void)origin;
+
+	if(at_ms < (int64_t)fl->cfg->outage_s * 1000){
+		/* o AP ainda não voltou */
+		schedule(fl, fl->current, search_ms, EV_ATTEMPT_DONE, WM_EVENT_STA_DISCONNECTED, REASON_NO_AP_FOUND, gen);
+	}
+	else if(!ap_associate(fl, at_ms)){
+		schedule(fl, fl->current, search_ms + uniform(ASSOC_MIN_MS, ASSOC_MAX_MS), EV_ATTEMPT_DONE, WM_EVENT_STA_DISCONNECTED, REASON_ASSOC_TOOMANY, gen);
+	}
+	else if(!ap_dhcp(fl, d)){
+		schedule(fl, fl->current, search_ms + uniform(ASSOC_MIN_MS, ASSOC_MAX_MS) + DHCP_TIMEOUT_MS, EV_ATTEMPT_DONE, WM_EVENT_STA_DISCONNECTED, REASON_CONNECTION_FAIL, gen);
+	}
+	else{
+		schedule(fl, fl->current, search_ms + uniform(ASSOC_MIN_MS, ASSOC_MAX_MS) + uniform(DHCP_MIN_MS, DHCP_MAX_MS), EV_ATTEMPT_DONE, WM_EVENT_STA_GOT_IP, 0, gen);
+	}
+
+	return use_hint;
+}
+
+static void op_post(void *ctx, uint8_t code, uint32_t param){
+	struct fleet_t *fl = (struct fleet_t*)ctx;
+	schedule(fl, fl->current, 0, EV_MESSAGE, code, param, 0);
+}
+
+static void op_arm_retry(void *ctx, uint32_t attempt){
+	struct fleet_t *fl = (struct fleet_t*)ctx;
+	struct device_t *d = &fl->dev[fl->current];
+	uint32_t delay_ms = fl->cfg->retry_ms;
+	if(fl->policy == POLICY_BACKOFF){
+		delay_ms = retry_policy_backoff_full_jitter(attempt, fl->cfg->retry_ms, fl->cfg->backoff_cap_ms, xorshift32());
+	}
+	schedule(fl, fl->current, delay_ms, EV_RETRY_TIMER, 0, 0, ++d->retry_gen);
+}
+
+static void op_cancel_retry(void *ctx){
+	struct fleet_t *fl = (struct fleet_t*)ctx;
+	fl->dev[fl->current].retry_gen++;
+}
+
+static const struct conn_fsm_ops_t fleet_ops = {
+	.connect = op_connect,
+	.post = op_post,
+	.arm_retry = op_arm_retry,
+	.cancel_retry = op_cancel_retry,
+};
+
+
+/**
+ * @brief Trata uma mensagem de um dispositivo como o laço de wifi_manager().
+ */
+static void handle(struct fleet_t *fl, uint32_t i, uint8_t code, uint32_t param){
+
+	struct device_t *d = &fl->dev[i];
+	fl->current = i;
+
+	switch(code){
+	case WM_ORDER_START_AP:
+		d->ap_started = true;
+		d->fell_back = true;
+		break;
+
+	case WM_ORDER_START_WIFI_SCAN:
+		schedule(fl, i, uniform(SCAN_MIN_MS, SCAN_MAX_MS), EV_MESSAGE, WM_EVENT_SCAN_DONE, 0, 0);
+		break;
+
+	case WM_EVENT_SCAN_DONE:
+		/* uma rede salva por dispositivo: a seleção sempre volta para ela */
+		if(d->fsm.state == CONN_STATE_SELECTING){
+			conn_fsm_dispatch(&d->fsm, code, fl->now_ms >= (int64_t)fl->cfg->outage_s * 1000);
+		}
+		break;
+
+	case WM_EVENT_STA_DISCONNECTED:
+		if(d->online){
+			d->online = false;
+			fl->online_count--;
+		}
+		d->fsm.ap_started = d->ap_started;
+		d->fsm.saved_networks = 1;
+		conn_fsm_dispatch(&d->fsm, code, param);
+		break;
+
+	case WM_EVENT_STA_GOT_IP:
+		conn_fsm_dispatch(&d->fsm, code, param);
+		d->online = true;
+		fl->online_count++;
+		/* o AP é desligado pelo temporizador de desligamento, que não altera a contagem */
+		d->ap_started = false;
+		break;
+
+	default:
+		conn_fsm_dispatch(&d->fsm, code, param);
+		break;
+	}
+}
+
+static int time_to_percent(const struct fleet_t *fl, int percent){
+	int64_t target = ((int64_t)fl->cfg->devices * percent + 99) / 100;
+	/* antes da volta do AP a contagem só cai: toda a frota estava online em t=0 */
+	for(int s=fl->cfg->outage_s; s<fl->cfg->duration_s; s++){
+		if(fl->online[s] >= target) return s + 1;
+	}
+	return -1;
+}
+
+static void print_time_to(const struct fleet_t *fl, int percent){
+	int s = time_to_percent(fl, percent);
+	if(s < 0) printf("  %3d%% online: not reached in %d s\n", percent, fl->cfg->duration_s);
+	else printf("  %3d%% online: %d s (%d s after the AP came back)\n", percent, s, s - fl->cfg->outage_s);
+}
+
+static void simulate(const struct config_t *cfg, policy_t policy){
+
+	struct fleet_t fl;
+	struct event_t e;
+	uint64_t events = 0;
+
+	memset(&fl, 0x00, sizeof(fl));
+	fl.cfg = cfg;
+	fl.policy = policy;
+	fl.dev = calloc(cfg->devices, sizeof(struct device_t));
+	fl.accepted = calloc(cfg->duration_s, sizeof(uint32_t));
+	fl.attempts = calloc(cfg->duration_s, sizeof(uint32_t));
+	fl.online = calloc(cfg->duration_s, sizeof(uint32_t));
+	xorshift_state = cfg->seed ? cfg->seed : 2463534242UL;
+
+	/* t=0: toda a frota está conectada e o AP cai. Cada dispositivo percebe a queda pela perda de beacons */
+	for(int i=0; i<cfg->devices; i++){
+		struct device_t *d = &fl.dev[i];
+		fl.current = (uint32_t)i;
+		conn_fsm_init(&d->fsm, (uint8_t)cfg->max_retry, &fleet_ops, &fl);
+		conn_fsm_dispatch(&d->fsm, WM_EVENT_STA_GOT_IP, 0);
+		d->online = true;
+		d->lease = i < cfg->pool;
+		schedule(&fl, (uint32_t)i, uniform(BEACON_LOSS_MIN_MS, BEACON_LOSS_MAX_MS), EV_MESSAGE, WM_EVENT_STA_DISCONNECTED, REASON_BEACON_TIMEOUT, 0);
+	}
+	fl.online_count = cfg->devices;
+	fl.leases = cfg->devices < cfg->pool ? cfg->devices : cfg->pool;
+
+	int s = 0;
+	while(next_event(&fl, &e)){
+		if(e.time_ms >= (int64_t)cfg->duration_s * 1000) break;
+		while(s < e.time_ms / 1000) fl.online[s++] = (uint32_t)fl.online_count;
+		fl.now_ms = e.time_ms;
+		events++;
+
+		struct device_t *d = &fl.dev[e.dev];
+		switch(e.type){
+		case EV_RETRY_TIMER:
+			if(e.gen == d->retry_gen) handle(&fl, e.dev, WM_ORDER_CONNECT_STA, CONNECTION_REQUEST_AUTO_RECONNECT);
+			break;
+		case EV_ATTEMPT_DONE:
+			if(e.gen == d->attempt_gen) handle(&fl, e.dev, e.code, e.param);
+			break;
+		default:
+			handle(&fl, e.dev, e.code, e.param);
+			break;
+		}
+	}
+	while(s < cfg->duration_s) fl.online[s++] = (uint32_t)fl.online_count;
+
+	uint32_t peak = 0, peak_s = 0;
+	uint64_t total = 0;
+	int fell_back = 0, offline = 0;
+	for(int i=0; i<cfg->duration_s; i++){
+		total += fl.attempts[i];
+		if(fl.attempts[i] > peak){
+			peak = fl.attempts[i];
+			peak_s = (uint32_t)i;
+		}
+	}
+	for(int i=0; i<cfg->devices; i++){
+		if(fl.dev[i].fell_back) fell_back++;
+		if(!fl.dev[i].online) offline++;
+	}
+
+	printf("\n== %s: %d devices, AP back at %d s, %d associations/s, %d DHCP leases ==\n",
+			policy == POLICY_BACKOFF ? "exponential backoff + full jitter" : "fixed delay", cfg->devices, cfg->outage_s, cfg->capacity, cfg->pool);
+	if(cfg->verbose){
+		printf("  second  attempts/s  accepted/s  online\n");
+		for(int i=0; i<cfg->duration_s; i++){
+			if(fl.attempts[i] || (i > 0 && fl.online[i] != fl.online[i - 1])){
+				printf("  %6d  %10u  %10u  %6u\n", i, fl.attempts[i], fl.accepted[i], fl.online[i]);
+			}
+		}
+	}
+	print_time_to(&fl, 50);
+	print_time_to(&fl, 90);
+	print_time_to(&fl, 99);
+	print_time_to(&fl, 100);
+	if(cfg->percent != 50 && cfg->percent != 90 && cfg->percent != 99 && cfg->percent != 100){
+		print_time_to(&fl, cfg->percent);
+	}
+	printf("  peak association attempts at the AP: %u/s at %u s, total: %llu, per device: %.1f\n",
+			peak, peak_s, (unsigned long long)total, (double)total / cfg->devices);
+	printf("  fell back to soft AP: %d (%.1f%%), offline at the end: %d, events: %llu\n",
+			fell_back, 100.0 * fell_back / cfg->devices, offline, (unsigned long long)events);
+
+	free(fl.heap);
+	free(fl.dev);
+	free(fl.accepted);
+	free(fl.attempts);
+	free(fl.online);
+}
+
+static void usage(const char *argv0){
+	fprintf(stderr, "usage: %s [-n devices] [-o outage_s] [-c assoc_per_s] [-d dhcp_pool] [-t duration_s] [-p percent]\n"
+			"          [-r retry_ms] [-b backoff_cap_ms] [-m max_retry_start_ap] [-s seed] [-v]\n", argv0);
+}
+
+int main(int argc, char **argv){
+
+	/* valores padrão do menuconfig para as tentativas */
+	struct config_t cfg = {
+		.devices = 2000,
+		.outage_s = 120,
+		.capacity = 50,
+		.pool = -1,
+		.duration_s = 1800,
+		.percent = 95,
+		.retry_ms = 5000,
+		.backoff_cap_ms = 300000,
+		.max_retry = 3,
+		.seed = 1,
+		.verbose = false
+	};
+
+	for(int i=1; i<argc; i++){
+		const char *a = argv[i];
+		const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if(strcmp(a, "-v") == 0){
+			cfg.verbose = true;
+			continue;
+		}
+		if(v == NULL || a[0] != '-' || a[1] == '\0' || a[2] != '\0'){
+			usage(argv[0]);
+			return 1;
+		}
+		switch(a[1]){
+		case 'n': cfg.devices = atoi(v); break;
+		case 'o': cfg.outage_s = atoi(v); break;
+		case 'c': cfg.capacity = atoi(v); break;
+		case 'd': cfg.pool = atoi(v); break;
+		case 't': cfg.duration_s = atoi(v); break;
+		case 'p': cfg.percent = atoi(v); break;
+		case 'r': cfg.retry_ms = (uint32_t)strtoul(v, NULL, 0); break;
+		case 'b': cfg.backoff_cap_ms = (uint32_t)strtoul(v, NULL, 0); break;
+		case 'm': cfg.max_retry = atoi(v); break;
+		case 's': cfg.seed = (uint32_t)strtoul(v, NULL, 0); break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+		i++;
+	}
+	if(cfg.pool < 0) cfg.pool = cfg.devices;
+
+	if(cfg.devices <= 0 || cfg.outage_s < 0 || cfg.capacity <= 0 || cfg.duration_s <= cfg.outage_s ||
+			cfg.percent <= 0 || cfg.percent > 100 || cfg.retry_ms == 0 || cfg.max_retry < 0 || cfg.max_retry > 255){
+		usage(argv[0]);
+		return 1;
+	}
+
+	simulate(&cfg, POLICY_FIXED);
+	simulate(&cfg, POLICY_BACKOFF);
+
+	return 0;
+}
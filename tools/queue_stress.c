@@ -0,0 +1,228 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file queue_stress.c
+@brief Teste de estresse em host da fila de mensagens com fusão (message_ring)
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+/*
+ * Compilação e execução no host (nenhuma dependência do esp-idf):
+ *
+ *   cc -O2 -pthread -I../src -o queue_stress queue_stress.c ../src/message_ring.c
+ *   ./queue_stress [producers] [messages_per_producer] [capacity]
+ *
+ * Vários produtores inundam a fila ao mesmo tempo em que um consumidor lento a esvazia, como o loop de eventos,
+ * o servidor http e os temporizadores fazem com a tarefa wifi_manager. O programa verifica que:
+ *  - toda mensagem postada foi entregue, fundida ou descartada, e os contadores batem;
+ *  - nenhuma mensagem entregue foi corrompida;
+ *  - duas mensagens de mesmo código fundível nunca ficam pendentes lado a lado;
+ *  - uma mensagem fundida nunca passa à frente de uma mensagem não fundível do mesmo produtor;
+ *  - uma mensagem fundida nunca passa à frente de uma mensagem mais antiga de outro código fundível;
+ *  - as mensagens não fundíveis de cada produtor saem na ordem em que entraram.
+ * Retorna 0 se tudo estiver correto.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "message_ring.h"
+
+#define CODE_COUNT			8
+#define COALESCE_MASK		( (1UL << 1) | (1UL << 2) | (1UL << 3) )
+#define MAX_PRODUCERS		64
+
+struct stress_msg_t{
+	uint8_t code;
+	uint32_t producer;
+	uint32_t seq;
+	uint32_t check;
+};
+
+static struct message_ring_t ring;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t not_empty = PTHREAD_COND_INITIALIZER;
+static int producers_done = 0;
+static int producers = 4;
+static uint32_t messages = 200000;
+static uint32_t pushed = 0;
+static uint32_t popped = 0;
+static uint32_t failures = 0;
+static uint32_t last_barrier_seq[MAX_PRODUCERS];
+
+
+static uint32_t stress_check(const struct stress_msg_t *m){
+	return (m->code * 2654435761u) ^ (m->producer * 40503u) ^ (m->seq * 2246822519u);
+}
+
+static bool coalesces(uint8_t code){
+	return (COALESCE_MASK & (1UL << code)) != 0;
+}
+
+/* a última mensagem vence, como WM_EVENT_STA_DISCONNECTED */
+static void merge_latest(uint8_t code, void *queued, const void *incoming){
+	(void)code;
+	memcpy(queued, incoming, sizeof(struct stress_msg_t));
+}
+
+static const struct stress_msg_t* ring_at(int i){
+	return (const struct stress_msg_t*)(ring.items + ((ring.head + i) % ring.capacity) * ring.item_size);
+}
+
+static void fail(const char *what){
+	failures++;
+	if(failures <= 10) fprintf(stderr, "FAIL: %s\n", what);
+}
+
+/* chamado com o lock: duas mensagens fundíveis de mesmo código lado a lado */
+static void check_no_duplicates(){
+	for(int i = 1; i < ring.count; i++){
+		uint8_t code = ring_at(i)->code;
+		if(coalesces(code) && ring_at(i - 1)->code == code){
+			fail("duplicate coalescible message pending");
+		}
+	}
+}
+
+static void* producer_task(void *arg){
+	uint32_t id = (uint32_t)(uintptr_t)arg;
+	uint32_t state = 0x9e3779b9u * (id + 1);
+
+	for(uint32_t seq = 1; seq <= messages; seq++){
+		state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+
+		struct stress_msg_t m;
+		m.code = state % CODE_COUNT;
+		m.producer = id;
+		m.seq = seq;
+		m.check = stress_check(&m);
+
+		pthread_mutex_lock(&lock);
+		message_ring_result_t r = message_ring_push(&ring, m.code, &m, false);
+		pushed++;
+		if(r == MESSAGE_RING_QUEUED) pthread_cond_signal(&not_empty);
+		if((seq & 0xff) == 0) check_no_duplicates();
+		pthread_mutex_unlock(&lock);
+
+		/* rajadas curtas, como eventos do driver */
+		if((seq & 0x7) == 0) sched_yield();
+	}
+
+	pthread_mutex_lock(&lock);
+	producers_done++;
+	pthread_cond_signal(&not_empty);
+	pthread_mutex_unlock(&lock);
+
+	return NULL;
+}
+
+static void* consumer_task(void *arg){
+	(void)arg;
+	struct stress_msg_t m;
+	volatile uint32_t work = 0;
+
+	for(;;){
+		pthread_mutex_lock(&lock);
+		while(ring.count == 0 && producers_done < producers){
+			pthread_cond_wait(&not_empty, &lock);
+		}
+		if(!message_ring_pop(&ring, &m)){
+			pthread_mutex_unlock(&lock);
+			break;
+		}
+		popped++;
+
+		if(m.code >= CODE_COUNT || m.producer >= (uint32_t)producers || m.check != stress_check(&m)){
+			fail("corrupted message");
+		}
+		else if(!coalesces(m.code)){
+			if(m.seq <= last_barrier_seq[m.producer]) fail("non coalescible messages out of order");
+			last_barrier_seq[m.producer] = m.seq;
+		}
+		else{
+			/* nenhuma mensagem mais antiga do mesmo produtor, de outro código, pode continuar pendente */
+			for(int i = 0; i < ring.count; i++){
+				const struct stress_msg_t *p = ring_at(i);
+				if(p->producer != m.producer || p->seq >= m.seq) continue;
+				if(!coalesces(p->code)){
+					fail("coalesced message overtook a barrier");
+					break;
+				}
+				if(p->code != m.code){
+					fail("coalesced message overtook another coalescible code");
+					break;
+				}
+			}
+		}
+		pthread_mutex_unlock(&lock);
+
+		/* consumidor lento: a fila enche e os produtores nunca esperam */
+		for(int i = 0; i < 50; i++) work += i;
+	}
+
+	return NULL;
+}
+
+int main(int argc, char **argv){
+
+	uint16_t capacity = 16;
+	if(argc > 1) producers = atoi(argv[1]);
+	if(argc > 2) messages = (uint32_t)atol(argv[2]);
+	if(argc > 3) capacity = (uint16_t)atoi(argv[3]);
+	if(producers < 1 || producers > MAX_PRODUCERS || capacity < 1){
+		fprintf(stderr, "usage: %s [producers 1-%d] [messages_per_producer] [capacity]\n", argv[0], MAX_PRODUCERS);
+		return 2;
+	}
+
+	if(!message_ring_init(&ring, capacity, sizeof(struct stress_msg_t), COALESCE_MASK, merge_latest)){
+		fprintf(stderr, "out of memory\n");
+		return 2;
+	}
+
+	pthread_t consumer;
+	pthread_t threads[MAX_PRODUCERS];
+	pthread_create(&consumer, NULL, consumer_task, NULL);
+	for(int i = 0; i < producers; i++){
+		pthread_create(&threads[i], NULL, producer_task, (void*)(uintptr_t)i);
+	}
+	for(int i = 0; i < producers; i++){
+		pthread_join(threads[i], NULL);
+	}
+	pthread_join(consumer, NULL);
+
+	if(pushed != ring.queued + ring.coalesced + ring.dropped) fail("pushed != queued + coalesced + dropped");
+	if(popped != ring.queued) fail("popped != queued");
+	if(pushed != (uint32_t)producers * messages) fail("lost push");
+
+	printf("producers %d, capacity %u\n", producers, capacity);
+	printf("pushed %u, queued %u, coalesced %u, dropped %u, high water %u\n", pushed, ring.queued, ring.coalesced, ring.dropped, ring.high_water);
+	printf("%s\n", failures ? "FAILED" : "OK");
+
+	message_ring_free(&ring);
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,153 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file retry_sim.c
+@brief Simulação em host das tentativas de associação de uma frota após a reinicialização do roteador
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+/*
+ * Compilação e execução no host (nenhuma dependência do esp-idf):
+ *
+ *   cc -O2 -I../src -o retry_sim retry_sim.c ../src/retry_policy.c
+ *   ./retry_sim [devices] [reboot_s] [capacity_per_s] [duration_s]
+ *
+ * Todos os dispositivos perdem a conexão em t=0 porque o roteador reiniciou. O roteador volta em reboot_s e
+ * aceita no máximo capacity_per_s associações por segundo: as tentativas além disso falham, como em um AP
+ * sobrecarregado. O programa imprime, por segundo, o número de tentativas de associação e de dispositivos
+ * conectados para a política fixa e para o recuo exponencial com jitter completo.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "retry_policy.h"
+
+/* valores padrão do menuconfig */
+#define RETRY_TIMER_MS			5000
+#define RETRY_BACKOFF_CAP_MS	300000
+
+/* tempo que o driver leva para declarar uma tentativa fracassada (varredura + autenticação) */
+#define ATTEMPT_FAIL_MS			3000
+
+/* passo da simulação */
+#define TICK_MS					10
+
+typedef enum { POLICY_FIXED = 0, POLICY_BACKOFF = 1 } policy_t;
+
+struct device_t{
+	int64_t next_attempt_ms;
+	uint32_t attempt;
+	int connected;
+};
+
+static uint32_t xorshift_state = 2463534242UL;
+static uint32_t xorshift32(){
+	uint32_t x = xorshift_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return xorshift_state = x;
+}
+
+static uint32_t next_delay(policy_t policy, uint32_t attempt){
+	if(policy == POLICY_BACKOFF){
+		return retry_policy_backoff_full_jitter(attempt, RETRY_TIMER_MS, RETRY_BACKOFF_CAP_MS, xorshift32());
+	}
+	return RETRY_TIMER_MS;
+}
+
+static void simulate(policy_t policy, int devices, int reboot_s, int capacity, int duration_s){
+
+	struct device_t *dev = calloc(devices, sizeof(struct device_t));
+	uint32_t *attempts = calloc(duration_s, sizeof(uint32_t));
+	uint32_t *online = calloc(duration_s, sizeof(uint32_t));
+	uint32_t peak = 0, total = 0;
+	int all_online_s = -1;
+	int connected = 0;
+
+	xorshift_state = 2463534242UL;
+
+	/* todos os dispositivos detectam a perda da conexão e armam o temporizador de nova tentativa */
+	for(int i=0; i<devices; i++){
+		dev[i].next_attempt_ms = next_delay(policy, 0);
+		dev[i].attempt = 1;
+	}
+
+	for(int s=0; s<duration_s; s++){
+		int accepted = 0;
+		for(int64_t t = (int64_t)s * 1000; t < (int64_t)(s + 1) * 1000; t += TICK_MS){
+			for(int i=0; i<devices; i++){
+				if(dev[i].connected || dev[i].next_attempt_ms > t) continue;
+
+				attempts[s]++;
+				if(t >= (int64_t)reboot_s * 1000 && accepted < capacity){
+					accepted++;
+					dev[i].connected = 1;
+					connected++;
+				}
+				else{
+					/* a falha é detectada após ATTEMPT_FAIL_MS e só então o temporizador é armado */
+					dev[i].next_attempt_ms = t + ATTEMPT_FAIL_MS + next_delay(policy, dev[i].attempt);
+					dev[i].attempt++;
+				}
+			}
+		}
+		online[s] = connected;
+		total += attempts[s];
+		if(attempts[s] > peak) peak = attempts[s];
+		if(connected == devices && all_online_s < 0) all_online_s = s + 1;
+	}
+
+	printf("\n== %s: %d devices, router back at %d s, %d associations/s ==\n", policy == POLICY_BACKOFF ? "exponential backoff + full jitter" : "fixed delay", devices, reboot_s, capacity);
+	printf("  second  attempts/s  online\n");
+	for(int s=0; s<duration_s; s++){
+		if(s < reboot_s + 60 || s % 10 == 0){
+			printf("  %6d  %10u  %6u\n", s, attempts[s], online[s]);
+		}
+	}
+	printf("  peak attempts/s: %u, total attempts: %u, all online after: %d s\n", peak, total, all_online_s);
+
+	free(dev);
+	free(attempts);
+	free(online);
+}
+
+int main(int argc, char **argv){
+
+	int devices = argc > 1 ? atoi(argv[1]) : 500;
+	int reboot_s = argc > 2 ? atoi(argv[2]) : 60;
+	int capacity = argc > 3 ? atoi(argv[3]) : 20;
+	int duration_s = argc > 4 ? atoi(argv[4]) : 600;
+
+	if(devices <= 0 || reboot_s < 0 || capacity <= 0 || duration_s <= 0){
+		fprintf(stderr, "usage: %s [devices] [reboot_s] [capacity_per_s] [duration_s]\n", argv[0]);
+		return 1;
+	}
+
+	simulate(POLICY_FIXED, devices, reboot_s, capacity, duration_s);
+	simulate(POLICY_BACKOFF, devices, reboot_s, capacity, duration_s);
+
+	return 0;
+}
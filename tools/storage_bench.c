@@ -0,0 +1,279 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file storage_bench.c
+@brief Custo da persistência no host, por política de gravação e por armazenamento
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+/*
+ * Compilação e execução no host (nenhuma dependência do esp-idf):
+ *
+ *   cc -O2 -I../src -I. -o storage_bench storage_bench.c storage_file.c ../src/storage_ram.c ../src/config_record.c
+ *   ./storage_bench [ram|file] [bursts] [commit_latency_us] [fail_permille] [byte_latency_ns]
+ *
+ * Cada rajada é o que o wifi_manager grava ao obter um IP: o registro de configuração (o histórico da rede salva mudou),
+ * o cache de BSSID/canal e, de vez em quando, o aluguel DHCP. As mesmas rajadas são gravadas com três políticas:
+ *  - sync:    um commit por chave, no momento da mudança (antes do nvs_writer);
+ *  - batch-1: um commit por rajada com todas as chaves pendentes;
+ *  - batch-4: um commit a cada 4 rajadas, como o agrupamento do nvs_writer quando as mudanças chegam juntas.
+ * Um commit que falha deixa as chaves pendentes para o próximo, como no nvs_writer. No fim, o programa lê as
+ * chaves de volta e verifica que são as últimas gravadas. Retorna 0 se todas as verificações passarem.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "config_record.h"
+#include "storage.h"
+#include "storage_file.h"
+
+#define KEY_COUNT			3
+#define SAVED_NETWORKS		4
+#define FINAL_RETRIES		32
+
+static const char *keys[KEY_COUNT] = { "config", "sta_cache", "sta_lease" };
+
+struct pending_t{
+	uint8_t data[CONFIG_RECORD_MAX_SIZE];
+	size_t len;
+	bool dirty;
+};
+
+struct result_t{
+	uint32_t commits;
+	uint32_t failed;
+	uint64_t bytes;
+	double wall_ms;
+	double simulated_ms;
+	bool verified;
+};
+
+
+static double now_ms(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief Os valores da rajada n.
+ */
+static void make_burst(int n, struct pending_t values[KEY_COUNT]){
+
+	struct config_record_t record;
+	memset(&record, 0x00, sizeof(record));
+	strcpy((char*)record.sta_ssid, "bench-network");
+	strcpy((char*)record.sta_password, "bench-password");
+	strcpy((char*)record.ap_ssid, "esp32");
+	strcpy((char*)record.ap_pwd, "esp32pwd");
+	record.ap_channel = 1;
+	record.profile_count = SAVED_NETWORKS;
+	for(int i=0; i<SAVED_NETWORKS; i++){
+		snprintf((char*)record.profiles[i].ssid, CONFIG_RECORD_SSID_SIZE, "network-%d", i);
+		strcpy((char*)record.profiles[i].password, "password");
+		record.profiles[i].last_success = (i == 0) ? 1600000000 + n * 300 : 1600000000;
+		record.profiles[i].avg_latency_ms = (uint16_t)(800 + (n % 7) * 10);
+	}
+	values[0].len = config_record_encode(&record, values[0].data, sizeof(values[0].data));
+	values[0].dirty = true;
+
+	/* BSSID/canal: o AP muda de canal de vez em quando */
+	memset(values[1].data, 0x00, 48);
+	values[1].data[38] = (uint8_t)(1 + (n / 5) % 11);
+	values[1].len = 48;
+	values[1].dirty = (n % 5) == 0;
+
+	/* aluguel DHCP: renovado a cada 10 rajadas */
+	memset(values[2].data, 0x00, 64);
+	memcpy(values[2].data, &n, sizeof(n));
+	values[2].len = 64;
+	values[2].dirty = (n % 10) == 0;
+}
+
+/**
+ * @brief Grava as chaves pendentes. sync: uma chamada por chave; caso contrário, uma única chamada.
+ */
+static void commit(struct storage_backend_t *backend, struct pending_t pending[KEY_COUNT], bool sync, struct result_t *r){
+
+	struct storage_item_t items[KEY_COUNT];
+	int idx[KEY_COUNT];
+	int count = 0;
+
+	for(int k=0; k<KEY_COUNT; k++){
+		if(!pending[k].dirty) continue;
+		items[count].key = keys[k];
+		items[count].data = pending[k].data;
+		items[count].len = pending[k].len;
+		idx[count++] = k;
+	}
+	if(count == 0) return;
+
+	if(sync){
+		for(int i=0; i<count; i++){
+			r->commits++;
+			if(backend->write(backend->ctx, &items[i], 1) == STORAGE_OK){
+				pending[idx[i]].dirty = false;
+				r->bytes += items[i].len;
+			}
+			else{
+				r->failed++;
+			}
+		}
+	}
+	else{
+		r->commits++;
+		if(backend->write(backend->ctx, items, count) == STORAGE_OK){
+			for(int i=0; i<count; i++){
+				pending[idx[i]].dirty = false;
+				r->bytes += items[i].len;
+			}
+		}
+		else{
+			/* gravação parcial possível: tudo continua pendente e é regravado */
+			r->failed++;
+		}
+	}
+}
+
+static bool verify(struct storage_backend_t *backend, const struct pending_t last[KEY_COUNT]){
+
+	uint8_t buf[CONFIG_RECORD_MAX_SIZE];
+	struct config_record_t record;
+
+	for(int k=0; k<KEY_COUNT; k++){
+		size_t len = sizeof(buf);
+		if(last[k].len == 0) continue;
+		if(backend->read(backend->ctx, keys[k], buf, &len) != STORAGE_OK) return false;
+		if(len != last[k].len || memcmp(buf, last[k].data, len) != 0) return false;
+	}
+
+	size_t len = sizeof(buf);
+	backend->read(backend->ctx, keys[0], buf, &len);
+	return config_record_decode(buf, len, &record) == CONFIG_RECORD_OK;
+}
+
+static bool run(const char *kind, int bursts, int batch, const struct storage_file_faults_t *faults, struct result_t *r){
+
+	struct storage_backend_t backend;
+	struct pending_t pending[KEY_COUNT], values[KEY_COUNT], last[KEY_COUNT];
+	char dir[] = "/tmp/storage_bench.XXXXXX";
+
+	memset(r, 0x00, sizeof(struct result_t));
+	memset(pending, 0x00, sizeof(pending));
+	memset(last, 0x00, sizeof(last));
+
+	if(strcmp(kind, "file") == 0){
+		if(mkdtemp(dir) == NULL || storage_file_create(&backend, dir, faults) != STORAGE_OK) return false;
+	}
+	else if(storage_ram_create(&backend) != STORAGE_OK){
+		return false;
+	}
+
+	double start = now_ms();
+	for(int n=0; n<bursts; n++){
+		make_burst(n, values);
+		for(int k=0; k<KEY_COUNT; k++){
+			if(!values[k].dirty) continue;
+			pending[k] = values[k];
+			last[k] = values[k];
+		}
+		if(batch == 0){
+			commit(&backend, pending, true, r);
+		}
+		else if((n + 1) % batch == 0){
+			commit(&backend, pending, false, r);
+		}
+	}
+
+	/* flush final, com novas tentativas se uma falha foi injetada */
+	for(int i=0; i<FINAL_RETRIES; i++){
+		bool dirty = false;
+		for(int k=0; k<KEY_COUNT; k++) dirty |= pending[k].dirty;
+		if(!dirty) break;
+		commit(&backend, pending, batch == 0, r);
+	}
+	r->wall_ms = now_ms() - start;
+
+	if(strcmp(kind, "file") == 0){
+		struct storage_file_stats_t stats;
+		storage_file_get_stats(&backend, &stats);
+		r->simulated_ms = stats.simulated_us / 1000.0;
+	}
+
+	r->verified = verify(&backend, last);
+
+	for(int k=0; k<KEY_COUNT; k++){
+		backend.erase(backend.ctx, keys[k]);
+	}
+	backend.destroy(backend.ctx);
+	if(strcmp(kind, "file") == 0){
+		rmdir(dir);
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv){
+
+	const char *kind = argc > 1 ? argv[1] : "file";
+	int bursts = argc > 2 ? atoi(argv[2]) : 200;
+	struct storage_file_faults_t faults;
+	memset(&faults, 0x00, sizeof(faults));
+	faults.commit_latency_us = argc > 3 ? (uint32_t)atoi(argv[3]) : 200;
+	faults.fail_permille = argc > 4 ? (uint32_t)atoi(argv[4]) : 0;
+	faults.byte_latency_ns = argc > 5 ? (uint32_t)atoi(argv[5]) : 0;
+	faults.read_latency_us = 0;
+	faults.seed = 12345;
+
+	static const struct { const char *name; int batch; } policies[] = {
+		{ "sync", 0 }, { "batch-1", 1 }, { "batch-4", 4 }
+	};
+
+	if(strcmp(kind, "file") != 0 && strcmp(kind, "ram") != 0){
+		fprintf(stderr, "usage: %s [ram|file] [bursts] [commit_latency_us] [fail_permille] [byte_latency_ns]\n", argv[0]);
+		return 2;
+	}
+
+	printf("backend=%s bursts=%d commit_latency=%u us fail=%u/1000 byte_latency=%u ns\n", kind, bursts,
+			faults.commit_latency_us, faults.fail_permille, faults.byte_latency_ns);
+	printf("%-8s %8s %8s %10s %10s %10s %s\n", "policy", "commits", "failed", "bytes", "wall_ms", "sim_ms", "verify");
+
+	int failures = 0;
+	for(size_t i=0; i<sizeof(policies)/sizeof(policies[0]); i++){
+		struct result_t r;
+		if(!run(kind, bursts, policies[i].batch, &faults, &r)){
+			fprintf(stderr, "could not create the %s backend\n", kind);
+			return 2;
+		}
+		printf("%-8s %8u %8u %10llu %10.1f %10.1f %s\n", policies[i].name, r.commits, r.failed, (unsigned long long)r.bytes,
+				r.wall_ms, r.simulated_ms, r.verified ? "ok" : "FAIL");
+		if(!r.verified) failures++;
+	}
+
+	return failures ? 1 : 0;
+}
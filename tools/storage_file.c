@@ -0,0 +1,183 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file storage_file.c
+@brief Armazenamento em arquivos no host, com latência e falhas injetadas
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include "storage_file.h"
+
+
+struct storage_file_t{
+	char dir[256];
+	struct storage_file_faults_t faults;
+	struct storage_file_stats_t stats;
+	uint32_t rand_state;
+};
+
+
+/* xorshift32: uma sequência de falhas reproduzível a partir da semente */
+static uint32_t storage_file_rand(struct storage_file_t *f){
+	uint32_t x = f->rand_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	f->rand_state = x;
+	return x;
+}
+
+static void storage_file_delay(struct storage_file_t *f, uint64_t us){
+	if(us == 0) return;
+	f->stats.simulated_us += us;
+	usleep((useconds_t)us);
+}
+
+static void storage_file_path(const struct storage_file_t *f, const char *key, const char *suffix, char *path, size_t len){
+	snprintf(path, len, "%s/%s%s", f->dir, key, suffix);
+}
+
+static storage_err_t storage_file_read(void *ctx, const char *key, void *out, size_t *len){
+
+	struct storage_file_t *f = (struct storage_file_t*)ctx;
+	char path[300];
+
+	f->stats.reads++;
+	storage_file_delay(f, f->faults.read_latency_us);
+
+	storage_file_path(f, key, "", path, sizeof(path));
+	FILE *fp = fopen(path, "rb");
+	if(fp == NULL) return STORAGE_ERR_NOT_FOUND;
+
+	fseek(fp, 0, SEEK_END);
+	size_t sz = (size_t)ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	storage_err_t err = STORAGE_OK;
+	if(out != NULL){
+		if(*len < sz){
+			err = STORAGE_ERR_TOO_SMALL;
+		}
+		else if(fread(out, 1, sz, fp) != sz){
+			err = STORAGE_ERR_IO;
+		}
+	}
+	*len = sz;
+	fclose(fp);
+
+	return err;
+}
+
+static storage_err_t storage_file_write(void *ctx, const struct storage_item_t *items, size_t count){
+
+	struct storage_file_t *f = (struct storage_file_t*)ctx;
+	char path[300], tmp[300];
+	uint64_t bytes = 0;
+
+	f->stats.writes++;
+
+	for(size_t i=0; i<count; i++){
+		if(items[i].key == NULL || strlen(items[i].key) >= STORAGE_KEY_SIZE) return STORAGE_ERR_INVALID_ARG;
+
+		storage_file_path(f, items[i].key, ".tmp", tmp, sizeof(tmp));
+		FILE *fp = fopen(tmp, "wb");
+		if(fp == NULL) return STORAGE_ERR_IO;
+		size_t written = fwrite(items[i].data, 1, items[i].len, fp);
+		fclose(fp);
+		if(written != items[i].len) return STORAGE_ERR_IO;
+		bytes += items[i].len;
+	}
+
+	storage_file_delay(f, f->faults.commit_latency_us + (bytes * f->faults.byte_latency_ns) / 1000);
+
+	/* falha injetada: apenas as chaves antes do ponto sorteado são aplicadas */
+	size_t applied = count;
+	bool fail = f->faults.fail_permille && (storage_file_rand(f) % 1000) < f->faults.fail_permille;
+	if(fail){
+		applied = storage_file_rand(f) % (count + 1);
+	}
+
+	for(size_t i=0; i<count; i++){
+		storage_file_path(f, items[i].key, ".tmp", tmp, sizeof(tmp));
+		if(i < applied){
+			storage_file_path(f, items[i].key, "", path, sizeof(path));
+			if(rename(tmp, path) != 0) fail = true;
+			else f->stats.bytes_written += items[i].len;
+		}
+		else{
+			remove(tmp);
+		}
+	}
+
+	if(fail){
+		f->stats.failed_writes++;
+		return STORAGE_ERR_IO;
+	}
+
+	return STORAGE_OK;
+}
+
+static storage_err_t storage_file_erase(void *ctx, const char *key){
+
+	struct storage_file_t *f = (struct storage_file_t*)ctx;
+	char path[300];
+
+	storage_file_path(f, key, "", path, sizeof(path));
+	remove(path);
+
+	return STORAGE_OK;
+}
+
+static void storage_file_destroy(void *ctx){
+	free(ctx);
+}
+
+storage_err_t storage_file_create(struct storage_backend_t *backend, const char *dir, const struct storage_file_faults_t *faults){
+
+	if(dir == NULL || strlen(dir) >= sizeof(((struct storage_file_t*)0)->dir)) return STORAGE_ERR_INVALID_ARG;
+
+	struct storage_file_t *f = (struct storage_file_t*)calloc(1, sizeof(struct storage_file_t));
+	if(f == NULL) return STORAGE_ERR_NO_MEM;
+
+	strcpy(f->dir, dir);
+	if(faults) f->faults = *faults;
+	f->rand_state = f->faults.seed ? f->faults.seed : 1;
+
+	backend->name = "file";
+	backend->read = storage_file_read;
+	backend->write = storage_file_write;
+	backend->erase = storage_file_erase;
+	backend->destroy = storage_file_destroy;
+	backend->ctx = f;
+
+	return STORAGE_OK;
+}
+
+void storage_file_get_stats(const struct storage_backend_t *backend, struct storage_file_stats_t *stats){
+	*stats = ((const struct storage_file_t*)backend->ctx)->stats;
+}
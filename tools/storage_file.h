@@ -0,0 +1,75 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file storage_file.h
+@brief Armazenamento em arquivos no host, com latência e falhas injetadas
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+
+#ifndef WIFI_MANAGER_STORAGE_FILE_H_INCLUDED
+#define WIFI_MANAGER_STORAGE_FILE_H_INCLUDED
+
+#include <stdint.h>
+#include "storage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Custos e falhas simulados. Tudo zerado: um sistema de arquivos comum, sem falhas.
+ */
+struct storage_file_faults_t{
+	uint32_t read_latency_us;		/* por leitura */
+	uint32_t commit_latency_us;		/* por chamada a write: o custo fixo de um commit NVS */
+	uint32_t byte_latency_ns;		/* por byte gravado: a velocidade de gravação do flash */
+	uint32_t fail_permille;			/* chance de falha de cada write, em milésimos */
+	uint32_t seed;					/* semente das falhas, para repetir uma execução */
+};
+
+struct storage_file_stats_t{
+	uint32_t reads;
+	uint32_t writes;				/* chamadas a write, com ou sem falha */
+	uint32_t failed_writes;
+	uint64_t bytes_written;
+	uint64_t simulated_us;			/* soma das latências injetadas */
+};
+
+
+/**
+ * @brief Cada chave é um arquivo em dir, que deve existir.
+ * Um write grava todos os arquivos temporários e depois os renomeia; uma falha injetada interrompe os renomeios
+ * em um ponto aleatório, como um commit NVS interrompido: algumas chaves ficam com o valor novo, outras com o antigo.
+ */
+storage_err_t storage_file_create(struct storage_backend_t *backend, const char *dir, const struct storage_file_faults_t *faults);
+
+void storage_file_get_stats(const struct storage_backend_t *backend, struct storage_file_stats_t *stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_STORAGE_FILE_H_INCLUDED */
@@ -0,0 +1,413 @@
+/**
+Copyright (c) 2020 Tony Pottier
+
+A permissão é concedida, gratuitamente, a qualquer pessoa que obtenha uma cópia
+deste software e arquivos de documentação associados (o "Software"), para lidar
+no Software sem restrição, incluindo, sem limitação, os direitos
+para usar, copiar, modificar, mesclar, publicar, distribuir, sublicenciar e / ou vender
+cópias do Software, e para permitir que as pessoas a quem o Software é
+fornecido para fazê-lo, sujeito às seguintes condições:
+
+O aviso de direitos autorais acima e este aviso de permissão devem ser incluídos em todos
+cópias ou partes substanciais do Software.
+
+O SOFTWARE É FORNECIDO "COMO ESTÁ", SEM GARANTIA DE QUALQUER TIPO, EXPRESSA OU
+IMPLÍCITA, INCLUINDO, MAS NÃO SE LIMITANDO ÀS GARANTIAS DE COMERCIALIZAÇÃO,
+ADEQUAÇÃO A UMA FINALIDADE ESPECÍFICA E NÃO VIOLAÇÃO. EM NENHUMA HIPÓTESE O
+AUTORES OU TITULARES DE DIREITOS AUTORAIS SÃO RESPONSÁVEIS POR QUALQUER RECLAMAÇÃO, DANOS OU OUTROS
+RESPONSABILIDADE, SEJA EM AÇÃO DE CONTRATO, DELITO OU DE OUTRA FORMA, DECORRENTE DE,
+FORA DE OU EM CONEXÃO COM O SOFTWARE OU O USO OU OUTRAS NEGOCIAÇÕES NO
+PROGRAMAS.
+
+@file trace_replay.c
+@brief Reprodução no host de um trace de mensagens do wifi_manager pela máquina de estados atual, com tempo virtual
+
+@see https://idyl.io
+@see https://github.com/tonyp7/esp32-wifi-manager
+*/
+
+/*
+ * Compilação e execução no host (nenhuma dependência do esp-idf):
+ *
+ *   cc -O2 -I../src -o trace_replay trace_replay.c ../src/msg_trace.c ../src/record_ring.c ../src/conn_fsm.c ../src/disconnect_reason.c
+ *   curl -o trace.bin http://192.168.4.1/trace.bin
+ *   ./trace_replay [-v] [--retry-ms N] [--max-retries N] [--saved N] [--max-recovery-ms N] [--max-attempts N] trace.bin
+ *
+ * As mensagens são reproduzidas na ordem gravada, com o relógio virtual avançando até o instante de cada uma
+ * (sem esperar), e cada uma é entregue a conn_fsm_dispatch, como no firmware. As operações da máquina não agem:
+ * cada mensagem postada e cada temporizador armado vira uma decisão esperada, com o instante em que a máquina atual
+ * a tomaria (o temporizador usa --retry-ms, a política fixa). As ordens geradas pelo próprio gerenciador
+ * (CONNECT_STA automática ou de restauração, START_WIFI_SCAN, START_AP) são comparadas com essas decisões: uma ordem
+ * gravada que a máquina não decidiu, ou uma decisão que não aparece no trace, é impressa como divergência.
+ *
+ * O trace não guarda o número de redes salvas (--saved, 1 por padrão) nem a rede escolhida por uma varredura de
+ * seleção: a máquina recebe "rede escolhida" quando a varredura encontrou algum ponto de acesso.
+ *
+ * O programa reconstrói as quedas de conexão: do primeiro EVENT_STA_DISCONNECTED com a STA conectada até o
+ * EVENT_STA_GOT_IP seguinte, com o número de tentativas e os códigos de razão. Para cada queda são impressos a
+ * recuperação gravada e a recuperação que a máquina atual produziria: a gravada corrigida pela diferença entre os
+ * instantes decididos pela máquina e os gravados. Com -v, imprime a linha do tempo completa, com o estado da máquina.
+ * Retorna 1 se a recuperação da máquina atual passar de --max-recovery-ms ou uma queda passar de --max-attempts,
+ * para uso em testes de regressão.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "msg_trace.h"
+#include "conn_fsm.h"
+#include "disconnect_reason.h"
+#include "message_codes.h"
+
+/* bits do grupo de eventos, como em wifi_manager.c */
+#define BIT_CONNECTED						( 1 << 0 )
+#define BIT_AP_STARTED						( 1 << 2 )
+#define BIT_REQUEST_STA_CONNECT				( 1 << 3 )
+#define BIT_DISCONNECTED					( 1 << 4 )
+#define BIT_REQUEST_RESTORE_STA				( 1 << 5 )
+#define BIT_SCAN							( 1 << 7 )
+#define BIT_REQUEST_DISCONNECT				( 1 << 8 )
+
+#define MAX_OUTAGES							1024
+#define MAX_DECISIONS						16
+
+/* valores padrão do menuconfig */
+#define RETRY_TIMER_MS						5000
+#define MAX_RETRY_START_AP					3
+
+static const char *code_names[WM_MESSAGE_CODE_COUNT] = {
+	"NONE", "START_HTTP_SERVER", "STOP_HTTP_SERVER", "START_DNS_SERVICE", "STOP_DNS_SERVICE",
+	"START_WIFI_SCAN", "LOAD_AND_RESTORE_STA", "CONNECT_STA", "DISCONNECT_STA", "START_AP",
+	"EVENT_STA_DISCONNECTED", "EVENT_SCAN_DONE", "EVENT_STA_GOT_IP", "STOP_AP", "EVENT_STA_LEASE_EXPIRED"
+};
+
+static const char *origin_names[] = { "-", "user", "auto", "restore" };
+
+static const char *action_names[] = { "retry", "backoff", "rescan", "start_ap" };
+
+struct outage_t{
+	uint32_t start_ms;
+	uint32_t end_ms;			/* 0 enquanto não recuperada */
+	uint32_t attempts;
+	uint32_t scans;
+	bool ap_started;
+	uint8_t last_reason;
+	int64_t drift_ms;			/* instantes decididos pela máquina menos os gravados, somados */
+	uint32_t divergences;
+};
+
+/**
+ * @brief Uma mensagem que a máquina postou ou um temporizador que ela armou, à espera da ordem gravada correspondente.
+ */
+struct decision_t{
+	uint8_t code;
+	uint32_t param;
+	uint32_t due_ms;			/* instante em que a máquina atual poria a mensagem na fila */
+	bool timer;
+};
+
+struct replay_t{
+	bool verbose;
+	uint32_t clock_ms;			/* relógio virtual */
+	uint32_t count;
+	uint32_t per_code[WM_MESSAGE_CODE_COUNT];
+	uint32_t max_pending;
+	uint32_t first_ip_ms;
+	bool connected;
+	struct outage_t outages[MAX_OUTAGES];
+	int outage_count;
+	struct outage_t *open;		/* queda em andamento */
+
+	/* máquina de estados atual */
+	struct conn_fsm_t fsm;
+	uint32_t retry_ms;
+	uint8_t saved_networks;
+	struct decision_t decisions[MAX_DECISIONS];
+	int decision_count;
+	uint32_t divergences;
+};
+
+
+static const char* code_name(uint8_t code){
+	return code < WM_MESSAGE_CODE_COUNT ? code_names[code] : "?";
+}
+
+static void replay_decide(struct replay_t *rp, uint8_t code, uint32_t param, uint32_t due_ms, bool timer){
+	if(rp->decision_count == MAX_DECISIONS){
+		/* a máquina decidiu mais do que o trace mostra: a mais antiga é descartada como divergência */
+		printf("%10u ms  ! FSM posted %s, not in the trace\n", rp->clock_ms, code_name(rp->decisions[0].code));
+		rp->divergences++;
+		if(rp->open) rp->open->divergences++;
+		memmove(&rp->decisions[0], &rp->decisions[1], (MAX_DECISIONS - 1) * sizeof(struct decision_t));
+		rp->decision_count--;
+	}
+	rp->decisions[rp->decision_count++] = (struct decision_t){ code, param, due_ms, timer };
+}
+
+static bool op_connect(void *ctx, uint8_t origin, bool use_hint){
+	/* a associação em si não é reproduzida: o resultado vem do trace */
+	(void)ctx;
+	(void)origin;
+	return use_hint;
+}
+
+static void op_post(void *ctx, uint8_t code, uint32_t param){
+	struct replay_t *rp = (struct replay_t*)ctx;
+	replay_decide(rp, code, param, rp->clock_ms, false);
+}
+
+static void op_arm_retry(void *ctx, uint32_t attempt){
+	struct replay_t *rp = (struct replay_t*)ctx;
+	(void)attempt;
+	replay_decide(rp, WM_ORDER_CONNECT_STA, CONNECTION_REQUEST_AUTO_RECONNECT, rp->clock_ms + rp->retry_ms, true);
+}
+
+static void op_cancel_retry(void *ctx){
+	struct replay_t *rp = (struct replay_t*)ctx;
+	for(int i=0; i<rp->decision_count; i++){
+		if(rp->decisions[i].timer){
+			memmove(&rp->decisions[i], &rp->decisions[i + 1], (size_t)(rp->decision_count - i - 1) * sizeof(struct decision_t));
+			rp->decision_count--;
+			break;
+		}
+	}
+}
+
+static const struct conn_fsm_ops_t replay_ops = {
+	.connect = op_connect,
+	.post = op_post,
+	.arm_retry = op_arm_retry,
+	.cancel_retry = op_cancel_retry,
+};
+
+/**
+ * @brief Ordens que o próprio gerenciador põe na fila, a partir das decisões da máquina.
+ */
+static bool replay_is_decision(const struct msg_trace_record_t *r){
+	switch(r->code){
+	case WM_ORDER_CONNECT_STA:
+		return r->param != CONNECTION_REQUEST_USER;
+	case WM_ORDER_START_WIFI_SCAN:
+	case WM_ORDER_START_AP:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ * @brief Procura a decisão da máquina que corresponde a uma ordem gravada.
+ */
+static void replay_match(struct replay_t *rp, const struct msg_trace_record_t *r){
+
+	for(int i=0; i<rp->decision_count; i++){
+		const struct decision_t *d = &rp->decisions[i];
+		if(d->code != r->code) continue;
+
+		int64_t drift = (int64_t)d->due_ms - (int64_t)rp->clock_ms;
+		if(rp->open) rp->open->drift_ms += drift;
+		if(rp->verbose && d->timer) printf("%10u ms    FSM retry due at %u ms (%+lld ms)\n", rp->clock_ms, d->due_ms, (long long)drift);
+
+		memmove(&rp->decisions[i], &rp->decisions[i + 1], (size_t)(rp->decision_count - i - 1) * sizeof(struct decision_t));
+		rp->decision_count--;
+		return;
+	}
+
+	/* uma varredura também é pedida pelas páginas do portal: só as outras ordens divergem */
+	if(r->code == WM_ORDER_START_WIFI_SCAN) return;
+
+	printf("%10u ms  ! trace has %s, the FSM did not decide it\n", rp->clock_ms, code_name(r->code));
+	rp->divergences++;
+	if(rp->open) rp->open->divergences++;
+}
+
+/**
+ * @brief Um novo evento da STA chegou: as mensagens postadas pela máquina antes dele e ainda não vistas não aconteceram.
+ */
+static void replay_flush(struct replay_t *rp){
+
+	int kept = 0;
+
+	for(int i=0; i<rp->decision_count; i++){
+		const struct decision_t *d = &rp->decisions[i];
+		if(d->timer && d->due_ms > rp->clock_ms){
+			rp->decisions[kept++] = *d;
+			continue;
+		}
+		printf("%10u ms  ! FSM %s %s at %u ms, not in the trace\n", rp->clock_ms, d->timer ? "retry" : "posted", code_name(d->code), d->due_ms);
+		rp->divergences++;
+		if(rp->open) rp->open->divergences++;
+	}
+	rp->decision_count = kept;
+}
+
+
+static void replay_record(const struct msg_trace_record_t *r, void *arg){
+
+	struct replay_t *rp = (struct replay_t*)arg;
+	const char *name = code_name(r->code);
+	uint32_t param = 0;
+
+	/* o relógio virtual nunca volta: um trace que atravessa a volta de 49 dias continua crescente */
+	if(r->time_ms >= rp->clock_ms || rp->count == 0) rp->clock_ms = r->time_ms;
+	rp->count++;
+	if(r->code < WM_MESSAGE_CODE_COUNT) rp->per_code[r->code]++;
+	if(r->pending > rp->max_pending) rp->max_pending = r->pending;
+
+	if(rp->verbose){
+		printf("%10u ms  %-22s bits:%03x pending:%u", rp->clock_ms, name, r->bits, r->pending);
+		if(r->code == WM_ORDER_CONNECT_STA) printf(" origin:%s", origin_names[r->param & 3]);
+		if(r->code == WM_EVENT_STA_DISCONNECTED){
+			printf(" reason:%u (%s) -> %s", r->arg, disconnect_reason_to_str((uint8_t)r->arg), action_names[disconnect_reason_classify((uint8_t)r->arg)]);
+		}
+		printf("  [%s]\n", conn_fsm_state_to_str(rp->fsm.state));
+	}
+
+	if(r->code == WM_EVENT_STA_DISCONNECTED || r->code == WM_EVENT_STA_GOT_IP){
+		replay_flush(rp);
+	}
+
+	switch(r->code){
+	case WM_EVENT_STA_DISCONNECTED:
+		/* uma queda começa quando a STA estava conectada e o usuário não pediu a desconexão */
+		if((rp->connected || (r->bits & BIT_CONNECTED)) && !(r->bits & BIT_REQUEST_DISCONNECT) && rp->open == NULL && rp->outage_count < MAX_OUTAGES){
+			rp->open = &rp->outages[rp->outage_count++];
+			memset(rp->open, 0x00, sizeof(struct outage_t));
+			rp->open->start_ms = rp->clock_ms;
+		}
+		if(rp->open) rp->open->last_reason = (uint8_t)r->arg;
+		rp->connected = false;
+		param = r->arg;
+		break;
+	case WM_ORDER_CONNECT_STA:
+		if(rp->open) rp->open->attempts++;
+		param = r->param;
+		break;
+	case WM_ORDER_LOAD_AND_RESTORE_STA:
+		param = rp->saved_networks;
+		break;
+	case WM_EVENT_SCAN_DONE:
+		param = r->arg != 0;
+		break;
+	case WM_ORDER_START_WIFI_SCAN:
+		if(rp->open) rp->open->scans++;
+		break;
+	case WM_ORDER_START_AP:
+		if(rp->open) rp->open->ap_started = true;
+		break;
+	case WM_EVENT_STA_GOT_IP:
+		if(rp->first_ip_ms == 0) rp->first_ip_ms = rp->clock_ms ? rp->clock_ms : 1;
+		if(rp->open){
+			rp->open->end_ms = rp->clock_ms ? rp->clock_ms : 1;
+			rp->open = NULL;
+		}
+		rp->connected = true;
+		break;
+	default:
+		break;
+	}
+
+	/* a máquina atual recebe a mensagem como no firmware, depois de comparar a ordem com as decisões dela */
+	if(replay_is_decision(r)) replay_match(rp, r);
+	rp->fsm.ap_started = (r->bits & BIT_AP_STARTED) != 0;
+	rp->fsm.saved_networks = rp->saved_networks;
+	conn_outcome_t outcome = conn_fsm_dispatch(&rp->fsm, r->code, param);
+	if(rp->verbose && outcome != CONN_OUTCOME_NONE && outcome != CONN_OUTCOME_IGNORED){
+		printf("%10u ms    FSM %s -> %s\n", rp->clock_ms, conn_fsm_outcome_to_str(outcome), conn_fsm_state_to_str(rp->fsm.state));
+	}
+}
+
+static int compare_u32(const void *a, const void *b){
+	uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv){
+
+	const char *path = NULL;
+	uint32_t max_recovery_ms = 0, max_attempts = 0, max_retries = MAX_RETRY_START_AP;
+	static struct replay_t rp;
+
+	rp.retry_ms = RETRY_TIMER_MS;
+	rp.saved_networks = 1;
+	for(int i=1; i<argc; i++){
+		if(strcmp(argv[i], "-v") == 0) rp.verbose = true;
+		else if(strcmp(argv[i], "--retry-ms") == 0 && i + 1 < argc) rp.retry_ms = (uint32_t)atoi(argv[++i]);
+		else if(strcmp(argv[i], "--max-retries") == 0 && i + 1 < argc) max_retries = (uint32_t)atoi(argv[++i]);
+		else if(strcmp(argv[i], "--saved") == 0 && i + 1 < argc) rp.saved_networks = (uint8_t)atoi(argv[++i]);
+		else if(strcmp(argv[i], "--max-recovery-ms") == 0 && i + 1 < argc) max_recovery_ms = (uint32_t)atoi(argv[++i]);
+		else if(strcmp(argv[i], "--max-attempts") == 0 && i + 1 < argc) max_attempts = (uint32_t)atoi(argv[++i]);
+		else path = argv[i];
+	}
+	if(path == NULL){
+		fprintf(stderr, "usage: %s [-v] [--retry-ms N] [--max-retries N] [--saved N] [--max-recovery-ms N] [--max-attempts N] trace.bin\n", argv[0]);
+		return 2;
+	}
+
+	FILE *fp = fopen(path, "rb");
+	if(fp == NULL){
+		perror(path);
+		return 2;
+	}
+	conn_fsm_init(&rp.fsm, max_retries > UINT8_MAX ? UINT8_MAX : (uint8_t)max_retries, &replay_ops, &rp);
+
+	fseek(fp, 0, SEEK_END);
+	long sz = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	uint8_t *buf = (uint8_t*)malloc(sz > 0 ? (size_t)sz : 1);
+	size_t len = buf ? fread(buf, 1, (size_t)sz, fp) : 0;
+	fclose(fp);
+
+	uint32_t lost = 0;
+	if(msg_trace_parse(buf, len, &lost, replay_record, &rp) < 0){
+		fprintf(stderr, "%s: not a wifi_manager trace\n", path);
+		free(buf);
+		return 2;
+	}
+	free(buf);
+
+	printf("%u messages, %u lost before the first one, %u ms of virtual time, max queue backlog %u\n", rp.count, lost, rp.clock_ms, rp.max_pending);
+	for(int c=0; c<WM_MESSAGE_CODE_COUNT; c++){
+		if(rp.per_code[c]) printf("  %-22s %u\n", code_names[c], rp.per_code[c]);
+	}
+	if(rp.first_ip_ms){
+		printf("first IP at %u ms\n", rp.first_ip_ms);
+	}
+
+	/* quedas */
+	int failures = 0, recovered = 0;
+	uint32_t durations[MAX_OUTAGES], fsm_durations[MAX_OUTAGES];
+	printf("%d outage(s)\n", rp.outage_count);
+	for(int i=0; i<rp.outage_count; i++){
+		const struct outage_t *o = &rp.outages[i];
+		bool bad = false;
+		if(o->end_ms){
+			uint32_t d = o->end_ms - o->start_ms;
+			int64_t f = (int64_t)d + o->drift_ms;
+			uint32_t fsm_d = f < 0 ? 0 : (uint32_t)f;
+			durations[recovered] = d;
+			fsm_durations[recovered++] = fsm_d;
+			bad = (max_recovery_ms && fsm_d > max_recovery_ms);
+			printf("  #%d at %u ms: recovered in %u ms (current FSM: %u ms)", i, o->start_ms, d, fsm_d);
+		}
+		else{
+			bad = max_recovery_ms != 0;
+			printf("  #%d at %u ms: not recovered", i, o->start_ms);
+		}
+		bad |= (max_attempts && o->attempts > max_attempts);
+		printf(", %u attempt(s), %u scan(s)%s, last reason %u (%s), %u divergence(s)%s\n", o->attempts, o->scans, o->ap_started ? ", AP started" : "",
+				o->last_reason, disconnect_reason_to_str(o->last_reason), o->divergences, bad ? "  <-- REGRESSION" : "");
+		if(bad) failures++;
+	}
+	if(recovered){
+		qsort(durations, recovered, sizeof(uint32_t), compare_u32);
+		qsort(fsm_durations, recovered, sizeof(uint32_t), compare_u32);
+		printf("recovery: median %u ms, max %u ms\n", durations[recovered / 2], durations[recovered - 1]);
+		printf("recovery with the current FSM: median %u ms, max %u ms\n", fsm_durations[recovered / 2], fsm_durations[recovered - 1]);
+	}
+	printf("%u divergence(s) between the recorded orders and the current FSM\n", rp.divergences);
+
+	return failures ? 1 : 0;
+}